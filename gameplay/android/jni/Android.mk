@@ -24,6 +24,7 @@ LOCAL_SRC_FILES := \
     Animation.cpp \
     AnimationClip.cpp \
     AnimationController.cpp \
+    AnimationSampler.cpp \
     AnimationTarget.cpp \
     AnimationValue.cpp \
     AudioBuffer.cpp \
@@ -32,7 +33,9 @@ LOCAL_SRC_FILES := \
     AudioSource.cpp \
     BoundingBox.cpp \
     BoundingSphere.cpp \
+    BoundingVolumeTree.cpp \
     Bundle.cpp \
+    BundleLoader.cpp \
     Button.cpp \
     Camera.cpp \
     CheckBox.cpp \
@@ -71,6 +74,7 @@ LOCAL_SRC_FILES := \
     MeshSkin.cpp \
     Model.cpp \
     Node.cpp \
+    OcclusionCuller.cpp \
     ParticleEmitter.cpp \
     Pass.cpp \
     PhysicsCharacter.cpp \
@@ -104,6 +108,7 @@ LOCAL_SRC_FILES := \
     Script.cpp \
     ScriptController.cpp \
     ScriptTarget.cpp \
+    SkinDeformer.cpp \
     Slider.cpp \
     Sprite.cpp \
     SpriteBatch.cpp \
@@ -20,6 +20,7 @@ SOURCES += src/AbsoluteLayout.cpp \
     src/Animation.cpp \
     src/AnimationClip.cpp \
     src/AnimationController.cpp \
+    src/AnimationSampler.cpp \
     src/AnimationTarget.cpp \
     src/AnimationValue.cpp \
     src/AudioBuffer.cpp \
@@ -30,7 +31,9 @@ SOURCES += src/AbsoluteLayout.cpp \
     src/BoundingBox.inl \
     src/BoundingSphere.cpp \
     src/BoundingSphere.inl \
+    src/BoundingVolumeTree.cpp \
     src/Bundle.cpp \
+    src/BundleLoader.cpp \
     src/Button.cpp \
     src/Camera.cpp \
     src/CheckBox.cpp \
@@ -65,6 +68,7 @@ SOURCES += src/AbsoluteLayout.cpp \
     src/MathUtil.cpp \
     src/MathUtil.inl \
     src/MathUtilNeon.inl \
+    src/MathUtilSSE.inl \
     src/Matrix.cpp \
     src/Matrix.inl \
     src/Mesh.cpp \
@@ -74,6 +78,7 @@ SOURCES += src/AbsoluteLayout.cpp \
     src/MeshSkin.cpp \
     src/Model.cpp \
     src/Node.cpp \
+    src/OcclusionCuller.cpp \
     src/ParticleEmitter.cpp \
     src/Pass.cpp \
     src/PhysicsCharacter.cpp \
@@ -115,6 +120,7 @@ SOURCES += src/AbsoluteLayout.cpp \
     src/ScriptController.cpp \
     src/ScriptController.inl \
     src/ScriptTarget.cpp \
+    src/SkinDeformer.cpp \
     src/Slider.cpp \
     src/Sprite.cpp \
     src/SpriteBatch.cpp \
@@ -281,6 +287,7 @@ HEADERS += src/AbsoluteLayout.h \
     src/Animation.h \
     src/AnimationClip.h \
     src/AnimationController.h \
+    src/AnimationSampler.h \
     src/AnimationTarget.h \
     src/AnimationValue.h \
     src/AudioBuffer.h \
@@ -290,7 +297,9 @@ HEADERS += src/AbsoluteLayout.h \
     src/Base.h \
     src/BoundingBox.h \
     src/BoundingSphere.h \
+    src/BoundingVolumeTree.h \
     src/Bundle.h \
+    src/BundleLoader.h \
     src/Button.h \
     src/Camera.h \
     src/CheckBox.h \
@@ -332,6 +341,7 @@ HEADERS += src/AbsoluteLayout.h \
     src/Model.h \
     src/Mouse.h \
     src/Node.h \
+    src/OcclusionCuller.h \
     src/ParticleEmitter.h \
     src/Pass.h \
     src/PhysicsCharacter.h \
@@ -364,6 +374,7 @@ HEADERS += src/AbsoluteLayout.h \
     src/Script.h \
     src/ScriptController.h \
     src/ScriptTarget.h \
+    src/SkinDeformer.h \
     src/Slider.h \
     src/Sprite.h \
     src/SpriteBatch.h \
@@ -2,6 +2,7 @@
 #include "Animation.h"
 #include "AnimationController.h"
 #include "AnimationClip.h"
+#include "AnimationSampler.h"
 #include "AnimationTarget.h"
 #include "Game.h"
 #include "Transform.h"
@@ -16,7 +17,7 @@ namespace vkcore
 {
 
 Animation::Animation(const char* id, AnimationTarget* target, int propertyId, unsigned int keyCount, unsigned int* keyTimes, float* keyValues, unsigned int type)
-    : _controller(Game::getInstance()->getAnimationController()), _id(id), _duration(0L), _defaultClip(NULL), _clips(NULL)
+    : _controller(Game::getInstance()->getAnimationController()), _id(id), _duration(0L), _defaultClip(NULL), _clips(NULL), _sampler(NULL)
 {
     createChannel(target, propertyId, keyCount, keyTimes, keyValues, type);
 
@@ -26,7 +27,7 @@ Animation::Animation(const char* id, AnimationTarget* target, int propertyId, un
 }
 
 Animation::Animation(const char* id, AnimationTarget* target, int propertyId, unsigned int keyCount, unsigned int* keyTimes, float* keyValues, float* keyInValue, float* keyOutValue, unsigned int type)
-    : _controller(Game::getInstance()->getAnimationController()), _id(id), _duration(0L), _defaultClip(NULL), _clips(NULL)
+    : _controller(Game::getInstance()->getAnimationController()), _id(id), _duration(0L), _defaultClip(NULL), _clips(NULL), _sampler(NULL)
 {
     createChannel(target, propertyId, keyCount, keyTimes, keyValues, keyInValue, keyOutValue, type);
     // Release the animation because a newly created animation has a ref count of 1 and the channels hold the ref to animation.
@@ -35,7 +36,7 @@ Animation::Animation(const char* id, AnimationTarget* target, int propertyId, un
 }
 
 Animation::Animation(const char* id)
-    : _controller(Game::getInstance()->getAnimationController()), _id(id), _duration(0L), _defaultClip(NULL), _clips(NULL)
+    : _controller(Game::getInstance()->getAnimationController()), _id(id), _duration(0L), _defaultClip(NULL), _clips(NULL), _sampler(NULL)
 {
 }
 
@@ -72,6 +73,7 @@ Animation::~Animation()
         _clips->clear();
     }
     SAFE_DELETE(_clips);
+    SAFE_DELETE(_sampler);
 }
 
 Animation::Channel::Channel(Animation* animation, AnimationTarget* target, int propertyId, Curve* curve, unsigned long duration)
@@ -322,38 +324,10 @@ Animation::Channel* Animation::createChannel(AnimationTarget* target, int proper
     unsigned int propertyComponentCount = target->getAnimationPropertyComponentCount(propertyId);
     GP_ASSERT(propertyComponentCount > 0);
 
-    Curve* curve = Curve::create(keyCount, propertyComponentCount);
-    GP_ASSERT(curve);
-    if (target->_targetType == AnimationTarget::TRANSFORM)
-        setTransformRotationOffset(curve, propertyId);
-
-    unsigned int lowest = keyTimes[0];
-    unsigned long duration = keyTimes[keyCount-1] - lowest;
-
-    float* normalizedKeyTimes = new float[keyCount];
-
-    normalizedKeyTimes[0] = 0.0f;
-    curve->setPoint(0, normalizedKeyTimes[0], keyValues, (Curve::InterpolationType) type);
-
-    unsigned int pointOffset = propertyComponentCount;
-    unsigned int i = 1;
-    for (; i < keyCount - 1; i++)
-    {
-        normalizedKeyTimes[i] = (float) (keyTimes[i] - lowest) / (float) duration;
-        curve->setPoint(i, normalizedKeyTimes[i], (keyValues + pointOffset), (Curve::InterpolationType) type);
-        pointOffset += propertyComponentCount;
-    }
-    if (keyCount > 1) {
-        i = keyCount - 1;
-        normalizedKeyTimes[i] = 1.0f;
-        curve->setPoint(i, normalizedKeyTimes[i], keyValues + pointOffset, (Curve::InterpolationType) type);
-    }
-
-    SAFE_DELETE_ARRAY(normalizedKeyTimes);
-
-    Channel* channel = new Channel(this, target, propertyId, curve, duration);
+    unsigned long duration;
+    Curve* curve = createCurve(propertyId, propertyComponentCount, target->_targetType == AnimationTarget::TRANSFORM, keyCount, keyTimes, keyValues, type, &duration);
+    Channel* channel = createChannel(target, propertyId, curve, duration);
     curve->release();
-    addChannel(channel);
     return channel;
 }
 
@@ -399,6 +373,49 @@ Animation::Channel* Animation::createChannel(AnimationTarget* target, int proper
     return channel;
 }
 
+Animation::Channel* Animation::createChannel(AnimationTarget* target, int propertyId, Curve* curve, unsigned long duration)
+{
+    GP_ASSERT(target);
+    GP_ASSERT(curve);
+
+    Channel* channel = new Channel(this, target, propertyId, curve, duration);
+    addChannel(channel);
+    return channel;
+}
+
+Curve* Animation::createCurve(int propertyId, unsigned int componentCount, bool transform, unsigned int keyCount, unsigned int* keyTimes, float* keyValues, unsigned int type, unsigned long* duration)
+{
+    GP_ASSERT(componentCount > 0);
+    GP_ASSERT(keyCount > 0);
+    GP_ASSERT(keyTimes);
+    GP_ASSERT(keyValues);
+    GP_ASSERT(duration);
+
+    Curve* curve = Curve::create(keyCount, componentCount);
+    GP_ASSERT(curve);
+    if (transform)
+        setTransformRotationOffset(curve, propertyId);
+
+    unsigned int lowest = keyTimes[0];
+    *duration = keyTimes[keyCount-1] - lowest;
+
+    curve->setPoint(0, 0.0f, keyValues, (Curve::InterpolationType) type);
+
+    unsigned int pointOffset = componentCount;
+    unsigned int i = 1;
+    for (; i < keyCount - 1; i++)
+    {
+        curve->setPoint(i, (float) (keyTimes[i] - lowest) / (float) *duration, (keyValues + pointOffset), (Curve::InterpolationType) type);
+        pointOffset += componentCount;
+    }
+    if (keyCount > 1) {
+        i = keyCount - 1;
+        curve->setPoint(i, 1.0f, keyValues + pointOffset, (Curve::InterpolationType) type);
+    }
+
+    return curve;
+}
+
 void Animation::addChannel(Channel* channel)
 {
     GP_ASSERT(channel);
@@ -406,6 +423,8 @@ void Animation::addChannel(Channel* channel)
 
     if (channel->_duration > _duration)
         _duration = channel->_duration;
+
+    invalidateSampler();
 }
 
 void Animation::removeChannel(Channel* channel)
@@ -417,6 +436,7 @@ void Animation::removeChannel(Channel* channel)
         if (channel == chan)
         {
             _channels.erase(itr);
+            invalidateSampler();
             return;
         }
         else
@@ -426,6 +446,33 @@ void Animation::removeChannel(Channel* channel)
     }
 }
 
+AnimationSampler* Animation::getSampler()
+{
+    if (_sampler == NULL)
+        _sampler = new AnimationSampler(this);
+
+    return _sampler;
+}
+
+void Animation::invalidateSampler()
+{
+    if (_sampler == NULL)
+        return;
+
+    if (_defaultClip)
+        SAFE_DELETE(_defaultClip->_pose);
+
+    if (_clips)
+    {
+        for (std::vector<AnimationClip*>::iterator itr = _clips->begin(); itr != _clips->end(); ++itr)
+        {
+            SAFE_DELETE((*itr)->_pose);
+        }
+    }
+
+    SAFE_DELETE(_sampler);
+}
+
 void Animation::setTransformRotationOffset(Curve* curve, unsigned int propertyId)
 {
     GP_ASSERT(curve);
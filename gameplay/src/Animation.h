@@ -11,6 +11,7 @@ namespace vkcore
 class AnimationTarget;
 class AnimationController;
 class AnimationClip;
+class AnimationSampler;
 
 /**
  * Defines a generic property animation.
@@ -26,6 +27,7 @@ class Animation : public Ref
 {
     friend class AnimationClip;
     friend class AnimationTarget;
+    friend class AnimationSampler;
     friend class Bundle;
 
 public:
@@ -125,6 +127,8 @@ private:
         friend class AnimationClip;
         friend class Animation;
         friend class AnimationTarget;
+        friend class AnimationSampler;
+        friend class Bundle;
 
     private:
 
@@ -202,6 +206,29 @@ private:
      */
     Channel* createChannel(AnimationTarget* target, int propertyId, unsigned int keyCount, unsigned int* keyTimes, float* keyValues, float* keyInValue, float* keyOutValue, unsigned int type);
 
+    /**
+     * Creates a channel within this animation from a curve built with createCurve.
+     */
+    Channel* createChannel(AnimationTarget* target, int propertyId, Curve* curve, unsigned long duration);
+
+    /**
+     * Creates the curve of a channel from its keys.
+     *
+     * Touches nothing but the new curve, so it may be called from a worker thread.
+     *
+     * @param propertyId The property of the target that the curve animates.
+     * @param componentCount The number of components of the property.
+     * @param transform Whether the target is a Transform, whose rotations are interpolated as quaternions.
+     * @param keyCount The number of keys.
+     * @param keyTimes The times of the keys, in milliseconds.
+     * @param keyValues The values of the keys, componentCount for each key.
+     * @param type The interpolation type of the keys.
+     * @param duration Populated with the duration of the curve, in milliseconds.
+     *
+     * @return The new curve. The caller owns a reference to it.
+     */
+    static Curve* createCurve(int propertyId, unsigned int componentCount, bool transform, unsigned int keyCount, unsigned int* keyTimes, float* keyValues, unsigned int type, unsigned long* duration);
+
     /**
      * Adds a channel to the animation.
      */
@@ -212,10 +239,20 @@ private:
      */
     void removeChannel(Channel* channel);
 
+    /**
+     * Gets the compiled sampler for the channels of this animation, building it if needed.
+     */
+    AnimationSampler* getSampler();
+
+    /**
+     * Discards the compiled sampler and the clip poses built from it, after the channels change.
+     */
+    void invalidateSampler();
+
     /**
      * Sets the rotation offset in a Curve representing a Transform's animation data.
      */
-    void setTransformRotationOffset(Curve* curve, unsigned int propertyId);
+    static void setTransformRotationOffset(Curve* curve, unsigned int propertyId);
 
     /**
      * Clones this animation.
@@ -233,6 +270,7 @@ private:
     std::vector<Channel*> _channels;        // The channels within this Animation.
     AnimationClip* _defaultClip;            // The Animation's default clip.
     std::vector<AnimationClip*>* _clips;    // All the clips created from this Animation.
+    AnimationSampler* _sampler;             // The compiled form of the channels; built on first use.
 
 };
 
@@ -15,7 +15,8 @@ AnimationClip::AnimationClip(const char* id, Animation* animation, unsigned long
     : _id(id), _animation(animation), _startTime(startTime), _endTime(endTime), _duration(_endTime - _startTime), 
       _stateBits(0x00), _repeatCount(1.0f), _loopBlendTime(0), _activeDuration(_duration * _repeatCount), _speed(1.0f), _timeStarted(0), 
       _elapsedTime(0), _crossFadeToClip(NULL), _crossFadeOutElapsed(0), _crossFadeOutDuration(0), _blendWeight(1.0f),
-      _beginListeners(NULL), _endListeners(NULL), _listeners(NULL), _listenerItr(NULL)
+      _pose(NULL), _percentComplete(0.0f), _visible(true), _updateInterval(1), _jointDepth(AnimationController::ALL_JOINTS),
+      _root(NULL), _beginListeners(NULL), _endListeners(NULL), _listeners(NULL), _listenerItr(NULL)
 {
     GP_REGISTER_SCRIPT_EVENTS();
 
@@ -39,6 +40,7 @@ AnimationClip::~AnimationClip()
         valueIter++;
     }
     _values.clear();
+    SAFE_DELETE(_pose);
 
     SAFE_RELEASE(_crossFadeToClip);
     SAFE_DELETE(_beginListeners);
@@ -397,20 +399,17 @@ void AnimationClip::removeEndListener(AnimationClip::Listener* listener)
     }
 }
 
-bool AnimationClip::update(float elapsedTime)
+bool AnimationClip::advance(float elapsedTime)
 {
-    if (isClipStateBitSet(CLIP_IS_PAUSED_BIT))
-    {
-        return false;
-    }
+    GP_ASSERT(!isClipStateBitSet(CLIP_IS_PAUSED_BIT));
 
     if (isClipStateBitSet(CLIP_IS_MARKED_FOR_REMOVAL_BIT))
     {
         // If the marked for removal bit is set, it means stop() was called on the AnimationClip at some point
-        // after the last update call. Reset the flag, and return true so the AnimationClip is removed from the 
+        // after the last update call. Reset the flag, and return false so the AnimationClip is removed from the 
         // running clips on the AnimationController.
         onEnd();
-        return true;
+        return false;
     }
 
     if (!isClipStateBitSet(CLIP_IS_STARTED_BIT))
@@ -498,10 +497,10 @@ bool AnimationClip::update(float elapsedTime)
     // Compute percentage complete for the current loop (prevent a divide by zero if _duration==0).
     // Note that we don't use (currentTime/(_duration+_loopBlendTime)). That's because we want a
     // % value that is outside the 0-1 range for loop smoothing/blending purposes.
-    float percentComplete = _duration == 0 ? 1 : currentTime / (float)_duration;
+    _percentComplete = _duration == 0 ? 1 : currentTime / (float)_duration;
 
     if (_loopBlendTime == 0.0f)
-        percentComplete = MATH_CLAMP(percentComplete, 0.0f, 1.0f);
+        _percentComplete = MATH_CLAMP(_percentComplete, 0.0f, 1.0f);
 
     // If we're cross fading, compute blend weights
     if (isClipStateBitSet(CLIP_IS_FADING_OUT_BIT))
@@ -550,32 +549,72 @@ bool AnimationClip::update(float elapsedTime)
             SAFE_RELEASE(_crossFadeToClip);
         }
     }
-    
-    // Evaluate this clip.
+
+    // Build the sampling state here rather than during evaluation, which may run on a worker thread.
+    AnimationSampler* sampler = _animation->getSampler();
+    GP_ASSERT(sampler);
+    GP_ASSERT(_animation->_controller);
+    if (_pose == NULL)
+        _pose = sampler->createPose(_animation->_controller->_poseCount++);
+
+    // Decide the level of detail to evaluate this clip at.
+    _visible = _animation->_controller->getLOD(sampler->getLODNode(), &_updateInterval, &_jointDepth);
+    _root = sampler->getRoot();
+
+    return true;
+}
+
+void AnimationClip::evaluate()
+{
     Animation::Channel* channel = NULL;
     AnimationValue* value = NULL;
     AnimationTarget* target = NULL;
-    size_t channelCount = _animation->_channels.size();
+    float percentComplete = _percentComplete;
     float percentageStart = (float)_startTime / (float)_animation->_duration;
     float percentageEnd = (float)_endTime / (float)_animation->_duration;
     float percentageBlend = (float)_loopBlendTime / (float)_animation->_duration;
-    for (size_t i = 0; i < channelCount; i++)
-    {
-        channel = _animation->_channels[i];
-        GP_ASSERT(channel);
-        target = channel->_target;
-        GP_ASSERT(target);
-        value = _values[i];
-        GP_ASSERT(value);
 
-        // Evaluate the point on Curve
-        GP_ASSERT(channel->getCurve());
-        channel->getCurve()->evaluate(percentComplete, percentageStart, percentageEnd, percentageBlend, value->_value);
+    // The channels may have changed since the clip was advanced, discarding its pose.
+    AnimationSampler* sampler = _animation->_sampler;
+    if (sampler == NULL || _pose == NULL)
+        return;
+
+    // Clips of models that are not visible are not evaluated.
+    if (_visible)
+    {
+        // Sample the compiled transform channels in bulk and apply the pose.
+        bool sampled = sampler->update(percentComplete, percentageStart, percentageEnd, percentageBlend, _updateInterval, _jointDepth, _pose);
+        sampler->apply(_pose, _blendWeight, _jointDepth);
 
-        // Set the animation value on the target property.
-        target->setAnimationPropertyValue(channel->_propertyId, value, _blendWeight);
+        // Evaluate the channels the sampler could not compile one at a time, at the same rate.
+        const std::vector<unsigned int>& fallbackChannels = sampler->_fallbackChannels;
+        for (size_t j = 0, count = fallbackChannels.size(); j < count; j++)
+        {
+            size_t i = fallbackChannels[j];
+            channel = _animation->_channels[i];
+            GP_ASSERT(channel);
+            target = channel->_target;
+            GP_ASSERT(target);
+            value = _values[i];
+            GP_ASSERT(value);
+
+            // Evaluate the point on Curve
+            GP_ASSERT(channel->getCurve());
+            if (sampled)
+                channel->getCurve()->evaluate(percentComplete, percentageStart, percentageEnd, percentageBlend, value->_value, &value->_cursor);
+
+            // Set the animation value on the target property.
+            target->setAnimationPropertyValue(channel->_propertyId, value, _blendWeight);
+        }
     }
+    else
+    {
+        sampler->cull(_pose);
+    }
+}
 
+bool AnimationClip::finish()
+{
     // When ended. Probably should move to it's own method so we can call it when the clip is ended early.
     if (isClipStateBitSet(CLIP_IS_MARKED_FOR_REMOVAL_BIT) || !isClipStateBitSet(CLIP_IS_STARTED_BIT))
     {
@@ -4,6 +4,7 @@
 #include "AnimationValue.h"
 #include "Curve.h"
 #include "Animation.h"
+#include "AnimationSampler.h"
 #include "ScriptTarget.h"
 
 namespace vkcore
@@ -11,6 +12,7 @@ namespace vkcore
 
 class Animation;
 class AnimationValue;
+class Node;
 
 /**
  * Defines the runtime session of an Animation to be played.
@@ -348,9 +350,31 @@ private:
     AnimationClip& operator=(const AnimationClip&);
 
     /**
-     * Updates the animation with the elapsed time.
+     * Advances the clip by the elapsed time, firing its begin and time events and updating
+     * any cross fade, and decides the level of detail to evaluate it at.
+     *
+     * Called on the main thread for each running clip, in order.
+     *
+     * @param elapsedTime The elapsed game time.
+     *
+     * @return true if the clip is to be evaluated; false if it was stopped and has ended.
+     */
+    bool advance(float elapsedTime);
+
+    /**
+     * Evaluates the clip's channels at its current time and applies them to their targets.
+     *
+     * Fires no events and touches only the clip and the targets of its animation, so clips
+     * of animations targeting separate node hierarchies may be evaluated concurrently.
+     */
+    void evaluate();
+
+    /**
+     * Ends the clip if it finished in the last advance.
+     *
+     * @return true if the clip has ended and is to be removed from the running clips.
      */
-    bool update(float elapsedTime);
+    bool finish();
 
     /**
      * Handles when the AnimationClip begins.
@@ -403,6 +427,12 @@ private:
     unsigned long _crossFadeOutDuration;                // The duration of the cross fade.
     float _blendWeight;                                 // The clip's blendweight.
     std::vector<AnimationValue*> _values;               // AnimationValue holder.
+    AnimationSampler::Pose* _pose;                      // Sampling state for the animation's compiled channels.
+    float _percentComplete;                             // Position within the clip to evaluate at, set by advance().
+    bool _visible;                                      // Whether the clip's model is visible, set by advance().
+    unsigned int _updateInterval;                       // Number of updates between pose samples, set by advance().
+    unsigned int _jointDepth;                           // Deepest joint to animate, set by advance().
+    Node* _root;                                        // Root of the hierarchy the clip animates, set by advance(); NULL if several.
     std::vector<Listener*>* _beginListeners;            // Collection of begin listeners on the clip.
     std::vector<Listener*>* _endListeners;              // Collection of end listeners on the clip.
     std::list<ListenerEvent*>* _listeners;              // Ordered collection of listeners on the clip.
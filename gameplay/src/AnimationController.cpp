@@ -2,31 +2,123 @@
 #include "AnimationController.h"
 #include "Game.h"
 #include "Curve.h"
+#include "Camera.h"
+#include "Node.h"
+#include "jobsystem.hpp"
 
 namespace vkcore
 {
 
 AnimationController::AnimationController()
-    : _state(STOPPED)
+    : _state(STOPPED), _updating(false), _lodCamera(NULL), _jobSystem(NULL), _poseCount(0)
 {
+    const float screenSizes[] = { 0.15f, 0.05f, 0.02f, 0.0f };
+    const unsigned int updateIntervals[] = { 1, 2, 4, 8 };
+    const unsigned int jointDepths[] = { ALL_JOINTS, ALL_JOINTS, 4, 2 };
+    setLODLevels(screenSizes, updateIntervals, jointDepths, 4);
 }
 
 AnimationController::~AnimationController()
 {
+    SAFE_RELEASE(_lodCamera);
 }
 
 void AnimationController::stopAllAnimations() 
 {
-    std::list<AnimationClip*>::iterator clipIter = _runningClips.begin();
-    while (clipIter != _runningClips.end())
+    for (size_t i = 0, count = _runningClips.size(); i < count; i++)
     {
-        AnimationClip* clip = *clipIter;
-        GP_ASSERT(clip);
-        clip->stop();
-        clipIter++;
+        AnimationClip* clip = _runningClips[i];
+        if (clip)
+            clip->stop();
     }
 }
 
+void AnimationController::setLODCamera(Camera* camera)
+{
+    if (_lodCamera == camera)
+        return;
+
+    SAFE_RELEASE(_lodCamera);
+    _lodCamera = camera;
+    if (_lodCamera)
+        _lodCamera->addRef();
+}
+
+Camera* AnimationController::getLODCamera() const
+{
+    return _lodCamera;
+}
+
+void AnimationController::setLODLevels(const float* screenSizes, const unsigned int* updateIntervals, const unsigned int* jointDepths, unsigned int count)
+{
+    GP_ASSERT(screenSizes && updateIntervals && jointDepths && count > 0);
+
+    _lodLevels.resize(count);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        GP_ASSERT(updateIntervals[i] > 0);
+        GP_ASSERT(i == 0 || screenSizes[i] <= screenSizes[i - 1]);
+        _lodLevels[i].screenSize = screenSizes[i];
+        _lodLevels[i].updateInterval = updateIntervals[i] > 0 ? updateIntervals[i] : 1;
+        _lodLevels[i].jointDepth = jointDepths[i];
+    }
+}
+
+void AnimationController::setJobSystem(vkTools::JobSystem* jobSystem)
+{
+    GP_ASSERT(!_updating);
+
+    _jobSystem = jobSystem;
+}
+
+vkTools::JobSystem* AnimationController::getJobSystem() const
+{
+    return _jobSystem;
+}
+
+bool AnimationController::getLOD(Node* node, unsigned int* updateInterval, unsigned int* jointDepth) const
+{
+    GP_ASSERT(updateInterval && jointDepth);
+
+    *updateInterval = 1;
+    *jointDepth = ALL_JOINTS;
+    if (_lodCamera == NULL || _lodCamera->getNode() == NULL || node == NULL)
+        return true;
+
+    const BoundingSphere& sphere = node->getBoundingSphere();
+    if (sphere.radius <= 0.0f)
+        return true;
+    if (!_lodCamera->getFrustum().intersects(sphere))
+        return false;
+
+    // Project the bounding sphere's radius to a fraction of half the viewport height.
+    float screenSize;
+    if (_lodCamera->getCameraType() == Camera::PERSPECTIVE)
+    {
+        float distance = sphere.center.distance(_lodCamera->getNode()->getTranslationWorld());
+        float extent = distance * tan(MATH_DEG_TO_RAD(_lodCamera->getFieldOfView()) * 0.5f);
+        screenSize = distance > sphere.radius && extent > 0.0f ? sphere.radius / extent : 1.0f;
+    }
+    else
+    {
+        float extent = _lodCamera->getZoomY() * 0.5f;
+        screenSize = extent > 0.0f ? sphere.radius / extent : 1.0f;
+    }
+
+    const LODLevel* level = &_lodLevels.back();
+    for (size_t i = 0, count = _lodLevels.size(); i < count; i++)
+    {
+        if (screenSize >= _lodLevels[i].screenSize)
+        {
+            level = &_lodLevels[i];
+            break;
+        }
+    }
+    *updateInterval = level->updateInterval;
+    *jointDepth = level->jointDepth;
+    return true;
+}
+
 AnimationController::State AnimationController::getState() const
 {
     return _state;
@@ -39,13 +131,12 @@ void AnimationController::initialize()
 
 void AnimationController::finalize()
 {
-    std::list<AnimationClip*>::iterator itr = _runningClips.begin();
-    for ( ; itr != _runningClips.end(); itr++)
+    for (size_t i = 0, count = _runningClips.size(); i < count; i++)
     {
-        AnimationClip* clip = *itr;
-        SAFE_RELEASE(clip);
+        SAFE_RELEASE(_runningClips[i]);
     }
     _runningClips.clear();
+    SAFE_RELEASE(_lodCamera);
     _state = STOPPED;
 }
 
@@ -67,6 +158,9 @@ void AnimationController::schedule(AnimationClip* clip)
     if (_runningClips.empty())
     {
         _state = RUNNING;
+
+        // Stagger the clips of each new batch of animations from the start.
+        _poseCount = 0;
     }
 
     GP_ASSERT(clip);
@@ -76,17 +170,15 @@ void AnimationController::schedule(AnimationClip* clip)
 
 void AnimationController::unschedule(AnimationClip* clip)
 {
-    std::list<AnimationClip*>::iterator clipItr = _runningClips.begin();
-    while (clipItr != _runningClips.end())
+    std::vector<AnimationClip*>::iterator clipItr = std::find(_runningClips.begin(), _runningClips.end(), clip);
+    if (clipItr != _runningClips.end())
     {
-        AnimationClip* rClip = (*clipItr);
-        if (rClip == clip)
-        {
+        // Slots are only emptied during an update, so that the update's indices stay valid.
+        if (_updating)
+            *clipItr = NULL;
+        else
             _runningClips.erase(clipItr);
-            SAFE_RELEASE(clip);
-            break;
-        }
-        clipItr++;
+        SAFE_RELEASE(clip);
     }
 
     if (_runningClips.empty())
@@ -99,38 +191,186 @@ void AnimationController::update(float elapsedTime)
         return;
     
     Transform::suspendTransformChanged();
+    _updating = true;
 
-    // Loop through running clips and call update() on them.
-    std::list<AnimationClip*>::iterator clipIter = _runningClips.begin();
-    while (clipIter != _runningClips.end())
-    {
-        AnimationClip* clip = (*clipIter);
-        GP_ASSERT(clip);
-        clip->addRef();
-        if (clip->isClipStateBitSet(AnimationClip::CLIP_IS_RESTARTED_BIT))
-        {   // If the CLIP_IS_RESTARTED_BIT is set, we should end the clip and 
-            // move it from where it is in the running clips list to the back.
-            clip->onEnd();
-            clip->setClipStateBit(AnimationClip::CLIP_IS_PLAYING_BIT);
-            _runningClips.push_back(clip);
-            clipIter = _runningClips.erase(clipIter);
-        }
-        else if (clip->update(elapsedTime))
+    // Clips played by listeners during the update are appended to the running clips and
+    // updated in a following pass, as if they had been running all along.
+    size_t begin = 0;
+    while (begin < _runningClips.size())
+    {
+        // Advance the running clips and fire their begin and time events, in order. With a job
+        // system the advanced clips are then evaluated together, and ended in order.
+        _evaluatedClips.clear();
+        _evaluatedSlots.clear();
+        for (size_t i = begin; i < _runningClips.size(); i++)
         {
+            AnimationClip* clip = _runningClips[i];
+            if (clip == NULL || clip->isClipStateBitSet(AnimationClip::CLIP_IS_PAUSED_BIT))
+                continue;
+
+            clip->addRef();
+            if (clip->isClipStateBitSet(AnimationClip::CLIP_IS_RESTARTED_BIT))
+            {   // If the CLIP_IS_RESTARTED_BIT is set, we should end the clip and 
+                // move it from where it is in the running clips to the back.
+                clip->onEnd();
+                clip->setClipStateBit(AnimationClip::CLIP_IS_PLAYING_BIT);
+                _runningClips[i] = NULL;
+                _runningClips.push_back(clip);
+            }
+            else if (clip->advance(elapsedTime))
+            {
+                if (_jobSystem == NULL)
+                {
+                    // Without a job system each clip is evaluated and ended before the next one
+                    // advances, so listeners see the poses of the clips before them.
+                    clip->evaluate();
+                    if (clip->finish() && _runningClips[i] == clip)
+                    {
+                        _runningClips[i] = NULL;
+                        clip->release();
+                    }
+                }
+                else
+                {
+                    clip->addRef();
+                    _evaluatedClips.push_back(clip);
+                    _evaluatedSlots.push_back(i);
+                }
+            }
+            else if (_runningClips[i] == clip)
+            {
+                _runningClips[i] = NULL;
+                clip->release();
+            }
             clip->release();
-            clipIter = _runningClips.erase(clipIter);
         }
-        else
+        size_t end = _runningClips.size();
+
+        evaluate();
+
+        // End the clips that finished, in order.
+        for (size_t i = 0, count = _evaluatedClips.size(); i < count; i++)
         {
-            clipIter++;
+            AnimationClip* clip = _evaluatedClips[i];
+            size_t slot = _evaluatedSlots[i];
+            if (clip->finish() && _runningClips[slot] == clip)
+            {
+                _runningClips[slot] = NULL;
+                clip->release();
+            }
+            clip->release();
         }
-        clip->release();
+        _evaluatedClips.clear();
+        _evaluatedSlots.clear();
+
+        begin = end;
     }
 
+    _updating = false;
+    compact();
+
     Transform::resumeTransformChanged();
 
     if (_runningClips.empty())
         _state = IDLE;
 }
 
+void AnimationController::evaluate()
+{
+    size_t clipCount = _evaluatedClips.size();
+    if (_jobSystem == NULL || clipCount < 2)
+    {
+        for (size_t i = 0; i < clipCount; i++)
+            _evaluatedClips[i]->evaluate();
+        return;
+    }
+
+    // Clips that may share targets with any group are evaluated on this thread in their place
+    // among the others, so that clips blending into the same targets keep their order. The
+    // grouped clips between them are evaluated in parallel.
+    size_t first = 0;
+    for (size_t i = 0; i <= clipCount; i++)
+    {
+        if (i < clipCount && _evaluatedClips[i]->_root != NULL)
+            continue;
+
+        evaluateGroups(first, i);
+        if (i < clipCount)
+            _evaluatedClips[i]->evaluate();
+        first = i + 1;
+    }
+}
+
+void AnimationController::evaluateGroups(size_t first, size_t last)
+{
+    // Group the clips by the hierarchy they animate, keeping their order within each group.
+    std::vector<unsigned int>& groupCounts = _groupOffsets;
+    groupCounts.clear();
+    _groupIndices.clear();
+    _clipGroups.resize(last - first);
+    for (size_t i = first; i < last; i++)
+    {
+        Node* root = _evaluatedClips[i]->_root;
+        GP_ASSERT(root);
+
+        std::pair<std::unordered_map<Node*, unsigned int>::iterator, bool> group = _groupIndices.insert(std::make_pair(root, (unsigned int)groupCounts.size()));
+        if (group.second)
+            groupCounts.push_back(0);
+        _clipGroups[i - first] = group.first->second;
+        groupCounts[group.first->second]++;
+    }
+
+    unsigned int groupCount = (unsigned int)groupCounts.size();
+    if (groupCount < 2)
+    {
+        for (size_t i = first; i < last; i++)
+            _evaluatedClips[i]->evaluate();
+        return;
+    }
+
+    // Turn the counts into offsets and sort the grouped clips into place.
+    unsigned int offset = 0;
+    for (unsigned int g = 0; g < groupCount; g++)
+    {
+        unsigned int count = _groupOffsets[g];
+        _groupOffsets[g] = offset;
+        offset += count;
+    }
+    _groupOffsets.push_back(offset);
+    _groupedClips.resize(offset);
+    std::vector<unsigned int> next(_groupOffsets.begin(), _groupOffsets.end() - 1);
+    for (size_t i = first; i < last; i++)
+    {
+        _groupedClips[next[_clipGroups[i - first]]++] = _evaluatedClips[i];
+    }
+
+    // Evaluate the groups in parallel. Each group records the transforms it changes in its
+    // own list, and the lists are merged in group order so the change notifications made
+    // when transform changed events resume do not depend on the thread timing.
+    if (_groupChanges.size() < groupCount)
+        _groupChanges.resize(groupCount);
+    vkTools::JobHandle job = _jobSystem->parallelFor(groupCount, 1, [this](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t g = begin; g < end; g++)
+        {
+            Transform::setTransformChangedList(&_groupChanges[g]);
+            for (unsigned int i = _groupOffsets[g]; i < _groupOffsets[g + 1]; i++)
+                _groupedClips[i]->evaluate();
+            Transform::setTransformChangedList(NULL);
+        }
+    });
+    _jobSystem->wait(job);
+
+    for (unsigned int g = 0; g < groupCount; g++)
+    {
+        Transform::mergeTransformChanged(_groupChanges[g]);
+        _groupChanges[g].clear();
+    }
+}
+
+void AnimationController::compact()
+{
+    _runningClips.erase(std::remove(_runningClips.begin(), _runningClips.end(), (AnimationClip*)NULL), _runningClips.end());
+}
+
 }
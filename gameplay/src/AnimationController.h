@@ -6,11 +6,35 @@
 #include "AnimationTarget.h"
 #include "Properties.h"
 
+namespace vkTools
+{
+class JobSystem;
+}
+
 namespace vkcore
 {
 
+class Camera;
+class Node;
+
 /**
  * Defines a class for controlling game animation.
+ *
+ * When a level of detail camera is set, the running clips of models that are outside
+ * its frustum are not evaluated (their time and events still advance), and the clips of
+ * visible models are evaluated at the level of detail matching their size on screen.
+ *
+ * When a job system is set, the running clips are advanced and their events fired on the
+ * main thread, in the order they were played, and are then evaluated concurrently: clips
+ * whose channels all target one node hierarchy are grouped by the top-level node of the
+ * hierarchy, and the groups are evaluated as parallel jobs. Clips of animations that
+ * target several hierarchies, or targets other than nodes, are evaluated on the main
+ * thread in their place among the others: the groups of the clips played before them are
+ * done first, and those of the clips played after them start once they are evaluated, so
+ * clips blending into the same targets are applied in the order they were played. The
+ * clips are ended once all of them are evaluated.
+ *
+ * Without a job system each clip is advanced, evaluated and ended in turn.
  */
 class AnimationController
 {
@@ -21,13 +45,86 @@ class AnimationController
 
 public:
 
+    /**
+     * Joint depth of a level of detail that animates every joint.
+     */
+    static const unsigned int ALL_JOINTS = 0xffffffff;
+
     /** 
      * Stops all AnimationClips currently playing on the AnimationController.
      */
     void stopAllAnimations();
-       
+
+    /**
+     * Sets the camera that animation level of detail is computed against.
+     *
+     * The level of detail of a clip is decided by the bounding sphere of the node of the
+     * model it animates: the model skinned by the animated joints, or otherwise the
+     * shallowest animated node.
+     *
+     * @param camera The level of detail camera, or NULL to evaluate every clip fully on
+     *      every update (the default).
+     */
+    void setLODCamera(Camera* camera);
+
+    /**
+     * Gets the camera that animation level of detail is computed against.
+     *
+     * @return The level of detail camera, or NULL if level of detail is disabled.
+     */
+    Camera* getLODCamera() const;
+
+    /**
+     * Sets the animation levels of detail.
+     *
+     * The screen size of a model is the radius of its bounding sphere as a fraction of
+     * half the viewport height. A model uses the first level whose screen size it reaches,
+     * or the last level if it reaches none, so levels are given by decreasing screen size.
+     *
+     * At a level, the clips of the model sample their pose every updateIntervals[i]
+     * updates, interpolating in between, and only animate the joints up to
+     * jointDepths[i] levels below the root of the animated hierarchy.
+     *
+     * The default levels are:
+     *  - screen size 0.15: every update, all joints.
+     *  - screen size 0.05: every 2nd update, all joints.
+     *  - screen size 0.02: every 4th update, 4 joint levels.
+     *  - smaller: every 8th update, 2 joint levels.
+     *
+     * @param screenSizes The smallest screen size of each level.
+     * @param updateIntervals The number of updates between pose samples at each level.
+     * @param jointDepths The deepest joint animated at each level, or ALL_JOINTS.
+     * @param count The number of levels.
+     */
+    void setLODLevels(const float* screenSizes, const unsigned int* updateIntervals, const unsigned int* jointDepths, unsigned int count);
+
+    /**
+     * Sets the job system used to evaluate running clips in parallel.
+     *
+     * @param jobSystem The job system, or NULL to evaluate every clip on the main thread
+     *      (the default). The job system must outlive its use by the controller.
+     */
+    void setJobSystem(vkTools::JobSystem* jobSystem);
+
+    /**
+     * Gets the job system used to evaluate running clips in parallel.
+     *
+     * @return The job system, or NULL if clips are evaluated on the main thread.
+     */
+    vkTools::JobSystem* getJobSystem() const;
+
 private:
 
+    /**
+     * Defines a level of detail.
+     */
+    struct LODLevel
+    {
+        float screenSize;
+        unsigned int updateInterval;
+        unsigned int jointDepth;
+    };
+
     /**
      * The states that the AnimationController may be in.
      */
@@ -95,9 +192,48 @@ private:
      * Callback for when the controller receives a frame update event.
      */
     void update(float elapsedTime);
+
+    /**
+     * Gets the level of detail to evaluate the clips animating a node at.
+     *
+     * @param node The level of detail node of the clip's animation; may be NULL.
+     * @param updateInterval Populated with the number of updates between pose samples.
+     * @param jointDepth Populated with the deepest joint to animate.
+     *
+     * @return false if the node is not visible and its clips should not be evaluated.
+     */
+    bool getLOD(Node* node, unsigned int* updateInterval, unsigned int* jointDepth) const;
+
+    /**
+     * Evaluates the clips advanced in the current update, in parallel when possible.
+     */
+    void evaluate();
+
+    /**
+     * Evaluates a range of the clips advanced in the current update, all of which target a
+     * single node hierarchy, grouping them by hierarchy and evaluating the groups in parallel.
+     */
+    void evaluateGroups(size_t first, size_t last);
+
+    /**
+     * Removes the slots of clips unscheduled during an update from the running clips.
+     */
+    void compact();
     
-    State _state;                                 // The current state of the AnimationController.
-    std::list<AnimationClip*> _runningClips;      // A list of running AnimationClips.
+    State _state;                                         // The current state of the AnimationController.
+    std::vector<AnimationClip*> _runningClips;            // The running AnimationClips, in the order they were played.
+    bool _updating;                                       // Whether the running clips are being updated.
+    Camera* _lodCamera;                                   // The camera level of detail is computed against.
+    std::vector<LODLevel> _lodLevels;                     // The levels of detail, by decreasing screen size.
+    vkTools::JobSystem* _jobSystem;                       // The job system clips are evaluated on; NULL for the main thread.
+    std::vector<AnimationClip*> _evaluatedClips;          // The clips to evaluate in the current update.
+    std::vector<size_t> _evaluatedSlots;                  // The slot of each evaluated clip in the running clips.
+    std::vector<AnimationClip*> _groupedClips;            // The evaluated clips sorted by group.
+    std::vector<unsigned int> _groupOffsets;              // Offset of each group's first clip in _groupedClips.
+    std::vector<unsigned int> _clipGroups;                // The group of each clip of the range being evaluated.
+    std::vector<std::vector<Transform*> > _groupChanges;  // The transforms changed by each group.
+    std::unordered_map<Node*, unsigned int> _groupIndices; // The group of each root node.
+    unsigned int _poseCount;                              // Number of clip poses created since the controller was last idle.
 };
 
 }
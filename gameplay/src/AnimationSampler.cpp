@@ -0,0 +1,707 @@
+#include "Base.h"
+#include "AnimationSampler.h"
+#include "Animation.h"
+#include "Curve.h"
+#include "AnimationTarget.h"
+#include "Transform.h"
+#include "Joint.h"
+#include "MeshSkin.h"
+#include "Model.h"
+#include "MathUtil.h"
+
+#ifdef GP_USE_SSE
+#include <emmintrin.h>
+#endif
+
+namespace vkcore
+{
+
+unsigned char AnimationSampler::getPoseParts(int propertyId, unsigned int* scaleOffset, unsigned int* rotationOffset, unsigned int* translationOffset)
+{
+    switch (propertyId)
+    {
+    case Transform::ANIMATE_SCALE:
+        *scaleOffset = 0;
+        return POSE_SCALE;
+    case Transform::ANIMATE_ROTATE:
+        *rotationOffset = 0;
+        return POSE_ROTATION;
+    case Transform::ANIMATE_TRANSLATE:
+        *translationOffset = 0;
+        return POSE_TRANSLATION;
+    case Transform::ANIMATE_ROTATE_TRANSLATE:
+        *rotationOffset = 0;
+        *translationOffset = 4;
+        return POSE_ROTATION | POSE_TRANSLATION;
+    case Transform::ANIMATE_SCALE_ROTATE:
+        *scaleOffset = 0;
+        *rotationOffset = 3;
+        return POSE_SCALE | POSE_ROTATION;
+    case Transform::ANIMATE_SCALE_TRANSLATE:
+        *scaleOffset = 0;
+        *translationOffset = 3;
+        return POSE_SCALE | POSE_TRANSLATION;
+    case Transform::ANIMATE_SCALE_ROTATE_TRANSLATE:
+        *scaleOffset = 0;
+        *rotationOffset = 3;
+        *translationOffset = 7;
+        return POSE_SCALE | POSE_ROTATION | POSE_TRANSLATION;
+    default:
+        return 0;
+    }
+}
+
+unsigned char AnimationSampler::getAnimatedParts(int propertyId)
+{
+    switch (propertyId)
+    {
+    case Transform::ANIMATE_SCALE_UNIT:
+    case Transform::ANIMATE_SCALE:
+    case Transform::ANIMATE_SCALE_X:
+    case Transform::ANIMATE_SCALE_Y:
+    case Transform::ANIMATE_SCALE_Z:
+        return POSE_SCALE;
+    case Transform::ANIMATE_ROTATE:
+        return POSE_ROTATION;
+    case Transform::ANIMATE_TRANSLATE:
+    case Transform::ANIMATE_TRANSLATE_X:
+    case Transform::ANIMATE_TRANSLATE_Y:
+    case Transform::ANIMATE_TRANSLATE_Z:
+        return POSE_TRANSLATION;
+    case Transform::ANIMATE_ROTATE_TRANSLATE:
+        return POSE_ROTATION | POSE_TRANSLATION;
+    case Transform::ANIMATE_SCALE_ROTATE:
+        return POSE_SCALE | POSE_ROTATION;
+    case Transform::ANIMATE_SCALE_TRANSLATE:
+        return POSE_SCALE | POSE_TRANSLATION;
+    case Transform::ANIMATE_SCALE_ROTATE_TRANSLATE:
+        return POSE_SCALE | POSE_ROTATION | POSE_TRANSLATION;
+    default:
+        // Properties of Transform subclasses may change any part.
+        return POSE_SCALE | POSE_ROTATION | POSE_TRANSLATION;
+    }
+}
+
+/**
+ * Gets the top-level ancestor of a node.
+ */
+static Node* getTopLevel(Node* node)
+{
+    while (node->getParent())
+        node = node->getParent();
+    return node;
+}
+
+/**
+ * Determines whether a channel's curve only uses linear interpolation.
+ */
+static bool isLinear(const Curve* curve)
+{
+    for (unsigned int i = 0, count = curve->getPointCount(); i < count; ++i)
+    {
+        if (curve->getPointInterpolation(i) != Curve::LINEAR)
+            return false;
+    }
+    return true;
+}
+
+#ifdef GP_USE_SSE
+
+static inline __m128 gather(const float* keys, const unsigned int* index)
+{
+    return _mm_set_ps(keys[index[3]], keys[index[2]], keys[index[1]], keys[index[0]]);
+}
+
+static inline __m128 select(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+/**
+ * Interpolates four pairs of quaternions, lane for lane matching Quaternion::slerp.
+ */
+static inline void slerp(const __m128* q1, const __m128* q2, __m128 t, __m128* dst)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+
+    __m128 cosTheta = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(q1[3], q2[3]), _mm_mul_ps(q1[0], q2[0])), _mm_mul_ps(q1[1], q2[1])), _mm_mul_ps(q1[2], q2[2]));
+
+    // Fold theta.
+    __m128 alpha = select(_mm_cmpge_ps(cosTheta, zero), one, _mm_set1_ps(-1.0f));
+    __m128 halfY = _mm_add_ps(one, _mm_mul_ps(alpha, cosTheta));
+
+    // Bisect the interval and fold t.
+    __m128 f2b = _mm_sub_ps(t, half);
+    __m128 u = _mm_and_ps(f2b, absMask);
+    __m128 f2a = _mm_sub_ps(u, f2b);
+    f2b = _mm_add_ps(f2b, u);
+    u = _mm_add_ps(u, u);
+    __m128 f1 = _mm_sub_ps(one, u);
+
+    // One iteration of Newton to get 1-cos(theta / 2).
+    __m128 halfSecHalfTheta = _mm_sub_ps(_mm_set1_ps(1.09f), _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(0.476537f), _mm_mul_ps(_mm_set1_ps(0.0903321f), halfY)), halfY));
+    halfSecHalfTheta = _mm_mul_ps(halfSecHalfTheta, _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(_mm_mul_ps(halfY, halfSecHalfTheta), halfSecHalfTheta)));
+    __m128 versHalfTheta = _mm_sub_ps(one, _mm_mul_ps(halfY, halfSecHalfTheta));
+
+    // Evaluate the series expansions of the coefficients.
+    const __m128 c0 = _mm_set1_ps(0.0000440917108f);
+    const __m128 c1 = _mm_set1_ps(-0.00158730159f);
+    const __m128 c2 = _mm_set1_ps(0.0333333333f);
+    const __m128 c3 = _mm_set1_ps(-0.333333333f);
+    const __m128 four = _mm_set1_ps(4.0f);
+    const __m128 nine = _mm_set1_ps(9.0f);
+    const __m128 sixteen = _mm_set1_ps(16.0f);
+
+    __m128 sqNotU = _mm_mul_ps(f1, f1);
+    __m128 ratio2 = _mm_mul_ps(c0, versHalfTheta);
+    __m128 ratio1 = _mm_add_ps(c1, _mm_mul_ps(_mm_sub_ps(sqNotU, sixteen), ratio2));
+    ratio1 = _mm_add_ps(c2, _mm_mul_ps(_mm_mul_ps(ratio1, _mm_sub_ps(sqNotU, nine)), versHalfTheta));
+    ratio1 = _mm_add_ps(c3, _mm_mul_ps(_mm_mul_ps(ratio1, _mm_sub_ps(sqNotU, four)), versHalfTheta));
+    ratio1 = _mm_add_ps(one, _mm_mul_ps(_mm_mul_ps(ratio1, _mm_sub_ps(sqNotU, one)), versHalfTheta));
+
+    __m128 sqU = _mm_mul_ps(u, u);
+    ratio2 = _mm_add_ps(c1, _mm_mul_ps(_mm_sub_ps(sqU, sixteen), ratio2));
+    ratio2 = _mm_add_ps(c2, _mm_mul_ps(_mm_mul_ps(ratio2, _mm_sub_ps(sqU, nine)), versHalfTheta));
+    ratio2 = _mm_add_ps(c3, _mm_mul_ps(_mm_mul_ps(ratio2, _mm_sub_ps(sqU, four)), versHalfTheta));
+    ratio2 = _mm_add_ps(one, _mm_mul_ps(_mm_mul_ps(ratio2, _mm_sub_ps(sqU, one)), versHalfTheta));
+
+    // Perform the bisection and resolve the folding.
+    f1 = _mm_mul_ps(f1, _mm_mul_ps(ratio1, halfSecHalfTheta));
+    f2a = _mm_mul_ps(f2a, ratio2);
+    f2b = _mm_mul_ps(f2b, ratio2);
+    alpha = _mm_mul_ps(alpha, _mm_add_ps(f1, f2a));
+    __m128 beta = _mm_add_ps(f1, f2b);
+
+    __m128 w = _mm_add_ps(_mm_mul_ps(alpha, q1[3]), _mm_mul_ps(beta, q2[3]));
+    __m128 x = _mm_add_ps(_mm_mul_ps(alpha, q1[0]), _mm_mul_ps(beta, q2[0]));
+    __m128 y = _mm_add_ps(_mm_mul_ps(alpha, q1[1]), _mm_mul_ps(beta, q2[1]));
+    __m128 z = _mm_add_ps(_mm_mul_ps(alpha, q1[2]), _mm_mul_ps(beta, q2[2]));
+
+    // Correct any small constraint error in the inputs.
+    f1 = _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(half, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(w, w), _mm_mul_ps(x, x)), _mm_mul_ps(y, y)), _mm_mul_ps(z, z))));
+
+    // Lanes at either end point, or between equal quaternions, take the end point directly.
+    __m128 useQ2 = _mm_cmpeq_ps(t, one);
+    __m128 useQ1 = _mm_or_ps(_mm_cmpeq_ps(t, zero),
+        _mm_and_ps(_mm_and_ps(_mm_cmpeq_ps(q1[0], q2[0]), _mm_cmpeq_ps(q1[1], q2[1])), _mm_and_ps(_mm_cmpeq_ps(q1[2], q2[2]), _mm_cmpeq_ps(q1[3], q2[3]))));
+
+    dst[0] = select(useQ1, q1[0], select(useQ2, q2[0], _mm_mul_ps(x, f1)));
+    dst[1] = select(useQ1, q1[1], select(useQ2, q2[1], _mm_mul_ps(y, f1)));
+    dst[2] = select(useQ1, q1[2], select(useQ2, q2[2], _mm_mul_ps(z, f1)));
+    dst[3] = select(useQ1, q1[3], select(useQ2, q2[3], _mm_mul_ps(w, f1)));
+}
+
+#endif
+
+AnimationSampler::Pose::Pose(unsigned int channelCount, unsigned int phase)
+    : _capacity((channelCount + 3) & ~3u), _startTime(-1.0f), _endTime(-1.0f), _output(NULL),
+      _phase(phase), _interval(1), _jointDepth(0), _countdown(0), _step(0), _sampled(false), _interpolated(false)
+{
+    _min = new unsigned int[_capacity];
+    _max = new unsigned int[_capacity];
+    _cursors = new unsigned int[_capacity];
+    _from = new unsigned int[_capacity];
+    _to = new unsigned int[_capacity];
+    _t = new float[_capacity];
+    _values = new float[_capacity * POSE_COMPONENTS];
+    _previous = new float[_capacity * POSE_COMPONENTS];
+    _blended = new float[_capacity * POSE_COMPONENTS];
+    _output = _values;
+
+    memset(_min, 0, _capacity * sizeof(unsigned int));
+    memset(_max, 0, _capacity * sizeof(unsigned int));
+    memset(_cursors, 0, _capacity * sizeof(unsigned int));
+    memset(_from, 0, _capacity * sizeof(unsigned int));
+    memset(_to, 0, _capacity * sizeof(unsigned int));
+    memset(_t, 0, _capacity * sizeof(float));
+    memset(_values, 0, _capacity * POSE_COMPONENTS * sizeof(float));
+    memset(_previous, 0, _capacity * POSE_COMPONENTS * sizeof(float));
+    memset(_blended, 0, _capacity * POSE_COMPONENTS * sizeof(float));
+}
+
+AnimationSampler::Pose::~Pose()
+{
+    SAFE_DELETE_ARRAY(_min);
+    SAFE_DELETE_ARRAY(_max);
+    SAFE_DELETE_ARRAY(_cursors);
+    SAFE_DELETE_ARRAY(_from);
+    SAFE_DELETE_ARRAY(_to);
+    SAFE_DELETE_ARRAY(_t);
+    SAFE_DELETE_ARRAY(_values);
+    SAFE_DELETE_ARRAY(_previous);
+    SAFE_DELETE_ARRAY(_blended);
+}
+
+AnimationSampler::AnimationSampler(Animation* animation)
+    : _channelCount(0), _keyCount(0), _targets(NULL), _parts(NULL), _depths(NULL), _keyOffsets(NULL), _times(NULL), _keys(NULL),
+      _lodTarget(NULL), _grouped(false)
+{
+    GP_ASSERT(animation);
+
+    // Select the channels that can be compiled.
+    size_t animationChannelCount = animation->_channels.size();
+    std::vector<bool> compilable(animationChannelCount);
+    for (size_t i = 0; i < animationChannelCount; i++)
+    {
+        Animation::Channel* channel = animation->_channels[i];
+        GP_ASSERT(channel && channel->_target && channel->_curve);
+
+        unsigned int offset[3];
+        compilable[i] = channel->_target->_targetType == AnimationTarget::TRANSFORM &&
+            getPoseParts(channel->_propertyId, &offset[0], &offset[1], &offset[2]) != 0 &&
+            channel->_curve->getComponentCount() == channel->_target->getAnimationPropertyComponentCount(channel->_propertyId) &&
+            isLinear(channel->_curve);
+    }
+
+    // Compiled channels are applied before the others, so a channel is not compiled when one that
+    // is not animates an overlapping part of the same transform. Channels writing the same values
+    // are then all evaluated one at a time, in the order they were added.
+    for (bool demoted = true; demoted; )
+    {
+        demoted = false;
+        for (size_t i = 0; i < animationChannelCount; i++)
+        {
+            Animation::Channel* channel = animation->_channels[i];
+            if (compilable[i] || channel->_target->_targetType != AnimationTarget::TRANSFORM)
+                continue;
+
+            unsigned char parts = getAnimatedParts(channel->_propertyId);
+            for (size_t j = 0; j < animationChannelCount; j++)
+            {
+                Animation::Channel* other = animation->_channels[j];
+                if (compilable[j] && other->_target == channel->_target && (getAnimatedParts(other->_propertyId) & parts) != 0)
+                {
+                    compilable[j] = false;
+                    demoted = true;
+                }
+            }
+        }
+    }
+
+    // Count the keys of the compiled channels.
+    std::vector<unsigned int> compiled;
+    for (size_t i = 0; i < animationChannelCount; i++)
+    {
+        Animation::Channel* channel = animation->_channels[i];
+        if (compilable[i])
+        {
+            compiled.push_back((unsigned int)i);
+            _keyCount += channel->_curve->getPointCount();
+        }
+        else
+        {
+            _fallbackChannels.push_back((unsigned int)i);
+        }
+    }
+
+    _channelCount = (unsigned int)compiled.size();
+    if (_channelCount == 0)
+        return;
+
+    _targets = new Transform*[_channelCount];
+    _parts = new unsigned char[_channelCount];
+    _depths = new unsigned int[_channelCount];
+    _keyOffsets = new unsigned int[_channelCount + 1];
+    _times = new float[_keyCount];
+    _keys = new float[_keyCount * POSE_COMPONENTS];
+
+    // Pack the keys of every channel into the component arrays. Parts a channel does not
+    // animate are filled with the identity so that bulk interpolation stays well defined.
+    float value[POSE_COMPONENTS];
+    unsigned int key = 0;
+    for (unsigned int c = 0; c < _channelCount; c++)
+    {
+        Animation::Channel* channel = animation->_channels[compiled[c]];
+        Curve* curve = channel->_curve;
+
+        unsigned int scaleOffset = 0, rotationOffset = 0, translationOffset = 0;
+        _parts[c] = getPoseParts(channel->_propertyId, &scaleOffset, &rotationOffset, &translationOffset);
+        _targets[c] = static_cast<Transform*>(channel->_target);
+        _keyOffsets[c] = key;
+
+        for (unsigned int i = 0, count = curve->getPointCount(); i < count; i++, key++)
+        {
+            float pose[POSE_COMPONENTS] = { 1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f };
+            curve->getPointValues(i, value, NULL, NULL);
+            if (_parts[c] & POSE_SCALE)
+                memcpy(&pose[0], &value[scaleOffset], 3 * sizeof(float));
+            if (_parts[c] & POSE_ROTATION)
+                memcpy(&pose[3], &value[rotationOffset], 4 * sizeof(float));
+            if (_parts[c] & POSE_TRANSLATION)
+                memcpy(&pose[7], &value[translationOffset], 3 * sizeof(float));
+
+            _times[key] = curve->getPointTime(i);
+            for (unsigned int k = 0; k < POSE_COMPONENTS; k++)
+                _keys[k * _keyCount + key] = pose[k];
+        }
+    }
+    _keyOffsets[_channelCount] = key;
+
+    // Measure the depth of every animated node below the shallowest one, so that the
+    // channels of minor joints can be dropped at low levels of detail.
+    unsigned int minDepth = 0;
+    for (unsigned int c = 0; c < _channelCount; c++)
+    {
+        Node* node = dynamic_cast<Node*>(_targets[c]);
+        unsigned int depth = 0;
+        if (node)
+        {
+            for (Node* parent = node->getParent(); parent; parent = parent->getParent())
+                depth++;
+            if (_lodTarget == NULL || depth < minDepth)
+            {
+                _lodTarget = node;
+                minDepth = depth;
+            }
+        }
+        _depths[c] = depth;
+    }
+    for (unsigned int c = 0; c < _channelCount; c++)
+    {
+        _depths[c] = _depths[c] > minDepth ? _depths[c] - minDepth : 0;
+    }
+
+    // Check whether every channel, compiled or not, animates the hierarchy of the shallowest node.
+    if (_lodTarget)
+    {
+        Node* root = getTopLevel(_lodTarget);
+        _grouped = true;
+        for (size_t i = 0, count = animation->_channels.size(); i < count && _grouped; i++)
+        {
+            AnimationTarget* target = animation->_channels[i]->_target;
+            Node* node = target->_targetType == AnimationTarget::TRANSFORM ? dynamic_cast<Node*>(target) : NULL;
+            _grouped = node && getTopLevel(node) == root;
+        }
+    }
+}
+
+AnimationSampler::~AnimationSampler()
+{
+    SAFE_DELETE_ARRAY(_targets);
+    SAFE_DELETE_ARRAY(_parts);
+    SAFE_DELETE_ARRAY(_depths);
+    SAFE_DELETE_ARRAY(_keyOffsets);
+    SAFE_DELETE_ARRAY(_times);
+    SAFE_DELETE_ARRAY(_keys);
+}
+
+AnimationSampler::Pose* AnimationSampler::createPose(unsigned int phase) const
+{
+    return new Pose(_channelCount, phase);
+}
+
+Node* AnimationSampler::getLODNode() const
+{
+    if (_lodTarget && _lodTarget->getType() == Node::JOINT)
+    {
+        // Joints are bounded by the model they skin.
+        MeshSkin* skin = static_cast<Joint*>(_lodTarget)->_skin.skin;
+        if (skin && skin->getModel() && skin->getModel()->getNode())
+            return skin->getModel()->getNode();
+    }
+    return _lodTarget;
+}
+
+Node* AnimationSampler::getRoot() const
+{
+    return _grouped ? getTopLevel(_lodTarget) : NULL;
+}
+
+bool AnimationSampler::update(float time, float startTime, float endTime, float loopBlendTime, unsigned int updateInterval, unsigned int jointDepth, Pose* pose) const
+{
+    GP_ASSERT(pose && updateInterval > 0);
+
+    if (pose->_interval != updateInterval || pose->_jointDepth != jointDepth)
+    {
+        // Start over at a new level of detail.
+        pose->_interval = updateInterval;
+        pose->_jointDepth = jointDepth;
+        pose->_sampled = false;
+    }
+
+    bool due = !pose->_sampled || pose->_countdown == 0;
+    if (due)
+    {
+        // Keep the previous sample to interpolate from until the next one.
+        pose->_interpolated = pose->_sampled && updateInterval > 1;
+        if (pose->_interpolated)
+            std::swap(pose->_previous, pose->_values);
+
+        sample(time, startTime, endTime, loopBlendTime, jointDepth, pose);
+
+        // The first sample at a rate waits for the clip's phase; later ones a full interval.
+        if (pose->_interpolated)
+            pose->_countdown = updateInterval - 1;
+        else
+            pose->_countdown = pose->_phase % updateInterval;
+        pose->_step = 0;
+        pose->_sampled = true;
+    }
+    else
+    {
+        pose->_countdown--;
+        pose->_step++;
+    }
+
+    if (pose->_interpolated)
+    {
+        blend(pose, std::min(1.0f, (float)(pose->_step + 1) / (float)updateInterval));
+        pose->_output = pose->_blended;
+    }
+    else
+    {
+        pose->_output = pose->_values;
+    }
+
+    return due;
+}
+
+void AnimationSampler::cull(Pose* pose) const
+{
+    GP_ASSERT(pose);
+
+    pose->_sampled = false;
+}
+
+void AnimationSampler::sample(float time, float startTime, float endTime, float loopBlendTime, unsigned int jointDepth, Pose* pose) const
+{
+    GP_ASSERT(pose && pose->_capacity >= _channelCount);
+    GP_ASSERT(startTime >= 0.0f && startTime <= endTime && endTime <= 1.0f && loopBlendTime >= 0.0f);
+
+    if (_channelCount == 0)
+        return;
+
+    if (pose->_startTime != startTime || pose->_endTime != endTime)
+    {
+        // Resolve the subregion of every channel; this only changes when the clip does.
+        bool subregion = startTime > 0.0f || endTime < 1.0f;
+        for (unsigned int c = 0; c < _channelCount; c++)
+        {
+            unsigned int first = _keyOffsets[c];
+            unsigned int last = _keyOffsets[c + 1] - 1;
+            pose->_min[c] = subregion ? findKey(startTime, first, last) : first;
+            pose->_max[c] = subregion ? findKey(endTime, pose->_min[c], last) : last;
+            pose->_cursors[c] = pose->_min[c];
+        }
+        pose->_startTime = startTime;
+        pose->_endTime = endTime;
+    }
+
+    for (unsigned int c = 0; c < _channelCount; c++)
+    {
+        if (_depths[c] <= jointDepth)
+            sampleChannel(c, time, loopBlendTime, pose);
+    }
+
+    interpolate(pose);
+}
+
+void AnimationSampler::apply(const Pose* pose, float blendWeight, unsigned int jointDepth) const
+{
+    GP_ASSERT(pose && pose->_capacity >= _channelCount && pose->_output);
+
+    const unsigned int capacity = pose->_capacity;
+    float value[POSE_COMPONENTS];
+    for (unsigned int c = 0; c < _channelCount; c++)
+    {
+        if (_depths[c] > jointDepth)
+            continue;
+
+        for (unsigned int k = 0; k < POSE_COMPONENTS; k++)
+            value[k] = pose->_output[k * capacity + c];
+
+        unsigned char parts = _parts[c];
+        _targets[c]->applyAnimationPose((parts & POSE_SCALE) ? &value[0] : NULL,
+                                        (parts & POSE_ROTATION) ? &value[3] : NULL,
+                                        (parts & POSE_TRANSLATION) ? &value[7] : NULL,
+                                        blendWeight);
+    }
+}
+
+void AnimationSampler::sampleChannel(unsigned int channel, float time, float loopBlendTime, Pose* pose) const
+{
+    // Mirrors Curve::evaluate for linear curves, producing the keys and factor to interpolate.
+    unsigned int min = pose->_min[channel];
+    unsigned int max = pose->_max[channel];
+    unsigned int from = min;
+    unsigned int to = min;
+    float t = 0.0f;
+
+    if (_keyOffsets[channel + 1] - _keyOffsets[channel] > 1)
+    {
+        float minTime = _times[min];
+        float maxTime = _times[max];
+        float localTime = time;
+        if (pose->_startTime > 0.0f || pose->_endTime < 1.0f)
+            localTime = minTime + (maxTime - minTime) * time;
+
+        if (loopBlendTime == 0.0f)
+        {
+            if (localTime < minTime)
+                localTime = minTime;
+            else if (localTime > maxTime)
+                localTime = maxTime;
+        }
+
+        if (localTime == minTime)
+        {
+            from = to = min;
+        }
+        else if (localTime == maxTime)
+        {
+            from = to = max;
+        }
+        else if (localTime > maxTime)
+        {
+            // Looping forward.
+            from = max;
+            to = min;
+            t = (localTime - maxTime) / loopBlendTime;
+        }
+        else if (localTime < minTime)
+        {
+            // Looping in reverse.
+            from = min;
+            to = max;
+            t = (minTime - localTime) / loopBlendTime;
+        }
+        else
+        {
+            // minTime < localTime < maxTime, so the segment lies in [min, max).
+            const float* times = _times;
+            unsigned int index = pose->_cursors[channel];
+            if (!Curve::stepCursor(localTime, min, max, &index, [times](unsigned int i) { return times[i]; }))
+                index = findKey(localTime, min, max - 1);
+
+            pose->_cursors[channel] = index;
+            from = index;
+            to = index + 1;
+            t = (localTime - _times[from]) / (_times[to] - _times[from]);
+        }
+    }
+
+    pose->_from[channel] = from;
+    pose->_to[channel] = to;
+    pose->_t[channel] = t;
+}
+
+void AnimationSampler::interpolate(Pose* pose) const
+{
+    const unsigned int capacity = pose->_capacity;
+    float* values = pose->_values;
+
+#ifdef GP_USE_SSE
+    // Interpolate four channels per iteration; the padding slots of the pose point at key zero.
+    static const unsigned int linear[6] = { 0, 1, 2, 7, 8, 9 };
+    for (unsigned int c = 0; c < _channelCount; c += 4)
+    {
+        const unsigned int* from = pose->_from + c;
+        const unsigned int* to = pose->_to + c;
+        __m128 t = _mm_loadu_ps(pose->_t + c);
+
+        for (unsigned int i = 0; i < 6; i++)
+        {
+            const float* keys = _keys + linear[i] * _keyCount;
+            __m128 a = gather(keys, from);
+            __m128 b = gather(keys, to);
+            _mm_storeu_ps(values + linear[i] * capacity + c, _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t)));
+        }
+
+        __m128 q1[4];
+        __m128 q2[4];
+        __m128 q[4];
+        for (unsigned int i = 0; i < 4; i++)
+        {
+            const float* keys = _keys + (3 + i) * _keyCount;
+            q1[i] = gather(keys, from);
+            q2[i] = gather(keys, to);
+        }
+        slerp(q1, q2, t, q);
+        for (unsigned int i = 0; i < 4; i++)
+            _mm_storeu_ps(values + (3 + i) * capacity + c, q[i]);
+    }
+#else
+    const float* x = _keys + 3 * _keyCount;
+    const float* y = _keys + 4 * _keyCount;
+    const float* z = _keys + 5 * _keyCount;
+    const float* w = _keys + 6 * _keyCount;
+    for (unsigned int c = 0; c < _channelCount; c++)
+    {
+        unsigned int from = pose->_from[c];
+        unsigned int to = pose->_to[c];
+        float t = pose->_t[c];
+
+        for (unsigned int k = 0; k < 3; k++)
+        {
+            const float* keys = _keys + k * _keyCount;
+            values[k * capacity + c] = keys[from] + (keys[to] - keys[from]) * t;
+        }
+        Quaternion::slerp(x[from], y[from], z[from], w[from], x[to], y[to], z[to], w[to], t,
+            &values[3 * capacity + c], &values[4 * capacity + c], &values[5 * capacity + c], &values[6 * capacity + c]);
+        for (unsigned int k = 7; k < POSE_COMPONENTS; k++)
+        {
+            const float* keys = _keys + k * _keyCount;
+            values[k * capacity + c] = keys[from] + (keys[to] - keys[from]) * t;
+        }
+    }
+#endif
+}
+
+void AnimationSampler::blend(Pose* pose, float t) const
+{
+    const unsigned int capacity = pose->_capacity;
+    const float* from = pose->_previous;
+    const float* to = pose->_values;
+    float* values = pose->_blended;
+
+#ifdef GP_USE_SSE
+    static const unsigned int linear[6] = { 0, 1, 2, 7, 8, 9 };
+    const __m128 factor = _mm_set1_ps(t);
+    for (unsigned int c = 0; c < _channelCount; c += 4)
+    {
+        for (unsigned int i = 0; i < 6; i++)
+        {
+            unsigned int offset = linear[i] * capacity + c;
+            __m128 a = _mm_loadu_ps(from + offset);
+            __m128 b = _mm_loadu_ps(to + offset);
+            _mm_storeu_ps(values + offset, _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), factor)));
+        }
+
+        __m128 q1[4];
+        __m128 q2[4];
+        __m128 q[4];
+        for (unsigned int i = 0; i < 4; i++)
+        {
+            q1[i] = _mm_loadu_ps(from + (3 + i) * capacity + c);
+            q2[i] = _mm_loadu_ps(to + (3 + i) * capacity + c);
+        }
+        slerp(q1, q2, factor, q);
+        for (unsigned int i = 0; i < 4; i++)
+            _mm_storeu_ps(values + (3 + i) * capacity + c, q[i]);
+    }
+#else
+    for (unsigned int c = 0; c < _channelCount; c++)
+    {
+        for (unsigned int k = 0; k < 3; k++)
+            values[k * capacity + c] = from[k * capacity + c] + (to[k * capacity + c] - from[k * capacity + c]) * t;
+        Quaternion::slerp(from[3 * capacity + c], from[4 * capacity + c], from[5 * capacity + c], from[6 * capacity + c],
+            to[3 * capacity + c], to[4 * capacity + c], to[5 * capacity + c], to[6 * capacity + c], t,
+            &values[3 * capacity + c], &values[4 * capacity + c], &values[5 * capacity + c], &values[6 * capacity + c]);
+        for (unsigned int k = 7; k < POSE_COMPONENTS; k++)
+            values[k * capacity + c] = from[k * capacity + c] + (to[k * capacity + c] - from[k * capacity + c]) * t;
+    }
+#endif
+}
+
+unsigned int AnimationSampler::findKey(float time, unsigned int min, unsigned int max) const
+{
+    GP_ASSERT(min <= max && max < _keyCount);
+
+    const float* key = std::upper_bound(_times + min, _times + max + 1, time);
+    return key == _times + min ? min : (unsigned int)(key - _times) - 1;
+}
+
+}
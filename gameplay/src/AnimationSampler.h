@@ -0,0 +1,258 @@
+#ifndef ANIMATIONSAMPLER_H_
+#define ANIMATIONSAMPLER_H_
+
+#include "Base.h"
+
+namespace vkcore
+{
+
+class Animation;
+class Node;
+class Transform;
+
+/**
+ * Defines a compiled, structure-of-arrays form of an Animation's transform channels.
+ *
+ * Channels that animate the scale, rotation and/or translation of a Transform with linear
+ * keyframes (the form skeletal animation is exported in) are packed into contiguous key
+ * buffers: one buffer of key times and one buffer per pose component. Sampling a clip
+ * locates the keyframe segment of every channel, interpolates all channels in bulk
+ * (four at a time when SIMD is available) into a pose buffer, and then applies the pose
+ * to the target transforms in a single pass.
+ *
+ * Channels that cannot be compiled (scalar targets, single component properties or
+ * non-linear curves) are left to the regular per-channel Curve evaluation.
+ *
+ * The sampler is built from the channel curves the first time a clip of the animation is
+ * updated and is rebuilt when channels are added or removed. Changes made to the points
+ * of a curve after that are not seen by the sampler.
+ *
+ * For animation level of detail a clip may sample its pose only every few updates,
+ * interpolating between the last two samples in between, and may leave the channels of
+ * joints below a given depth of the skeleton unsampled.
+ */
+class AnimationSampler
+{
+    friend class Animation;
+    friend class AnimationClip;
+
+private:
+
+    /**
+     * Number of floats in a sampled pose: scale (3), rotation (4) and translation (3).
+     */
+    static const unsigned int POSE_COMPONENTS = 10;
+
+    /**
+     * Bits describing which parts of the pose a channel animates.
+     */
+    enum PosePart
+    {
+        POSE_SCALE = 0x01,
+        POSE_ROTATION = 0x02,
+        POSE_TRANSLATION = 0x04
+    };
+
+    /**
+     * Defines the per-clip sampling state and output of a sampler.
+     *
+     * Each playing clip owns a pose, holding the keyframe cursors of the compiled
+     * channels, the sampled component values in structure-of-arrays form and the
+     * reduced rate sampling state of the clip.
+     */
+    class Pose
+    {
+        friend class AnimationSampler;
+
+    public:
+
+        /**
+         * Destructor.
+         */
+        ~Pose();
+
+    private:
+
+        /**
+         * Constructor.
+         */
+        Pose(unsigned int channelCount, unsigned int phase);
+
+        /**
+         * Hidden copy constructor.
+         */
+        Pose(const Pose& copy);
+
+        /**
+         * Hidden copy assignment operator.
+         */
+        Pose& operator=(const Pose&);
+
+        unsigned int _capacity;         // Number of channel slots, rounded up to a multiple of four.
+        float _startTime;               // Subregion start time the cached subregions were resolved for.
+        float _endTime;                 // Subregion end time the cached subregions were resolved for.
+        unsigned int* _min;             // First key of each channel's subregion.
+        unsigned int* _max;             // Last key of each channel's subregion.
+        unsigned int* _cursors;         // Key starting the last sampled segment of each channel.
+        unsigned int* _from;            // Key to interpolate from for each channel.
+        unsigned int* _to;              // Key to interpolate to for each channel.
+        float* _t;                      // Interpolation factor for each channel.
+        float* _values;                 // Sampled values; POSE_COMPONENTS arrays of _capacity floats.
+        float* _previous;               // Values of the sample before _values, when sampling at a reduced rate.
+        float* _blended;                // Values interpolated between _previous and _values.
+        const float* _output;           // The values to apply; either _values or _blended.
+        unsigned int _phase;            // Offset that staggers the sample updates of clips at a reduced rate.
+        unsigned int _interval;         // Number of updates between samples at the current rate.
+        unsigned int _jointDepth;       // Deepest channel sampled at the current rate.
+        unsigned int _countdown;        // Number of updates left until the next sample.
+        unsigned int _step;             // Number of updates since the last sample.
+        bool _sampled;                  // Whether _values holds a sample at the current rate.
+        bool _interpolated;             // Whether _previous holds the sample before _values.
+    };
+
+    /**
+     * Constructor.
+     *
+     * @param animation The animation to compile the channels of.
+     */
+    AnimationSampler(Animation* animation);
+
+    /**
+     * Hidden copy constructor.
+     */
+    AnimationSampler(const AnimationSampler& copy);
+
+    /**
+     * Destructor.
+     */
+    ~AnimationSampler();
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    AnimationSampler& operator=(const AnimationSampler&);
+
+    /**
+     * Creates the sampling state for a clip playing this sampler.
+     *
+     * @param phase The offset that staggers the sample updates of the clip at a reduced rate.
+     *
+     * @return A new pose, owned by the caller.
+     */
+    Pose* createPose(unsigned int phase) const;
+
+    /**
+     * Gets the node whose bounds decide the level of detail of this animation.
+     *
+     * This is the node of the model skinned by the animated joints, or the shallowest
+     * animated node when no skinned model is found.
+     *
+     * @return The level of detail node, or NULL if no compiled channel targets a node.
+     */
+    Node* getLODNode() const;
+
+    /**
+     * Gets the top-level node of the hierarchy that all channels of this animation target.
+     *
+     * Clips of animations with different roots change disjoint sets of transforms and may
+     * be evaluated concurrently.
+     *
+     * @return The root node, or NULL if the channels do not all target nodes of one hierarchy.
+     */
+    Node* getRoot() const;
+
+    /**
+     * Updates the pose of a clip, sampling the compiled channels every updateInterval calls.
+     *
+     * On the calls in between the pose is interpolated from the previous sample towards
+     * the latest one, so at a reduced rate the applied pose trails the clip by up to
+     * updateInterval - 1 updates. Samples of clips running at the same rate are staggered
+     * over the interval.
+     *
+     * The time parameters have the same meaning as those of Curve::evaluate.
+     *
+     * @param time The position within the subregion to sample at.
+     * @param startTime Start time for the subregion (between 0.0 - 1.0).
+     * @param endTime End time for the subregion (between 0.0 - 1.0).
+     * @param loopBlendTime Time to blend between the end points of the subregion when looping.
+     * @param updateInterval The number of calls between samples; 1 samples on every call.
+     * @param jointDepth The deepest channel, relative to the shallowest one, to sample.
+     * @param pose The pose to update.
+     *
+     * @return true if the channels were sampled by this call.
+     */
+    bool update(float time, float startTime, float endTime, float loopBlendTime, unsigned int updateInterval, unsigned int jointDepth, Pose* pose) const;
+
+    /**
+     * Marks the pose of a clip whose model is not visible as out of date, so that it is
+     * sampled afresh when it is next updated.
+     *
+     * @param pose The pose of the culled clip.
+     */
+    void cull(Pose* pose) const;
+
+    /**
+     * Applies an updated pose to the target transforms of the compiled channels.
+     *
+     * @param pose The updated pose.
+     * @param blendWeight The weight to blend the pose with the current transform values.
+     * @param jointDepth The deepest channel, relative to the shallowest one, to apply.
+     */
+    void apply(const Pose* pose, float blendWeight, unsigned int jointDepth) const;
+
+    /**
+     * Samples the compiled channels up to the given depth into the pose values.
+     */
+    void sample(float time, float startTime, float endTime, float loopBlendTime, unsigned int jointDepth, Pose* pose) const;
+
+    /**
+     * Locates the keyframe segment of a channel and stores it in the pose.
+     */
+    void sampleChannel(unsigned int channel, float time, float loopBlendTime, Pose* pose) const;
+
+    /**
+     * Interpolates the located keyframe segments of all channels into the pose values.
+     */
+    void interpolate(Pose* pose) const;
+
+    /**
+     * Interpolates from the previous sample of the pose towards its latest one.
+     */
+    void blend(Pose* pose, float t) const;
+
+    /**
+     * Gets the pose parts animated by a transform property and where each part starts
+     * within the property's value.
+     *
+     * @return The PosePart bits of the property; zero if the property cannot be compiled.
+     */
+    static unsigned char getPoseParts(int propertyId, unsigned int* scaleOffset, unsigned int* rotationOffset, unsigned int* translationOffset);
+
+    /**
+     * Gets the pose parts that any channel of a transform property changes, whether it can be compiled or not.
+     *
+     * @return The PosePart bits of the property.
+     */
+    static unsigned char getAnimatedParts(int propertyId);
+
+    /**
+     * Finds the last key of a channel whose time is less than or equal to the given time.
+     */
+    unsigned int findKey(float time, unsigned int min, unsigned int max) const;
+
+    unsigned int _channelCount;                 // Number of compiled channels.
+    unsigned int _keyCount;                     // Total number of keys over all compiled channels.
+    Transform** _targets;                       // The target transform of each compiled channel.
+    unsigned char* _parts;                      // The PosePart bits each compiled channel animates.
+    unsigned int* _depths;                      // Depth of each compiled channel's target below the shallowest one.
+    unsigned int* _keyOffsets;                  // Offset of each compiled channel's first key; _channelCount + 1 entries.
+    float* _times;                              // Key times of all compiled channels.
+    float* _keys;                               // Key values; POSE_COMPONENTS arrays of _keyCount floats.
+    std::vector<unsigned int> _fallbackChannels; // Indices of the animation channels that were not compiled.
+    Node* _lodTarget;                           // The shallowest animated node; resolves the level of detail node.
+    bool _grouped;                              // Whether all channels target nodes in the hierarchy of _lodTarget.
+};
+
+}
+
+#endif
@@ -80,6 +80,7 @@ private:
     unsigned int _componentCount;   // The number of float values for the property.
     unsigned int _componentSize;    // The number of bytes of memory the property is.
     float* _value;                  // The current value of the property.
+    Curve::Cursor _cursor;          // Keyframe segment last evaluated for this value.
 
 };
 
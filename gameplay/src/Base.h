@@ -31,6 +31,7 @@
 #include <typeinfo>
 #include <thread>
 #include <mutex>
+#include <atomic>
 #include <chrono>
 #include "Logger.h"
 
@@ -208,6 +208,21 @@ public:
      */
     void transform(const Matrix& matrix);
 
+    /**
+     * Transforms an array of bounding boxes by the given transformation matrix
+     * and stores the resulting axis-aligned boxes in dst.
+     *
+     * Each box is transformed by its center and half extents rather than by its
+     * eight corners, which yields the same box for affine matrices at a fraction
+     * of the cost.
+     *
+     * @param matrix The transformation matrix to transform by.
+     * @param boxes The bounding boxes to transform.
+     * @param dst An array to store the transformed boxes in (may be the same array as boxes).
+     * @param count The number of bounding boxes to transform.
+     */
+    static void transform(const Matrix& matrix, const BoundingBox* boxes, BoundingBox* dst, unsigned int count);
+
     /**
      * Transforms this bounding box by the given matrix.
      * 
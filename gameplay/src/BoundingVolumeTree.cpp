@@ -0,0 +1,389 @@
+#include "Base.h"
+#include "BoundingVolumeTree.h"
+#include "Scene.h"
+#include "Node.h"
+
+// The maximum depth of a tree traversal. Trees are built by median splits, so their
+// depth is about log2 of the number of nodes.
+#define BVH_STACK_SIZE 64
+
+// The bits of the frustum planes in a plane mask.
+#define BVH_ALL_PLANES 0x3f
+
+namespace vkcore
+{
+
+BoundingVolumeTree::BoundingVolumeTree(Scene* scene) :
+    _scene(scene), _root(-1), _dirty(true)
+{
+    GP_ASSERT(scene);
+}
+
+BoundingVolumeTree::~BoundingVolumeTree()
+{
+}
+
+void BoundingVolumeTree::setDirty()
+{
+    _dirty = true;
+}
+
+void BoundingVolumeTree::setLeafMoved(Node* node, int leaf)
+{
+    // Leaf indices of nodes that left the tree are stale until the next rebuild.
+    if (_dirty || leaf >= (int)_elements.size())
+        return;
+
+    Element& element = _elements[leaf];
+    if (element.node == node && !element.moved)
+    {
+        element.moved = true;
+        _moved.push_back(leaf);
+    }
+}
+
+void BoundingVolumeTree::rebuild()
+{
+    _elements.clear();
+    _moved.clear();
+    _unbounded.clear();
+    _root = -1;
+    _dirty = false;
+
+    for (Node* node = _scene->getFirstNode(); node != NULL; node = node->getNextSibling())
+    {
+        addLeaves(node);
+    }
+
+    unsigned int leafCount = (unsigned int)_elements.size();
+    if (leafCount == 0)
+        return;
+
+    std::vector<int> leaves(leafCount);
+    for (unsigned int i = 0; i < leafCount; ++i)
+        leaves[i] = (int)i;
+    _elements.reserve(2 * leafCount - 1);
+    _root = build(&leaves[0], leafCount, -1);
+}
+
+void BoundingVolumeTree::addLeaves(Node* node)
+{
+    GP_ASSERT(node);
+
+    node->_boundsLeaf = -1;
+    if (node->getDrawable())
+    {
+        BoundingSphere sphere;
+        if (node->getLocalBoundingSphere(&sphere))
+        {
+            Element leaf;
+            leaf.box.set(sphere);
+            leaf.node = node;
+            leaf.parent = -1;
+            leaf.left = -1;
+            leaf.right = -1;
+            leaf.moved = false;
+            node->_boundsLeaf = (int)_elements.size();
+            _elements.push_back(leaf);
+        }
+        else
+        {
+            _unbounded.push_back(node);
+        }
+    }
+
+    for (Node* child = node->getFirstChild(); child != NULL; child = child->getNextSibling())
+    {
+        addLeaves(child);
+    }
+}
+
+int BoundingVolumeTree::build(int* leaves, unsigned int count, int parent)
+{
+    GP_ASSERT(leaves && count > 0);
+
+    if (count == 1)
+    {
+        _elements[leaves[0]].parent = parent;
+        return leaves[0];
+    }
+
+    // Split at the median of the leaf centers along the axis where they are most spread out.
+    BoundingBox centers = BoundingBox::empty();
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        Vector3 center = _elements[leaves[i]].box.getCenter();
+        centers.merge(BoundingBox(center, center));
+    }
+    Vector3 extent = centers.max - centers.min;
+    int axis = extent.x >= extent.y ? (extent.x >= extent.z ? 0 : 2) : (extent.y >= extent.z ? 1 : 2);
+
+    const std::vector<Element>& elements = _elements;
+    unsigned int half = count / 2;
+    std::nth_element(leaves, leaves + half, leaves + count, [&elements, axis](int a, int b)
+    {
+        const BoundingBox& boxA = elements[a].box;
+        const BoundingBox& boxB = elements[b].box;
+        return (&boxA.min.x)[axis] + (&boxA.max.x)[axis] < (&boxB.min.x)[axis] + (&boxB.max.x)[axis];
+    });
+
+    int index = (int)_elements.size();
+    Element inner;
+    inner.node = NULL;
+    inner.parent = parent;
+    inner.moved = false;
+    _elements.push_back(inner);
+
+    int left = build(leaves, half, index);
+    int right = build(leaves + half, count - half, index);
+
+    Element& element = _elements[index];
+    element.left = left;
+    element.right = right;
+    element.box = _elements[left].box;
+    element.box.merge(_elements[right].box);
+
+    return index;
+}
+
+void BoundingVolumeTree::update()
+{
+    if (_dirty)
+    {
+        rebuild();
+        return;
+    }
+
+    for (size_t i = 0, count = _moved.size(); i < count; ++i)
+    {
+        Element& leaf = _elements[_moved[i]];
+        leaf.moved = false;
+
+        BoundingSphere sphere;
+        leaf.node->getLocalBoundingSphere(&sphere);
+        leaf.box.set(sphere);
+
+        // Refit the ancestors, stopping early where another refit already covers the leaf.
+        for (int parent = leaf.parent; parent >= 0; parent = _elements[parent].parent)
+        {
+            Element& element = _elements[parent];
+            BoundingBox box(_elements[element.left].box);
+            box.merge(_elements[element.right].box);
+            if (box.min == element.box.min && box.max == element.box.max)
+                break;
+            element.box = box;
+        }
+    }
+    _moved.clear();
+}
+
+unsigned int BoundingVolumeTree::getNodeCount()
+{
+    update();
+
+    return _root < 0 ? (unsigned int)_unbounded.size() : (unsigned int)(_elements.size() + 1) / 2 + (unsigned int)_unbounded.size();
+}
+
+const BoundingBox& BoundingVolumeTree::getBounds()
+{
+    update();
+
+    return _root < 0 ? BoundingBox::empty() : _elements[_root].box;
+}
+
+void BoundingVolumeTree::addNode(Node* node, std::vector<Node*>& nodes)
+{
+    if (node->isEnabledInHierarchy())
+        nodes.push_back(node);
+}
+
+void BoundingVolumeTree::addAll(int element, std::vector<Node*>& nodes) const
+{
+    int stack[BVH_STACK_SIZE];
+    unsigned int size = 0;
+    stack[size++] = element;
+    while (size > 0)
+    {
+        const Element& e = _elements[stack[--size]];
+        if (e.node)
+        {
+            addNode(e.node, nodes);
+        }
+        else
+        {
+            GP_ASSERT(size + 2 <= BVH_STACK_SIZE);
+            stack[size++] = e.right;
+            stack[size++] = e.left;
+        }
+    }
+}
+
+unsigned int BoundingVolumeTree::query(const Frustum& frustum, std::vector<Node*>& nodes)
+{
+    update();
+
+    size_t first = nodes.size();
+    for (size_t i = 0, count = _unbounded.size(); i < count; ++i)
+        addNode(_unbounded[i], nodes);
+
+    if (_root >= 0)
+    {
+        const Plane* planes[6] = { &frustum.getNear(), &frustum.getFar(), &frustum.getLeft(),
+                                   &frustum.getRight(), &frustum.getBottom(), &frustum.getTop() };
+
+        // Each entry carries the planes its parent was not already entirely inside of.
+        int stack[BVH_STACK_SIZE];
+        unsigned int masks[BVH_STACK_SIZE];
+        unsigned int size = 0;
+        stack[size] = _root;
+        masks[size++] = BVH_ALL_PLANES;
+        while (size > 0)
+        {
+            --size;
+            int index = stack[size];
+            unsigned int mask = masks[size];
+            const Element& e = _elements[index];
+
+            Vector3 center = e.box.getCenter();
+            Vector3 extent = (e.box.max - e.box.min) * 0.5f;
+            bool outside = false;
+            for (unsigned int p = 0; p < 6; ++p)
+            {
+                if ((mask & (1 << p)) == 0)
+                    continue;
+
+                // Compare the distance of the center with the projected radius of the box.
+                const Vector3& normal = planes[p]->getNormal();
+                float distance = planes[p]->distance(center);
+                float radius = fabsf(normal.x) * extent.x + fabsf(normal.y) * extent.y + fabsf(normal.z) * extent.z;
+                if (distance < -radius)
+                {
+                    outside = true;
+                    break;
+                }
+                if (distance >= radius)
+                    mask &= ~(1 << p);
+            }
+            if (outside)
+                continue;
+
+            if (mask == 0)
+            {
+                // Entirely inside the frustum: take the whole subtree without testing it.
+                addAll(index, nodes);
+            }
+            else if (e.node)
+            {
+                addNode(e.node, nodes);
+            }
+            else
+            {
+                GP_ASSERT(size + 2 <= BVH_STACK_SIZE);
+                stack[size] = e.right;
+                masks[size++] = mask;
+                stack[size] = e.left;
+                masks[size++] = mask;
+            }
+        }
+    }
+
+    return (unsigned int)(nodes.size() - first);
+}
+
+unsigned int BoundingVolumeTree::query(const BoundingSphere& sphere, std::vector<Node*>& nodes)
+{
+    update();
+
+    size_t first = nodes.size();
+    if (_root >= 0)
+    {
+        int stack[BVH_STACK_SIZE];
+        unsigned int size = 0;
+        stack[size++] = _root;
+        while (size > 0)
+        {
+            const Element& e = _elements[stack[--size]];
+            if (!e.box.intersects(sphere))
+                continue;
+
+            if (e.node)
+            {
+                addNode(e.node, nodes);
+            }
+            else
+            {
+                GP_ASSERT(size + 2 <= BVH_STACK_SIZE);
+                stack[size++] = e.right;
+                stack[size++] = e.left;
+            }
+        }
+    }
+
+    return (unsigned int)(nodes.size() - first);
+}
+
+unsigned int BoundingVolumeTree::query(const BoundingBox& box, std::vector<Node*>& nodes)
+{
+    update();
+
+    size_t first = nodes.size();
+    if (_root >= 0)
+    {
+        int stack[BVH_STACK_SIZE];
+        unsigned int size = 0;
+        stack[size++] = _root;
+        while (size > 0)
+        {
+            const Element& e = _elements[stack[--size]];
+            if (!e.box.intersects(box))
+                continue;
+
+            if (e.node)
+            {
+                addNode(e.node, nodes);
+            }
+            else
+            {
+                GP_ASSERT(size + 2 <= BVH_STACK_SIZE);
+                stack[size++] = e.right;
+                stack[size++] = e.left;
+            }
+        }
+    }
+
+    return (unsigned int)(nodes.size() - first);
+}
+
+unsigned int BoundingVolumeTree::query(const Ray& ray, std::vector<Node*>& nodes)
+{
+    update();
+
+    size_t first = nodes.size();
+    if (_root >= 0)
+    {
+        int stack[BVH_STACK_SIZE];
+        unsigned int size = 0;
+        stack[size++] = _root;
+        while (size > 0)
+        {
+            const Element& e = _elements[stack[--size]];
+            if (e.box.intersects(ray) == Ray::INTERSECTS_NONE)
+                continue;
+
+            if (e.node)
+            {
+                addNode(e.node, nodes);
+            }
+            else
+            {
+                GP_ASSERT(size + 2 <= BVH_STACK_SIZE);
+                stack[size++] = e.right;
+                stack[size++] = e.left;
+            }
+        }
+    }
+
+    return (unsigned int)(nodes.size() - first);
+}
+
+}
@@ -0,0 +1,185 @@
+#ifndef BOUNDINGVOLUMETREE_H_
+#define BOUNDINGVOLUMETREE_H_
+
+#include "BoundingBox.h"
+#include "BoundingSphere.h"
+#include "Frustum.h"
+#include "Ray.h"
+
+namespace vkcore
+{
+
+class Scene;
+class Node;
+
+/**
+ * Defines a bounding volume hierarchy over the drawable nodes of a scene.
+ *
+ * The tree is a binary hierarchy of axis-aligned bounding boxes whose leaves are the
+ * nodes of the scene that have a drawable. It answers frustum, sphere, box and ray
+ * queries in time proportional to the number of nodes they return rather than the
+ * number of nodes in the scene, since whole subtrees are rejected (or, for frustum
+ * queries, accepted) with a single test.
+ *
+ * The tree is owned by its scene and kept up to date lazily. When a node moves, or its
+ * bounds change, only its leaf is marked; the boxes of the marked leaves and their
+ * ancestors are refit before the next query. Adding, removing or reparenting nodes or
+ * changing their drawables marks the whole tree, which is then rebuilt before the next
+ * query. Refitting keeps the topology of the tree, so a tree whose nodes have moved far
+ * from where they were when it was built may be rebuilt explicitly to regain query speed.
+ *
+ * The bounds of a leaf are those of the node's own drawable, not including its children,
+ * which have leaves of their own. Drawables without bounds (such as particle emitters,
+ * forms and text) are kept outside of the hierarchy and are returned by every frustum
+ * query. Queries skip nodes that are not enabled in the hierarchy.
+ */
+class BoundingVolumeTree
+{
+    friend class Scene;
+    friend class Node;
+
+public:
+
+    /**
+     * Gets the nodes whose bounds intersect the given frustum.
+     *
+     * @param frustum The frustum to test against.
+     * @param nodes The vector to append the nodes to.
+     *
+     * @return The number of nodes appended.
+     */
+    unsigned int query(const Frustum& frustum, std::vector<Node*>& nodes);
+
+    /**
+     * Gets the nodes whose bounds intersect the given sphere.
+     *
+     * @param sphere The sphere to test against.
+     * @param nodes The vector to append the nodes to.
+     *
+     * @return The number of nodes appended.
+     */
+    unsigned int query(const BoundingSphere& sphere, std::vector<Node*>& nodes);
+
+    /**
+     * Gets the nodes whose bounds intersect the given box.
+     *
+     * @param box The box to test against.
+     * @param nodes The vector to append the nodes to.
+     *
+     * @return The number of nodes appended.
+     */
+    unsigned int query(const BoundingBox& box, std::vector<Node*>& nodes);
+
+    /**
+     * Gets the nodes whose bounds are hit by the given ray.
+     *
+     * The nodes are appended in no particular order; the bounds are only a conservative
+     * approximation of the drawables, so the hits should be tested further by the caller.
+     *
+     * @param ray The ray to test against.
+     * @param nodes The vector to append the nodes to.
+     *
+     * @return The number of nodes appended.
+     */
+    unsigned int query(const Ray& ray, std::vector<Node*>& nodes);
+
+    /**
+     * Rebuilds the tree from the current bounds of the scene's nodes.
+     */
+    void rebuild();
+
+    /**
+     * Gets the number of drawable nodes in the tree, including those without bounds.
+     *
+     * @return The number of drawable nodes.
+     */
+    unsigned int getNodeCount();
+
+    /**
+     * Gets the bounds of all of the drawable nodes in the tree.
+     *
+     * @return The bounds of the root of the tree; empty if the tree has no bounded nodes.
+     */
+    const BoundingBox& getBounds();
+
+private:
+
+    /**
+     * An element of the tree: either a leaf referencing a node, or an inner element with two children.
+     */
+    struct Element
+    {
+        BoundingBox box;
+        Node* node;
+        int parent;
+        int left;
+        int right;
+        bool moved;
+    };
+
+    /**
+     * Constructor.
+     */
+    BoundingVolumeTree(Scene* scene);
+
+    /**
+     * Destructor.
+     */
+    ~BoundingVolumeTree();
+
+    /**
+     * Hidden copy constructor.
+     */
+    BoundingVolumeTree(const BoundingVolumeTree& copy);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    BoundingVolumeTree& operator=(const BoundingVolumeTree&);
+
+    /**
+     * Marks the tree as needing a rebuild.
+     */
+    void setDirty();
+
+    /**
+     * Marks the leaf of the given node as needing a refit.
+     */
+    void setLeafMoved(Node* node, int leaf);
+
+    /**
+     * Rebuilds the tree if it is dirty, otherwise refits the leaves that have moved.
+     */
+    void update();
+
+    /**
+     * Adds the leaves of the drawable nodes in the given subtree of the scene.
+     */
+    void addLeaves(Node* node);
+
+    /**
+     * Builds the subtree over the given leaves and returns the index of its root.
+     */
+    int build(int* leaves, unsigned int count, int parent);
+
+    /**
+     * Appends the nodes of the leaves under the given element, without further tests.
+     */
+    void addAll(int element, std::vector<Node*>& nodes) const;
+
+    /**
+     * Appends the given node if it is enabled.
+     */
+    static void addNode(Node* node, std::vector<Node*>& nodes);
+
+    Scene* _scene;                      // The scene the tree belongs to.
+    std::vector<Element> _elements;     // Leaves first, then inner elements.
+    std::vector<int> _moved;            // Leaves whose bounds need a refit.
+    std::vector<Node*> _unbounded;      // Drawable nodes without bounds.
+    int _root;                          // The root element, or -1 if the tree is empty.
+    bool _dirty;                        // Whether the tree needs a rebuild.
+};
+
+}
+
+#endif
@@ -4,6 +4,7 @@
 #include "MeshPart.h"
 #include "Scene.h"
 #include "Joint.h"
+#include "jobsystem.hpp"
 
 // Minimum version numbers supported
 #define BUNDLE_VERSION_MAJOR_REQUIRED   1 
@@ -30,23 +31,52 @@
 #define BUNDLE_VERSION_MAJOR_FONT_FORMAT  1
 #define BUNDLE_VERSION_MINOR_FONT_FORMAT  5
 
+// Version of bundles whose bulk data is stored in a table of aligned sections
+#define BUNDLE_VERSION_MAJOR_SECTIONS   2
+#define BUNDLE_VERSION_MINOR_SECTIONS   0
+
+// Alignment of sections within the file and of blobs within a section
+#define BUNDLE_SECTION_ALIGNMENT        16
+
+#define BUNDLE_COMPRESSION_NONE         0
+#define BUNDLE_COMPRESSION_LZ4          1
+
+// Size of the hash table used to find matches when compressing, as a power of two
+#define BUNDLE_LZ4_HASH_BITS            12
+#define BUNDLE_LZ4_MIN_MATCH            4
+
+// Largest ratio of the decompressed to the compressed size of LZ4 data, reached by long runs
+// of matches whose lengths are encoded with one byte per 255 bytes of output
+#define BUNDLE_LZ4_MAX_RATIO            255
+
 namespace vkcore
 {
 
-static std::vector<Bundle*> __bundleCache;
+// Bundles that are loaded, by path.
+static std::unordered_map<std::string, Bundle*> __bundleCache;
+
+Bundle::Bundle(const char* path, float compressionTolerance) :
+    _path(path), _referenceCount(0), _references(NULL), _stream(NULL), _trackedNodes(NULL), _preloadedRef(NULL),
+    _compressionTolerance(compressionTolerance), _animationDataSize(0), _compressedDataSize(0), _compressionError(0.0f), _jobSystem(NULL)
+{
+}
 
-Bundle::Bundle(const char* path) :
-    _path(path), _referenceCount(0), _references(NULL), _stream(NULL), _trackedNodes(NULL)
+float Bundle::getCompressionTolerance()
 {
+    Properties* config = Game::getInstance()->getConfig()->getNamespace("animation", true);
+    if (config && config->exists("compressionTolerance"))
+        return config->getFloat("compressionTolerance");
+    return -1.0f;
 }
 
 Bundle::~Bundle()
 {
     clearLoadSession();
+    clearPreloaded();
 
     // Remove this Bundle from the cache.
-    std::vector<Bundle*>::iterator itr = std::find(__bundleCache.begin(), __bundleCache.end(), this);
-    if (itr != __bundleCache.end())
+    std::unordered_map<std::string, Bundle*>::iterator itr = __bundleCache.find(_path);
+    if (itr != __bundleCache.end() && itr->second == this)
     {
         __bundleCache.erase(itr);
     }
@@ -69,6 +99,11 @@ unsigned int Bundle::getVersionMinor() const
     return (unsigned int)_version[1];
 }
 
+bool Bundle::hasObjectVersion(unsigned int minor) const
+{
+    return _objectVersion[0] > 1 || (_objectVersion[0] == 1 && _objectVersion[1] >= minor);
+}
+
 template <class T>
 bool Bundle::readArray(unsigned int* length, T** ptr)
 {
@@ -168,25 +203,185 @@ static std::string readString(Stream* stream)
     return str;
 }
 
+static void writeData(std::vector<unsigned char>* data, const void* ptr, size_t size)
+{
+    const unsigned char* bytes = (const unsigned char*)ptr;
+    data->insert(data->end(), bytes, bytes + size);
+}
+
+static void writeUInt(std::vector<unsigned char>* data, unsigned int value)
+{
+    writeData(data, &value, sizeof(unsigned int));
+}
+
+static size_t alignSection(size_t offset)
+{
+    return (offset + BUNDLE_SECTION_ALIGNMENT - 1) & ~(size_t)(BUNDLE_SECTION_ALIGNMENT - 1);
+}
+
+static unsigned char* writeLZ4Length(unsigned char* op, size_t length)
+{
+    while (length >= 255)
+    {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = (unsigned char)length;
+    return op;
+}
+
+static unsigned char* writeLZ4Sequence(unsigned char* op, const unsigned char* literals, size_t literalLength, size_t offset, size_t matchLength)
+{
+    unsigned char* token = op++;
+    *token = (unsigned char)((literalLength >= 15 ? 15 : literalLength) << 4);
+    if (literalLength >= 15)
+        op = writeLZ4Length(op, literalLength - 15);
+    memcpy(op, literals, literalLength);
+    op += literalLength;
+
+    // The last sequence of a block holds literals only.
+    if (matchLength == 0)
+        return op;
+
+    *op++ = (unsigned char)(offset & 0xff);
+    *op++ = (unsigned char)(offset >> 8);
+    matchLength -= BUNDLE_LZ4_MIN_MATCH;
+    *token |= (unsigned char)(matchLength >= 15 ? 15 : matchLength);
+    if (matchLength >= 15)
+        op = writeLZ4Length(op, matchLength - 15);
+    return op;
+}
+
+/**
+ * Compresses a block of data in the LZ4 block format.
+ *
+ * @return The compressed size; dst must hold at least size + size / 255 + 16 bytes.
+ */
+static size_t compressLZ4(const unsigned char* src, size_t size, unsigned char* dst)
+{
+    unsigned char* op = dst;
+    size_t anchor = 0;
+
+    // The format requires the last match to start 12 bytes and end 5 bytes before the end of the block.
+    if (size > 12)
+    {
+        std::vector<size_t> table(1 << BUNDLE_LZ4_HASH_BITS, (size_t)-1);
+        size_t matchLimit = size - 5;
+        size_t ip = 0;
+        while (ip + 12 <= size)
+        {
+            unsigned int sequence;
+            memcpy(&sequence, src + ip, 4);
+            unsigned int hash = (sequence * 2654435761u) >> (32 - BUNDLE_LZ4_HASH_BITS);
+            size_t candidate = table[hash];
+            table[hash] = ip;
+            if (candidate != (size_t)-1 && ip - candidate <= 65535 && memcmp(src + candidate, src + ip, 4) == 0)
+            {
+                size_t matchLength = BUNDLE_LZ4_MIN_MATCH;
+                while (ip + matchLength < matchLimit && src[candidate + matchLength] == src[ip + matchLength])
+                    ++matchLength;
+                op = writeLZ4Sequence(op, src + anchor, ip - anchor, ip - candidate, matchLength);
+                ip += matchLength;
+                anchor = ip;
+            }
+            else
+            {
+                ++ip;
+            }
+        }
+    }
+
+    op = writeLZ4Sequence(op, src + anchor, size - anchor, 0, 0);
+    return (size_t)(op - dst);
+}
+
+static bool readLZ4Length(const unsigned char** ip, const unsigned char* end, size_t* length)
+{
+    unsigned char b;
+    do
+    {
+        if (*ip >= end)
+            return false;
+        b = *(*ip)++;
+        *length += b;
+    } while (b == 255);
+    return true;
+}
+
+/**
+ * Decompresses a block of data in the LZ4 block format.
+ *
+ * @return True if the block was valid and decompressed to exactly dstSize bytes.
+ */
+static bool decompressLZ4(const unsigned char* src, size_t srcSize, unsigned char* dst, size_t dstSize)
+{
+    const unsigned char* ip = src;
+    const unsigned char* end = src + srcSize;
+    unsigned char* op = dst;
+    unsigned char* outEnd = dst + dstSize;
+    while (ip < end)
+    {
+        unsigned char token = *ip++;
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !readLZ4Length(&ip, end, &literalLength))
+            return false;
+        if ((size_t)(end - ip) < literalLength || (size_t)(outEnd - op) < literalLength)
+            return false;
+        memcpy(op, ip, literalLength);
+        ip += literalLength;
+        op += literalLength;
+        if (ip == end)
+            break;
+
+        if (end - ip < 2)
+            return false;
+        size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - dst))
+            return false;
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !readLZ4Length(&ip, end, &matchLength))
+            return false;
+        matchLength += BUNDLE_LZ4_MIN_MATCH;
+        if ((size_t)(outEnd - op) < matchLength)
+            return false;
+
+        // Matches may overlap the bytes they produce, so copy forwards byte by byte.
+        const unsigned char* match = op - offset;
+        for (size_t i = 0; i < matchLength; ++i)
+            op[i] = match[i];
+        op += matchLength;
+    }
+    return op == outEnd;
+}
+
 Bundle* Bundle::create(const char* path)
 {
     GP_ASSERT(path);
 
     // Search the cache for this bundle.
-    for (size_t i = 0, count = __bundleCache.size(); i < count; ++i)
+    std::unordered_map<std::string, Bundle*>::iterator itr = __bundleCache.find(path);
+    if (itr != __bundleCache.end())
     {
-        Bundle* p = __bundleCache[i];
-        GP_ASSERT(p);
-        if (p->_path == path)
-        {
-            // Found a match
-            p->addRef();
-            return p;
-        }
+        // Found a match
+        GP_ASSERT(itr->second);
+        itr->second->addRef();
+        return itr->second;
     }
 
-    // Open the bundle.
-    Stream* stream = FileSystem::open(path);
+    Bundle* bundle = open(path, getCompressionTolerance());
+    if (bundle)
+        __bundleCache[bundle->_path] = bundle;
+
+    return bundle;
+}
+
+Bundle* Bundle::open(const char* path, float compressionTolerance)
+{
+    GP_ASSERT(path);
+
+    // Open the bundle, mapping it into memory so that mesh data can be used in place.
+    Stream* stream = FileSystem::open(path, FileSystem::READ | FileSystem::MAPPED);
     if (!stream)
     {
         GP_WARN("Failed to open file '%s'.", path);
@@ -211,13 +406,23 @@ Bundle* Bundle::create(const char* path)
         return NULL;
     }
     // Check for the minimal 
-    if (version[0] != BUNDLE_VERSION_MAJOR_REQUIRED || version[1] < BUNDLE_VERSION_MINOR_REQUIRED)
+    bool sectioned = version[0] == BUNDLE_VERSION_MAJOR_SECTIONS;
+    if (!sectioned && (version[0] != BUNDLE_VERSION_MAJOR_REQUIRED || version[1] < BUNDLE_VERSION_MINOR_REQUIRED))
     {
         SAFE_DELETE(stream);
         GP_WARN("Unsupported version (%d.%d) for bundle '%s' (expected %d.%d).", (int)version[0], (int)version[1], path, BUNDLE_VERSION_MAJOR_REQUIRED, BUNDLE_VERSION_MINOR_REQUIRED);
         return NULL;
     }
 
+    // Sectioned bundles encode their objects as the version 1 bundle they were converted from.
+    unsigned char objectVersion[2] = { version[0], version[1] };
+    if (sectioned && stream->read(objectVersion, 1, 2) != 2)
+    {
+        SAFE_DELETE(stream);
+        GP_WARN("Failed to read GPB object version for bundle '%s'.", path);
+        return NULL;
+    }
+
     // Read ref table.
     unsigned int refCount;
     if (stream->read(&refCount, 4, 1) != 1)
@@ -242,14 +447,59 @@ Bundle* Bundle::create(const char* path)
         }
     }
 
+    // Read the section table.
+    std::vector<Section> sections;
+    if (sectioned)
+    {
+        unsigned int sectionCount;
+        if (stream->read(&sectionCount, 4, 1) != 1)
+        {
+            SAFE_DELETE(stream);
+            GP_WARN("Failed to read section table for bundle '%s'.", path);
+            SAFE_DELETE_ARRAY(refs);
+            return NULL;
+        }
+        sections.resize(sectionCount);
+        for (unsigned int i = 0; i < sectionCount; ++i)
+        {
+            Section& section = sections[i];
+            if (stream->read(&section.offset, 4, 1) != 1 ||
+                stream->read(&section.size, 4, 1) != 1 ||
+                stream->read(&section.uncompressedSize, 4, 1) != 1 ||
+                stream->read(&section.compression, 4, 1) != 1 ||
+                (size_t)section.offset + section.size > stream->length() ||
+                (section.compression == BUNDLE_COMPRESSION_NONE && section.uncompressedSize != section.size) ||
+                (section.compression == BUNDLE_COMPRESSION_LZ4 && (uint64_t)section.uncompressedSize > (uint64_t)section.size * BUNDLE_LZ4_MAX_RATIO))
+            {
+                SAFE_DELETE(stream);
+                GP_WARN("Failed to read section number %d for bundle '%s'.", i, path);
+                SAFE_DELETE_ARRAY(refs);
+                return NULL;
+            }
+        }
+    }
+
     // Keep file open for faster reading later.
-    Bundle* bundle = new Bundle(path);
+    Bundle* bundle = new Bundle(path, compressionTolerance);
     bundle->_version[0] = version[0];
     bundle->_version[1] = version[1];
+    bundle->_objectVersion[0] = objectVersion[0];
+    bundle->_objectVersion[1] = objectVersion[1];
+    bundle->_sections.swap(sections);
     bundle->_referenceCount = refCount;
     bundle->_references = refs;
     bundle->_stream = stream;
 
+    // Index the refs by id and by offset. Where several refs share an id or offset, the
+    // first one wins, as it would for a search of the ref table.
+    bundle->_referenceIds.reserve(refCount);
+    bundle->_referenceOffsets.reserve(refCount);
+    for (unsigned int i = 0; i < refCount; ++i)
+    {
+        bundle->_referenceIds.insert(std::make_pair(refs[i].id, &refs[i]));
+        bundle->_referenceOffsets.insert(std::make_pair(refs[i].offset, &refs[i]));
+    }
+
     return bundle;
 }
 
@@ -258,17 +508,9 @@ Bundle::Reference* Bundle::find(const char* id) const
     GP_ASSERT(id);
     GP_ASSERT(_references);
 
-    // Search the ref table for the given id (case-sensitive).
-    for (unsigned int i = 0; i < _referenceCount; ++i)
-    {
-        if (_references[i].id == id)
-        {
-            // Found a match
-            return &_references[i];
-        }
-    }
-
-    return NULL;
+    // Look up the given id (case-sensitive).
+    std::unordered_map<std::string, Reference*>::const_iterator itr = _referenceIds.find(id);
+    return itr != _referenceIds.end() ? itr->second : NULL;
 }
 
 void Bundle::clearLoadSession()
@@ -278,6 +520,16 @@ void Bundle::clearLoadSession()
         SAFE_DELETE(_meshSkins[i]);
     }
     _meshSkins.clear();
+    _curves.clear();
+
+    if (_animationDataSize > 0)
+    {
+        Logger::log(Logger::LEVEL_INFO, "Compressed animations in bundle '%s' from %u to %u bytes (max error %f).\n",
+            _path.c_str(), _animationDataSize, _compressedDataSize, _compressionError);
+        _animationDataSize = 0;
+        _compressedDataSize = 0;
+        _compressionError = 0.0f;
+    }
 }
 
 const char* Bundle::getIdFromOffset() const
@@ -288,16 +540,14 @@ const char* Bundle::getIdFromOffset() const
 
 const char* Bundle::getIdFromOffset(unsigned int offset) const
 {
-    // Search the ref table for the given offset.
+    // Look up the given offset.
     if (offset > 0)
     {
         GP_ASSERT(_references);
-        for (unsigned int i = 0; i < _referenceCount; ++i)
+        std::unordered_map<unsigned int, Reference*>::const_iterator itr = _referenceOffsets.find(offset);
+        if (itr != _referenceOffsets.end())
         {
-            if (_references[i].offset == offset && _references[i].id.length() > 0)
-            {
-                return _references[i].id.c_str();
-            }
+            return itr->second->id.c_str();
         }
     }
     return NULL;
@@ -384,6 +634,28 @@ bool Bundle::read(float* ptr)
     return _stream->read(ptr, sizeof(float), 1) == 1;
 }
 
+bool Bundle::readBlob(Stream* stream, unsigned int size, bool mapped, unsigned char** data, bool* isMapped)
+{
+    GP_ASSERT(stream);
+    GP_ASSERT(data && isMapped);
+
+    // Point into the mapped file rather than copying, when it is.
+    const unsigned char* fileData = mapped ? stream->getData() : NULL;
+    if (fileData)
+    {
+        long int position = stream->position();
+        if (position < 0 || (size_t)position + size > stream->length() || !stream->seek(size, SEEK_CUR))
+            return false;
+        *data = const_cast<unsigned char*>(fileData + position);
+        *isMapped = true;
+        return true;
+    }
+
+    *data = new unsigned char[size];
+    *isMapped = false;
+    return stream->read(*data, 1, size) == size;
+}
+
 bool Bundle::readMatrix(float* m)
 {
     return _stream->read(m, sizeof(float), 16) == 16;
@@ -413,6 +685,18 @@ Scene* Bundle::loadScene(const char* id)
         }
     }
 
+    // Decode the meshes and skins of the scene up front, in parallel, so reading the nodes only creates them.
+    if (_jobSystem && _preloadedRef != ref)
+    {
+        preload(ref, NULL);
+        if (_stream->seek(ref->offset, SEEK_SET) == false)
+        {
+            GP_ERROR("Failed to seek to object '%s' in bundle '%s'.", ref->id.c_str(), _path.c_str());
+            return NULL;
+        }
+    }
+    _preloadedRef = NULL;
+
     Scene* scene = Scene::create(getIdFromOffset());
 
     // Read the number of children.
@@ -469,22 +753,30 @@ Scene* Bundle::loadScene(const char* id)
     }
     scene->setAmbientColor(red, green, blue);
 
-    // Parse animations.
+    // Parse animations, unless they were built ahead of time.
     GP_ASSERT(_references);
     GP_ASSERT(_stream);
-    for (unsigned int i = 0; i < _referenceCount; ++i)
+    if (!_preloadedAnimations.empty())
     {
-        Reference* ref = &_references[i];
-        if (ref->type == BUNDLE_TYPE_ANIMATIONS)
+        createAnimations(scene);
+    }
+    else
+    {
+        for (unsigned int i = 0; i < _referenceCount; ++i)
         {
-            // Found a match.
-            if (_stream->seek(ref->offset, SEEK_SET) == false)
+            Reference* ref = &_references[i];
+            if (ref->type == BUNDLE_TYPE_ANIMATIONS)
             {
-                GP_ERROR("Failed to seek to object '%s' in bundle '%s'.", ref->id.c_str(), _path.c_str());
-                return NULL;
+                // Found a match.
+                if (_stream->seek(ref->offset, SEEK_SET) == false)
+                {
+                    GP_ERROR("Failed to seek to object '%s' in bundle '%s'.", ref->id.c_str(), _path.c_str());
+                    return NULL;
+                }
+                readAnimations(scene);
             }
-            readAnimations(scene);
         }
+        compressCurves();
     }
 
     resolveJointReferences(scene, NULL);
@@ -492,6 +784,16 @@ Scene* Bundle::loadScene(const char* id)
     return scene;
 }
 
+void Bundle::setJobSystem(vkTools::JobSystem* jobSystem)
+{
+    _jobSystem = jobSystem;
+}
+
+vkTools::JobSystem* Bundle::getJobSystem() const
+{
+    return _jobSystem;
+}
+
 Node* Bundle::loadNode(const char* id)
 {
     return loadNode(id, NULL);
@@ -510,8 +812,15 @@ Node* Bundle::loadNode(const char* id, Scene* sceneContext)
     Node* node = loadNode(id, sceneContext, NULL);
     if (node)
         resolveJointReferences(sceneContext, node);
+    _preloadedRef = NULL;
 
     // Load all animations targeting any nodes or mesh skins under this node's hierarchy.
+    if (!_preloadedAnimations.empty())
+    {
+        createAnimations(sceneContext);
+        SAFE_DELETE(_trackedNodes);
+        return node;
+    }
     for (unsigned int i = 0; i < _referenceCount; i++)
     {
         Reference* ref = &_references[i];
@@ -600,6 +909,7 @@ Node* Bundle::loadNode(const char* id, Scene* sceneContext)
             }
         }
     }
+    compressCurves();
 
     SAFE_DELETE(_trackedNodes);
     return node;
@@ -1031,6 +1341,38 @@ Model* Bundle::readModel(const char* nodeId)
 }
 
 MeshSkin* Bundle::readMeshSkin()
+{
+    GP_ASSERT(_stream);
+
+    // Use the skin decoded ahead of time, if it was.
+    MeshSkinData* skinData = NULL;
+    std::map<long, MeshSkinData*>::iterator itr = _preloadedSkins.find(_stream->position());
+    if (itr != _preloadedSkins.end())
+    {
+        skinData = itr->second;
+        _preloadedSkins.erase(itr);
+        if (_stream->seek(skinData->end, SEEK_SET) == false)
+        {
+            GP_ERROR("Failed to skip over mesh skin in bundle '%s'.", _path.c_str());
+            SAFE_DELETE(skinData->skin);
+            SAFE_DELETE(skinData);
+            return NULL;
+        }
+    }
+    else
+    {
+        skinData = readMeshSkinData();
+        if (skinData == NULL)
+            return NULL;
+    }
+
+    // Store the MeshSkinData so we can go back and resolve all joint references later.
+    _meshSkins.push_back(skinData);
+
+    return skinData->skin;
+}
+
+Bundle::MeshSkinData* Bundle::readMeshSkinData()
 {
     MeshSkin* meshSkin = new MeshSkin();
 
@@ -1097,10 +1439,9 @@ MeshSkin* Bundle::readMeshSkin()
         }
     }
 
-    // Store the MeshSkinData so we can go back and resolve all joint references later.
-    _meshSkins.push_back(skinData);
+    skinData->end = _stream->position();
 
-    return meshSkin;
+    return skinData;
 }
 
 void Bundle::resolveJointReferences(Scene* sceneContext, Node* nodeContext)
@@ -1293,6 +1634,38 @@ Animation* Bundle::readAnimationChannelData(Animation* animation, const char* id
 
     std::vector<unsigned int> keyTimes;
     std::vector<float> values;
+    if (!readAnimationKeys(id, &keyTimes, &values))
+        return NULL;
+
+    if (targetAttribute > 0)
+    {
+        GP_ASSERT(target);
+        GP_ASSERT(keyTimes.size() > 0 && values.size() > 0);
+        unsigned int keyTimesCount = (unsigned int)keyTimes.size();
+        Animation::Channel* channel;
+        if (animation == NULL)
+        {
+            // TODO: This code currently assumes LINEAR only.
+            animation = target->createAnimation(id, targetAttribute, keyTimesCount, &keyTimes[0], &values[0], Curve::LINEAR);
+            channel = animation->_channels.back();
+        }
+        else
+        {
+            channel = animation->createChannel(target, targetAttribute, keyTimesCount, &keyTimes[0], &values[0], Curve::LINEAR);
+        }
+
+        // Compress the channel's keys if enabled in the game config.
+        compressCurve(channel->_curve);
+    }
+
+    return animation;
+}
+
+bool Bundle::readAnimationKeys(const char* id, std::vector<unsigned int>* keyTimes, std::vector<float>* values)
+{
+    GP_ASSERT(id);
+    GP_ASSERT(keyTimes && values);
+
     std::vector<float> tangentsIn;
     std::vector<float> tangentsOut;
     std::vector<unsigned int> interpolation;
@@ -1305,56 +1678,41 @@ Animation* Bundle::readAnimationChannelData(Animation* animation, const char* id
     unsigned int interpolationCount;
 
     // Read key times.
-    if (!readArray(&keyTimesCount, &keyTimes, sizeof(unsigned int)))
+    if (!readArray(&keyTimesCount, keyTimes, sizeof(unsigned int)))
     {
         GP_ERROR("Failed to read key times for animation '%s'.", id);
-        return NULL;
+        return false;
     }
 
     // Read key values.
-    if (!readArray(&valuesCount, &values))
+    if (!readArray(&valuesCount, values))
     {
         GP_ERROR("Failed to read key values for animation '%s'.", id);
-        return NULL;
+        return false;
     }
 
     // Read in-tangents.
     if (!readArray(&tangentsInCount, &tangentsIn))
     {
         GP_ERROR("Failed to read in tangents for animation '%s'.", id);
-        return NULL;
+        return false;
     }
 
     // Read out-tangents.
     if (!readArray(&tangentsOutCount, &tangentsOut))
     {
         GP_ERROR("Failed to read out tangents for animation '%s'.", id);
-        return NULL;
+        return false;
     }
 
     // Read interpolations.
     if (!readArray(&interpolationCount, &interpolation, sizeof(unsigned int)))
     {
         GP_ERROR("Failed to read the interpolation values for animation '%s'.", id);
-        return NULL;
-    }
-
-    if (targetAttribute > 0)
-    {
-        GP_ASSERT(target);
-        GP_ASSERT(keyTimes.size() > 0 && values.size() > 0);
-        if (animation == NULL)
-        {
-            // TODO: This code currently assumes LINEAR only.
-            animation = target->createAnimation(id, targetAttribute, keyTimesCount, &keyTimes[0], &values[0], Curve::LINEAR);
-        }
-        else
-        {
-            animation->createChannel(target, targetAttribute, keyTimesCount, &keyTimes[0], &values[0], Curve::LINEAR);
-        }
+        return false;
     }
 
-    return animation;
+    return true;
 }
 
 Mesh* Bundle::loadMesh(const char* id)
@@ -1367,6 +1725,15 @@ Mesh* Bundle::loadMesh(const char* id, const char* nodeId)
     GP_ASSERT(_stream);
     GP_ASSERT(id);
 
+    // Use the mesh data decoded ahead of time, if it was.
+    std::map<std::string, MeshData*>::iterator itr = _preloadedMeshes.find(id);
+    if (itr != _preloadedMeshes.end())
+    {
+        MeshData* meshData = itr->second;
+        _preloadedMeshes.erase(itr);
+        return createMesh(meshData, id);
+    }
+
     // Save the file position.
     long position = _stream->position();
     if (position == -1L)
@@ -1383,20 +1750,38 @@ Mesh* Bundle::loadMesh(const char* id, const char* nodeId)
         return NULL;
     }
 
-    // Read mesh data.
-    MeshData* meshData = readMeshData();
+    // Read mesh data. It is uploaded before this returns, so it can be used in place.
+    MeshData* meshData = readMeshData(_stream, true);
     if (meshData == NULL)
     {
         GP_ERROR("Failed to load mesh data for mesh '%s'.", id);
         return NULL;
     }
 
+    Mesh* mesh = createMesh(meshData, id);
+
+    // Restore file pointer.
+    if (_stream->seek(position, SEEK_SET) == false)
+    {
+        GP_ERROR("Failed to restore file pointer after loading mesh '%s'.", id);
+        SAFE_RELEASE(mesh);
+        return NULL;
+    }
+
+    return mesh;
+}
+
+Mesh* Bundle::createMesh(MeshData* meshData, const char* id)
+{
+    GP_ASSERT(meshData);
+    GP_ASSERT(id);
+
     // Create mesh.
     Mesh* mesh = Mesh::createMesh(meshData->vertexFormat, meshData->vertexCount, false);
     if (mesh == NULL)
     {
         GP_ERROR("Failed to create mesh '%s'.", id);
-        SAFE_DELETE_ARRAY(meshData);
+        SAFE_DELETE(meshData);
         return NULL;
     }
 
@@ -1420,6 +1805,7 @@ Mesh* Bundle::loadMesh(const char* id, const char* nodeId)
         {
             GP_ERROR("Failed to create mesh part (with index %d) for mesh '%s'.", i, id);
             SAFE_DELETE(meshData);
+            SAFE_RELEASE(mesh);
             return NULL;
         }
         part->setIndexData(partData->indexData, 0, partData->indexCount);
@@ -1427,42 +1813,547 @@ Mesh* Bundle::loadMesh(const char* id, const char* nodeId)
 
     SAFE_DELETE(meshData);
 
-    // Restore file pointer.
-    if (_stream->seek(position, SEEK_SET) == false)
-    {
-        GP_ERROR("Failed to restore file pointer after loading mesh '%s'.", id);
-        return NULL;
-    }
-
     return mesh;
 }
 
-Bundle::MeshData* Bundle::readMeshData()
+bool Bundle::preloadMesh(const char* id)
 {
-    // Read vertex format/elements.
-    unsigned int vertexElementCount;
-    if (_stream->read(&vertexElementCount, 4, 1) != 1)
-    {
-        GP_ERROR("Failed to load vertex element count.");
-        return NULL;
-    }
-    if (vertexElementCount < 1)
+    GP_ASSERT(id);
+
+    if (_preloadedMeshes.find(id) != _preloadedMeshes.end())
+        return true;
+
+    if (seekTo(id, BUNDLE_TYPE_MESH) == NULL)
+        return false;
+
+    MeshData* meshData = readMeshData(_stream, true);
+    if (meshData == NULL)
     {
-        GP_ERROR("Failed to load mesh data; invalid vertex element count (must be greater than 0).");
-        return NULL;
+        GP_ERROR("Failed to preload mesh data for mesh '%s'.", id);
+        return false;
     }
-
+    _preloadedMeshes[id] = meshData;
+    return true;
+}
+
+void Bundle::preloadMeshes(const std::vector<Reference*>& refs)
+{
+    GP_ASSERT(_stream);
+
+    if (refs.empty())
+        return;
+
+    // Without a job system or a mapped file the meshes are read one after another through the bundle's stream.
+    if (_jobSystem == NULL || _stream->getData() == NULL || refs.size() == 1)
+    {
+        long position = _stream->position();
+        for (size_t i = 0, count = refs.size(); i < count; ++i)
+            preloadMesh(refs[i]->id.c_str());
+        _stream->seek(position, SEEK_SET);
+        return;
+    }
+
+    // Each range of meshes is read through its own cursor over the mapping, into its own slots.
+    std::vector<MeshData*> meshData(refs.size(), NULL);
+    vkTools::JobHandle job = _jobSystem->parallelFor((uint32_t)refs.size(), 1, [this, &refs, &meshData](uint32_t begin, uint32_t end)
+    {
+        Stream* cursor = _stream->createCursor();
+        if (cursor == NULL)
+            return;
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            if (cursor->seek(refs[i]->offset, SEEK_SET))
+                meshData[i] = readMeshData(cursor, true);
+            if (meshData[i] == NULL)
+                GP_ERROR("Failed to preload mesh data for mesh '%s'.", refs[i]->id.c_str());
+        }
+        SAFE_DELETE(cursor);
+    });
+    _jobSystem->wait(job);
+
+    for (size_t i = 0, count = refs.size(); i < count; ++i)
+    {
+        if (meshData[i])
+            _preloadedMeshes[refs[i]->id] = meshData[i];
+    }
+}
+
+void Bundle::preloadScene(const char* id)
+{
+    GP_ASSERT(_references);
+
+    Reference* ref = NULL;
+    if (id)
+    {
+        ref = find(id);
+        if (ref && ref->type != BUNDLE_TYPE_SCENE)
+            ref = NULL;
+    }
+    else
+    {
+        for (unsigned int i = 0; i < _referenceCount && ref == NULL; ++i)
+        {
+            if (_references[i].type == BUNDLE_TYPE_SCENE)
+                ref = &_references[i];
+        }
+    }
+    if (ref == NULL)
+        return;
+
+    preload(ref, NULL);
+    preloadAnimations(NULL);
+}
+
+void Bundle::preloadNode(const char* id)
+{
+    GP_ASSERT(id);
+
+    Reference* ref = find(id);
+    if (ref == NULL || ref->type != BUNDLE_TYPE_NODE)
+        return;
+
+    std::set<std::string> nodeIds;
+    preload(ref, &nodeIds);
+    preloadAnimations(&nodeIds);
+}
+
+void Bundle::preload(Reference* ref, std::set<std::string>* nodeIds)
+{
+    GP_ASSERT(ref);
+    GP_ASSERT(ref->type == BUNDLE_TYPE_SCENE || ref->type == BUNDLE_TYPE_NODE);
+    GP_ASSERT(_stream);
+
+    // Walk the scene or node, decoding its skins and collecting the meshes it uses.
+    long position = _stream->position();
+    std::set<std::string> meshIds;
+    if (_stream->seek(ref->offset, SEEK_SET))
+    {
+        if (ref->type == BUNDLE_TYPE_SCENE)
+        {
+            unsigned int childrenCount;
+            if (read(&childrenCount))
+            {
+                for (unsigned int i = 0; i < childrenCount; ++i)
+                {
+                    if (!scanNode(&meshIds, nodeIds))
+                        break;
+                }
+            }
+        }
+        else
+        {
+            scanNode(&meshIds, nodeIds);
+        }
+    }
+
+    // Objects that could not be walked are read as usual when the scene or node is loaded.
+    std::vector<Reference*> refs;
+    for (std::set<std::string>::const_iterator itr = meshIds.begin(); itr != meshIds.end(); ++itr)
+    {
+        Reference* meshRef = find(itr->c_str());
+        if (meshRef && meshRef->type == BUNDLE_TYPE_MESH && _preloadedMeshes.find(*itr) == _preloadedMeshes.end())
+            refs.push_back(meshRef);
+    }
+    preloadMeshes(refs);
+
+    _stream->seek(position, SEEK_SET);
+    _preloadedRef = ref;
+}
+
+bool Bundle::scanNode(std::set<std::string>* meshIds, std::set<std::string>* nodeIds)
+{
+    GP_ASSERT(meshIds);
+    GP_ASSERT(_stream);
+
+    const char* id = getIdFromOffset();
+    if (nodeIds && id)
+        nodeIds->insert(id);
+
+    // Skip over the node type and transform, and the parent ID.
+    if (_stream->seek(sizeof(unsigned int) + sizeof(float) * 16, SEEK_CUR) == false)
+        return false;
+    readString(_stream);
+
+    // Walk the children.
+    unsigned int childrenCount;
+    if (!read(&childrenCount))
+        return false;
+    for (unsigned int i = 0; i < childrenCount; ++i)
+    {
+        if (!scanNode(meshIds, nodeIds))
+            return false;
+    }
+
+    // Skip over the camera: aspect ratio, near and far plane, then field of view or x and y zoom.
+    unsigned char cameraType;
+    if (!read(&cameraType))
+        return false;
+    if (cameraType == Camera::PERSPECTIVE || cameraType == Camera::ORTHOGRAPHIC)
+    {
+        long cameraSize = sizeof(float) * (cameraType == Camera::PERSPECTIVE ? 4 : 5);
+        if (_stream->seek(cameraSize, SEEK_CUR) == false)
+            return false;
+    }
+    else if (cameraType != 0)
+    {
+        return false;
+    }
+
+    // Skip over the light: color, then range and the spot light angles.
+    unsigned char lightType;
+    if (!read(&lightType))
+        return false;
+    if (lightType == Light::DIRECTIONAL || lightType == Light::POINT || lightType == Light::SPOT)
+    {
+        long lightSize = sizeof(float) * (lightType == Light::DIRECTIONAL ? 3 : (lightType == Light::POINT ? 4 : 6));
+        if (_stream->seek(lightSize, SEEK_CUR) == false)
+            return false;
+    }
+    else if (lightType != 0)
+    {
+        return false;
+    }
+
+    // Read the model's mesh, decode its skin and skip over its materials.
+    std::string xref = readString(_stream);
+    if (xref.length() > 1 && xref[0] == '#') // TODO: Handle full xrefs
+    {
+        meshIds->insert(xref.substr(1));
+
+        unsigned char hasSkin;
+        if (!read(&hasSkin))
+            return false;
+        if (hasSkin)
+        {
+            long skinPosition = _stream->position();
+            std::map<long, MeshSkinData*>::iterator itr = _preloadedSkins.find(skinPosition);
+            if (itr != _preloadedSkins.end())
+            {
+                if (_stream->seek(itr->second->end, SEEK_SET) == false)
+                    return false;
+            }
+            else
+            {
+                MeshSkinData* skinData = readMeshSkinData();
+                if (skinData == NULL)
+                    return false;
+                _preloadedSkins[skinPosition] = skinData;
+
+                // The joints are loaded along with the node.
+                for (size_t i = 0, count = nodeIds ? skinData->joints.size() : 0; i < count; ++i)
+                {
+                    const std::string& jointId = skinData->joints[i];
+                    if (jointId.length() > 1 && jointId[0] == '#')
+                        nodeIds->insert(jointId.substr(1));
+                }
+            }
+        }
+
+        unsigned int materialCount;
+        if (!read(&materialCount))
+            return false;
+        for (unsigned int i = 0; i < materialCount; ++i)
+            readString(_stream);
+    }
+
+    return true;
+}
+
+void Bundle::preloadAnimations(const std::set<std::string>* targetIds)
+{
+    GP_ASSERT(_references);
+    GP_ASSERT(_stream);
+
+    long position = _stream->position();
+    for (unsigned int i = 0; i < _referenceCount; ++i)
+    {
+        Reference* ref = &_references[i];
+        if (ref->type != BUNDLE_TYPE_ANIMATIONS)
+            continue;
+
+        // Read the number of animations in this object.
+        unsigned int animationCount;
+        if (_stream->seek(ref->offset, SEEK_SET) == false || !read(&animationCount))
+        {
+            GP_ERROR("Failed to preload object '%s' in bundle '%s'.", ref->id.c_str(), _path.c_str());
+            clearPreloadedAnimations();
+            break;
+        }
+
+        // On an error the animations are read again, and the error reported, when they are loaded.
+        AnimationData* animationData = NULL;
+        for (unsigned int j = 0; j < animationCount; ++j)
+        {
+            animationData = preloadAnimation(targetIds);
+            if (animationData == NULL)
+                break;
+            _preloadedAnimations.push_back(animationData);
+        }
+        if (animationCount > 0 && animationData == NULL)
+        {
+            clearPreloadedAnimations();
+            break;
+        }
+    }
+    compressCurves();
+
+    _stream->seek(position, SEEK_SET);
+}
+
+Bundle::AnimationData* Bundle::preloadAnimation(const std::set<std::string>* targetIds)
+{
+    AnimationData* animationData = new AnimationData();
+    animationData->id = readString(_stream);
+    const char* id = animationData->id.c_str();
+
+    // Read the number of animation channels in this animation.
+    unsigned int channelCount;
+    if (!read(&channelCount))
+    {
+        GP_ERROR("Failed to read animation channel count for animation '%s'.", id);
+        SAFE_DELETE(animationData);
+        return NULL;
+    }
+
+    animationData->channels.resize(channelCount);
+    std::vector<unsigned int> keyTimes;
+    std::vector<float> values;
+    for (unsigned int i = 0; i < channelCount; ++i)
+    {
+        AnimationChannelData& channel = animationData->channels[i];
+        channel.targetId = readString(_stream);
+        if (channel.targetId.empty())
+        {
+            GP_ERROR("Failed to read target id for animation '%s'.", id);
+            SAFE_DELETE(animationData);
+            return NULL;
+        }
+        if (!read(&channel.targetAttribute))
+        {
+            GP_ERROR("Failed to read target attribute for animation '%s'.", id);
+            SAFE_DELETE(animationData);
+            return NULL;
+        }
+
+        keyTimes.clear();
+        values.clear();
+        channel.keys = _stream->position();
+        if (!readAnimationKeys(id, &keyTimes, &values))
+        {
+            SAFE_DELETE(animationData);
+            return NULL;
+        }
+
+        // The keys of channels that may not be loaded are read only if they are.
+        if (channel.targetAttribute == 0 || (targetIds && targetIds->find(channel.targetId) == targetIds->end()))
+            continue;
+
+        // The targets of bundle animations are nodes, so the values of each key are the components of a Transform property.
+        if (keyTimes.empty() || values.empty() || values.size() % keyTimes.size() != 0)
+        {
+            GP_ERROR("Invalid number of key values for animation '%s'.", id);
+            SAFE_DELETE(animationData);
+            return NULL;
+        }
+
+        // TODO: This code currently assumes LINEAR only.
+        unsigned int componentCount = (unsigned int)(values.size() / keyTimes.size());
+        channel.curve = Animation::createCurve(channel.targetAttribute, componentCount, true, (unsigned int)keyTimes.size(), &keyTimes[0], &values[0], Curve::LINEAR, &channel.duration);
+        compressCurve(channel.curve);
+    }
+
+    return animationData;
+}
+
+void Bundle::createAnimations(Scene* scene)
+{
+    for (size_t i = 0, count = _preloadedAnimations.size(); i < count; ++i)
+    {
+        AnimationData* animationData = _preloadedAnimations[i];
+        const char* id = animationData->id.c_str();
+
+        Animation* animation = NULL;
+        for (size_t j = 0, channelCount = animationData->channels.size(); j < channelCount; ++j)
+        {
+            const AnimationChannelData& channel = animationData->channels[j];
+
+            // Channels that target nodes outside of the loaded node's hierarchy are skipped.
+            AnimationTarget* target = NULL;
+            if (_trackedNodes)
+            {
+                std::map<std::string, Node*>::iterator itr = _trackedNodes->find(channel.targetId);
+                if (itr == _trackedNodes->end())
+                    continue;
+                target = itr->second;
+            }
+            else
+            {
+                GP_ASSERT(scene);
+                target = scene->findNode(channel.targetId.c_str());
+                if (!target)
+                {
+                    GP_ERROR("Failed to find the animation target (with id '%s') for animation '%s'.", channel.targetId.c_str(), id);
+                    animation = NULL;
+                    continue;
+                }
+            }
+
+            if (channel.targetAttribute == 0)
+                continue;
+            if (channel.curve == NULL)
+            {
+                if (_stream->seek(channel.keys, SEEK_SET) == false)
+                {
+                    GP_ERROR("Failed to seek to the keys of animation '%s' in bundle '%s'.", id, _path.c_str());
+                    continue;
+                }
+                animation = readAnimationChannelData(animation, id, target, channel.targetAttribute);
+                continue;
+            }
+            if (target->getAnimationPropertyComponentCount(channel.targetAttribute) != channel.curve->getComponentCount())
+            {
+                GP_ERROR("Invalid number of key values for the animation target (with id '%s') of animation '%s'.", channel.targetId.c_str(), id);
+                continue;
+            }
+
+            if (animation == NULL)
+            {
+                animation = new Animation(id);
+                animation->createChannel(target, channel.targetAttribute, channel.curve, channel.duration);
+
+                // Release the animation because a newly created animation has a ref count of 1 and the channels hold the ref to animation.
+                animation->release();
+            }
+            else
+            {
+                animation->createChannel(target, channel.targetAttribute, channel.curve, channel.duration);
+            }
+        }
+    }
+    compressCurves();
+    clearPreloadedAnimations();
+}
+
+void Bundle::clearPreloadedAnimations()
+{
+    for (size_t i = 0, count = _preloadedAnimations.size(); i < count; ++i)
+    {
+        SAFE_DELETE(_preloadedAnimations[i]);
+    }
+    _preloadedAnimations.clear();
+}
+
+void Bundle::compressCurve(Curve* curve)
+{
+    GP_ASSERT(curve);
+
+    if (_compressionTolerance < 0.0f)
+        return;
+
+    if (_jobSystem)
+    {
+        // Compressed in parallel once all animations are read.
+        _curves.push_back(curve);
+        return;
+    }
+
+    unsigned int size = curve->getPointDataSize();
+    float error;
+    if (curve->compress(_compressionTolerance, &error))
+    {
+        _animationDataSize += size;
+        _compressedDataSize += curve->getPointDataSize();
+        if (error > _compressionError)
+            _compressionError = error;
+    }
+}
+
+void Bundle::compressCurves()
+{
+    if (_curves.empty())
+        return;
+
+    GP_ASSERT(_jobSystem);
+    size_t count = _curves.size();
+    std::vector<unsigned int> sizes(count, 0);
+    std::vector<unsigned int> compressedSizes(count, 0);
+    std::vector<float> errors(count, -1.0f);
+    vkTools::JobHandle job = _jobSystem->parallelFor((uint32_t)count, 1, [this, &sizes, &compressedSizes, &errors](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            Curve* curve = _curves[i];
+            sizes[i] = curve->getPointDataSize();
+            float error;
+            if (curve->compress(_compressionTolerance, &error))
+            {
+                compressedSizes[i] = curve->getPointDataSize();
+                errors[i] = error;
+            }
+        }
+    });
+    _jobSystem->wait(job);
+
+    // Gather the statistics in order, as the curves would have been compressed one by one.
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (errors[i] < 0.0f)
+            continue;
+        _animationDataSize += sizes[i];
+        _compressedDataSize += compressedSizes[i];
+        if (errors[i] > _compressionError)
+            _compressionError = errors[i];
+    }
+    _curves.clear();
+}
+
+void Bundle::clearPreloaded()
+{
+    for (std::map<std::string, MeshData*>::iterator itr = _preloadedMeshes.begin(); itr != _preloadedMeshes.end(); ++itr)
+    {
+        SAFE_DELETE(itr->second);
+    }
+    _preloadedMeshes.clear();
+
+    for (std::map<long, MeshSkinData*>::iterator itr = _preloadedSkins.begin(); itr != _preloadedSkins.end(); ++itr)
+    {
+        SAFE_DELETE(itr->second->skin);
+        SAFE_DELETE(itr->second);
+    }
+    _preloadedSkins.clear();
+    _preloadedRef = NULL;
+
+    clearPreloadedAnimations();
+}
+
+Bundle::MeshData* Bundle::readMeshData(Stream* stream, bool mapped)
+{
+    GP_ASSERT(stream);
+
+    // Read vertex format/elements.
+    unsigned int vertexElementCount;
+    if (stream->read(&vertexElementCount, 4, 1) != 1)
+    {
+        GP_ERROR("Failed to load vertex element count.");
+        return NULL;
+    }
+    if (vertexElementCount < 1)
+    {
+        GP_ERROR("Failed to load mesh data; invalid vertex element count (must be greater than 0).");
+        return NULL;
+    }
+
     VertexFormat::Element* vertexElements = new VertexFormat::Element[vertexElementCount];
     for (unsigned int i = 0; i < vertexElementCount; ++i)
     {
         unsigned int vUsage, vSize;
-        if (_stream->read(&vUsage, 4, 1) != 1)
+        if (stream->read(&vUsage, 4, 1) != 1)
         {
             GP_ERROR("Failed to load vertex usage.");
             SAFE_DELETE_ARRAY(vertexElements);
             return NULL;
         }
-        if (_stream->read(&vSize, 4, 1) != 1)
+        if (stream->read(&vSize, 4, 1) != 1)
         {
             GP_ERROR("Failed to load vertex size.");
             SAFE_DELETE_ARRAY(vertexElements);
@@ -1478,7 +2369,7 @@ Bundle::MeshData* Bundle::readMeshData()
 
     // Read vertex data.
     unsigned int vertexByteCount;
-    if (_stream->read(&vertexByteCount, 4, 1) != 1)
+    if (stream->read(&vertexByteCount, 4, 1) != 1)
     {
         GP_ERROR("Failed to load vertex byte count.");
         SAFE_DELETE(meshData);
@@ -1493,8 +2384,10 @@ Bundle::MeshData* Bundle::readMeshData()
 
     GP_ASSERT(meshData->vertexFormat.getVertexSize());
     meshData->vertexCount = vertexByteCount / meshData->vertexFormat.getVertexSize();
-    meshData->vertexData = new unsigned char[vertexByteCount];
-    if (_stream->read(meshData->vertexData, 1, vertexByteCount) != vertexByteCount)
+
+    // Sectioned bundles keep the vertex and index data of a mesh together in a section, read below.
+    bool sectioned = !_sections.empty();
+    if (!sectioned && !readBlob(stream, vertexByteCount, mapped, &meshData->vertexData, &meshData->mapped))
     {
         GP_ERROR("Failed to load vertex data.");
         SAFE_DELETE(meshData);
@@ -1502,13 +2395,13 @@ Bundle::MeshData* Bundle::readMeshData()
     }
 
     // Read mesh bounds (bounding box and bounding sphere).
-    if (_stream->read(&meshData->boundingBox.min.x, 4, 3) != 3 || _stream->read(&meshData->boundingBox.max.x, 4, 3) != 3)
+    if (stream->read(&meshData->boundingBox.min.x, 4, 3) != 3 || stream->read(&meshData->boundingBox.max.x, 4, 3) != 3)
     {
         GP_ERROR("Failed to load mesh bounding box.");
         SAFE_DELETE(meshData);
         return NULL;
     }
-    if (_stream->read(&meshData->boundingSphere.center.x, 4, 3) != 3 || _stream->read(&meshData->boundingSphere.radius, 4, 1) != 1)
+    if (stream->read(&meshData->boundingSphere.center.x, 4, 3) != 3 || stream->read(&meshData->boundingSphere.radius, 4, 1) != 1)
     {
         GP_ERROR("Failed to load mesh bounding sphere.");
         SAFE_DELETE(meshData);
@@ -1517,29 +2410,30 @@ Bundle::MeshData* Bundle::readMeshData()
 
     // Read mesh parts.
     unsigned int meshPartCount;
-    if (_stream->read(&meshPartCount, 4, 1) != 1)
+    if (stream->read(&meshPartCount, 4, 1) != 1)
     {
         GP_ERROR("Failed to load mesh part count.");
         SAFE_DELETE(meshData);
         return NULL;
     }
+    std::vector<unsigned int> indexByteCounts(meshPartCount);
     for (unsigned int i = 0; i < meshPartCount; ++i)
     {
         // Read primitive type, index format and index count.
         unsigned int pType, iFormat, iByteCount;
-        if (_stream->read(&pType, 4, 1) != 1)
+        if (stream->read(&pType, 4, 1) != 1)
         {
             GP_ERROR("Failed to load primitive type for mesh part with index %d.", i);
             SAFE_DELETE(meshData);
             return NULL;
         }
-        if (_stream->read(&iFormat, 4, 1) != 1)
+        if (stream->read(&iFormat, 4, 1) != 1)
         {
             GP_ERROR("Failed to load index format for mesh part with index %d.", i);
             SAFE_DELETE(meshData);
             return NULL;
         }
-        if (_stream->read(&iByteCount, 4, 1) != 1)
+        if (stream->read(&iByteCount, 4, 1) != 1)
         {
             GP_ERROR("Failed to load index byte count for mesh part with index %d.", i);
             SAFE_DELETE(meshData);
@@ -1571,9 +2465,9 @@ Bundle::MeshData* Bundle::readMeshData()
 
         GP_ASSERT(indexSize);
         partData->indexCount = iByteCount / indexSize;
+        indexByteCounts[i] = iByteCount;
 
-        partData->indexData = new unsigned char[iByteCount];
-        if (_stream->read(partData->indexData, 1, iByteCount) != iByteCount)
+        if (!sectioned && !readBlob(stream, iByteCount, mapped, &partData->indexData, &partData->mapped))
         {
             GP_ERROR("Failed to read index data for mesh part with index %d.", i);
             SAFE_DELETE(meshData);
@@ -1581,9 +2475,137 @@ Bundle::MeshData* Bundle::readMeshData()
         }
     }
 
+    if (sectioned)
+    {
+        // The section holds the vertex data followed by the index data of each part, each aligned.
+        unsigned int sectionIndex;
+        unsigned char* data;
+        bool isMapped;
+        if (stream->read(&sectionIndex, 4, 1) != 1 || !readSection(stream, sectionIndex, mapped, &data, &isMapped))
+        {
+            GP_ERROR("Failed to read the data section of mesh.");
+            SAFE_DELETE(meshData);
+            return NULL;
+        }
+        if (!isMapped)
+            meshData->sectionData = data;
+
+        std::vector<size_t> indexOffsets(meshData->parts.size());
+        size_t offset = vertexByteCount;
+        for (size_t i = 0, count = meshData->parts.size(); i < count; ++i)
+        {
+            offset = alignSection(offset);
+            indexOffsets[i] = offset;
+            offset += indexByteCounts[i];
+        }
+        if (offset > _sections[sectionIndex].uncompressedSize)
+        {
+            GP_ERROR("Invalid size of the data section of mesh.");
+            SAFE_DELETE(meshData);
+            return NULL;
+        }
+
+        if (mapped)
+        {
+            // Point into the section, which stays alive as long as the mesh data does.
+            meshData->vertexData = data;
+            meshData->mapped = true;
+            for (size_t i = 0, count = meshData->parts.size(); i < count; ++i)
+            {
+                meshData->parts[i]->indexData = data + indexOffsets[i];
+                meshData->parts[i]->mapped = true;
+            }
+        }
+        else
+        {
+            // Callers may take ownership of the vertex and index data (as physics does), so give each its own array.
+            meshData->vertexData = new unsigned char[vertexByteCount];
+            memcpy(meshData->vertexData, data, vertexByteCount);
+            for (size_t i = 0, count = meshData->parts.size(); i < count; ++i)
+            {
+                MeshPartData* partData = meshData->parts[i];
+                partData->indexData = new unsigned char[indexByteCounts[i]];
+                memcpy(partData->indexData, data + indexOffsets[i], indexByteCounts[i]);
+            }
+            SAFE_DELETE_ARRAY(meshData->sectionData);
+        }
+    }
+
     return meshData;
 }
 
+bool Bundle::readSection(Stream* stream, unsigned int index, bool mapped, unsigned char** data, bool* isMapped) const
+{
+    GP_ASSERT(stream);
+    GP_ASSERT(data && isMapped);
+
+    if (index >= _sections.size())
+    {
+        GP_ERROR("Invalid section index %u in bundle '%s'.", index, _path.c_str());
+        return false;
+    }
+    const Section& section = _sections[index];
+
+    // Read compressed sections straight from the mapping even when the result may not point into it.
+    const unsigned char* source = stream->getData();
+    unsigned char* buffer = NULL;
+    if (source)
+    {
+        source += section.offset;
+    }
+    else
+    {
+        buffer = new unsigned char[section.size];
+        long int position = stream->position();
+        if (!stream->seek(section.offset, SEEK_SET) || stream->read(buffer, 1, section.size) != section.size || !stream->seek(position, SEEK_SET))
+        {
+            SAFE_DELETE_ARRAY(buffer);
+            return false;
+        }
+        source = buffer;
+    }
+
+    switch (section.compression)
+    {
+    case BUNDLE_COMPRESSION_NONE:
+        if (buffer)
+        {
+            *data = buffer;
+            *isMapped = false;
+        }
+        else if (mapped)
+        {
+            *data = const_cast<unsigned char*>(source);
+            *isMapped = true;
+        }
+        else
+        {
+            *data = new unsigned char[section.size];
+            memcpy(*data, source, section.size);
+            *isMapped = false;
+        }
+        return true;
+
+    case BUNDLE_COMPRESSION_LZ4:
+        *data = new unsigned char[section.uncompressedSize];
+        *isMapped = false;
+        if (!decompressLZ4(source, section.size, *data, section.uncompressedSize))
+        {
+            GP_ERROR("Failed to decompress section %u in bundle '%s'.", index, _path.c_str());
+            SAFE_DELETE_ARRAY(*data);
+            SAFE_DELETE_ARRAY(buffer);
+            return false;
+        }
+        SAFE_DELETE_ARRAY(buffer);
+        return true;
+
+    default:
+        GP_ERROR("Unsupported compression %u of section %u in bundle '%s'.", section.compression, index, _path.c_str());
+        SAFE_DELETE_ARRAY(buffer);
+        return false;
+    }
+}
+
 Bundle::MeshData* Bundle::readMeshData(const char* url)
 {
     GP_ASSERT(url);
@@ -1624,13 +2646,201 @@ Bundle::MeshData* Bundle::readMeshData(const char* url)
     }
 
     // Read mesh data from current file position.
-    MeshData* meshData = bundle->readMeshData();
+    MeshData* meshData = bundle->readMeshData(bundle->_stream, false);
 
     SAFE_RELEASE(bundle);
 
     return meshData;
 }
 
+bool Bundle::convert(const char* path, const char* convertedPath, bool compress)
+{
+    GP_ASSERT(path);
+    GP_ASSERT(convertedPath);
+
+    Bundle* bundle = open(path, -1.0f);
+    if (bundle == NULL)
+        return false;
+    if (!bundle->_sections.empty() || bundle->_version[0] == BUNDLE_VERSION_MAJOR_SECTIONS)
+    {
+        GP_WARN("Bundle '%s' is already sectioned.", path);
+        SAFE_RELEASE(bundle);
+        return false;
+    }
+
+    // Everything from the end of the ref table on is copied over, except for the meshes, whose
+    // vertex and index data is moved out into sections.
+    Stream* stream = bundle->_stream;
+    size_t length = stream->length();
+    unsigned int objectsOffset = (unsigned int)stream->position();
+    std::vector<Reference*> refs(bundle->_referenceCount);
+    for (unsigned int i = 0; i < bundle->_referenceCount; ++i)
+        refs[i] = &bundle->_references[i];
+    std::stable_sort(refs.begin(), refs.end(), [](const Reference* a, const Reference* b) { return a->offset < b->offset; });
+
+    std::vector<unsigned char> objects;
+    std::vector<unsigned char> sectionData;
+    std::vector<Section> sections;
+    std::unordered_map<unsigned int, unsigned int> offsets;
+    bool failed = false;
+    size_t next = objectsOffset;
+    for (size_t i = 0, count = refs.size(); i <= count && !failed; ++i)
+    {
+        if (i < count && offsets.find(refs[i]->offset) != offsets.end())
+            continue;
+
+        // Copy the bytes up to the next object as they are.
+        size_t end = i < count ? refs[i]->offset : length;
+        if (end < next || end > length)
+        {
+            GP_WARN("Invalid object offset %u in bundle '%s'.", (unsigned int)end, path);
+            failed = true;
+            break;
+        }
+        if (end > next)
+        {
+            size_t size = objects.size();
+            objects.resize(size + (end - next));
+            if (!stream->seek((long int)next, SEEK_SET) || stream->read(&objects[size], 1, end - next) != end - next)
+            {
+                GP_WARN("Failed to read bundle '%s'.", path);
+                failed = true;
+                break;
+            }
+            next = end;
+        }
+        if (i == count)
+            break;
+
+        Reference* ref = refs[i];
+        offsets[ref->offset] = (unsigned int)objects.size();
+        if (ref->type != BUNDLE_TYPE_MESH)
+            continue;
+
+        MeshData* meshData = NULL;
+        if (stream->seek(ref->offset, SEEK_SET))
+            meshData = bundle->readMeshData(stream, false);
+        if (meshData == NULL || (i + 1 < count && (size_t)stream->position() > refs[i + 1]->offset))
+        {
+            GP_WARN("Failed to convert mesh '%s' in bundle '%s'.", ref->id.c_str(), path);
+            SAFE_DELETE(meshData);
+            failed = true;
+            break;
+        }
+        next = (size_t)stream->position();
+
+        // Write the mesh without its data, followed by the index of its section.
+        const VertexFormat& vertexFormat = meshData->vertexFormat;
+        writeUInt(&objects, (unsigned int)vertexFormat.getElementCount());
+        for (unsigned int j = 0; j < vertexFormat.getElementCount(); ++j)
+        {
+            const VertexFormat::Element& element = vertexFormat.getElement(j);
+            writeUInt(&objects, (unsigned int)element.usage);
+            writeUInt(&objects, element.size);
+        }
+        unsigned int vertexByteCount = meshData->vertexCount * vertexFormat.getVertexSize();
+        writeUInt(&objects, vertexByteCount);
+        writeData(&objects, &meshData->boundingBox.min.x, sizeof(float) * 3);
+        writeData(&objects, &meshData->boundingBox.max.x, sizeof(float) * 3);
+        writeData(&objects, &meshData->boundingSphere.center.x, sizeof(float) * 3);
+        writeData(&objects, &meshData->boundingSphere.radius, sizeof(float));
+        writeUInt(&objects, (unsigned int)meshData->parts.size());
+
+        std::vector<unsigned char> data(meshData->vertexData, meshData->vertexData + vertexByteCount);
+        for (size_t j = 0, partCount = meshData->parts.size(); j < partCount; ++j)
+        {
+            MeshPartData* partData = meshData->parts[j];
+            unsigned int indexSize = partData->indexFormat == Mesh::INDEX8 ? 1 : (partData->indexFormat == Mesh::INDEX16 ? 2 : 4);
+            unsigned int indexByteCount = partData->indexCount * indexSize;
+            writeUInt(&objects, (unsigned int)partData->primitiveType);
+            writeUInt(&objects, (unsigned int)partData->indexFormat);
+            writeUInt(&objects, indexByteCount);
+            data.resize(alignSection(data.size()), 0);
+            data.insert(data.end(), partData->indexData, partData->indexData + indexByteCount);
+        }
+        writeUInt(&objects, (unsigned int)sections.size());
+        SAFE_DELETE(meshData);
+
+        // Keep the compressed data only when it is smaller.
+        Section section;
+        section.offset = (unsigned int)alignSection(sectionData.size());
+        section.uncompressedSize = (unsigned int)data.size();
+        section.compression = BUNDLE_COMPRESSION_NONE;
+        sectionData.resize(section.offset, 0);
+        if (compress && !data.empty())
+        {
+            std::vector<unsigned char> compressed(data.size() + data.size() / 255 + 16);
+            size_t size = compressLZ4(&data[0], data.size(), &compressed[0]);
+            if (size < data.size())
+            {
+                compressed.resize(size);
+                data.swap(compressed);
+                section.compression = BUNDLE_COMPRESSION_LZ4;
+            }
+        }
+        section.size = (unsigned int)data.size();
+        sectionData.insert(sectionData.end(), data.begin(), data.end());
+        sections.push_back(section);
+    }
+
+    if (failed)
+    {
+        SAFE_RELEASE(bundle);
+        return false;
+    }
+
+    // Lay out the header, the objects and then the sections.
+    std::vector<unsigned char> header;
+    writeData(&header, "\xABGPB\xBB\r\n\x1A\n", 9);
+    unsigned char version[4] = { BUNDLE_VERSION_MAJOR_SECTIONS, BUNDLE_VERSION_MINOR_SECTIONS, bundle->_version[0], bundle->_version[1] };
+    writeData(&header, version, 4);
+    size_t headerSize = header.size() + sizeof(unsigned int) * 2 + sections.size() * sizeof(unsigned int) * 4;
+    for (size_t i = 0, count = refs.size(); i < count; ++i)
+        headerSize += sizeof(unsigned int) * 3 + refs[i]->id.length();
+    size_t sectionsOffset = alignSection(headerSize + objects.size());
+
+    writeUInt(&header, bundle->_referenceCount);
+    for (unsigned int i = 0; i < bundle->_referenceCount; ++i)
+    {
+        const Reference& ref = bundle->_references[i];
+        writeUInt(&header, (unsigned int)ref.id.length());
+        writeData(&header, ref.id.c_str(), ref.id.length());
+        writeUInt(&header, ref.type);
+        writeUInt(&header, (unsigned int)headerSize + offsets[ref.offset]);
+    }
+    writeUInt(&header, (unsigned int)sections.size());
+    for (size_t i = 0, count = sections.size(); i < count; ++i)
+    {
+        writeUInt(&header, (unsigned int)sectionsOffset + sections[i].offset);
+        writeUInt(&header, sections[i].size);
+        writeUInt(&header, sections[i].uncompressedSize);
+        writeUInt(&header, sections[i].compression);
+    }
+    GP_ASSERT(header.size() == headerSize);
+    header.insert(header.end(), objects.begin(), objects.end());
+    header.resize(sectionsOffset, 0);
+    header.insert(header.end(), sectionData.begin(), sectionData.end());
+    SAFE_RELEASE(bundle);
+
+    Stream* output = FileSystem::open(convertedPath, FileSystem::WRITE);
+    if (output == NULL)
+    {
+        GP_WARN("Failed to open file '%s'.", convertedPath);
+        return false;
+    }
+    bool written = output->write(&header[0], 1, header.size()) == header.size();
+    SAFE_DELETE(output);
+    if (!written)
+    {
+        GP_WARN("Failed to write bundle '%s'.", convertedPath);
+        return false;
+    }
+
+    Logger::log(Logger::LEVEL_INFO, "Converted bundle '%s' (%u bytes) to '%s' (%u bytes, %u mesh sections).\n",
+        path, (unsigned int)length, convertedPath, (unsigned int)header.size(), (unsigned int)sections.size());
+    return true;
+}
+
 Font* Bundle::loadFont(const char* id)
 {
     GP_ASSERT(id);
@@ -1662,7 +2872,7 @@ Font* Bundle::loadFont(const char* id)
 
     // In bundle version 1.4 we introduced storing multiple font sizes per font
     unsigned int fontSizeCount = 1;
-    if (getVersionMajor() >= 1 && getVersionMinor() >= 4)
+    if (hasObjectVersion(4))
     {
         if (_stream->read(&fontSizeCount, 4, 1) != 1)
         {
@@ -1714,7 +2924,7 @@ Font* Bundle::loadFont(const char* id)
                 SAFE_DELETE_ARRAY(glyphs);
                 return NULL;
             }
-            if (getVersionMajor() >= 1 && getVersionMinor() >= 5)
+            if (hasObjectVersion(5))
             {
                 if (_stream->read(&glyphs[j].bearingX, 4, 1) != 1)
                 {
@@ -1783,7 +2993,7 @@ Font* Bundle::loadFont(const char* id)
         unsigned int format = Font::BITMAP;
 
         // In bundle version 1.3 we added a format field
-        if (getVersionMajor() >= 1 && getVersionMinor() >= 3)
+        if (hasObjectVersion(3))
         {
             if (_stream->read(&format, 4, 1) != 1)
             {
@@ -1870,30 +3080,47 @@ Bundle::Reference::~Reference()
 {
 }
 
+Bundle::AnimationChannelData::AnimationChannelData() :
+    targetAttribute(0), curve(NULL), duration(0), keys(0)
+{
+}
+
+Bundle::AnimationData::~AnimationData()
+{
+    for (size_t i = 0, count = channels.size(); i < count; ++i)
+    {
+        SAFE_RELEASE(channels[i].curve);
+    }
+}
+
 Bundle::MeshPartData::MeshPartData() :
 	primitiveType(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST), indexFormat(Mesh::INDEX32), 
-	indexCount(0), indexData(NULL)
+	indexCount(0), indexData(NULL), mapped(false)
 {
 }
 
 Bundle::MeshPartData::~MeshPartData()
 {
-    SAFE_DELETE_ARRAY(indexData);
+    if (!mapped)
+        SAFE_DELETE_ARRAY(indexData);
 }
 
 Bundle::MeshData::MeshData(const VertexFormat& vertexFormat)
-    : vertexFormat(vertexFormat), vertexCount(0), vertexData(NULL), primitiveType(Mesh::TRIANGLES)
+    : vertexFormat(vertexFormat), vertexCount(0), vertexData(NULL), mapped(false), sectionData(NULL), primitiveType(Mesh::TRIANGLES)
 {
 }
 
 Bundle::MeshData::~MeshData()
 {
-    SAFE_DELETE_ARRAY(vertexData);
+    if (!mapped)
+        SAFE_DELETE_ARRAY(vertexData);
 
     for (unsigned int i = 0; i < parts.size(); ++i)
     {
         SAFE_DELETE(parts[i]);
     }
+
+    SAFE_DELETE_ARRAY(sectionData);
 }
 
 }
@@ -7,17 +7,36 @@
 #include "Game.h"
 #include "MeshSkin.h"
 
+namespace vkTools
+{
+class JobSystem;
+}
+
 namespace vkcore
 {
 
 /**
  * Defines a gameplay bundle file (.gpb) that contains a
  * collection of binary game assets that can be loaded.
+ *
+ * Animation keyframes can be compressed as they are loaded (see Curve::compress) by
+ * setting a tolerance in the "animation" namespace of the game config:
+ *
+ * @verbatim
+    animation
+    {
+        compressionTolerance = 0.001
+    }
+   @endverbatim
+ *
+ * A tolerance of zero only quantizes the keys; leaving it unset disables compression.
+ * After each load the memory saved and the largest error introduced are logged.
  */
 class Bundle : public Ref
 {
     friend class PhysicsController;
     friend class SceneLoader;
+    friend class BundleLoader;
 
 public:
 
@@ -36,6 +55,28 @@ public:
      */
     static Bundle* create(const char* path);
 
+    /**
+     * Converts a version 1 bundle to the sectioned version 2 format.
+     *
+     * The objects of the bundle are kept as they are, except that the vertex and index data
+     * of each mesh is moved into a section of its own: the vertex data followed by the index
+     * data of each mesh part, each starting at a 16 byte aligned offset. Sections themselves
+     * are 16 byte aligned in the file, so a mesh is uploaded with a single read of its
+     * section, or used in place from the mapped file, instead of being parsed field by field.
+     * Sections may be compressed with LZ4 (block format); a section is only stored compressed
+     * when that makes it smaller.
+     *
+     * The sizes of both bundles are logged.
+     *
+     * @param path The path of the bundle to convert.
+     * @param convertedPath The path to write the converted bundle to.
+     * @param compress Whether to compress the sections.
+     *
+     * @return True if the bundle was converted, false if an error occurred.
+     * @script{ignore}
+     */
+    static bool convert(const char* path, const char* convertedPath, bool compress = true);
+
     /**
      * Loads the scene with the specified ID from the bundle.
      * If id is NULL then the first scene found is loaded.
@@ -77,6 +118,25 @@ public:
      */
     Font* loadFont(const char* id);
 
+    /**
+     * Sets the job system to decode independent objects of the bundle on.
+     *
+     * With a job system set, loading a scene decodes the vertex and index data of all
+     * meshes in the bundle and compresses its animation curves in parallel, each mesh
+     * read through its own cursor over the memory mapped file. Objects that are shared
+     * with the rest of the engine are still created on the calling thread.
+     *
+     * @param jobSystem The job system to use, or NULL to decode everything on the calling thread.
+     */
+    void setJobSystem(vkTools::JobSystem* jobSystem);
+
+    /**
+     * Gets the job system the bundle decodes independent objects on.
+     *
+     * @return The job system, or NULL if objects are decoded on the calling thread.
+     */
+    vkTools::JobSystem* getJobSystem() const;
+
     /**
      * Determines if this bundle contains a top-level object with the given ID.
      *
@@ -134,11 +194,39 @@ private:
         ~Reference();
     };
 
+    struct Section
+    {
+        unsigned int offset;            // Offset of the section in the file.
+        unsigned int size;              // Size of the section in the file.
+        unsigned int uncompressedSize;  // Size of the section once decompressed.
+        unsigned int compression;       // How the section is compressed.
+    };
+
     struct MeshSkinData
     {
         MeshSkin* skin;
         std::vector<std::string> joints;
         std::vector<Matrix> inverseBindPoseMatrices;
+        long end;                       // File position just past the skin.
+    };
+
+    struct AnimationChannelData
+    {
+        AnimationChannelData();
+
+        std::string targetId;
+        unsigned int targetAttribute;
+        Curve* curve;                   // The curve of the channel; NULL if it was not built ahead of time.
+        unsigned long duration;
+        long keys;                      // File position of the keys of the channel.
+    };
+
+    struct AnimationData
+    {
+        ~AnimationData();
+
+        std::string id;
+        std::vector<AnimationChannelData> channels;
     };
 
     struct MeshPartData
@@ -150,6 +238,7 @@ private:
         Mesh::IndexFormat indexFormat;
         unsigned int indexCount;
         unsigned char* indexData;
+        bool mapped;
     };
 
     struct MeshData
@@ -160,19 +249,40 @@ private:
         VertexFormat vertexFormat;
         unsigned int vertexCount;
         unsigned char* vertexData;
+        bool mapped;
+        unsigned char* sectionData;     // Decompressed section that the vertex and index data point into; NULL if none.
         BoundingBox boundingBox;
         BoundingSphere boundingSphere;
         Mesh::PrimitiveType primitiveType;
         std::vector<MeshPartData*> parts;
     };
 
-    Bundle(const char* path);
+    Bundle(const char* path, float compressionTolerance);
 
     /**
      * Destructor.
      */
     ~Bundle();
 
+    /**
+     * Opens the bundle at the given path without going through the bundle cache.
+     *
+     * Only touches the new bundle, so it may be called from a worker thread.
+     *
+     * @param path The path of the bundle.
+     * @param compressionTolerance The tolerance to compress animation curves with; negative to not compress.
+     *
+     * @return The new Bundle or NULL if there was an error.
+     */
+    static Bundle* open(const char* path, float compressionTolerance);
+
+    /**
+     * Gets the animation compression tolerance set in the game config.
+     *
+     * @return The tolerance, or -1 if compression is disabled.
+     */
+    static float getCompressionTolerance();
+
     /**
      * Hidden copy assignment operator.
      */
@@ -325,6 +435,19 @@ private:
      */
     bool readMatrix(float* m);
 
+    /**
+     * Reads a block of bytes from the current position of a stream.
+     *
+     * @param stream The stream to read from; the bundle's stream or a cursor over it.
+     * @param size The number of bytes to read.
+     * @param mapped Whether the block may point into the memory mapped file, when it is.
+     * @param data Populated with the block; a new array unless it points into the mapping.
+     * @param isMapped Populated with whether the block points into the mapping.
+     *
+     * @return True if successful, false if an error occurred.
+     */
+    bool readBlob(Stream* stream, unsigned int size, bool mapped, unsigned char** data, bool* isMapped);
+
     /**
      * Reads an xref string from the current file position.
      * 
@@ -364,9 +487,154 @@ private:
     Model* readModel(const char* nodeId);
 
     /**
-     * Reads mesh data from the current file position.
+     * Reads mesh data from the current position of a stream.
+     *
+     * @param stream The stream to read from; the bundle's stream or a cursor over it.
+     * @param mapped Whether the vertex and index data may point directly into the bundle's
+     *      memory mapped file, rather than being copied, when the file is mapped. Such data
+     *      is read-only and is only valid while the bundle is. When false the vertex data and
+     *      the index data of each part are separate arrays that the caller may take over.
+     */
+    MeshData* readMeshData(Stream* stream, bool mapped);
+
+    /**
+     * Reads the contents of a section of a sectioned bundle.
+     *
+     * Does not move the file pointer of the stream.
+     *
+     * @param stream The stream to read from; the bundle's stream or a cursor over it.
+     * @param index The index of the section.
+     * @param mapped Whether the contents may point into the memory mapped file, when it is
+     *      and the section is not compressed.
+     * @param data Populated with the contents; a new array unless it points into the mapping.
+     * @param isMapped Populated with whether the contents point into the mapping.
+     *
+     * @return True if successful, false if an error occurred.
+     */
+    bool readSection(Stream* stream, unsigned int index, bool mapped, unsigned char** data, bool* isMapped) const;
+
+    /**
+     * Determines whether the objects of the bundle are encoded as of the given minor
+     * version of the version 1 format, or later.
+     */
+    bool hasObjectVersion(unsigned int minor) const;
+
+    /**
+     * Creates a mesh from decoded mesh data.
+     *
+     * @param meshData The mesh data; deleted by this call.
+     * @param id The ID of the mesh.
+     *
+     * @return The new mesh, or NULL if there was an error.
+     */
+    Mesh* createMesh(MeshData* meshData, const char* id);
+
+    /**
+     * Decodes the data of a mesh ahead of time, so that loading the mesh later only has
+     * to create it. Preloading touches no state outside of the bundle.
+     *
+     * @param id The ID of the mesh.
+     *
+     * @return True if successful, false if an error occurred.
+     */
+    bool preloadMesh(const char* id);
+
+    /**
+     * Decodes the data of the given meshes ahead of time.
+     *
+     * When a job system is set and the bundle is memory mapped the meshes are decoded in
+     * parallel, each through its own cursor.
+     *
+     * @param refs The refs of the meshes.
+     */
+    void preloadMeshes(const std::vector<Reference*>& refs);
+
+    /**
+     * Decodes the meshes, mesh skins and animations of a scene ahead of time, so that
+     * loading the scene only has to create its objects. Preloading touches no state
+     * outside of the bundle.
+     *
+     * @param id The ID of the scene, or NULL for the first scene in the bundle.
+     */
+    void preloadScene(const char* id);
+
+    /**
+     * Decodes the meshes, mesh skins and animations of a node ahead of time, so that
+     * loading the node only has to create its objects. Preloading touches no state
+     * outside of the bundle.
+     *
+     * @param id The ID of the node.
+     */
+    void preloadNode(const char* id);
+
+    /**
+     * Decodes the meshes and mesh skins used by a scene or a node ahead of time.
+     *
+     * @param ref The ref of the scene or node.
+     * @param nodeIds Populated with the IDs of the node, its descendants and the joints
+     *      of their skins; may be NULL.
+     */
+    void preload(Reference* ref, std::set<std::string>* nodeIds);
+
+    /**
+     * Reads over a node at the current file position, decoding the skins of its models
+     * and those of its children ahead of time.
+     *
+     * @param meshIds Populated with the IDs of the meshes of the models.
+     * @param nodeIds Populated with the IDs of the nodes and the joints of their skins; may be NULL.
+     *
+     * @return True if successful, false if an error occurred.
+     */
+    bool scanNode(std::set<std::string>* meshIds, std::set<std::string>* nodeIds);
+
+    /**
+     * Builds the curves of the animations in the bundle ahead of time, compressing them
+     * if enabled, so that loading a scene or node only has to bind them to their targets.
+     *
+     * @param targetIds The IDs of the nodes to build the curves of channels for, or NULL
+     *      for every channel. The keys of other channels are read if their target is loaded.
      */
-    MeshData* readMeshData();
+    void preloadAnimations(const std::set<std::string>* targetIds);
+
+    /**
+     * Reads an animation at the current file position into curves.
+     *
+     * @param targetIds The IDs of the nodes to build the curves of channels for, or NULL for every channel.
+     *
+     * @return The animation data, or NULL if there was an error.
+     */
+    AnimationData* preloadAnimation(const std::set<std::string>* targetIds);
+
+    /**
+     * Creates the animations built ahead of time on the nodes loaded in this load session.
+     *
+     * Channels target the tracked nodes when nodes are being tracked, and the nodes of the
+     * scene otherwise.
+     *
+     * @param scene The scene that the animations are in; may be NULL when nodes are tracked.
+     */
+    void createAnimations(Scene* scene);
+
+    /**
+     * Deletes the animation data built ahead of time.
+     */
+    void clearPreloadedAnimations();
+
+    /**
+     * Deletes the meshes, skins and animations decoded ahead of time and not used.
+     */
+    void clearPreloaded();
+
+    /**
+     * Compresses the animation curves read in this load session in parallel.
+     */
+    void compressCurves();
+
+    /**
+     * Compresses an animation curve if enabled, or queues it for compressCurves when a
+     * job system is set.
+     */
+    void compressCurve(Curve* curve);
 
     /**
      * Reads mesh data for the specified URL.
@@ -388,6 +656,13 @@ private:
      */
     MeshSkin* readMeshSkin();
 
+    /**
+     * Reads a mesh skin and its joint references from the current file position.
+     *
+     * @return The new mesh skin data, or NULL if there was an error.
+     */
+    MeshSkinData* readMeshSkinData();
+
     /**
      * Reads an animation from the current file position.
      * 
@@ -428,6 +703,17 @@ private:
      */
     Animation* readAnimationChannelData(Animation* animation, const char* id, AnimationTarget* target, unsigned int targetAttribute);
 
+    /**
+     * Reads the keys of an animation channel at the current file position.
+     *
+     * @param id The ID of the animation that the channel belongs to.
+     * @param keyTimes Populated with the key times.
+     * @param values Populated with the key values.
+     *
+     * @return True if successful, false if an error occurred.
+     */
+    bool readAnimationKeys(const char* id, std::vector<unsigned int>* keyTimes, std::vector<float>* values);
+
     /**
      * Sets the transformation matrix.
      *
@@ -451,14 +737,28 @@ private:
     bool skipNode();
 
     unsigned char _version[2];
+    unsigned char _objectVersion[2];    // The version 1 format the objects are encoded in; _version for version 1 bundles.
+    std::vector<Section> _sections;     // The section table of a sectioned bundle; empty for version 1 bundles.
     std::string _path;
     std::string _materialPath;
     unsigned int _referenceCount;
     Reference* _references;
+    std::unordered_map<std::string, Reference*> _referenceIds;          // The refs by id.
+    std::unordered_map<unsigned int, Reference*> _referenceOffsets;     // The refs by offset.
     Stream* _stream;
 
     std::vector<MeshSkinData*> _meshSkins;
     std::map<std::string, Node*>* _trackedNodes;
+    std::map<std::string, MeshData*> _preloadedMeshes;  // Mesh data decoded ahead of time, by mesh ID.
+    std::map<long, MeshSkinData*> _preloadedSkins;      // Mesh skins decoded ahead of time, by file position.
+    std::vector<AnimationData*> _preloadedAnimations;   // Animations built ahead of time; empty if none.
+    Reference* _preloadedRef;           // The scene or node whose data was decoded ahead of time; NULL if none.
+    float _compressionTolerance;        // Tolerance to compress animation curves with; negative if disabled.
+    unsigned int _animationDataSize;    // Size of the animation curves compressed in this load session.
+    unsigned int _compressedDataSize;   // Size of those curves once compressed.
+    float _compressionError;            // Largest error of the curves compressed in this load session.
+    std::vector<Curve*> _curves;        // Curves read in this load session, to be compressed on the job system.
+    vkTools::JobSystem* _jobSystem;     // The job system to decode independent objects on; may be NULL.
 };
 
 }
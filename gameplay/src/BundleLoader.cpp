@@ -0,0 +1,265 @@
+#include "Base.h"
+#include "BundleLoader.h"
+#include "Bundle.h"
+#include "Game.h"
+#include "Scene.h"
+#include "Node.h"
+#include "Mesh.h"
+#include "Font.h"
+#include "jobsystem.hpp"
+
+// Size of the pages touched to fault a mapped bundle into memory.
+#define BUNDLE_PAGE_SIZE 4096
+
+namespace vkcore
+{
+
+BundleLoader::Request::Request(Type type, const char* path, const char* id, Listener* listener) :
+    _type(type), _state(LOADING), _path(path), _id(id ? id : ""), _listener(listener),
+    _cancelled(false), _decoded(false), _bundle(NULL), _job(NULL), _result(NULL)
+{
+}
+
+BundleLoader::Request::~Request()
+{
+    GP_ASSERT(_job == NULL);
+    SAFE_RELEASE(_bundle);
+    SAFE_RELEASE(_result);
+}
+
+BundleLoader::Request::Type BundleLoader::Request::getType() const
+{
+    return _type;
+}
+
+BundleLoader::Request::State BundleLoader::Request::getState() const
+{
+    return _state;
+}
+
+const char* BundleLoader::Request::getPath() const
+{
+    return _path.c_str();
+}
+
+const char* BundleLoader::Request::getId() const
+{
+    return _id.c_str();
+}
+
+Scene* BundleLoader::Request::getScene() const
+{
+    return _type == SCENE ? static_cast<Scene*>(_result) : NULL;
+}
+
+Node* BundleLoader::Request::getNode() const
+{
+    return _type == NODE ? static_cast<Node*>(_result) : NULL;
+}
+
+Mesh* BundleLoader::Request::getMesh() const
+{
+    return _type == MESH ? static_cast<Mesh*>(_result) : NULL;
+}
+
+Font* BundleLoader::Request::getFont() const
+{
+    return _type == FONT ? static_cast<Font*>(_result) : NULL;
+}
+
+void BundleLoader::Request::cancel()
+{
+    if (_state == LOADING)
+        _cancelled.store(true, std::memory_order_relaxed);
+}
+
+BundleLoader::BundleLoader(vkTools::JobSystem& jobSystem) :
+    _jobSystem(jobSystem)
+{
+}
+
+BundleLoader::~BundleLoader()
+{
+    for (size_t i = 0, count = _requests.size(); i < count; ++i)
+    {
+        Request* request = _requests[i];
+        request->_cancelled.store(true, std::memory_order_relaxed);
+        _jobSystem.wait(*request->_job);
+        SAFE_DELETE(request->_job);
+        SAFE_RELEASE(request->_bundle);
+        request->_state = Request::CANCELLED;
+        request->release();
+    }
+    _requests.clear();
+}
+
+BundleLoader::Request* BundleLoader::loadScene(const char* path, const char* id, Listener* listener)
+{
+    return load(Request::SCENE, path, id, listener);
+}
+
+BundleLoader::Request* BundleLoader::loadNode(const char* path, const char* id, Listener* listener)
+{
+    GP_ASSERT(id);
+    return load(Request::NODE, path, id, listener);
+}
+
+BundleLoader::Request* BundleLoader::loadMesh(const char* path, const char* id, Listener* listener)
+{
+    GP_ASSERT(id);
+    return load(Request::MESH, path, id, listener);
+}
+
+BundleLoader::Request* BundleLoader::loadFont(const char* path, const char* id, Listener* listener)
+{
+    GP_ASSERT(id);
+    return load(Request::FONT, path, id, listener);
+}
+
+BundleLoader::Request* BundleLoader::load(Request::Type type, const char* path, const char* id, Listener* listener)
+{
+    GP_ASSERT(path);
+
+    // The game config is read here since it is not safe to read from the worker.
+    float compressionTolerance = Bundle::getCompressionTolerance();
+
+    // The loader keeps its own reference until the request is finished.
+    Request* request = new Request(type, path, id, listener);
+    request->addRef();
+    vkTools::JobSystem* jobSystem = &_jobSystem;
+    request->_job = new vkTools::JobHandle(_jobSystem.run([request, jobSystem, compressionTolerance]()
+    {
+        decode(request, jobSystem, compressionTolerance);
+    }));
+    _requests.push_back(request);
+
+    return request;
+}
+
+void BundleLoader::decode(Request* request, vkTools::JobSystem* jobSystem, float compressionTolerance)
+{
+    GP_ASSERT(request);
+
+    // Only the request's bundle and its atomic flags may be touched here; everything else
+    // belongs to the main thread until _decoded is set.
+    if (!request->_cancelled.load(std::memory_order_relaxed))
+    {
+        Bundle* bundle = Bundle::open(request->_path.c_str(), compressionTolerance);
+        if (bundle)
+        {
+            // Meshes are decoded and curves compressed in parallel here.
+            bundle->setJobSystem(jobSystem);
+
+            // Fault the mapped pages in now rather than on the main thread.
+            const unsigned char* data = bundle->_stream->getData();
+            if (data)
+            {
+                size_t length = bundle->_stream->length();
+                volatile unsigned char sum = 0;
+                for (size_t offset = 0; offset < length; offset += BUNDLE_PAGE_SIZE)
+                    sum += data[offset];
+            }
+
+            // Decode the meshes and skins the object uses and build its animation curves, so that
+            // hookup only has to create the objects and bind them together.
+            switch (request->_type)
+            {
+            case Request::MESH:
+                bundle->preloadMesh(request->_id.c_str());
+                break;
+            case Request::SCENE:
+                bundle->preloadScene(request->_id.empty() ? NULL : request->_id.c_str());
+                break;
+            case Request::NODE:
+                bundle->preloadNode(request->_id.c_str());
+                break;
+            case Request::FONT:
+                // The glyph texture is created on the main thread.
+                break;
+            }
+        }
+        request->_bundle = bundle;
+    }
+
+    request->_decoded.store(true, std::memory_order_release);
+}
+
+unsigned int BundleLoader::update(float budget)
+{
+    double start = Game::getAbsoluteTime();
+
+    size_t i = 0;
+    while (i < _requests.size())
+    {
+        Request* request = _requests[i];
+        if (!request->_decoded.load(std::memory_order_acquire))
+        {
+            ++i;
+            continue;
+        }
+
+        _requests.erase(_requests.begin() + i);
+        finish(request);
+        request->release();
+
+        if (Game::getAbsoluteTime() - start >= budget)
+            break;
+    }
+
+    return (unsigned int)_requests.size();
+}
+
+unsigned int BundleLoader::getRequestCount() const
+{
+    return (unsigned int)_requests.size();
+}
+
+void BundleLoader::finish(Request* request)
+{
+    GP_ASSERT(request);
+    GP_ASSERT(request->_job);
+
+    // The job is done; this only releases its handle.
+    _jobSystem.wait(*request->_job);
+    SAFE_DELETE(request->_job);
+
+    Bundle* bundle = request->_bundle;
+    request->_bundle = NULL;
+
+    if (request->_cancelled.load(std::memory_order_relaxed))
+    {
+        request->_state = Request::CANCELLED;
+    }
+    else if (bundle == NULL)
+    {
+        GP_WARN("Failed to open bundle '%s' in the background.", request->_path.c_str());
+        request->_state = Request::FAILED;
+    }
+    else
+    {
+        const char* id = request->_id.c_str();
+        switch (request->_type)
+        {
+        case Request::SCENE:
+            request->_result = bundle->loadScene(request->_id.empty() ? NULL : id);
+            break;
+        case Request::NODE:
+            request->_result = bundle->loadNode(id);
+            break;
+        case Request::MESH:
+            request->_result = bundle->loadMesh(id);
+            break;
+        case Request::FONT:
+            request->_result = bundle->loadFont(id);
+            break;
+        }
+        request->_state = request->_result ? Request::COMPLETED : Request::FAILED;
+    }
+
+    SAFE_RELEASE(bundle);
+
+    if (request->_listener)
+        request->_listener->loadCompleted(request);
+}
+
+}
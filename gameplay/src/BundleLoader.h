@@ -0,0 +1,317 @@
+#ifndef BUNDLELOADER_H_
+#define BUNDLELOADER_H_
+
+#include "Ref.h"
+
+namespace vkTools
+{
+class JobSystem;
+class JobHandle;
+}
+
+namespace vkcore
+{
+
+class Bundle;
+class Scene;
+class Node;
+class Mesh;
+class Font;
+
+/**
+ * Defines a loader that reads bundles in the background.
+ *
+ * Each load request opens its bundle on a job of the job system and decodes there the
+ * data of the object it loads: the vertex and index data of the meshes it uses, its mesh
+ * skins, and the curves of the animations that target it, compressed if enabled. The
+ * objects that the engine shares between threads (scene nodes, materials, animations and
+ * GPU resources) are then created on the main thread when the loader is updated, from
+ * the decoded data.
+ *
+ * The hookup of a request is not split: each update finishes whole requests, oldest
+ * first, until its time budget is spent. Many requests are spread over several frames,
+ * but the hookup of a single large scene still runs within one update, and materials
+ * are still read from their files during hookup.
+ *
+ * Bundles opened by the loader do not go through the bundle cache, so a bundle being
+ * loaded in the background never aliases one opened with Bundle::create.
+ */
+class BundleLoader
+{
+public:
+
+    class Request;
+
+    /**
+     * Defines the interface to be notified when a load request is done.
+     */
+    class Listener
+    {
+    public:
+
+        /**
+         * Destructor.
+         */
+        virtual ~Listener() { }
+
+        /**
+         * Called on the main thread, from BundleLoader::update, when a request is done.
+         *
+         * The request has completed, failed or been cancelled; see Request::getState.
+         *
+         * @param request The request that is done.
+         */
+        virtual void loadCompleted(Request* request) = 0;
+    };
+
+    /**
+     * Defines a single background load of an object from a bundle.
+     */
+    class Request : public Ref
+    {
+        friend class BundleLoader;
+
+    public:
+
+        /**
+         * The type of object a request loads.
+         */
+        enum Type
+        {
+            SCENE,
+            NODE,
+            MESH,
+            FONT
+        };
+
+        /**
+         * The state of a request.
+         */
+        enum State
+        {
+            LOADING,
+            COMPLETED,
+            FAILED,
+            CANCELLED
+        };
+
+        /**
+         * Gets the type of object this request loads.
+         *
+         * @return The type of the request.
+         */
+        Type getType() const;
+
+        /**
+         * Gets the state of this request.
+         *
+         * @return The state of the request.
+         */
+        State getState() const;
+
+        /**
+         * Gets the path of the bundle this request loads from.
+         *
+         * @return The bundle path.
+         */
+        const char* getPath() const;
+
+        /**
+         * Gets the ID of the object this request loads.
+         *
+         * @return The object ID, or an empty string for the first scene of the bundle.
+         */
+        const char* getId() const;
+
+        /**
+         * Gets the loaded scene of a completed SCENE request.
+         *
+         * The request holds a reference to the scene; call addRef to keep it beyond the request.
+         *
+         * @return The loaded scene, or NULL.
+         */
+        Scene* getScene() const;
+
+        /**
+         * Gets the loaded node of a completed NODE request.
+         *
+         * The request holds a reference to the node; call addRef to keep it beyond the request.
+         *
+         * @return The loaded node, or NULL.
+         */
+        Node* getNode() const;
+
+        /**
+         * Gets the loaded mesh of a completed MESH request.
+         *
+         * The request holds a reference to the mesh; call addRef to keep it beyond the request.
+         *
+         * @return The loaded mesh, or NULL.
+         */
+        Mesh* getMesh() const;
+
+        /**
+         * Gets the loaded font of a completed FONT request.
+         *
+         * The request holds a reference to the font; call addRef to keep it beyond the request.
+         *
+         * @return The loaded font, or NULL.
+         */
+        Font* getFont() const;
+
+        /**
+         * Cancels this request if it is still loading.
+         *
+         * Background work that has not started yet is skipped and nothing is created on
+         * the main thread. The listener is still notified, with the CANCELLED state.
+         */
+        void cancel();
+
+    private:
+
+        /**
+         * Constructor.
+         */
+        Request(Type type, const char* path, const char* id, Listener* listener);
+
+        /**
+         * Destructor.
+         */
+        ~Request();
+
+        /**
+         * Hidden copy constructor.
+         */
+        Request(const Request& copy);
+
+        /**
+         * Hidden copy assignment operator.
+         */
+        Request& operator=(const Request&);
+
+        Type _type;                     // The type of object to load.
+        State _state;                   // The state of the request; only changed on the main thread.
+        std::string _path;              // The path of the bundle.
+        std::string _id;                // The ID of the object to load.
+        Listener* _listener;            // The listener to notify when done; may be NULL.
+        std::atomic<bool> _cancelled;   // Set by cancel; read by the background job.
+        std::atomic<bool> _decoded;     // Set once the background job is done with the request.
+        Bundle* _bundle;                // The bundle opened by the background job; NULL if it failed.
+        vkTools::JobHandle* _job;       // The background job of the request.
+        Ref* _result;                   // The loaded object.
+    };
+
+    /**
+     * Constructor.
+     *
+     * @param jobSystem The job system to open and decode bundles on.
+     */
+    BundleLoader(vkTools::JobSystem& jobSystem);
+
+    /**
+     * Destructor.
+     *
+     * Waits for the background jobs of outstanding requests. Outstanding requests are
+     * cancelled without notifying their listeners.
+     */
+    ~BundleLoader();
+
+    /**
+     * Loads a scene from a bundle in the background.
+     *
+     * @param path The path of the bundle.
+     * @param id The ID of the scene to load, or NULL to load the first scene in the bundle.
+     * @param listener The listener to notify when the request is done; may be NULL.
+     *
+     * @return The new request. The caller owns a reference to it and must release it.
+     */
+    Request* loadScene(const char* path, const char* id = NULL, Listener* listener = NULL);
+
+    /**
+     * Loads a node from a bundle in the background.
+     *
+     * @param path The path of the bundle.
+     * @param id The ID of the node to load.
+     * @param listener The listener to notify when the request is done; may be NULL.
+     *
+     * @return The new request. The caller owns a reference to it and must release it.
+     */
+    Request* loadNode(const char* path, const char* id, Listener* listener = NULL);
+
+    /**
+     * Loads a mesh from a bundle in the background.
+     *
+     * @param path The path of the bundle.
+     * @param id The ID of the mesh to load.
+     * @param listener The listener to notify when the request is done; may be NULL.
+     *
+     * @return The new request. The caller owns a reference to it and must release it.
+     */
+    Request* loadMesh(const char* path, const char* id, Listener* listener = NULL);
+
+    /**
+     * Loads a font from a bundle in the background.
+     *
+     * @param path The path of the bundle.
+     * @param id The ID of the font to load.
+     * @param listener The listener to notify when the request is done; may be NULL.
+     *
+     * @return The new request. The caller owns a reference to it and must release it.
+     */
+    Request* loadFont(const char* path, const char* id, Listener* listener = NULL);
+
+    /**
+     * Creates the objects of requests whose background work is done.
+     *
+     * Must be called on the main thread, typically once per frame. Requests are finished
+     * oldest first until the budget is spent; at least one ready request is finished on
+     * every call so that loading always makes progress. The budget is checked between
+     * requests, so a single request may overrun it.
+     *
+     * @param budget The time, in milliseconds, to spend finishing requests.
+     *
+     * @return The number of requests still outstanding.
+     */
+    unsigned int update(float budget);
+
+    /**
+     * Gets the number of requests that are not done yet.
+     *
+     * @return The number of outstanding requests.
+     */
+    unsigned int getRequestCount() const;
+
+private:
+
+    /**
+     * Hidden copy constructor.
+     */
+    BundleLoader(const BundleLoader& copy);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    BundleLoader& operator=(const BundleLoader&);
+
+    /**
+     * Creates a request and schedules its background job.
+     */
+    Request* load(Request::Type type, const char* path, const char* id, Listener* listener);
+
+    /**
+     * Opens the bundle of a request and decodes its data. Runs on a worker thread.
+     */
+    static void decode(Request* request, vkTools::JobSystem* jobSystem, float compressionTolerance);
+
+    /**
+     * Creates the objects of a decoded request and notifies its listener.
+     */
+    void finish(Request* request);
+
+    vkTools::JobSystem& _jobSystem;     // The job system background jobs run on.
+    std::vector<Request*> _requests;    // Outstanding requests, oldest first.
+};
+
+}
+
+#endif
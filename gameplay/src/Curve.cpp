@@ -5,6 +5,7 @@
 #include <cstring>
 #include <cmath>
 #include <memory>
+#include <vector>
 
 using std::memcpy;
 using std::fabs;
@@ -13,11 +14,22 @@ using std::cos;
 using std::sin;
 using std::exp;
 using std::strcmp;
+using std::memset;
+using std::floor;
 
 #ifndef NULL
 #define NULL 0
 #endif
 
+// Largest number of components a curve can have and still be compressed.
+#define COMPRESSED_MAX_COMPONENTS 16
+
+// Range of the three smallest components of a unit quaternion (1 / sqrt(2)).
+#define QUATERNION_SMALLEST_RANGE 0.707106781f
+
+// Largest value of a 15 bit quantized quaternion component.
+#define QUATERNION_SMALLEST_MAX 32767
+
 #ifndef MATH_PI
 #define MATH_PI 3.14159265358979323846f
 #endif
@@ -89,7 +101,8 @@ Curve* Curve::create(unsigned int pointCount, unsigned int componentCount)
 }
 
 Curve::Curve(unsigned int pointCount, unsigned int componentCount)
-    : _pointCount(pointCount), _componentCount(componentCount), _componentSize(sizeof(float)*componentCount), _quaternionOffset(NULL), _points(NULL)
+    : _pointCount(pointCount), _componentCount(componentCount), _componentSize(sizeof(float)*componentCount), _quaternionOffset(NULL), _points(NULL),
+      _times(NULL), _packedValues(NULL), _packedStride(0), _valueMin(NULL), _valueScale(NULL)
 {
     _points = new Point[_pointCount];
     for (unsigned int i = 0; i < _pointCount; i++)
@@ -107,6 +120,10 @@ Curve::~Curve()
 {
     SAFE_DELETE_ARRAY(_points);
     SAFE_DELETE_ARRAY(_quaternionOffset);
+    SAFE_DELETE_ARRAY(_times);
+    SAFE_DELETE_ARRAY(_packedValues);
+    SAFE_DELETE_ARRAY(_valueMin);
+    SAFE_DELETE_ARRAY(_valueScale);
 }
 
 Curve::Point::Point()
@@ -121,6 +138,100 @@ Curve::Point::~Point()
     SAFE_DELETE_ARRAY(outValue);
 }
 
+/**
+ * Quantizes a quaternion to its three smallest components. The index of the largest
+ * component is stored in the top bits of the first two values.
+ */
+static void encodeQuaternion(const float* q, unsigned short* dst)
+{
+    unsigned int largest = 0;
+    for (unsigned int i = 1; i < 4; i++)
+    {
+        if (fabs(q[i]) > fabs(q[largest]))
+            largest = i;
+    }
+
+    // q and -q are the same rotation, so flip the quaternion to make the largest component positive.
+    float length = sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+    float scale = length > 0.0f ? (q[largest] < 0.0f ? -1.0f : 1.0f) / length : 0.0f;
+
+    for (unsigned int i = 0, k = 0; i < 4; i++)
+    {
+        if (i == largest)
+            continue;
+
+        float v = (q[i] * scale + QUATERNION_SMALLEST_RANGE) / (2.0f * QUATERNION_SMALLEST_RANGE);
+        int bits = (int)floor(v * QUATERNION_SMALLEST_MAX + 0.5f);
+        dst[k++] = (unsigned short)(bits < 0 ? 0 : (bits > QUATERNION_SMALLEST_MAX ? QUATERNION_SMALLEST_MAX : bits));
+    }
+    dst[0] |= (unsigned short)((largest & 1) << 15);
+    dst[1] |= (unsigned short)((largest >> 1) << 15);
+}
+
+/**
+ * Rebuilds a quaternion quantized by encodeQuaternion.
+ */
+static void decodeQuaternion(const unsigned short* src, float* dst)
+{
+    unsigned int largest = (src[0] >> 15) | ((src[1] >> 15) << 1);
+    float sum = 0.0f;
+    for (unsigned int i = 0, k = 0; i < 4; i++)
+    {
+        if (i == largest)
+            continue;
+
+        float v = (float)(src[k++] & 0x7fff) * (2.0f * QUATERNION_SMALLEST_RANGE / QUATERNION_SMALLEST_MAX) - QUATERNION_SMALLEST_RANGE;
+        dst[i] = v;
+        sum += v * v;
+    }
+    dst[largest] = sum < 1.0f ? sqrt(1.0f - sum) : 0.0f;
+}
+
+float Curve::getKeyTime(unsigned int index) const
+{
+    return _points ? _points[index].time : _times[index];
+}
+
+void Curve::getKeyValue(unsigned int index, float* dst) const
+{
+    if (_points)
+    {
+        memcpy(dst, _points[index].value, _componentSize);
+        return;
+    }
+
+    const unsigned short* packed = _packedValues + index * _packedStride;
+    unsigned int quaternionOffset = _quaternionOffset ? *_quaternionOffset : _componentCount;
+    for (unsigned int i = 0; i < _componentCount;)
+    {
+        if (i == quaternionOffset)
+        {
+            decodeQuaternion(packed, dst + i);
+            packed += 3;
+            i += 4;
+        }
+        else
+        {
+            dst[i] = _valueMin[i] + (float)*packed++ * _valueScale[i];
+            i++;
+        }
+    }
+}
+
+Curve::Cursor::Cursor()
+{
+    reset();
+}
+
+void Curve::Cursor::reset()
+{
+    _index = 0;
+    _min = 0;
+    _max = 0;
+    _startTime = -1.0f;
+    _endTime = -1.0f;
+}
+
 unsigned int Curve::getPointCount() const
 {
     return _pointCount;
@@ -133,30 +244,42 @@ unsigned int Curve::getComponentCount() const
 
 float Curve::getStartTime() const
 {
-    return _points[0].time;
+    return getKeyTime(0);
 }
 
 float Curve::getEndTime() const
 {
-    return _points[_pointCount-1].time;
+    return getKeyTime(_pointCount - 1);
 }
 
 float Curve::getPointTime(unsigned int index) const
 {
     assert(index < _pointCount);
-    return _points[index].time;
+    return getKeyTime(index);
 }
 
 
 Curve::InterpolationType Curve::getPointInterpolation(unsigned int index) const
 {
     assert(index < _pointCount);
-    return _points[index].type;;
+    return _points ? _points[index].type : LINEAR;
 }
 
 void Curve::getPointValues(unsigned int index, float* value, float* inValue, float* outValue) const
 {
     assert(index < _pointCount);
+
+    if (_packedValues)
+    {
+        // Compressed curves are linear, so they have no tangents.
+        if (value)
+            getKeyValue(index, value);
+        if (inValue)
+            memset(inValue, 0, _componentSize);
+        if (outValue)
+            memset(outValue, 0, _componentSize);
+        return;
+    }
     
     if (value)
         memcpy(value, _points[index].value, _componentSize);
@@ -176,6 +299,7 @@ void Curve::setPoint(unsigned int index, float time, float* value, Interpolation
 void Curve::setPoint(unsigned int index, float time, float* value, InterpolationType type, float* inValue, float* outValue)
 {
     assert(index < _pointCount && time >= 0.0f && time <= 1.0f && !(_pointCount > 1 && index == 0 && time != 0.0f) && !(_pointCount != 1 && index == _pointCount - 1 && time != 1.0f));
+    assert(!_packedValues);
 
     _points[index].time = time;
     _points[index].type = type;
@@ -192,7 +316,7 @@ void Curve::setPoint(unsigned int index, float time, float* value, Interpolation
 
 void Curve::setTangent(unsigned int index, InterpolationType type, float* inValue, float* outValue)
 {
-    assert(index < _pointCount);
+    assert(index < _pointCount && !_packedValues);
 
     _points[index].type = type;
 
@@ -211,13 +335,18 @@ void Curve::evaluate(float time, float* dst) const
 }
 
 void Curve::evaluate(float time, float startTime, float endTime, float loopBlendTime, float* dst) const
+{
+    evaluate(time, startTime, endTime, loopBlendTime, dst, NULL);
+}
+
+void Curve::evaluate(float time, float startTime, float endTime, float loopBlendTime, float* dst, Cursor* cursor) const
 {
     assert(dst && startTime >= 0.0f && startTime <= endTime && endTime <= 1.0f && loopBlendTime >= 0.0f);
 
     // If there's only one point on the curve, return its value.
     if (_pointCount == 1)
     {
-        memcpy(dst, _points[0].value, _componentSize);
+        getKeyValue(0, dst);
         return;
     }
 
@@ -227,72 +356,93 @@ void Curve::evaluate(float time, float startTime, float endTime, float loopBlend
     if (startTime > 0.0f || endTime < 1.0f)
     {
         // Evaluating a sub section of the curve
-        min = determineIndex(startTime, 0, max);
-        max = determineIndex(endTime, min, max);
+        if (cursor && cursor->_startTime == startTime && cursor->_endTime == endTime)
+        {
+            // The subregion bounds only change when the clip does, so reuse the cached ones.
+            min = cursor->_min;
+            max = cursor->_max;
+        }
+        else
+        {
+            min = determineIndex(startTime, 0, max);
+            max = determineIndex(endTime, min, max);
+            if (cursor)
+            {
+                cursor->_min = min;
+                cursor->_max = max;
+                cursor->_startTime = startTime;
+                cursor->_endTime = endTime;
+            }
+        }
 
         // Convert time to fall within the subregion
-        localTime = _points[min].time + (_points[max].time - _points[min].time) * time;
+        localTime = getKeyTime(min) + (getKeyTime(max) - getKeyTime(min)) * time;
     }
 
     if (loopBlendTime == 0.0f)
     {
         // If no loop blend time is specified, clamp time to end points
-        if (localTime < _points[min].time)
-            localTime = _points[min].time;
-        else if (localTime > _points[max].time)
-            localTime = _points[max].time;
+        if (localTime < getKeyTime(min))
+            localTime = getKeyTime(min);
+        else if (localTime > getKeyTime(max))
+            localTime = getKeyTime(max);
     }
 
     // If an exact endpoint was specified, skip interpolation and return the value directly
-    if (localTime == _points[min].time)
+    if (localTime == getKeyTime(min))
     {
-        memcpy(dst, _points[min].value, _componentSize);
+        getKeyValue(min, dst);
         return;
     }
-    if (localTime == _points[max].time)
+    if (localTime == getKeyTime(max))
     {
-        memcpy(dst, _points[max].value, _componentSize);
+        getKeyValue(max, dst);
         return;
     }
 
-    Point* from;
-    Point* to;
-    float scale;
+    unsigned int fromIndex;
+    unsigned int toIndex;
     float t;
-    unsigned int index;
 
-    if (localTime > _points[max].time)
+    if (localTime > getKeyTime(max))
     {
         // Looping forward
-        index = max;
-        from = &_points[max];
-        to = &_points[min];
+        fromIndex = max;
+        toIndex = min;
 
         // Calculate the fractional time between the two points.
-        t = (localTime - from->time) / loopBlendTime;
+        t = (localTime - getKeyTime(fromIndex)) / loopBlendTime;
     }
-    else if (localTime < _points[min].time)
+    else if (localTime < getKeyTime(min))
     {
         // Looping in reverse
-        index = min;
-        from = &_points[min];
-        to = &_points[max];
+        fromIndex = min;
+        toIndex = max;
 
         // Calculate the fractional time between the two points.
-        t = (from->time - localTime) / loopBlendTime;
+        t = (getKeyTime(fromIndex) - localTime) / loopBlendTime;
     }
     else
     {
-        // Locate the points we are interpolating between using a binary search.
-        index = determineIndex(localTime, min, max);
-        from = &_points[index];
-        to = &_points[index == max ? index : index+1];
+        // Locate the points we are interpolating between, resuming from the cursor if there is one.
+        fromIndex = cursor ? determineIndex(localTime, min, max, cursor) : determineIndex(localTime, min, max);
+        toIndex = fromIndex == max ? fromIndex : fromIndex + 1;
 
         // Calculate the fractional time between the two points.
-        scale = (to->time - from->time);
-        t = (localTime - from->time) / scale;
+        t = (localTime - getKeyTime(fromIndex)) / (getKeyTime(toIndex) - getKeyTime(fromIndex));
     }
 
+    // Compressed curves only hold linear keys.
+    if (_packedValues)
+    {
+        interpolateCompressed(t, fromIndex, toIndex, dst);
+        return;
+    }
+
+    unsigned int index = fromIndex;
+    Point* from = &_points[fromIndex];
+    Point* to = &_points[toIndex];
+
     // Calculate the value of the curve discretely if appropriate.
     switch (from->type)
     {
@@ -833,9 +983,137 @@ float Curve::lerp(float t, float from, float to)
     return lerpInl(t, from, to);
 }
 
+bool Curve::compress(float tolerance, float* maxError)
+{
+    if (_packedValues)
+    {
+        if (maxError)
+            *maxError = 0.0f;
+        return true;
+    }
+
+    if (_componentCount > COMPRESSED_MAX_COMPONENTS)
+        return false;
+    for (unsigned int i = 0; i < _pointCount; i++)
+    {
+        if (_points[i].type != LINEAR)
+            return false;
+    }
+
+    // Select the keys to keep: extend a segment from the last kept key for as long as
+    // interpolating across it reproduces every key it skips to within the tolerance.
+    std::vector<unsigned int> keys;
+    keys.push_back(0);
+    float value[COMPRESSED_MAX_COMPONENTS];
+    if (tolerance > 0.0f)
+    {
+        unsigned int anchor = 0;
+        for (unsigned int i = 2; i < _pointCount; i++)
+        {
+            float duration = _points[i].time - _points[anchor].time;
+            bool fits = duration > 0.0f;
+            for (unsigned int j = anchor + 1; fits && j < i; j++)
+            {
+                interpolateLinear((_points[j].time - _points[anchor].time) / duration, &_points[anchor], &_points[i], value);
+                fits = getValueError(value, _points[j].value) <= tolerance;
+            }
+            if (!fits)
+            {
+                anchor = i - 1;
+                keys.push_back(anchor);
+            }
+        }
+    }
+    else
+    {
+        for (unsigned int i = 1; i < _pointCount - 1; i++)
+            keys.push_back(i);
+    }
+    if (_pointCount > 1)
+        keys.push_back(_pointCount - 1);
+
+    // Find the range of each fixed-point component over the kept keys.
+    unsigned int keyCount = (unsigned int)keys.size();
+    unsigned int quaternionOffset = _quaternionOffset ? *_quaternionOffset : _componentCount;
+    _valueMin = new float[_componentCount];
+    _valueScale = new float[_componentCount];
+    for (unsigned int i = 0; i < _componentCount; i++)
+    {
+        float minValue = _points[keys[0]].value[i];
+        float maxValue = minValue;
+        for (unsigned int k = 1; k < keyCount; k++)
+        {
+            float v = _points[keys[k]].value[i];
+            minValue = v < minValue ? v : minValue;
+            maxValue = v > maxValue ? v : maxValue;
+        }
+        _valueMin[i] = minValue;
+        _valueScale[i] = (maxValue - minValue) / 65535.0f;
+    }
+
+    // Quantize the kept keys.
+    _packedStride = _quaternionOffset ? _componentCount - 1 : _componentCount;
+    _packedValues = new unsigned short[keyCount * _packedStride];
+    _times = new float[keyCount];
+    for (unsigned int k = 0; k < keyCount; k++)
+    {
+        const Point& point = _points[keys[k]];
+        unsigned short* packed = _packedValues + k * _packedStride;
+        _times[k] = point.time;
+        for (unsigned int i = 0; i < _componentCount;)
+        {
+            if (i == quaternionOffset)
+            {
+                encodeQuaternion(point.value + i, packed);
+                packed += 3;
+                i += 4;
+            }
+            else
+            {
+                float v = _valueScale[i] > 0.0f ? (point.value[i] - _valueMin[i]) / _valueScale[i] : 0.0f;
+                int bits = (int)floor(v + 0.5f);
+                *packed++ = (unsigned short)(bits < 0 ? 0 : (bits > 65535 ? 65535 : bits));
+                i++;
+            }
+        }
+    }
+
+    // Measure the error of the compressed curve at the original keys before discarding them.
+    Point* points = _points;
+    unsigned int pointCount = _pointCount;
+    _points = NULL;
+    _pointCount = keyCount;
+    float error = 0.0f;
+    for (unsigned int i = 0; i < pointCount; i++)
+    {
+        evaluate(points[i].time, value);
+        float e = getValueError(value, points[i].value);
+        error = e > error ? e : error;
+    }
+    SAFE_DELETE_ARRAY(points);
+
+    if (maxError)
+        *maxError = error;
+    return true;
+}
+
+bool Curve::isCompressed() const
+{
+    return _packedValues != NULL;
+}
+
+unsigned int Curve::getPointDataSize() const
+{
+    if (_packedValues)
+        return _pointCount * (sizeof(float) + _packedStride * sizeof(unsigned short)) + 2 * _componentSize;
+
+    // Every point allocates its value and both tangents.
+    return _pointCount * (sizeof(Point) + 3 * _componentSize);
+}
+
 void Curve::setQuaternionOffset(unsigned int offset)
 {
-    assert(offset <= (_componentCount - 4));
+    assert(offset <= (_componentCount - 4) && !_packedValues);
 
     if (!_quaternionOffset)
         _quaternionOffset = new unsigned int[1];
@@ -1247,6 +1525,59 @@ void Curve::interpolateQuaternion(float s, float* from, float* to, float* dst) c
         Quaternion::slerp(to[0], to[1], to[2], to[3], from[0], from[1], from[2], from[3], s, dst, dst + 1, dst + 2, dst + 3);
 }
 
+void Curve::interpolateCompressed(float s, unsigned int from, unsigned int to, float* dst) const
+{
+    float fromValue[COMPRESSED_MAX_COMPONENTS];
+    float toValue[COMPRESSED_MAX_COMPONENTS];
+    getKeyValue(from, fromValue);
+    getKeyValue(to, toValue);
+
+    unsigned int quaternionOffset = _quaternionOffset ? *_quaternionOffset : _componentCount;
+    for (unsigned int i = 0; i < _componentCount; i++)
+    {
+        if (i == quaternionOffset)
+        {
+            interpolateQuaternion(s, fromValue + i, toValue + i, dst + i);
+            i += 3;
+        }
+        else if (fromValue[i] == toValue[i])
+        {
+            dst[i] = fromValue[i];
+        }
+        else
+        {
+            dst[i] = lerpInl(s, fromValue[i], toValue[i]);
+        }
+    }
+}
+
+float Curve::getValueError(const float* value, const float* expected) const
+{
+    unsigned int quaternionOffset = _quaternionOffset ? *_quaternionOffset : _componentCount;
+    float error = 0.0f;
+    for (unsigned int i = 0; i < _componentCount; i++)
+    {
+        if (i == quaternionOffset)
+        {
+            const float* q1 = value + i;
+            const float* q2 = expected + i;
+            float sign = (q1[0] * q2[0] + q1[1] * q2[1] + q1[2] * q2[2] + q1[3] * q2[3]) < 0.0f ? -1.0f : 1.0f;
+            for (unsigned int j = 0; j < 4; j++)
+            {
+                float e = fabs(q1[j] * sign - q2[j]);
+                error = e > error ? e : error;
+            }
+            i += 3;
+        }
+        else
+        {
+            float e = fabs(value[i] - expected[i]);
+            error = e > error ? e : error;
+        }
+    }
+    return error;
+}
+
 int Curve::determineIndex(float time, unsigned int min, unsigned int max) const
 {
     unsigned int mid;
@@ -1256,9 +1587,9 @@ int Curve::determineIndex(float time, unsigned int min, unsigned int max) const
     {
         mid = (min + max) >> 1;
 
-        if (time >= _points[mid].time && time < _points[mid + 1].time)
+        if (time >= getKeyTime(mid) && time < getKeyTime(mid + 1))
             return mid;
-        else if (time < _points[mid].time)
+        else if (time < getKeyTime(mid))
             max = mid - 1;
         else
             min = mid + 1;
@@ -1267,6 +1598,24 @@ int Curve::determineIndex(float time, unsigned int min, unsigned int max) const
     return max;
 }
 
+unsigned int Curve::determineIndex(float time, unsigned int min, unsigned int max, Cursor* cursor) const
+{
+    assert(cursor);
+
+    // The caller guarantees getKeyTime(min) < time < getKeyTime(max), so the result lies in [min, max).
+    unsigned int index = cursor->_index;
+    if (stepCursor(time, min, max, &index, [this](unsigned int i) { return getKeyTime(i); }))
+    {
+        cursor->_index = index;
+        return index;
+    }
+
+    // The time jumped (seek, loop or clip change), so search the whole range.
+    index = (unsigned int)determineIndex(time, min, max);
+    cursor->_index = index;
+    return index;
+}
+
 int Curve::getInterpolationType(const char* curveId)
 {
     if (strcmp(curveId, "BEZIER") == 0)
@@ -16,6 +16,7 @@ class Curve : public Ref
     friend class AnimationClip;
     friend class AnimationController;
     friend class MeshSkin;
+    friend class AnimationSampler;
 
 public:
 
@@ -275,6 +276,41 @@ public:
         BOUNCE_OUT_IN
     };
 
+    /**
+     * Remembers the keyframe segment that was last evaluated on a curve.
+     *
+     * Playback normally advances through a curve in small monotonic steps, so passing
+     * a cursor to evaluate() lets the curve resume from the previous segment and step
+     * forward instead of binary searching every frame. The cursor falls back to a
+     * binary search when the time jumps (seeking, looping or reversing).
+     *
+     * A cursor caches indices for one curve and should only be used with that curve.
+     */
+    class Cursor
+    {
+        friend class Curve;
+
+    public:
+
+        /**
+         * Constructor.
+         */
+        Cursor();
+
+        /**
+         * Invalidates the cached segment so the next evaluation performs a full search.
+         */
+        void reset();
+
+    private:
+
+        unsigned int _index;    // Index of the point starting the last evaluated segment.
+        unsigned int _min;      // First point of the cached subregion.
+        unsigned int _max;      // Last point of the cached subregion.
+        float _startTime;       // Subregion start time the cached min/max were resolved for.
+        float _endTime;         // Subregion end time the cached min/max were resolved for.
+    };
+
     /**
      * Creates a new curve.
      *
@@ -414,11 +450,67 @@ public:
      */
     void evaluate(float time, float startTime, float endTime, float loopBlendTime, float* dst) const;
 
+    /**
+     * Evaluates the curve within the specified subregion, using a cursor to locate the keyframes.
+     *
+     * Behaves exactly like the evaluate overload without a cursor, but resumes the keyframe
+     * search from the segment stored in the cursor. Evaluating at monotonically advancing
+     * times is constant time per call rather than logarithmic in the number of points.
+     *
+     * @param time The position within the subregion of the curve to evaluate the curve at.
+     * @param startTime Start time for the subregion (between 0.0 - 1.0).
+     * @param endTime End time for the subregion (between 0.0 - 1.0).
+     * @param loopBlendTime Time (in milliseconds) to blend between the end points of the curve
+     *      for looping purposes when time is outside the range 0-1. A value of zero here
+     *      disables curve looping.
+     * @param dst The evaluated value of the curve at the given time.
+     * @param cursor The cursor caching the last evaluated segment. Ignored if NULL.
+     */
+    void evaluate(float time, float startTime, float endTime, float loopBlendTime, float* dst, Cursor* cursor) const;
+
     /**
      * Linear interpolation function.
      */
     static float lerp(float t, float from, float to);
 
+    /**
+     * Compresses the keyframes of the curve to reduce its memory footprint.
+     *
+     * Keys that can be reproduced by interpolating their neighbours to within the given
+     * tolerance are removed first. The remaining keys are then quantized: the quaternion
+     * component (if any) is stored as its three smallest components at 15 bits each, and
+     * every other component is stored as a 16 bit fixed-point value over the range the
+     * component spans on this curve.
+     *
+     * Only curves whose points all use LINEAR interpolation can be compressed. A compressed
+     * curve evaluates as before but its points can no longer be modified.
+     *
+     * Note that removing keys can move the boundaries of clips whose start or end time
+     * falls on a removed key, since clip subregions are resolved against the curve's keys.
+     *
+     * @param tolerance The maximum error allowed when removing keys, in the units of
+     *      the curve's components. Zero keeps every key and only quantizes them.
+     * @param maxError Populated with the largest error of the compressed curve measured
+     *      at the original keys. Ignored if NULL.
+     *
+     * @return True if the curve was compressed, false if it cannot be compressed.
+     */
+    bool compress(float tolerance, float* maxError);
+
+    /**
+     * Determines whether the curve has been compressed.
+     *
+     * @return True if the curve is compressed, false otherwise.
+     */
+    bool isCompressed() const;
+
+    /**
+     * Gets the number of bytes of memory used by the curve's points.
+     *
+     * @return The size of the point data in bytes.
+     */
+    unsigned int getPointDataSize() const;
+
 private:
 
     /**
@@ -523,6 +615,50 @@ private:
      */
     int determineIndex(float time, unsigned int min, unsigned int max) const;
 
+    /**
+     * Gets the time of the point at the specified index, for both compressed and uncompressed curves.
+     */
+    float getKeyTime(unsigned int index) const;
+
+    /**
+     * Copies the value of the point at the specified index, decoding it if the curve is compressed.
+     */
+    void getKeyValue(unsigned int index, float* dst) const;
+
+    /**
+     * Linearly interpolates between two keys of a compressed curve.
+     */
+    void interpolateCompressed(float s, unsigned int from, unsigned int to, float* dst) const;
+
+    /**
+     * Gets the largest difference between two values of the curve; quaternions are compared
+     * after flipping one of them into the same hemisphere as the other.
+     */
+    float getValueError(const float* value, const float* expected) const;
+
+    /**
+     * Determines the current keyframe starting from the segment cached in the cursor,
+     * falling back to determineIndex when the cursor is not close to the given time.
+     */
+    unsigned int determineIndex(float time, unsigned int min, unsigned int max, Cursor* cursor) const;
+
+    /**
+     * Steps a cached segment index forward, or back by one segment, to the segment containing the given time.
+     *
+     * Shared by the cursors of curves and the compiled channels of animation samplers. The caller
+     * guarantees keyTime(min) < time < keyTime(max) and falls back to a binary search when this fails.
+     *
+     * @param time The time to find the segment of.
+     * @param min The first key of the range.
+     * @param max The last key of the range.
+     * @param index The cached segment on input; the segment containing the time on success.
+     * @param keyTime Function object returning the time of a key from its index.
+     *
+     * @return true if the segment was found within a few steps of the cached one.
+     */
+    template <class T>
+    static bool stepCursor(float time, unsigned int min, unsigned int max, unsigned int* index, const T& keyTime);
+
     /**
      * Sets the offset for the beginning of a Quaternion piece of data within the curve's value span at the specified
      * index. The next four components of data starting at the given index will be interpolated as a Quaternion.
@@ -545,9 +681,46 @@ private:
     unsigned int _componentCount;       // Number of components on the curve.
     unsigned int _componentSize;        // The component size (in bytes).
     unsigned int* _quaternionOffset;    // Offset for the rotation component.
-    Point* _points;                     // The points on the curve.
+    Point* _points;                     // The points on the curve; NULL once compressed.
+    float* _times;                      // The key times of a compressed curve.
+    unsigned short* _packedValues;      // The quantized key values of a compressed curve.
+    unsigned int _packedStride;         // The number of packed values per key of a compressed curve.
+    float* _valueMin;                   // The minimum of each fixed-point component of a compressed curve.
+    float* _valueScale;                 // The quantization step of each fixed-point component of a compressed curve.
 };
 
+template <class T>
+bool Curve::stepCursor(float time, unsigned int min, unsigned int max, unsigned int* index, const T& keyTime)
+{
+    // Number of segments a cursor steps forward before falling back to a binary search.
+    static const unsigned int CURSOR_MAX_STEPS = 4;
+
+    unsigned int i = *index;
+    if (i < min || i >= max)
+        return false;
+
+    if (time >= keyTime(i))
+    {
+        // Playback moved forward; step through the few segments it could have crossed since the last frame.
+        for (unsigned int step = 0; step < CURSOR_MAX_STEPS && i < max; ++step, ++i)
+        {
+            if (time < keyTime(i + 1))
+            {
+                *index = i;
+                return true;
+            }
+        }
+    }
+    else if (i > min && time >= keyTime(i - 1))
+    {
+        // Playback moved back into the previous segment (negative speed).
+        *index = i - 1;
+        return true;
+    }
+
+    return false;
+}
+
 }
 
 #endif
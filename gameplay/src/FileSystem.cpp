@@ -14,12 +14,21 @@
     #include <direct.h>
     #define gp_stat _stat
     #define gp_stat_struct struct stat
+    #define gp_fseek64 _fseeki64
+    #define gp_ftell64 _ftelli64
+    typedef __int64 gp_off64_t;
 #else
     #define __EXT_POSIX2
     #include <libgen.h>
     #include <dirent.h>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <unistd.h>
     #define gp_stat stat
     #define gp_stat_struct struct stat
+    #define gp_fseek64 fseeko
+    #define gp_ftell64 ftello
+    typedef off_t gp_off64_t;
 #endif
 
 #ifdef __ANDROID__
@@ -133,6 +142,8 @@ public:
     virtual long int position();
     virtual bool seek(long int offset, int origin);
     virtual bool rewind();
+    virtual int64_t length64();
+    virtual bool seek64(int64_t offset);
 
     static FileStream* create(const char* filePath, const char* mode);
 
@@ -145,6 +156,48 @@ private:
     bool _canWrite;
 };
 
+/**
+ * A read-only stream over a file that is mapped into memory.
+ *
+ * @script{ignore}
+ */
+class FileStreamMapped : public Stream
+{
+public:
+    friend class FileSystem;
+    
+    ~FileStreamMapped();
+    virtual bool canRead();
+    virtual bool canWrite();
+    virtual bool canSeek();
+    virtual void close();
+    virtual size_t read(void* ptr, size_t size, size_t count);
+    virtual char* readLine(char* str, int num);
+    virtual size_t write(const void* ptr, size_t size, size_t count);
+    virtual bool eof();
+    virtual size_t length();
+    virtual long int position();
+    virtual bool seek(long int offset, int origin);
+    virtual bool rewind();
+    virtual const unsigned char* getData();
+    virtual Stream* createCursor();
+
+    static FileStreamMapped* create(const char* filePath);
+
+private:
+    FileStreamMapped(const unsigned char* data, size_t length, bool owner);
+
+private:
+    const unsigned char* _data;
+    size_t _length;
+    size_t _position;
+    bool _owner;
+#ifdef WIN32
+    HANDLE _file;
+    HANDLE _mapping;
+#endif
+};
+
 #ifdef __ANDROID__
 
 /**
@@ -169,6 +222,8 @@ public:
     virtual long int position();
     virtual bool seek(long int offset, int origin);
     virtual bool rewind();
+    virtual int64_t length64();
+    virtual bool seek64(int64_t offset);
 
     static FileStreamAndroid* create(const char* filePath, const char* mode);
 
@@ -388,7 +443,11 @@ Stream* FileSystem::open(const char* path, size_t streamMode)
     else
     {
         // First try the SD card
-        Stream* stream = FileStream::create(fullPath.c_str(), modeStr);
+        Stream* stream = NULL;
+        if ((streamMode & MAPPED) != 0)
+            stream = FileStreamMapped::create(fullPath.c_str());
+        if (!stream)
+            stream = FileStream::create(fullPath.c_str(), modeStr);
 
         if (!stream)
         {
@@ -404,6 +463,12 @@ Stream* FileSystem::open(const char* path, size_t streamMode)
 #else
     std::string fullPath;
     getFullPath(path, fullPath);
+    if ((streamMode & MAPPED) != 0 && (streamMode & WRITE) == 0)
+    {
+        Stream* stream = FileStreamMapped::create(fullPath.c_str());
+        if (stream)
+            return stream;
+    }
     FileStream* stream = FileStream::create(fullPath.c_str(), modeStr);
     return stream;
 #endif
@@ -715,6 +780,239 @@ bool FileStream::rewind()
     return false;
 }
 
+int64_t FileStream::length64()
+{
+    int64_t len = 0;
+    if (canSeek())
+    {
+        gp_off64_t pos = gp_ftell64(_file);
+        if (gp_fseek64(_file, 0, SEEK_END) == 0)
+        {
+            len = std::max((int64_t)gp_ftell64(_file), (int64_t)0);
+        }
+        gp_fseek64(_file, pos, SEEK_SET);
+    }
+    return len;
+}
+
+bool FileStream::seek64(int64_t offset)
+{
+    // Without large file support the file offsets of 32-bit targets are 32 bits.
+    if (!_file || offset < 0 || (int64_t)(gp_off64_t)offset != offset)
+        return false;
+    return gp_fseek64(_file, (gp_off64_t)offset, SEEK_SET) == 0;
+}
+
+////////////////////////////////
+
+FileStreamMapped::FileStreamMapped(const unsigned char* data, size_t length, bool owner)
+    : _data(data), _length(length), _position(0), _owner(owner)
+#ifdef WIN32
+    , _file(INVALID_HANDLE_VALUE), _mapping(NULL)
+#endif
+{
+}
+
+FileStreamMapped::~FileStreamMapped()
+{
+    if (_data)
+    {
+        close();
+    }
+}
+
+FileStreamMapped* FileStreamMapped::create(const char* filePath)
+{
+#ifdef WIN32
+    HANDLE file = CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return NULL;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0 || size.QuadPart > (LONGLONG)std::numeric_limits<long>::max())
+    {
+        CloseHandle(file);
+        return NULL;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL)
+    {
+        CloseHandle(file);
+        return NULL;
+    }
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (data == NULL)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return NULL;
+    }
+
+    FileStreamMapped* stream = new FileStreamMapped((const unsigned char*)data, (size_t)size.QuadPart, true);
+    stream->_file = file;
+    stream->_mapping = mapping;
+    return stream;
+#else
+    int file = ::open(filePath, O_RDONLY);
+    if (file < 0)
+        return NULL;
+
+    // Empty files cannot be mapped.
+    gp_stat_struct s;
+    if (fstat(file, &s) != 0 || s.st_size <= 0 || (unsigned long long)s.st_size > (unsigned long long)std::numeric_limits<long>::max())
+    {
+        ::close(file);
+        return NULL;
+    }
+
+    void* data = mmap(NULL, (size_t)s.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);
+    if (data == MAP_FAILED)
+        return NULL;
+
+    return new FileStreamMapped((const unsigned char*)data, (size_t)s.st_size, true);
+#endif
+}
+
+bool FileStreamMapped::canRead()
+{
+    return _data != NULL;
+}
+
+bool FileStreamMapped::canWrite()
+{
+    return false;
+}
+
+bool FileStreamMapped::canSeek()
+{
+    return _data != NULL;
+}
+
+void FileStreamMapped::close()
+{
+    // Cursors share the mapping of the stream they were created from.
+    if (_data && _owner)
+    {
+#ifdef WIN32
+        UnmapViewOfFile(_data);
+        CloseHandle(_mapping);
+        CloseHandle(_file);
+        _mapping = NULL;
+        _file = INVALID_HANDLE_VALUE;
+#else
+        munmap((void*)_data, _length);
+#endif
+    }
+    _data = NULL;
+    _length = 0;
+    _position = 0;
+}
+
+size_t FileStreamMapped::read(void* ptr, size_t size, size_t count)
+{
+    if (!_data || size == 0)
+        return 0;
+
+    // Like fread, read as many bytes as are left and return the number of whole elements read.
+    size_t bytes = _position < _length ? std::min(size * count, _length - _position) : 0;
+    memcpy(ptr, _data + _position, bytes);
+    _position += bytes;
+    return bytes / size;
+}
+
+char* FileStreamMapped::readLine(char* str, int num)
+{
+    if (!_data || num <= 0 || _position >= _length)
+        return NULL;
+
+    // Like fgets, read up to and including the next newline.
+    size_t i = 0;
+    while (i < (size_t)num - 1 && _position < _length)
+    {
+        char c = (char)_data[_position++];
+        str[i++] = c;
+        if (c == '\n')
+            break;
+    }
+    str[i] = '\0';
+    return str;
+}
+
+size_t FileStreamMapped::write(const void* ptr, size_t size, size_t count)
+{
+    return 0;
+}
+
+bool FileStreamMapped::eof()
+{
+    return !_data || _position >= _length;
+}
+
+size_t FileStreamMapped::length()
+{
+    return _length;
+}
+
+long int FileStreamMapped::position()
+{
+    if (!_data)
+        return -1;
+    return (long int)_position;
+}
+
+bool FileStreamMapped::seek(long int offset, int origin)
+{
+    if (!_data)
+        return false;
+
+    long int base;
+    switch (origin)
+    {
+    case SEEK_SET:
+        base = 0;
+        break;
+    case SEEK_CUR:
+        base = (long int)_position;
+        break;
+    case SEEK_END:
+        base = (long int)_length;
+        break;
+    default:
+        return false;
+    }
+    if (offset < -base)
+        return false;
+
+    // As with fseek, seeking past the end is allowed; reads there return nothing.
+    _position = (size_t)(base + offset);
+    return true;
+}
+
+bool FileStreamMapped::rewind()
+{
+    if (canSeek())
+    {
+        _position = 0;
+        return true;
+    }
+    return false;
+}
+
+const unsigned char* FileStreamMapped::getData()
+{
+    return _data;
+}
+
+Stream* FileStreamMapped::createCursor()
+{
+    if (!_data)
+        return NULL;
+    return new FileStreamMapped(_data, _length, false);
+}
+
 ////////////////////////////////
 
 #ifdef __ANDROID__
@@ -862,6 +1160,16 @@ bool FileStreamAndroid::rewind()
     return false;
 }
 
+int64_t FileStreamAndroid::length64()
+{
+    return (int64_t)AAsset_getLength64(_asset);
+}
+
+bool FileStreamAndroid::seek64(int64_t offset)
+{
+    return AAsset_seek64(_asset, (off64_t)offset, SEEK_SET) != -1;
+}
+
 #endif
 
 }
@@ -24,7 +24,14 @@ public:
     enum StreamMode
     {
         READ = 1,
-        WRITE = 2
+        WRITE = 2,
+
+        /**
+         * Maps the file into memory when it is opened for reading, so that its contents
+         * can be accessed directly through Stream::getData(). Falls back to a regular
+         * stream where the file cannot be mapped.
+         */
+        MAPPED = 4
     };
 
     /**
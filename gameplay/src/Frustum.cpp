@@ -2,6 +2,7 @@
 #include "Frustum.h"
 #include "BoundingSphere.h"
 #include "BoundingBox.h"
+#include "frustumculling.hpp"
 
 namespace vkcore
 {
@@ -125,6 +126,40 @@ float Frustum::intersects(const Plane& plane) const
     return plane.intersects(*this);
 }
 
+void Frustum::intersects(const float* x, const float* y, const float* z, const float* radius, unsigned int count,
+                         unsigned char* visible, unsigned char* planeCache) const
+{
+    GP_ASSERT((x && y && z && radius && visible) || count == 0);
+
+    float planes[6][4];
+    getPlanes(planes);
+    vkTools::cullSpheres(planes, x, y, z, radius, count, visible, planeCache);
+}
+
+void Frustum::intersects(const float* minX, const float* minY, const float* minZ, const float* maxX, const float* maxY, const float* maxZ,
+                         unsigned int count, unsigned char* visible, unsigned char* planeCache) const
+{
+    GP_ASSERT((minX && minY && minZ && maxX && maxY && maxZ && visible) || count == 0);
+
+    float planes[6][4];
+    getPlanes(planes);
+    vkTools::cullBoxes(planes, minX, minY, minZ, maxX, maxY, maxZ, count, visible, planeCache);
+}
+
+void Frustum::getPlanes(float planes[6][4]) const
+{
+    // The side planes reject the most objects, so they come first.
+    const Plane* sources[6] = { &_left, &_right, &_bottom, &_top, &_near, &_far };
+    for (unsigned int i = 0; i < 6; ++i)
+    {
+        const Vector3& normal = sources[i]->getNormal();
+        planes[i][0] = normal.x;
+        planes[i][1] = normal.y;
+        planes[i][2] = normal.z;
+        planes[i][3] = sources[i]->getDistance();
+    }
+}
+
 float Frustum::intersects(const Ray& ray) const
 {
     return ray.intersects(*this);
@@ -193,6 +193,52 @@ public:
      */
     float intersects(const Ray& ray) const;
 
+    /**
+     * Tests which of the given bounding spheres intersect this frustum.
+     *
+     * The spheres are passed as one array per component and tested eight at a time
+     * with SIMD instructions when available. Bit (i % 8) of visible[i / 8] is set if
+     * sphere i intersects the frustum, with the same result as intersects(const BoundingSphere&).
+     *
+     * When a plane cache is given, the plane that rejected each sphere is remembered
+     * and tested first on the next call, so that with a slowly moving view most of the
+     * invisible spheres are rejected with a single plane test.
+     *
+     * @param x The x coordinates of the sphere centers.
+     * @param y The y coordinates of the sphere centers.
+     * @param z The z coordinates of the sphere centers.
+     * @param radius The radii of the spheres.
+     * @param count The number of spheres.
+     * @param visible The array of at least (count + 7) / 8 bytes to store the visibility bits in.
+     * @param planeCache An array of count bytes, initially zero, kept between calls; may be NULL.
+     * @script{ignore}
+     */
+    void intersects(const float* x, const float* y, const float* z, const float* radius, unsigned int count,
+                    unsigned char* visible, unsigned char* planeCache = NULL) const;
+
+    /**
+     * Tests which of the given bounding boxes intersect this frustum.
+     *
+     * The boxes are passed as one array per component of their corners, see the
+     * sphere variant for the layout of the result and the use of the plane cache.
+     * Each plane is tested against the corner of the box furthest along its normal,
+     * which matches intersects(const BoundingBox&) up to rounding for boxes that
+     * just touch a plane.
+     *
+     * @param minX The minimum x coordinates of the boxes.
+     * @param minY The minimum y coordinates of the boxes.
+     * @param minZ The minimum z coordinates of the boxes.
+     * @param maxX The maximum x coordinates of the boxes.
+     * @param maxY The maximum y coordinates of the boxes.
+     * @param maxZ The maximum z coordinates of the boxes.
+     * @param count The number of boxes.
+     * @param visible The array of at least (count + 7) / 8 bytes to store the visibility bits in.
+     * @param planeCache An array of count bytes, initially zero, kept between calls; may be NULL.
+     * @script{ignore}
+     */
+    void intersects(const float* minX, const float* minY, const float* minZ, const float* maxX, const float* maxY, const float* maxZ,
+                    unsigned int count, unsigned char* visible, unsigned char* planeCache = NULL) const;
+
     /**
      * Sets this frustum to the specified frustum.
      *
@@ -214,6 +260,11 @@ private:
      */
     void updatePlanes();
 
+    /**
+     * Gets the planes of the frustum as (normal, distance) vectors, sides first.
+     */
+    void getPlanes(float planes[6][4]) const;
+
     Plane _near;
     Plane _far;
     Plane _bottom;
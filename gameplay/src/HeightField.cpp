@@ -40,11 +40,94 @@ HeightField* HeightField::createFromImage(const char* path, float heightMin, flo
     return create(path, 0, 0, heightMin, heightMax);
 }
 
+/**
+ * Converts RAW8 or RAW16 intensities to heights.
+ *
+ * @script{ignore}
+ */
+static void decodeRAW(const unsigned char* bytes, int bits, unsigned int count, float heightMin, float heightScale, float* heights)
+{
+    if (bits == 16)
+    {
+        // 16-bit (0-65535)
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            unsigned int idx = i << 1;
+            heights[i] = heightMin + ((bytes[idx] | (int)bytes[idx+1] << 8) / 65535.0f) * heightScale;
+        }
+    }
+    else
+    {
+        // 8-bit (0-255)
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            heights[i] = heightMin + (bytes[i] / 255.0f) * heightScale;
+        }
+    }
+}
+
 HeightField* HeightField::createFromRAW(const char* path, unsigned int width, unsigned int height, float heightMin, float heightMax)
 {
     return create(path, width, height, heightMin, heightMax);
 }
 
+HeightField* HeightField::createFromRAW(const char* path, unsigned int width, unsigned int height,
+                                        unsigned int column, unsigned int row, unsigned int columnCount, unsigned int rowCount,
+                                        float heightMin, float heightMax)
+{
+    GP_ASSERT(path);
+    GP_ASSERT(heightMax >= heightMin);
+
+    if (width < 2 || height < 2 || columnCount == 0 || rowCount == 0 || column + columnCount > width || row + rowCount > height)
+    {
+        GP_WARN("Invalid region of RAW heightfield image: %s.", path);
+        return NULL;
+    }
+
+    std::unique_ptr<Stream> stream(FileSystem::open(path));
+    if (stream.get() == NULL || !stream->canSeek())
+    {
+        GP_WARN("Failed to open RAW heightfield image: %s.", path);
+        return NULL;
+    }
+
+    // Determine if the RAW file is 8-bit or 16-bit based on file size, which may be too
+    // large for the 32-bit offsets of Stream::length and Stream::seek on some platforms.
+    int64_t length = stream->length64();
+    if (length <= 0)
+    {
+        GP_WARN("Failed to determine the size of RAW heightfield image (files of 2 GB or more require 64-bit file offsets): %s.", path);
+        return NULL;
+    }
+    int bits = (int)(length / ((int64_t)width * height)) * 8;
+    if (bits != 8 && bits != 16)
+    {
+        GP_WARN("Invalid RAW file - must be 8-bit or 16-bit, but found neither: %s.", path);
+        return NULL;
+    }
+
+    // Read the region row by row
+    unsigned int pixelSize = bits / 8;
+    unsigned char* bytes = new unsigned char[columnCount * pixelSize];
+    HeightField* heightfield = HeightField::create(columnCount, rowCount);
+    float* heights = heightfield->getArray();
+    for (unsigned int y = 0; y < rowCount; ++y)
+    {
+        int64_t offset = ((int64_t)(row + y) * width + column) * pixelSize;
+        if (!stream->seek64(offset) || stream->read(bytes, pixelSize, columnCount) != columnCount)
+        {
+            GP_WARN("Failed to read bytes from RAW heightfield image: %s.", path);
+            SAFE_DELETE_ARRAY(bytes);
+            SAFE_RELEASE(heightfield);
+            return NULL;
+        }
+        decodeRAW(bytes, bits, columnCount, heightMin, heightMax - heightMin, heights + y * columnCount);
+    }
+    SAFE_DELETE_ARRAY(bytes);
+
+    return heightfield;
+}
+
 HeightField* HeightField::create(const char* path, unsigned int width, unsigned int height, float heightMin, float heightMax)
 {
     GP_ASSERT(path);
@@ -122,32 +205,7 @@ HeightField* HeightField::create(const char* path, unsigned int width, unsigned
         }
 
         heightfield = HeightField::create(width, height);
-        float* heights = heightfield->getArray();
-
-        if (bits == 16)
-        {
-            // 16-bit (0-65535)
-            int idx;
-            for (unsigned int y = 0, i = 0; y < height; ++y)
-            {
-                for (unsigned int x = 0; x < width; ++x, ++i)
-                {
-                    idx = (y * width + x) << 1;
-                    heights[i] = heightMin + ((bytes[idx] | (int)bytes[idx+1] << 8) / 65535.0f) * heightScale;
-                }
-            }
-        }
-        else
-        {
-            // 8-bit (0-255)
-            for (unsigned int y = 0, i = 0; y < height; ++y)
-            {
-                for (unsigned int x = 0; x < width; ++x, ++i)
-                {
-                    heights[i] = heightMin + (bytes[y * width + x] / 255.0f) * heightScale;
-                }
-            }
-        }
+        decodeRAW(bytes, bits, width * height, heightMin, heightScale, heightfield->getArray());
 
         SAFE_DELETE_ARRAY(bytes);
     }
@@ -72,6 +72,32 @@ namespace vkcore
          */
         static HeightField* createFromRAW(const char* path, unsigned int width, unsigned int height, float heightMin = 0, float heightMax = 1);
 
+        /**
+         * Creates a HeightField from a rectangular region of the specified RAW8 or RAW16 file.
+         *
+         * Only the rows of the region are read from the file, so heightfields that are too large
+         * to be loaded whole can be read piece by piece as they are needed, as paged terrains do.
+         * The file is opened for the duration of the call, which may be made from any thread.
+         * Files of 2 GB or more are read with 64-bit file offsets; on 32-bit targets without
+         * large file support the regions beyond the first 2 GB cannot be read.
+         *
+         * @param path Path to the RAW file (must end in a .raw or .r16 file extension).
+         * @param width Width of the RAW data.
+         * @param height Height of the RAW data.
+         * @param column The first column of the region.
+         * @param row The first row of the region.
+         * @param columnCount The number of columns of the region.
+         * @param rowCount The number of rows of the region.
+         * @param heightMin Minimum height value for a zero intensity pixel.
+         * @param heightMax Maximum height value for a full intensity heightfield pixel (must be >= minHeight).
+         *
+         * @return The new HeightField, holding the heights of the region, or NULL if the region could not be read.
+         * @script{ignore}
+         */
+        static HeightField* createFromRAW(const char* path, unsigned int width, unsigned int height,
+                                          unsigned int column, unsigned int row, unsigned int columnCount, unsigned int rowCount,
+                                          float heightMin = 0, float heightMax = 1);
+
         /**
          * Returns a pointer to the underlying height array.
          *
@@ -7,7 +7,7 @@ namespace vkcore
 {
 
 Joint::Joint(const char* id)
-    : Node(id), _jointMatrixDirty(true)
+    : Node(id)
 {
 }
 
@@ -64,27 +64,11 @@ Scene* Joint::getScene() const
 void Joint::transformChanged()
 {
     Node::transformChanged();
-    _jointMatrixDirty = true;
-}
 
-void Joint::updateJointMatrix(const Matrix& bindShape, Vector4* matrixPalette)
-{
-    // Note: If more than one MeshSkin influences this Joint, we need to skip
-    // the _jointMatrixDirty optimization since updateJointMatrix() may be
-    // called multiple times a frame with different bindShape matrices (and
-    // different matrixPallete pointers).
-    if (_skin.next || _jointMatrixDirty)
+    // Each skin tracks which of its palette entries are out of date.
+    for (SkinReference* itr = &_skin; itr && itr->skin; itr = itr->next)
     {
-        _jointMatrixDirty = false;
-
-        static Matrix t;
-        Matrix::multiply(Node::getWorldMatrix(), getInverseBindPose(), &t);
-        Matrix::multiply(t, bindShape, &t);
-
-        GP_ASSERT(matrixPalette);
-        matrixPalette[0].set(t.m[0], t.m[4], t.m[8], t.m[12]);
-        matrixPalette[1].set(t.m[1], t.m[5], t.m[9], t.m[13]);
-        matrixPalette[2].set(t.m[2], t.m[6], t.m[10], t.m[14]);
+        itr->skin->setJointDirty(itr->index);
     }
 }
 
@@ -96,15 +80,20 @@ const Matrix& Joint::getInverseBindPose() const
 void Joint::setInverseBindPose(const Matrix& m)
 {
     _bindPose = m;
-    _jointMatrixDirty = true;
+
+    for (SkinReference* itr = &_skin; itr && itr->skin; itr = itr->next)
+    {
+        itr->skin->setBindShapesDirty();
+    }
 }
 
-void Joint::addSkin(MeshSkin* skin)
+void Joint::addSkin(MeshSkin* skin, unsigned int index)
 {
     if (!_skin.skin)
     {
         // Store skin in root reference
         _skin.skin = skin;
+        _skin.index = index;
     }
     else
     {
@@ -116,6 +105,7 @@ void Joint::addSkin(MeshSkin* skin)
         }
         ref->next = new SkinReference();
         ref->next->skin = skin;
+        ref->next->index = index;
     }
 }
 
@@ -131,6 +121,7 @@ void Joint::removeSkin(MeshSkin* skin)
         {
             SkinReference* tmp = _skin.next;
             _skin.skin = tmp->skin;
+            _skin.index = tmp->index;
             _skin.next = tmp->next;
             tmp->next = NULL; // prevent deletion
             SAFE_DELETE(tmp);
@@ -156,7 +147,7 @@ void Joint::removeSkin(MeshSkin* skin)
 }
 
 Joint::SkinReference::SkinReference()
-    : skin(NULL), next(NULL)
+    : skin(NULL), index(0), next(NULL)
 {
 }
 
@@ -21,6 +21,7 @@ class Joint : public Node
     friend class Node;
     friend class MeshSkin;
     friend class Bundle;
+    friend class AnimationSampler;
 
 public:
 
@@ -87,14 +88,6 @@ protected:
      */
     void setInverseBindPose(const Matrix& m);
 
-    /**
-     * Updates the joint matrix.
-     * 
-     * @param bindShape The bind shape matrix.
-     * @param matrixPalette The matrix palette to update.
-     */
-    void updateJointMatrix(const Matrix& bindShape, Vector4* matrixPalette);
-
     /**
      * Called when this Joint's transform changes.
      */
@@ -108,6 +101,7 @@ private:
     struct SkinReference
     {
         MeshSkin* skin;
+        unsigned int index;
         SkinReference* next;
 
         SkinReference();
@@ -124,7 +118,7 @@ private:
      */
     Joint& operator=(const Joint&);
 
-    void addSkin(MeshSkin* skin);
+    void addSkin(MeshSkin* skin, unsigned int index);
 
     void removeSkin(MeshSkin* skin);
 
@@ -133,11 +127,6 @@ private:
      */
     Matrix _bindPose;
 
-    /**
-     * Flag used to mark if the Joint's matrix is dirty.
-     */
-    bool _jointMatrixDirty;
-
     /**
      * Linked list of mesh skins that are referenced by this joint.
      */
@@ -12,6 +12,7 @@ class MathUtil
 {
     friend class Matrix;
     friend class Vector3;
+    friend class BoundingBox;
 
 public:
 
@@ -66,6 +67,18 @@ private:
 
     inline static void crossVector3(const float* v1, const float* v2, float* dst);
 
+    // Batched kernels. Arrays are tightly packed; m1Stride is 16 to step through
+    // an array of matrices or 0 to reuse a single matrix for every element.
+
+    inline static void multiplyMatrices(const float* m1, unsigned int m1Stride, const float* m2, float* dst, unsigned int count);
+
+    inline static void transformVector3Array(const float* m, const float* v, float w, float* dst, unsigned int count);
+
+    inline static void transformVector3SoA(const float* m, const float* x, const float* y, const float* z, float w,
+                                           float* dstX, float* dstY, float* dstZ, unsigned int count);
+
+    inline static void transformBoxes(const float* m, const float* boxes, float* dst, unsigned int count);
+
     MathUtil();
 };
 
@@ -73,8 +86,17 @@ private:
 
 #define MATRIX_SIZE ( sizeof(float) * 16)
 
+// Use the SSE implementation on x86 unless NEON was requested or GP_NO_SSE is defined.
+#if !defined(GP_USE_NEON) && !defined(GP_USE_SSE) && !defined(GP_NO_SSE)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GP_USE_SSE
+#endif
+#endif
+
 #ifdef GP_USE_NEON
 #include "MathUtilNeon.inl"
+#elif defined(GP_USE_SSE)
+#include "MathUtilSSE.inl"
 #else
 #include "MathUtil.inl"
 #endif
@@ -226,4 +226,67 @@ inline void MathUtil::crossVector3(const float* v1, const float* v2, float* dst)
     );
 }
 
+inline void MathUtil::multiplyMatrices(const float* m1, unsigned int m1Stride, const float* m2, float* dst, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        multiplyMatrix(&m1[i * m1Stride], &m2[i * 16], &dst[i * 16]);
+    }
+}
+
+inline void MathUtil::transformVector3Array(const float* m, const float* v, float w, float* dst, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        const float* p = &v[i * 3];
+        transformVector4(m, p[0], p[1], p[2], w, &dst[i * 3]);
+    }
+}
+
+inline void MathUtil::transformVector3SoA(const float* m, const float* x, const float* y, const float* z, float w,
+                                          float* dstX, float* dstY, float* dstZ, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        float px = x[i];
+        float py = y[i];
+        float pz = z[i];
+        dstX[i] = px * m[0] + py * m[4] + pz * m[8] + w * m[12];
+        dstY[i] = px * m[1] + py * m[5] + pz * m[9] + w * m[13];
+        dstZ[i] = px * m[2] + py * m[6] + pz * m[10] + w * m[14];
+    }
+}
+
+inline void MathUtil::transformBoxes(const float* m, const float* boxes, float* dst, unsigned int count)
+{
+    // Transform the center and project the half extents onto the absolute
+    // rotation/scale part (Arvo), which bounds the same 8 transformed corners.
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        const float* b = &boxes[i * 6];
+        float cx = (b[0] + b[3]) * 0.5f;
+        float cy = (b[1] + b[4]) * 0.5f;
+        float cz = (b[2] + b[5]) * 0.5f;
+        float ex = (b[3] - b[0]) * 0.5f;
+        float ey = (b[4] - b[1]) * 0.5f;
+        float ez = (b[5] - b[2]) * 0.5f;
+
+        float c[3];
+        float e[3];
+        for (int r = 0; r < 3; ++r)
+        {
+            c[r] = cx * m[r] + cy * m[4 + r] + cz * m[8 + r] + m[12 + r];
+            e[r] = ex * fabs(m[r]) + ey * fabs(m[4 + r]) + ez * fabs(m[8 + r]);
+        }
+
+        float* d = &dst[i * 6];
+        d[0] = c[0] - e[0];
+        d[1] = c[1] - e[1];
+        d[2] = c[2] - e[2];
+        d[3] = c[0] + e[0];
+        d[4] = c[1] + e[1];
+        d[5] = c[2] + e[2];
+    }
+}
+
 }
@@ -0,0 +1,236 @@
+#include <emmintrin.h>
+
+namespace vkcore
+{
+
+inline void MathUtil::addMatrix(const float* m, float scalar, float* dst)
+{
+    __m128 s = _mm_set1_ps(scalar);
+
+    _mm_storeu_ps(&dst[0],  _mm_add_ps(_mm_loadu_ps(&m[0]),  s));
+    _mm_storeu_ps(&dst[4],  _mm_add_ps(_mm_loadu_ps(&m[4]),  s));
+    _mm_storeu_ps(&dst[8],  _mm_add_ps(_mm_loadu_ps(&m[8]),  s));
+    _mm_storeu_ps(&dst[12], _mm_add_ps(_mm_loadu_ps(&m[12]), s));
+}
+
+inline void MathUtil::addMatrix(const float* m1, const float* m2, float* dst)
+{
+    _mm_storeu_ps(&dst[0],  _mm_add_ps(_mm_loadu_ps(&m1[0]),  _mm_loadu_ps(&m2[0])));
+    _mm_storeu_ps(&dst[4],  _mm_add_ps(_mm_loadu_ps(&m1[4]),  _mm_loadu_ps(&m2[4])));
+    _mm_storeu_ps(&dst[8],  _mm_add_ps(_mm_loadu_ps(&m1[8]),  _mm_loadu_ps(&m2[8])));
+    _mm_storeu_ps(&dst[12], _mm_add_ps(_mm_loadu_ps(&m1[12]), _mm_loadu_ps(&m2[12])));
+}
+
+inline void MathUtil::subtractMatrix(const float* m1, const float* m2, float* dst)
+{
+    _mm_storeu_ps(&dst[0],  _mm_sub_ps(_mm_loadu_ps(&m1[0]),  _mm_loadu_ps(&m2[0])));
+    _mm_storeu_ps(&dst[4],  _mm_sub_ps(_mm_loadu_ps(&m1[4]),  _mm_loadu_ps(&m2[4])));
+    _mm_storeu_ps(&dst[8],  _mm_sub_ps(_mm_loadu_ps(&m1[8]),  _mm_loadu_ps(&m2[8])));
+    _mm_storeu_ps(&dst[12], _mm_sub_ps(_mm_loadu_ps(&m1[12]), _mm_loadu_ps(&m2[12])));
+}
+
+inline void MathUtil::multiplyMatrix(const float* m, float scalar, float* dst)
+{
+    __m128 s = _mm_set1_ps(scalar);
+
+    _mm_storeu_ps(&dst[0],  _mm_mul_ps(_mm_loadu_ps(&m[0]),  s));
+    _mm_storeu_ps(&dst[4],  _mm_mul_ps(_mm_loadu_ps(&m[4]),  s));
+    _mm_storeu_ps(&dst[8],  _mm_mul_ps(_mm_loadu_ps(&m[8]),  s));
+    _mm_storeu_ps(&dst[12], _mm_mul_ps(_mm_loadu_ps(&m[12]), s));
+}
+
+inline void MathUtil::multiplyMatrix(const float* m1, const float* m2, float* dst)
+{
+    // Every column of the product is a linear combination of the columns of m1.
+    // All loads happen before the first store, so m1 or m2 may be the same array as dst.
+    __m128 c0 = _mm_loadu_ps(&m1[0]);
+    __m128 c1 = _mm_loadu_ps(&m1[4]);
+    __m128 c2 = _mm_loadu_ps(&m1[8]);
+    __m128 c3 = _mm_loadu_ps(&m1[12]);
+
+    __m128 product[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        const float* col = &m2[i * 4];
+        __m128 r = _mm_mul_ps(c0, _mm_set1_ps(col[0]));
+        r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(col[1])));
+        r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(col[2])));
+        r = _mm_add_ps(r, _mm_mul_ps(c3, _mm_set1_ps(col[3])));
+        product[i] = r;
+    }
+
+    _mm_storeu_ps(&dst[0],  product[0]);
+    _mm_storeu_ps(&dst[4],  product[1]);
+    _mm_storeu_ps(&dst[8],  product[2]);
+    _mm_storeu_ps(&dst[12], product[3]);
+}
+
+inline void MathUtil::negateMatrix(const float* m, float* dst)
+{
+    __m128 sign = _mm_set1_ps(-0.0f);
+
+    _mm_storeu_ps(&dst[0],  _mm_xor_ps(_mm_loadu_ps(&m[0]),  sign));
+    _mm_storeu_ps(&dst[4],  _mm_xor_ps(_mm_loadu_ps(&m[4]),  sign));
+    _mm_storeu_ps(&dst[8],  _mm_xor_ps(_mm_loadu_ps(&m[8]),  sign));
+    _mm_storeu_ps(&dst[12], _mm_xor_ps(_mm_loadu_ps(&m[12]), sign));
+}
+
+inline void MathUtil::transposeMatrix(const float* m, float* dst)
+{
+    __m128 c0 = _mm_loadu_ps(&m[0]);
+    __m128 c1 = _mm_loadu_ps(&m[4]);
+    __m128 c2 = _mm_loadu_ps(&m[8]);
+    __m128 c3 = _mm_loadu_ps(&m[12]);
+
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+    _mm_storeu_ps(&dst[0],  c0);
+    _mm_storeu_ps(&dst[4],  c1);
+    _mm_storeu_ps(&dst[8],  c2);
+    _mm_storeu_ps(&dst[12], c3);
+}
+
+inline void MathUtil::transformVector4(const float* m, float x, float y, float z, float w, float* dst)
+{
+    __m128 r = _mm_mul_ps(_mm_loadu_ps(&m[0]), _mm_set1_ps(x));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(&m[4]),  _mm_set1_ps(y)));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(&m[8]),  _mm_set1_ps(z)));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(&m[12]), _mm_set1_ps(w)));
+
+    // dst is a Vector3: write x, y and z only.
+    _mm_storel_pi((__m64*)dst, r);
+    _mm_store_ss(&dst[2], _mm_movehl_ps(r, r));
+}
+
+inline void MathUtil::transformVector4(const float* m, const float* v, float* dst)
+{
+    // Handle case where v == dst.
+    __m128 r = _mm_mul_ps(_mm_loadu_ps(&m[0]), _mm_set1_ps(v[0]));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(&m[4]),  _mm_set1_ps(v[1])));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(&m[8]),  _mm_set1_ps(v[2])));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(&m[12]), _mm_set1_ps(v[3])));
+
+    _mm_storeu_ps(dst, r);
+}
+
+inline void MathUtil::crossVector3(const float* v1, const float* v2, float* dst)
+{
+    // Vector3 only has three components, so build the registers without over-reading.
+    __m128 a = _mm_set_ps(0.0f, v1[2], v1[1], v1[0]);
+    __m128 b = _mm_set_ps(0.0f, v2[2], v2[1], v2[0]);
+
+    // (a.yzx * b.zxy) - (a.zxy * b.yzx)
+    __m128 r = _mm_sub_ps(
+        _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 1, 0, 2))),
+        _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 1, 0, 2)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1))));
+
+    _mm_storel_pi((__m64*)dst, r);
+    _mm_store_ss(&dst[2], _mm_movehl_ps(r, r));
+}
+
+inline void MathUtil::multiplyMatrices(const float* m1, unsigned int m1Stride, const float* m2, float* dst, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        multiplyMatrix(&m1[i * m1Stride], &m2[i * 16], &dst[i * 16]);
+    }
+}
+
+inline void MathUtil::transformVector3Array(const float* m, const float* v, float w, float* dst, unsigned int count)
+{
+    __m128 c0 = _mm_loadu_ps(&m[0]);
+    __m128 c1 = _mm_loadu_ps(&m[4]);
+    __m128 c2 = _mm_loadu_ps(&m[8]);
+    __m128 c3 = _mm_mul_ps(_mm_loadu_ps(&m[12]), _mm_set1_ps(w));
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        const float* p = &v[i * 3];
+        __m128 r = _mm_add_ps(c3, _mm_mul_ps(c0, _mm_set1_ps(p[0])));
+        r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(p[1])));
+        r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(p[2])));
+
+        float* d = &dst[i * 3];
+        _mm_storel_pi((__m64*)d, r);
+        _mm_store_ss(&d[2], _mm_movehl_ps(r, r));
+    }
+}
+
+inline void MathUtil::transformVector3SoA(const float* m, const float* x, const float* y, const float* z, float w,
+                                          float* dstX, float* dstY, float* dstZ, unsigned int count)
+{
+    __m128 m0 = _mm_set1_ps(m[0]), m4 = _mm_set1_ps(m[4]), m8  = _mm_set1_ps(m[8]),  t0 = _mm_set1_ps(m[12] * w);
+    __m128 m1 = _mm_set1_ps(m[1]), m5 = _mm_set1_ps(m[5]), m9  = _mm_set1_ps(m[9]),  t1 = _mm_set1_ps(m[13] * w);
+    __m128 m2 = _mm_set1_ps(m[2]), m6 = _mm_set1_ps(m[6]), m10 = _mm_set1_ps(m[10]), t2 = _mm_set1_ps(m[14] * w);
+
+    // Four points per iteration.
+    unsigned int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 px = _mm_loadu_ps(&x[i]);
+        __m128 py = _mm_loadu_ps(&y[i]);
+        __m128 pz = _mm_loadu_ps(&z[i]);
+
+        __m128 rx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, m0), _mm_mul_ps(py, m4)), _mm_add_ps(_mm_mul_ps(pz, m8), t0));
+        __m128 ry = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, m1), _mm_mul_ps(py, m5)), _mm_add_ps(_mm_mul_ps(pz, m9), t1));
+        __m128 rz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, m2), _mm_mul_ps(py, m6)), _mm_add_ps(_mm_mul_ps(pz, m10), t2));
+
+        _mm_storeu_ps(&dstX[i], rx);
+        _mm_storeu_ps(&dstY[i], ry);
+        _mm_storeu_ps(&dstZ[i], rz);
+    }
+
+    // Remaining points.
+    for (; i < count; ++i)
+    {
+        float px = x[i];
+        float py = y[i];
+        float pz = z[i];
+        dstX[i] = px * m[0] + py * m[4] + pz * m[8] + w * m[12];
+        dstY[i] = px * m[1] + py * m[5] + pz * m[9] + w * m[13];
+        dstZ[i] = px * m[2] + py * m[6] + pz * m[10] + w * m[14];
+    }
+}
+
+inline void MathUtil::transformBoxes(const float* m, const float* boxes, float* dst, unsigned int count)
+{
+    // Transform the center and project the half extents onto the absolute
+    // rotation/scale part (Arvo), which bounds the same 8 transformed corners.
+    __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 half = _mm_set1_ps(0.5f);
+    __m128 c0 = _mm_loadu_ps(&m[0]);
+    __m128 c1 = _mm_loadu_ps(&m[4]);
+    __m128 c2 = _mm_loadu_ps(&m[8]);
+    __m128 c3 = _mm_loadu_ps(&m[12]);
+    __m128 a0 = _mm_and_ps(c0, absMask);
+    __m128 a1 = _mm_and_ps(c1, absMask);
+    __m128 a2 = _mm_and_ps(c2, absMask);
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        const float* b = &boxes[i * 6];
+        __m128 bmin = _mm_set_ps(0.0f, b[2], b[1], b[0]);
+        __m128 bmax = _mm_set_ps(0.0f, b[5], b[4], b[3]);
+        __m128 center = _mm_mul_ps(_mm_add_ps(bmin, bmax), half);
+        __m128 extent = _mm_mul_ps(_mm_sub_ps(bmax, bmin), half);
+
+        __m128 c = _mm_add_ps(c3, _mm_mul_ps(c0, _mm_shuffle_ps(center, center, _MM_SHUFFLE(0, 0, 0, 0))));
+        c = _mm_add_ps(c, _mm_mul_ps(c1, _mm_shuffle_ps(center, center, _MM_SHUFFLE(1, 1, 1, 1))));
+        c = _mm_add_ps(c, _mm_mul_ps(c2, _mm_shuffle_ps(center, center, _MM_SHUFFLE(2, 2, 2, 2))));
+
+        __m128 e = _mm_mul_ps(a0, _mm_shuffle_ps(extent, extent, _MM_SHUFFLE(0, 0, 0, 0)));
+        e = _mm_add_ps(e, _mm_mul_ps(a1, _mm_shuffle_ps(extent, extent, _MM_SHUFFLE(1, 1, 1, 1))));
+        e = _mm_add_ps(e, _mm_mul_ps(a2, _mm_shuffle_ps(extent, extent, _MM_SHUFFLE(2, 2, 2, 2))));
+
+        __m128 rmin = _mm_sub_ps(c, e);
+        __m128 rmax = _mm_add_ps(c, e);
+
+        float* d = &dst[i * 6];
+        _mm_storel_pi((__m64*)&d[0], rmin);
+        _mm_store_ss(&d[2], _mm_movehl_ps(rmin, rmin));
+        _mm_storel_pi((__m64*)&d[3], rmax);
+        _mm_store_ss(&d[5], _mm_movehl_ps(rmax, rmax));
+    }
+}
+
+}
@@ -780,6 +780,20 @@ void Matrix::multiply(const Matrix& m1, const Matrix& m2, Matrix* dst)
     MathUtil::multiplyMatrix(m1.m, m2.m, dst->m);
 }
 
+void Matrix::multiply(const Matrix* m1, const Matrix* m2, Matrix* dst, unsigned int count)
+{
+    GP_ASSERT(count == 0 || (m1 && m2 && dst));
+
+    MathUtil::multiplyMatrices(m1->m, 16, m2->m, dst->m, count);
+}
+
+void Matrix::multiply(const Matrix& m1, const Matrix* m2, Matrix* dst, unsigned int count)
+{
+    GP_ASSERT(count == 0 || (m2 && dst));
+
+    MathUtil::multiplyMatrices(m1.m, 0, m2->m, dst->m, count);
+}
+
 void Matrix::negate()
 {
     negate(this);
@@ -949,6 +963,21 @@ void Matrix::transformPoint(const Vector3& point, Vector3* dst) const
     transformVector(point.x, point.y, point.z, 1.0f, dst);
 }
 
+void Matrix::transformPoints(const Vector3* points, Vector3* dst, unsigned int count) const
+{
+    GP_ASSERT(count == 0 || (points && dst));
+
+    MathUtil::transformVector3Array(m, (const float*)points, 1.0f, (float*)dst, count);
+}
+
+void Matrix::transformPoints(const float* x, const float* y, const float* z,
+                             float* dstX, float* dstY, float* dstZ, unsigned int count) const
+{
+    GP_ASSERT(count == 0 || (x && y && z && dstX && dstY && dstZ));
+
+    MathUtil::transformVector3SoA(m, x, y, z, 1.0f, dstX, dstY, dstZ, count);
+}
+
 void Matrix::transformVector(Vector3* vector) const
 {
     GP_ASSERT(vector);
@@ -960,6 +989,13 @@ void Matrix::transformVector(const Vector3& vector, Vector3* dst) const
     transformVector(vector.x, vector.y, vector.z, 0.0f, dst);
 }
 
+void Matrix::transformVectors(const Vector3* vectors, Vector3* dst, unsigned int count) const
+{
+    GP_ASSERT(count == 0 || (vectors && dst));
+
+    MathUtil::transformVector3Array(m, (const float*)vectors, 0.0f, (float*)dst, count);
+}
+
 void Matrix::transformVector(float x, float y, float z, float w, Vector3* dst) const
 {
     GP_ASSERT(dst);
@@ -532,6 +532,31 @@ public:
      */
     static void multiply(const Matrix& m1, const Matrix& m2, Matrix* dst);
 
+    /**
+     * Multiplies each matrix in m1 by the matrix at the same index in m2 and
+     * stores the results in dst.
+     *
+     * This is the batched form of multiply(const Matrix&, const Matrix&, Matrix*),
+     * for example to combine an array of parent world matrices with an array of
+     * local matrices in a single call. dst may be the same array as m1 or m2.
+     *
+     * @param m1 The array of first matrices to multiply.
+     * @param m2 The array of second matrices to multiply.
+     * @param dst An array of matrices to store the results in.
+     * @param count The number of matrices in each array.
+     */
+    static void multiply(const Matrix* m1, const Matrix* m2, Matrix* dst, unsigned int count);
+
+    /**
+     * Multiplies m1 by each matrix in m2 and stores the results in dst.
+     *
+     * @param m1 The first matrix to multiply.
+     * @param m2 The array of second matrices to multiply.
+     * @param dst An array of matrices to store the results in.
+     * @param count The number of matrices in m2 and dst.
+     */
+    static void multiply(const Matrix& m1, const Matrix* m2, Matrix* dst, unsigned int count);
+
     /**
      * Negates this matrix.
      */
@@ -767,6 +792,35 @@ public:
      */
     void transformPoint(const Vector3& point, Vector3* dst) const;
 
+    /**
+     * Transforms an array of points by this matrix, and stores
+     * the results in dst.
+     *
+     * @param points The points to transform.
+     * @param dst An array to store the transformed points in (may be the same array as points).
+     * @param count The number of points to transform.
+     */
+    void transformPoints(const Vector3* points, Vector3* dst, unsigned int count) const;
+
+    /**
+     * Transforms an array of points stored as separate x, y and z
+     * arrays (structure of arrays) by this matrix, and stores the results
+     * in the destination arrays.
+     *
+     * This layout lets several points be transformed per SIMD instruction.
+     * The destination arrays may be the same as the source arrays.
+     *
+     * @param x The x-coordinates of the points to transform.
+     * @param y The y-coordinates of the points to transform.
+     * @param z The z-coordinates of the points to transform.
+     * @param dstX An array to store the transformed x-coordinates in.
+     * @param dstY An array to store the transformed y-coordinates in.
+     * @param dstZ An array to store the transformed z-coordinates in.
+     * @param count The number of points to transform.
+     */
+    void transformPoints(const float* x, const float* y, const float* z,
+                         float* dstX, float* dstY, float* dstZ, unsigned int count) const;
+
     /**
      * Transforms the specified vector by this matrix by
      * treating the fourth (w) coordinate as zero.
@@ -787,6 +841,16 @@ public:
      */
     void transformVector(const Vector3& vector, Vector3* dst) const;
 
+    /**
+     * Transforms an array of vectors by this matrix by treating the
+     * fourth (w) coordinate as zero, and stores the results in dst.
+     *
+     * @param vectors The vectors to transform.
+     * @param dst An array to store the transformed vectors in (may be the same array as vectors).
+     * @param count The number of vectors to transform.
+     */
+    void transformVectors(const Vector3* vectors, Vector3* dst, unsigned int count) const;
+
     /**
      * Transforms the specified vector by this matrix.
      *
@@ -199,6 +199,48 @@ void MeshBatch::add(const float* vertices, unsigned int vertexCount, const unsig
     add(vertices, sizeof(float), vertexCount, indices, indexCount);
 }
 
+bool MeshBatch::append(unsigned int vertexCount, unsigned int indexCount, void** vertices, unsigned short** indices, unsigned int* firstVertex)
+{
+    GP_ASSERT(vertices && indices && firstVertex);
+
+    unsigned int newVertexCount = _vertexCount + vertexCount;
+    unsigned int newIndexCount = _indexCount + indexCount;
+    bool stitch = _indexed && _primitiveType == Mesh::TRIANGLE_STRIP && _vertexCount > 0;
+    if (stitch)
+        newIndexCount += 2; // need an extra 2 indices for connecting strips with degenerate triangles
+
+    // Do we need to grow the batch?
+    while (newVertexCount > _vertexCapacity || (_indexed && newIndexCount > _indexCapacity))
+    {
+        if (_growSize == 0 || !resize(_capacity + _growSize))
+            return false;
+    }
+
+    GP_ASSERT(_verticesPtr);
+    *vertices = _verticesPtr;
+    *firstVertex = _vertexCount;
+    _verticesPtr += vertexCount * _vertexFormat.getVertexSize();
+    _vertexCount = newVertexCount;
+
+    *indices = NULL;
+    if (_indexed)
+    {
+        GP_ASSERT(_indicesPtr);
+        if (stitch)
+        {
+            // Create a degenerate triangle to connect separate triangle strips
+            // by duplicating the previous and next vertices.
+            _indicesPtr[0] = *(_indicesPtr-1);
+            _indicesPtr[1] = *firstVertex;
+            _indicesPtr += 2;
+        }
+        *indices = _indicesPtr;
+        _indicesPtr += indexCount;
+        _indexCount = newIndexCount;
+    }
+    return true;
+}
+
 void MeshBatch::start()
 {
     _vertexCount = 0;
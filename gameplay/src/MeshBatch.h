@@ -114,6 +114,27 @@ public:
      */
     void add(const float* vertices, unsigned int vertexCount, const unsigned short* indices = NULL, unsigned int indexCount = 0);
 
+    /**
+     * Adds room for a group of primitives to the batch and returns it, so that the primitives
+     * can be generated directly into the batch's vertex and index arrays rather than copied in.
+     *
+     * The returned arrays do not move until the batch is next added to or resized, so separate
+     * parts of them may be filled from several threads.
+     *
+     * Unlike add(), the indices must be written as absolute vertex indices; the first added
+     * vertex has the index returned in firstVertex. If the batch draws triangle strips, the
+     * added group is stitched to the previous one by this method.
+     *
+     * @param vertexCount Number of vertices to add.
+     * @param indexCount Number of indices to add (should be zero for non-indexed batches).
+     * @param vertices Populated with the vertices to fill.
+     * @param indices Populated with the indices to fill; NULL for non-indexed batches.
+     * @param firstVertex Populated with the index of the first added vertex.
+     *
+     * @return True if successful, false if the batch could not grow to hold the primitives.
+     */
+    bool append(unsigned int vertexCount, unsigned int indexCount, void** vertices, unsigned short** indices, unsigned int* firstVertex);
+
     /**
      * Starts batching.
      *
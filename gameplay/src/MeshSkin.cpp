@@ -2,15 +2,86 @@
 #include "MeshSkin.h"
 #include "Joint.h"
 #include "Model.h"
+#include "MathUtil.h"
+#include "Quaternion.h"
+
+#ifdef GP_USE_SSE
+#include <emmintrin.h>
+#endif
 
 // The number of rows in each palette matrix.
 #define PALETTE_ROWS 3
 
+// The number of Vector4's for each joint in the dual quaternion palette.
+#define DUAL_QUATERNION_ROWS 2
+
+// Bits of MeshSkin::_jointsDirty telling which palette entries are out of date.
+#define MATRIX_PALETTE_DIRTY 0x01
+#define DUAL_QUATERNION_PALETTE_DIRTY 0x02
+#define ALL_PALETTES_DIRTY (MATRIX_PALETTE_DIRTY | DUAL_QUATERNION_PALETTE_DIRTY)
+
 namespace vkcore
 {
 
+/**
+ * Writes the 3 palette rows of world * bindShape, where bindShape is given by its 4 rows.
+ *
+ * Row r of the product is the sum over k of world(r, k) * bindShape row k; the fourth
+ * row of the product is always (0, 0, 0, 1) for affine transforms and is not stored.
+ */
+static void computePaletteRows(const float* world, const float* bindShape, Vector4* palette)
+{
+#ifdef GP_USE_SSE
+    __m128 b0 = _mm_loadu_ps(&bindShape[0]);
+    __m128 b1 = _mm_loadu_ps(&bindShape[4]);
+    __m128 b2 = _mm_loadu_ps(&bindShape[8]);
+    __m128 b3 = _mm_loadu_ps(&bindShape[12]);
+    for (unsigned int r = 0; r < PALETTE_ROWS; ++r)
+    {
+        __m128 row = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(_mm_set1_ps(world[r]), b0), _mm_mul_ps(_mm_set1_ps(world[r + 4]), b1)),
+            _mm_add_ps(_mm_mul_ps(_mm_set1_ps(world[r + 8]), b2), _mm_mul_ps(_mm_set1_ps(world[r + 12]), b3)));
+        _mm_storeu_ps(&palette[r].x, row);
+    }
+#else
+    for (unsigned int r = 0; r < PALETTE_ROWS; ++r)
+    {
+        float* row = &palette[r].x;
+        for (unsigned int c = 0; c < 4; ++c)
+        {
+            row[c] = world[r] * bindShape[c] + world[r + 4] * bindShape[4 + c] +
+                     world[r + 8] * bindShape[8 + c] + world[r + 12] * bindShape[12 + c];
+        }
+    }
+#endif
+}
+
+/**
+ * Writes the dual quaternion of a rigid transform given by its 3 palette rows.
+ */
+static void computeDualQuaternion(const Vector4* rows, Vector4* dualQuaternion)
+{
+    Matrix m(rows[0].x, rows[0].y, rows[0].z, rows[0].w,
+             rows[1].x, rows[1].y, rows[1].z, rows[1].w,
+             rows[2].x, rows[2].y, rows[2].z, rows[2].w,
+             0.0f, 0.0f, 0.0f, 1.0f);
+    Quaternion q;
+    m.getRotation(&q);
+
+    // The dual part is half the translation, as a pure quaternion, times the rotation.
+    float tx = rows[0].w * 0.5f;
+    float ty = rows[1].w * 0.5f;
+    float tz = rows[2].w * 0.5f;
+    dualQuaternion[0].set(q.x, q.y, q.z, q.w);
+    dualQuaternion[1].set( tx * q.w + ty * q.z - tz * q.y,
+                          -tx * q.z + ty * q.w + tz * q.x,
+                           tx * q.y - ty * q.x + tz * q.w,
+                          -tx * q.x - ty * q.y - tz * q.z);
+}
+
 MeshSkin::MeshSkin()
-    : _rootJoint(NULL), _rootNode(NULL), _matrixPalette(NULL), _model(NULL)
+    : _rootJoint(NULL), _rootNode(NULL), _matrixPalette(NULL), _model(NULL),
+      _jointBindShapes(NULL), _dualQuaternionPalette(NULL), _jointsDirty(NULL), _paletteDirty(ALL_PALETTES_DIRTY), _bindShapesDirty(true)
 {
 }
 
@@ -19,6 +90,9 @@ MeshSkin::~MeshSkin()
     clearJoints();
 
     SAFE_DELETE_ARRAY(_matrixPalette);
+    SAFE_DELETE_ARRAY(_dualQuaternionPalette);
+    SAFE_DELETE_ARRAY(_jointBindShapes);
+    SAFE_DELETE_ARRAY(_jointsDirty);
 }
 
 const Matrix& MeshSkin::getBindShape() const
@@ -29,6 +103,7 @@ const Matrix& MeshSkin::getBindShape() const
 void MeshSkin::setBindShape(const float* matrix)
 {
     _bindShape.set(matrix);
+    setBindShapesDirty();
 }
 
 unsigned int MeshSkin::getJointCount() const
@@ -123,6 +198,9 @@ void MeshSkin::setJointCount(unsigned int jointCount)
 
     // Rebuild the matrix palette. Each matrix is 3 rows of Vector4.
     SAFE_DELETE_ARRAY(_matrixPalette);
+    SAFE_DELETE_ARRAY(_dualQuaternionPalette);
+    SAFE_DELETE_ARRAY(_jointBindShapes);
+    SAFE_DELETE_ARRAY(_jointsDirty);
 
     if (jointCount > 0)
     {
@@ -133,7 +211,10 @@ void MeshSkin::setJointCount(unsigned int jointCount)
             _matrixPalette[i+1].set(0.0f, 1.0f, 0.0f, 0.0f);
             _matrixPalette[i+2].set(0.0f, 0.0f, 1.0f, 0.0f);
         }
+        _jointBindShapes = new float[jointCount * 16];
+        _jointsDirty = new unsigned char[jointCount];
     }
+    setBindShapesDirty();
 }
 
 void MeshSkin::setJoint(Joint* joint, unsigned int index)
@@ -151,20 +232,104 @@ void MeshSkin::setJoint(Joint* joint, unsigned int index)
     if (joint)
     {
         joint->addRef();
-        joint->addSkin(this);
+        joint->addSkin(this, index);
     }
+    setBindShapesDirty();
 }
 
 Vector4* MeshSkin::getMatrixPalette() const
 {
     GP_ASSERT(_matrixPalette);
 
+    updatePalette(MATRIX_PALETTE_DIRTY);
+    return _matrixPalette;
+}
+
+Vector4* MeshSkin::getDualQuaternionPalette() const
+{
+    GP_ASSERT(_matrixPalette);
+
+    if (!_dualQuaternionPalette)
+    {
+        _dualQuaternionPalette = new Vector4[_joints.size() * DUAL_QUATERNION_ROWS];
+        for (size_t i = 0, count = _joints.size(); i < count; i++)
+            _jointsDirty[i] |= DUAL_QUATERNION_PALETTE_DIRTY;
+        _paletteDirty |= DUAL_QUATERNION_PALETTE_DIRTY;
+    }
+    updatePalette(DUAL_QUATERNION_PALETTE_DIRTY);
+    return _dualQuaternionPalette;
+}
+
+unsigned int MeshSkin::getDualQuaternionPaletteSize() const
+{
+    return (unsigned int)_joints.size() * DUAL_QUATERNION_ROWS;
+}
+
+void MeshSkin::updatePalette(unsigned char dirtyBit) const
+{
+    if (_bindShapesDirty)
+        updateJointBindShapes();
+
+    if ((_paletteDirty & dirtyBit) == 0)
+        return;
+
+    _paletteDirty &= ~dirtyBit;
     for (size_t i = 0, count = _joints.size(); i < count; i++)
     {
+        if ((_jointsDirty[i] & dirtyBit) == 0)
+            continue;
+
         GP_ASSERT(_joints[i]);
-        _joints[i]->updateJointMatrix(getBindShape(), &_matrixPalette[i * PALETTE_ROWS]);
+        _jointsDirty[i] &= ~dirtyBit;
+        if (dirtyBit == MATRIX_PALETTE_DIRTY)
+        {
+            computePaletteRows(_joints[i]->getWorldMatrix().m, &_jointBindShapes[i * 16], &_matrixPalette[i * PALETTE_ROWS]);
+        }
+        else
+        {
+            Vector4 rows[PALETTE_ROWS];
+            computePaletteRows(_joints[i]->getWorldMatrix().m, &_jointBindShapes[i * 16], rows);
+            computeDualQuaternion(rows, &_dualQuaternionPalette[i * DUAL_QUATERNION_ROWS]);
+        }
+    }
+}
+
+void MeshSkin::setJointDirty(unsigned int index)
+{
+    GP_ASSERT(index < _joints.size());
+    _jointsDirty[index] = ALL_PALETTES_DIRTY;
+    _paletteDirty = ALL_PALETTES_DIRTY;
+}
+
+void MeshSkin::setBindShapesDirty()
+{
+    _bindShapesDirty = true;
+    _paletteDirty = ALL_PALETTES_DIRTY;
+    if (_jointsDirty)
+        memset(_jointsDirty, ALL_PALETTES_DIRTY, _joints.size());
+}
+
+void MeshSkin::updateJointBindShapes() const
+{
+    _bindShapesDirty = false;
+
+    Matrix m;
+    for (size_t i = 0, count = _joints.size(); i < count; i++)
+    {
+        if (!_joints[i])
+            continue;
+
+        // Store the rows of the product, as the palette builder consumes it a row at a time.
+        Matrix::multiply(_joints[i]->getInverseBindPose(), _bindShape, &m);
+        float* rows = &_jointBindShapes[i * 16];
+        for (unsigned int r = 0; r < 4; ++r)
+        {
+            rows[r * 4 + 0] = m.m[r];
+            rows[r * 4 + 1] = m.m[r + 4];
+            rows[r * 4 + 2] = m.m[r + 8];
+            rows[r * 4 + 3] = m.m[r + 12];
+        }
     }
-    return _matrixPalette;
 }
 
 unsigned int MeshSkin::getMatrixPaletteSize() const
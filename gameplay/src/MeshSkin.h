@@ -92,6 +92,14 @@ public:
 
     /**
      * Returns the pointer to the Vector4 array for the purpose of binding to a shader.
+     *
+     * Only the palette entries of joints whose transforms changed since the last call are
+     * rebuilt. Each entry is the joint's world matrix times the product of its inverse bind
+     * pose and the bind shape, which is computed once and kept until either changes.
+     *
+     * Building the palette uses no shared scratch state, so the palettes of different skins
+     * may be built on different threads, provided the world matrices of their joints are
+     * already up to date (see Node::getWorldMatrix).
      * 
      * @return The pointer to the matrix palette.
      */
@@ -106,6 +114,34 @@ public:
      */
     unsigned int getMatrixPaletteSize() const;
 
+    /**
+     * Returns the pointer to the dual quaternion palette for the purpose of binding to a shader.
+     *
+     * This is an alternative to the matrix palette for dual quaternion skinning, selected
+     * by binding a material parameter to the DUAL_QUATERNION_PALETTE auto binding instead
+     * of MATRIX_PALETTE. Each joint is represented by 2 Vector4's rather than 3: the unit
+     * quaternion of its rotation, followed by the dual part that encodes its translation.
+     * Joint transforms are assumed to be rigid; any scale in them is discarded.
+     *
+     * The quaternions of neighbouring joints are not kept in the same hemisphere, so the
+     * shader should negate each blended dual quaternion whose real part points away from
+     * that of the first influence.
+     *
+     * The palette is built from the same joint transforms as the matrix palette, and only
+     * its out of date entries are rebuilt.
+     *
+     * @return The pointer to the dual quaternion palette.
+     */
+    Vector4* getDualQuaternionPalette() const;
+
+    /**
+     * Returns the number of elements in the dual quaternion palette array.
+     * Each joint is represented by 2 Vector4's.
+     *
+     * @return The dual quaternion palette size.
+     */
+    unsigned int getDualQuaternionPaletteSize() const;
+
     /**
      * Returns our parent Model.
      */
@@ -175,6 +211,30 @@ private:
      */
     void clearJoints();
 
+    /**
+     * Marks the palette entry of a joint as out of date. Called when the joint's transform changes.
+     *
+     * @param index The index of the joint.
+     */
+    void setJointDirty(unsigned int index);
+
+    /**
+     * Marks the inverse bind pose and bind shape products of all joints as out of date.
+     */
+    void setBindShapesDirty();
+
+    /**
+     * Computes the inverse bind pose and bind shape product of every joint.
+     */
+    void updateJointBindShapes() const;
+
+    /**
+     * Rebuilds the out of date entries of the matrix palette or of the dual quaternion palette.
+     *
+     * @param dirtyBit The bit of _jointsDirty that marks the entries of the palette to rebuild.
+     */
+    void updatePalette(unsigned char dirtyBit) const;
+
     Matrix _bindShape;
     std::vector<Joint*> _joints;
     Joint* _rootJoint;
@@ -190,6 +250,16 @@ private:
     // The number of Vector4's is (_joints.size() * 3).
     Vector4* _matrixPalette;
     Model* _model;
+
+    // The inverse bind pose of each joint times the bind shape, as 4 rows of 4 floats.
+    float* _jointBindShapes;
+    // Pointer to the array of dual quaternions, 2 Vector4's per joint; allocated when first used.
+    mutable Vector4* _dualQuaternionPalette;
+    // Bits telling which palettes are out of date for each joint.
+    unsigned char* _jointsDirty;
+    // Bits telling which palettes have out of date joints.
+    mutable unsigned char _paletteDirty;
+    mutable bool _bindShapesDirty;
 };
 
 }
@@ -2,6 +2,7 @@
 #include "Node.h"
 #include "AudioSource.h"
 #include "Scene.h"
+#include "BoundingVolumeTree.h"
 #include "Joint.h"
 #include "PhysicsRigidBody.h"
 #include "PhysicsVehicle.h"
@@ -27,7 +28,7 @@ Node::Node(const char* id)
     : _scene(NULL), _firstChild(NULL), _nextSibling(NULL), _prevSibling(NULL), _parent(NULL),
 	_childCount(0), _enabled(true), _tags(NULL), _drawable(NULL), _camera(NULL),
 	_light(NULL), _audioSource(NULL), _collisionObject(NULL), _agent(NULL),
-	_userObject(NULL), _dirtyBits(NODE_DIRTY_ALL)
+	_userObject(NULL), _dirtyBits(NODE_DIRTY_ALL), _boundsLeaf(-1)
 {
     GP_REGISTER_SCRIPT_EVENTS();
     if (id)
@@ -123,6 +124,12 @@ void Node::addChild(Node* child)
     ++_childCount;
     setBoundsDirty();
 
+    Scene* scene = getScene();
+    if (scene)
+    {
+        scene->hierarchyChanged();
+    }
+
     if (_dirtyBits & NODE_DIRTY_HIERARCHY)
     {
         hierarchyChanged();
@@ -177,6 +184,12 @@ void Node::remove()
     _prevSibling = NULL;
     _parent = NULL;
 
+    Scene* scene = parent ? parent->getScene() : NULL;
+    if (scene)
+    {
+        scene->hierarchyChanged();
+    }
+
     if (parent && parent->_dirtyBits & NODE_DIRTY_HIERARCHY)
     {
         parent->hierarchyChanged();
@@ -467,6 +480,27 @@ const Matrix& Node::getWorldMatrix() const
     return _world;
 }
 
+void Node::updateWorldMatrix(const Node* parent) const
+{
+    if ((_dirtyBits & NODE_DIRTY_WORLD) == 0)
+        return;
+
+    _dirtyBits &= ~NODE_DIRTY_WORLD;
+
+    // Same rules as getWorldMatrix(), except that the parent is known to be resolved.
+    if (!isStatic())
+    {
+        if (parent && (!_collisionObject || _collisionObject->isKinematic()))
+        {
+            Matrix::multiply(parent->_world, getMatrix(), &_world);
+        }
+        else
+        {
+            _world = getMatrix();
+        }
+    }
+}
+
 const Matrix& Node::getWorldViewMatrix() const
 {
     static Matrix worldView;
@@ -659,6 +693,7 @@ void Node::transformChanged()
 {
     // Our local transform was changed, so mark our world matrices dirty.
     _dirtyBits |= NODE_DIRTY_WORLD | NODE_DIRTY_BOUNDS;
+    setBoundsLeafMoved();
 
     // Notify our children that their transform has also changed (since transforms are inherited).
     for (Node* n = getFirstChild(); n != NULL; n = n->getNextSibling())
@@ -684,12 +719,23 @@ void Node::setBoundsDirty()
 {
     // Mark ourself and our parent nodes as dirty
     _dirtyBits |= NODE_DIRTY_BOUNDS;
+    setBoundsLeafMoved();
 
     // Mark our parent bounds as dirty as well
     if (_parent)
         _parent->setBoundsDirty();
 }
 
+void Node::setBoundsLeafMoved()
+{
+    if (_boundsLeaf >= 0)
+    {
+        Scene* scene = getScene();
+        if (scene && scene->_boundsTree)
+            scene->_boundsTree->setLeafMoved(this, _boundsLeaf);
+    }
+}
+
 Animation* Node::getAnimation(const char* id) const
 {
     Animation* animation = ((AnimationTarget*)this)->getAnimation(id);
@@ -828,98 +874,111 @@ void Node::setDrawable(Drawable* drawable)
                 ref->addRef();
             _drawable->setNode(this);
         }
+
+        Scene* scene = getScene();
+        if (scene)
+            scene->drawableChanged();
     }
     setBoundsDirty();
 }
 
-const BoundingSphere& Node::getBoundingSphere() const
+bool Node::getLocalBoundingSphere(BoundingSphere* bounds) const
 {
-    if (_dirtyBits & NODE_DIRTY_BOUNDS)
-    {
-        _dirtyBits &= ~NODE_DIRTY_BOUNDS;
+    GP_ASSERT(bounds);
 
-        const Matrix& worldMatrix = getWorldMatrix();
+    const Matrix& worldMatrix = getWorldMatrix();
 
-        // Start with our local bounding sphere
-        // TODO: Incorporate bounds from entities other than mesh (i.e. particleemitters, audiosource, etc)
-        bool empty = true;
-        Terrain* terrain = dynamic_cast<Terrain*>(_drawable);
-        if (terrain)
+    // Start with our local bounding sphere
+    // TODO: Incorporate bounds from entities other than mesh (i.e. particleemitters, audiosource, etc)
+    bool empty = true;
+    Terrain* terrain = dynamic_cast<Terrain*>(_drawable);
+    if (terrain)
+    {
+        bounds->set(terrain->getBoundingBox());
+        empty = false;
+    }
+    Model* model = dynamic_cast<Model*>(_drawable);
+    if (model && model->getMesh())
+    {
+        if (empty)
         {
-            _bounds.set(terrain->getBoundingBox());
+            bounds->set(model->getMesh()->getBoundingSphere());
             empty = false;
         }
-        Model* model = dynamic_cast<Model*>(_drawable);
-        if (model && model->getMesh())
+        else
+        {
+            bounds->merge(model->getMesh()->getBoundingSphere());
+        }
+    }
+    if (_light)
+    {
+        switch (_light->getLightType())
         {
+        case Light::POINT:
             if (empty)
             {
-                _bounds.set(model->getMesh()->getBoundingSphere());
+                bounds->set(Vector3::zero(), _light->getRange());
                 empty = false;
             }
             else
             {
-                _bounds.merge(model->getMesh()->getBoundingSphere());
+                bounds->merge(BoundingSphere(Vector3::zero(), _light->getRange()));
             }
+            break;
+        case Light::SPOT:
+            // TODO: Implement spot light bounds
+            break;
         }
-        if (_light)
+    }
+    if (empty)
+    {
+        // Empty bounding sphere, set the world translation with zero radius
+        worldMatrix.getTranslation(&bounds->center);
+        bounds->radius = 0;
+    }
+
+    // Transform the sphere (if not empty) into world space.
+    if (!empty)
+    {
+        bool applyWorldTransform = true;
+        if (model && model->getSkin())
         {
-            switch (_light->getLightType())
+            // Special case: If the root joint of our mesh skin is parented by any nodes, 
+            // multiply the world matrix of the root joint's parent by this node's
+            // world matrix. This computes a final world matrix used for transforming this
+            // node's bounding volume. This allows us to store a much smaller bounding
+            // volume approximation than would otherwise be possible for skinned meshes,
+            // since joint parent nodes that are not in the matrix palette do not need to
+            // be considered as directly transforming vertices on the GPU (they can instead
+            // be applied directly to the bounding volume transformation below).
+            GP_ASSERT(model->getSkin()->getRootJoint());
+            Node* jointParent = model->getSkin()->getRootJoint()->getParent();
+            if (jointParent)
             {
-            case Light::POINT:
-                if (empty)
-                {
-                    _bounds.set(Vector3::zero(), _light->getRange());
-                    empty = false;
-                }
-                else
-                {
-                    _bounds.merge(BoundingSphere(Vector3::zero(), _light->getRange()));
-                }
-                break;
-            case Light::SPOT:
-                // TODO: Implement spot light bounds
-                break;
+                // TODO: Should we protect against the case where joints are nested directly
+                // in the node hierachy of the model (this is normally not the case)?
+                Matrix boundsMatrix;
+                Matrix::multiply(getWorldMatrix(), jointParent->getWorldMatrix(), &boundsMatrix);
+                bounds->transform(boundsMatrix);
+                applyWorldTransform = false;
             }
         }
-        if (empty)
+        if (applyWorldTransform)
         {
-            // Empty bounding sphere, set the world translation with zero radius
-            worldMatrix.getTranslation(&_bounds.center);
-            _bounds.radius = 0;
+            bounds->transform(getWorldMatrix());
         }
+    }
 
-        // Transform the sphere (if not empty) into world space.
-        if (!empty)
-        {
-            bool applyWorldTransform = true;
-            if (model && model->getSkin())
-            {
-                // Special case: If the root joint of our mesh skin is parented by any nodes, 
-                // multiply the world matrix of the root joint's parent by this node's
-                // world matrix. This computes a final world matrix used for transforming this
-                // node's bounding volume. This allows us to store a much smaller bounding
-                // volume approximation than would otherwise be possible for skinned meshes,
-                // since joint parent nodes that are not in the matrix palette do not need to
-                // be considered as directly transforming vertices on the GPU (they can instead
-                // be applied directly to the bounding volume transformation below).
-                GP_ASSERT(model->getSkin()->getRootJoint());
-                Node* jointParent = model->getSkin()->getRootJoint()->getParent();
-                if (jointParent)
-                {
-                    // TODO: Should we protect against the case where joints are nested directly
-                    // in the node hierachy of the model (this is normally not the case)?
-                    Matrix boundsMatrix;
-                    Matrix::multiply(getWorldMatrix(), jointParent->getWorldMatrix(), &boundsMatrix);
-                    _bounds.transform(boundsMatrix);
-                    applyWorldTransform = false;
-                }
-            }
-            if (applyWorldTransform)
-            {
-                _bounds.transform(getWorldMatrix());
-            }
-        }
+    return !empty;
+}
+
+const BoundingSphere& Node::getBoundingSphere() const
+{
+    if (_dirtyBits & NODE_DIRTY_BOUNDS)
+    {
+        _dirtyBits &= ~NODE_DIRTY_BOUNDS;
+
+        bool empty = !getLocalBoundingSphere(&_bounds);
 
         // Merge this world-space bounding sphere with our childrens' bounding volumes.
         for (Node* n = getFirstChild(); n != NULL; n = n->getNextSibling())
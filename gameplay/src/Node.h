@@ -41,6 +41,7 @@ class Node : public Transform, public Ref
     friend class Bundle;
     friend class MeshSkin;
     friend class Light;
+    friend class BoundingVolumeTree;
 
     GP_SCRIPT_EVENTS_START();
     GP_SCRIPT_EVENT(update, "<Node>f");
@@ -665,6 +666,30 @@ protected:
      */
     void setBoundsDirty();
 
+    /**
+     * Marks the leaf of this node in the scene's bounding volume tree as needing a refit.
+     */
+    void setBoundsLeafMoved();
+
+    /**
+     * Computes the world-space bounding sphere of the data inside this node,
+     * not including its children.
+     *
+     * @param bounds The sphere to store the bounds in.
+     *
+     * @return false if the node does not occupy any space, in which case the sphere is
+     *      set to the node translation with a radius of zero.
+     */
+    bool getLocalBoundingSphere(BoundingSphere* bounds) const;
+
+    /**
+     * Resolves the world matrix of this node if it is dirty, using the already
+     * resolved world matrix of the given parent instead of recursing.
+     *
+     * @param parent The parent node, or NULL for a top-level node.
+     */
+    void updateWorldMatrix(const Node* parent) const;
+
     /**
      * Returns the first child node that matches the given ID.
      *
@@ -752,6 +777,8 @@ protected:
     mutable BoundingSphere _bounds;
     /** The dirty bits used for optimization. */
     mutable int _dirtyBits;
+    /** The leaf of this node in the scene's bounding volume tree, or -1. */
+    int _boundsLeaf;
 };
 
 /**
@@ -0,0 +1,581 @@
+#include "Base.h"
+#include "OcclusionCuller.h"
+#include "MeshPart.h"
+#include "Node.h"
+#include "MathUtil.h"
+#include "jobsystem.hpp"
+#include <cfloat>
+
+#ifdef GP_USE_SSE
+#include <emmintrin.h>
+#endif
+
+// The size of the tiles of the depth buffer that are rasterized by a single job.
+#define OCCLUSION_TILE_WIDTH 64
+#define OCCLUSION_TILE_HEIGHT 32
+
+// The size of the blocks of pixels of the coarse depth level.
+#define OCCLUSION_BLOCK_SIZE 8
+
+// Triangles are clipped to the guard band, this many times the size of the view,
+// to keep their screen coordinates small enough for exact edge functions.
+#define OCCLUSION_GUARD_BAND 4.0f
+
+// Triangles are clipped to this minimum clip space w, in front of the camera.
+#define OCCLUSION_MIN_W 1e-4f
+
+// The maximum number of vertices of a triangle clipped by the near, minimum w and guard band planes.
+#define OCCLUSION_MAX_CLIP_VERTICES 9
+
+namespace vkcore
+{
+
+OcclusionCuller::Occluder::Occluder()
+{
+}
+
+OcclusionCuller::Occluder::~Occluder()
+{
+}
+
+// Returns the offset of the 3 component position of a vertex format, in floats, or -1.
+static int getPositionOffset(const VertexFormat& vertexFormat)
+{
+    unsigned int offset = 0;
+    for (unsigned int i = 0, count = vertexFormat.getElementCount(); i < count; ++i)
+    {
+        const VertexFormat::Element& e = vertexFormat.getElement(i);
+        if (e.usage == VertexFormat::POSITION)
+            return e.size >= 3 ? (int)offset : -1;
+        offset += e.size;
+    }
+    return -1;
+}
+
+OcclusionCuller::Occluder* OcclusionCuller::Occluder::create(const VertexFormat& vertexFormat, const void* vertexData, unsigned int vertexCount,
+                                                             Mesh::IndexFormat indexFormat, const void* indexData, unsigned int indexCount)
+{
+    GP_ASSERT(vertexData || vertexCount == 0);
+
+    int position = getPositionOffset(vertexFormat);
+    if (position < 0)
+    {
+        GP_WARN("Occluder vertex format must have a POSITION element with 3 components.");
+        return NULL;
+    }
+
+    Occluder* occluder = new Occluder();
+    occluder->addTriangles((const float*)vertexData + position, vertexFormat.getVertexSize() / sizeof(float), vertexCount,
+                           indexFormat, indexData, indexCount);
+    return occluder;
+}
+
+OcclusionCuller::Occluder* OcclusionCuller::Occluder::create(Mesh* mesh, const void* vertexData, const void** indexData)
+{
+    GP_ASSERT(mesh);
+
+    unsigned int partCount = mesh->getPartCount();
+    if (partCount == 0)
+    {
+        if (mesh->getPrimitiveType() != VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
+        {
+            GP_WARN("Occluder meshes must be triangle lists.");
+            return NULL;
+        }
+        return create(mesh->getVertexFormat(), vertexData, mesh->getVertexCount());
+    }
+
+    int position = getPositionOffset(mesh->getVertexFormat());
+    if (position < 0)
+    {
+        GP_WARN("Occluder vertex format must have a POSITION element with 3 components.");
+        return NULL;
+    }
+    GP_ASSERT(vertexData && indexData);
+
+    Occluder* occluder = new Occluder();
+    for (unsigned int i = 0; i < partCount; ++i)
+    {
+        MeshPart* part = mesh->getPart(i);
+        GP_ASSERT(part);
+        if (part->getPrimitiveType() != VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
+        {
+            GP_WARN("Skipping occluder mesh part %u, which is not a triangle list.", i);
+            continue;
+        }
+        occluder->addTriangles((const float*)vertexData + position, mesh->getVertexSize() / sizeof(float), mesh->getVertexCount(),
+                               part->getIndexFormat(), indexData[i], part->getIndexCount());
+    }
+    return occluder;
+}
+
+unsigned int OcclusionCuller::Occluder::getTriangleCount() const
+{
+    return (unsigned int)_indices.size() / 3;
+}
+
+void OcclusionCuller::Occluder::addTriangles(const float* positions, unsigned int stride, unsigned int vertexCount,
+                                             Mesh::IndexFormat indexFormat, const void* indexData, unsigned int indexCount)
+{
+    // Positions are shared by all parts, so they are only copied once.
+    if (_positions.empty())
+    {
+        _positions.resize(vertexCount);
+        for (unsigned int i = 0; i < vertexCount; ++i, positions += stride)
+            _positions[i].set(positions[0], positions[1], positions[2]);
+    }
+    GP_ASSERT(_positions.size() == vertexCount);
+
+    if (indexData == NULL)
+    {
+        for (unsigned int i = 0, count = vertexCount - vertexCount % 3; i < count; ++i)
+            _indices.push_back(i);
+        return;
+    }
+
+    indexCount -= indexCount % 3;
+    for (unsigned int i = 0; i < indexCount; ++i)
+    {
+        unsigned int index;
+        switch (indexFormat)
+        {
+        case Mesh::INDEX8:
+            index = ((const unsigned char*)indexData)[i];
+            break;
+        case Mesh::INDEX16:
+            index = ((const unsigned short*)indexData)[i];
+            break;
+        default:
+            index = ((const unsigned int*)indexData)[i];
+            break;
+        }
+        GP_ASSERT(index < vertexCount);
+        _indices.push_back(index < vertexCount ? index : 0);
+    }
+}
+
+OcclusionCuller::OcclusionCuller(unsigned int width, unsigned int height) :
+    _width((width + OCCLUSION_BLOCK_SIZE - 1) & ~(OCCLUSION_BLOCK_SIZE - 1)),
+    _height((height + OCCLUSION_BLOCK_SIZE - 1) & ~(OCCLUSION_BLOCK_SIZE - 1)),
+    _tilesX(0), _tilesY(0), _depth(NULL), _blocks(NULL), _jobSystem(NULL)
+{
+    GP_ASSERT(width > 0 && height > 0);
+
+    _tilesX = (_width + OCCLUSION_TILE_WIDTH - 1) / OCCLUSION_TILE_WIDTH;
+    _tilesY = (_height + OCCLUSION_TILE_HEIGHT - 1) / OCCLUSION_TILE_HEIGHT;
+    _depth = new float[_width * _height];
+    _blocks = new float[(_width / OCCLUSION_BLOCK_SIZE) * (_height / OCCLUSION_BLOCK_SIZE)];
+    _bins.resize(_tilesX * _tilesY);
+    begin(Matrix::identity());
+    end();
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+    SAFE_DELETE_ARRAY(_depth);
+    SAFE_DELETE_ARRAY(_blocks);
+}
+
+void OcclusionCuller::setJobSystem(vkTools::JobSystem* jobSystem)
+{
+    _jobSystem = jobSystem;
+}
+
+vkTools::JobSystem* OcclusionCuller::getJobSystem() const
+{
+    return _jobSystem;
+}
+
+void OcclusionCuller::begin(const Matrix& viewProjection)
+{
+    _viewProjection = viewProjection;
+    _triangles.clear();
+}
+
+void OcclusionCuller::addOccluder(Occluder* occluder, const Matrix& worldMatrix)
+{
+    GP_ASSERT(occluder);
+
+    Matrix m;
+    Matrix::multiply(_viewProjection, worldMatrix, &m);
+
+    size_t vertexCount = occluder->_positions.size();
+    std::vector<Vector4> clip(vertexCount);
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        const Vector3& p = occluder->_positions[i];
+        clip[i].set(m.m[0] * p.x + m.m[4] * p.y + m.m[8] * p.z + m.m[12],
+                    m.m[1] * p.x + m.m[5] * p.y + m.m[9] * p.z + m.m[13],
+                    m.m[2] * p.x + m.m[6] * p.y + m.m[10] * p.z + m.m[14],
+                    m.m[3] * p.x + m.m[7] * p.y + m.m[11] * p.z + m.m[15]);
+    }
+
+    const std::vector<unsigned int>& indices = occluder->_indices;
+    for (size_t i = 0, count = indices.size(); i + 3 <= count; i += 3)
+    {
+        addTriangle(clip[indices[i]], clip[indices[i + 1]], clip[indices[i + 2]]);
+    }
+}
+
+void OcclusionCuller::addTriangle(const Vector4& v0, const Vector4& v1, const Vector4& v2)
+{
+    // Clip planes as dot(plane, vertex) >= 0: the near plane, then the guard band. The near
+    // plane is z >= 0, which is that of the camera for projections with depths from 0 to 1
+    // and lies beyond it for those with depths from -1 to 1, so geometry the GPU clips away
+    // never hides anything. Clipping to a minimum w as well keeps the projection finite.
+    static const float planes[6][4] =
+    {
+        { 0.0f, 0.0f, 1.0f, 0.0f },
+        { 0.0f, 0.0f, 0.0f, 1.0f },
+        { 1.0f, 0.0f, 0.0f, OCCLUSION_GUARD_BAND },
+        { -1.0f, 0.0f, 0.0f, OCCLUSION_GUARD_BAND },
+        { 0.0f, 1.0f, 0.0f, OCCLUSION_GUARD_BAND },
+        { 0.0f, -1.0f, 0.0f, OCCLUSION_GUARD_BAND }
+    };
+    static const float offsets[6] = { 0.0f, -OCCLUSION_MIN_W, 0.0f, 0.0f, 0.0f, 0.0f };
+
+    Vector4 polygon[2][OCCLUSION_MAX_CLIP_VERTICES];
+    polygon[0][0] = v0;
+    polygon[0][1] = v1;
+    polygon[0][2] = v2;
+    unsigned int count = 3;
+    unsigned int current = 0;
+
+    for (unsigned int p = 0; p < 6; ++p)
+    {
+        const float* plane = planes[p];
+        float distances[OCCLUSION_MAX_CLIP_VERTICES];
+        unsigned int inside = 0;
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            const Vector4& v = polygon[current][i];
+            distances[i] = plane[0] * v.x + plane[1] * v.y + plane[2] * v.z + plane[3] * v.w + offsets[p];
+            if (distances[i] >= 0.0f)
+                ++inside;
+        }
+        if (inside == 0)
+            return;
+        if (inside == count)
+            continue;
+
+        // Sutherland-Hodgman clipping against the plane.
+        const Vector4* src = polygon[current];
+        Vector4* dst = polygon[current ^ 1];
+        unsigned int clipped = 0;
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            unsigned int j = (i + 1) % count;
+            if (distances[i] >= 0.0f)
+                dst[clipped++] = src[i];
+            if ((distances[i] >= 0.0f) != (distances[j] >= 0.0f))
+            {
+                float t = distances[i] / (distances[i] - distances[j]);
+                dst[clipped++] = src[i] + (src[j] - src[i]) * t;
+            }
+        }
+        GP_ASSERT(clipped <= OCCLUSION_MAX_CLIP_VERTICES);
+        count = clipped;
+        current ^= 1;
+    }
+
+    for (unsigned int i = 1; i + 1 < count; ++i)
+    {
+        setupTriangle(polygon[current][0], polygon[current][i], polygon[current][i + 1]);
+    }
+}
+
+void OcclusionCuller::setupTriangle(const Vector4& v0, const Vector4& v1, const Vector4& v2)
+{
+    // Project to pixels, with y down from the top of the view.
+    float x[3], y[3], z[3];
+    const Vector4* v[3] = { &v0, &v1, &v2 };
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+        float invW = 1.0f / v[i]->w;
+        x[i] = (v[i]->x * invW * 0.5f + 0.5f) * _width;
+        y[i] = (0.5f - v[i]->y * invW * 0.5f) * _height;
+        z[i] = v[i]->z * invW;
+    }
+
+    // Both sides of the triangles are rasterized, so orient them all the same way.
+    float area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+    if (fabsf(area) < MATH_FLOAT_SMALL)
+        return;
+    if (area < 0.0f)
+    {
+        std::swap(x[1], x[2]);
+        std::swap(y[1], y[2]);
+        std::swap(z[1], z[2]);
+        area = -area;
+    }
+
+    Triangle triangle;
+    triangle.minX = std::max((int)floorf(std::min(x[0], std::min(x[1], x[2]))), 0);
+    triangle.minY = std::max((int)floorf(std::min(y[0], std::min(y[1], y[2]))), 0);
+    triangle.maxX = std::min((int)ceilf(std::max(x[0], std::max(x[1], x[2]))) - 1, (int)_width - 1);
+    triangle.maxY = std::min((int)ceilf(std::max(y[0], std::max(y[1], y[2]))) - 1, (int)_height - 1);
+    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+        return;
+
+    // Edge functions evaluated at integer pixel coordinates: positive when the whole
+    // pixel square is inside the edge, so the pixel center is offset by half a pixel and
+    // the edge moved in by the half extent of the pixel along its normal.
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+        unsigned int j = (i + 1) % 3;
+        float a = y[i] - y[j];
+        float b = x[j] - x[i];
+        float c = x[i] * y[j] - y[i] * x[j];
+        triangle.edges[i][0] = a;
+        triangle.edges[i][1] = b;
+        triangle.edges[i][2] = c + 0.5f * (a + b) - 0.5f * (fabsf(a) + fabsf(b));
+    }
+
+    // The depth plane, moved back to the farthest depth over each pixel.
+    float dzdx = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+    float dzdy = ((x[1] - x[0]) * (z[2] - z[0]) - (x[2] - x[0]) * (z[1] - z[0])) / area;
+    triangle.depth[0] = z[0] - dzdx * x[0] - dzdy * y[0] + 0.5f * (dzdx + dzdy) + 0.5f * (fabsf(dzdx) + fabsf(dzdy));
+    triangle.depth[1] = dzdx;
+    triangle.depth[2] = dzdy;
+
+    _triangles.push_back(triangle);
+}
+
+void OcclusionCuller::end()
+{
+    // Bin the triangles by the tiles they overlap.
+    unsigned int tileCount = _tilesX * _tilesY;
+    for (unsigned int t = 0; t < tileCount; ++t)
+        _bins[t].clear();
+    for (size_t i = 0, count = _triangles.size(); i < count; ++i)
+    {
+        const Triangle& triangle = _triangles[i];
+        unsigned int tx1 = triangle.maxX / OCCLUSION_TILE_WIDTH;
+        unsigned int ty1 = triangle.maxY / OCCLUSION_TILE_HEIGHT;
+        for (unsigned int ty = triangle.minY / OCCLUSION_TILE_HEIGHT; ty <= ty1; ++ty)
+        {
+            for (unsigned int tx = triangle.minX / OCCLUSION_TILE_WIDTH; tx <= tx1; ++tx)
+                _bins[ty * _tilesX + tx].push_back((unsigned int)i);
+        }
+    }
+
+    // Tiles cover disjoint pixels and blocks, so they are rasterized independently.
+    if (_jobSystem && tileCount > 1 && !_triangles.empty())
+    {
+        vkTools::JobHandle job = _jobSystem->parallelFor(tileCount, 1, [this](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t t = begin; t < end; ++t)
+                rasterizeTile(t);
+        });
+        _jobSystem->wait(job);
+    }
+    else
+    {
+        for (unsigned int t = 0; t < tileCount; ++t)
+            rasterizeTile(t);
+    }
+}
+
+void OcclusionCuller::rasterizeTile(unsigned int tile)
+{
+    int tileX = (int)(tile % _tilesX) * OCCLUSION_TILE_WIDTH;
+    int tileY = (int)(tile / _tilesX) * OCCLUSION_TILE_HEIGHT;
+    int tileMaxX = std::min(tileX + OCCLUSION_TILE_WIDTH, (int)_width) - 1;
+    int tileMaxY = std::min(tileY + OCCLUSION_TILE_HEIGHT, (int)_height) - 1;
+
+    for (int y = tileY; y <= tileMaxY; ++y)
+    {
+        float* row = _depth + y * _width;
+        for (int x = tileX; x <= tileMaxX; ++x)
+            row[x] = FLT_MAX;
+    }
+
+    const std::vector<unsigned int>& bin = _bins[tile];
+    for (size_t i = 0, count = bin.size(); i < count; ++i)
+    {
+        const Triangle& t = _triangles[bin[i]];
+        int minX = std::max(t.minX, tileX);
+        int maxX = std::min(t.maxX, tileMaxX);
+        int minY = std::max(t.minY, tileY);
+        int maxY = std::min(t.maxY, tileMaxY);
+
+#ifdef GP_USE_SSE
+        // Rows are processed four pixels at a time. Tiles start on multiples of four, so
+        // the pixels outside of the bounds of the triangle are still inside the tile, and
+        // are rejected by the edge functions.
+        minX &= ~3;
+        __m128 a0 = _mm_set1_ps(t.edges[0][0]), b0 = _mm_set1_ps(t.edges[0][1]), c0 = _mm_set1_ps(t.edges[0][2]);
+        __m128 a1 = _mm_set1_ps(t.edges[1][0]), b1 = _mm_set1_ps(t.edges[1][1]), c1 = _mm_set1_ps(t.edges[1][2]);
+        __m128 a2 = _mm_set1_ps(t.edges[2][0]), b2 = _mm_set1_ps(t.edges[2][1]), c2 = _mm_set1_ps(t.edges[2][2]);
+        __m128 dx = _mm_set1_ps(t.depth[1]), dy = _mm_set1_ps(t.depth[2]), z0 = _mm_set1_ps(t.depth[0]);
+        __m128 zero = _mm_setzero_ps();
+        for (int y = minY; y <= maxY; ++y)
+        {
+            __m128 fy = _mm_set1_ps((float)y);
+            __m128 r0 = _mm_add_ps(_mm_mul_ps(b0, fy), c0);
+            __m128 r1 = _mm_add_ps(_mm_mul_ps(b1, fy), c1);
+            __m128 r2 = _mm_add_ps(_mm_mul_ps(b2, fy), c2);
+            __m128 rz = _mm_add_ps(_mm_mul_ps(dy, fy), z0);
+            float* row = _depth + y * _width;
+            for (int x = minX; x <= maxX; x += 4)
+            {
+                __m128 fx = _mm_setr_ps((float)x, (float)(x + 1), (float)(x + 2), (float)(x + 3));
+                __m128 inside = _mm_and_ps(_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a0, fx), r0), zero),
+                                _mm_and_ps(_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a1, fx), r1), zero),
+                                           _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a2, fx), r2), zero)));
+                if (_mm_movemask_ps(inside) == 0)
+                    continue;
+
+                __m128 depth = _mm_loadu_ps(row + x);
+                __m128 z = _mm_min_ps(depth, _mm_add_ps(_mm_mul_ps(dx, fx), rz));
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, z), _mm_andnot_ps(inside, depth)));
+            }
+        }
+#else
+        for (int y = minY; y <= maxY; ++y)
+        {
+            float* row = _depth + y * _width;
+            for (int x = minX; x <= maxX; ++x)
+            {
+                float fx = (float)x;
+                float fy = (float)y;
+                if (t.edges[0][0] * fx + t.edges[0][1] * fy + t.edges[0][2] >= 0.0f &&
+                    t.edges[1][0] * fx + t.edges[1][1] * fy + t.edges[1][2] >= 0.0f &&
+                    t.edges[2][0] * fx + t.edges[2][1] * fy + t.edges[2][2] >= 0.0f)
+                {
+                    row[x] = std::min(row[x], t.depth[0] + t.depth[1] * fx + t.depth[2] * fy);
+                }
+            }
+        }
+#endif
+    }
+
+    // Build the coarse level for the blocks of this tile.
+    unsigned int blocksX = _width / OCCLUSION_BLOCK_SIZE;
+    for (int by = tileY; by <= tileMaxY; by += OCCLUSION_BLOCK_SIZE)
+    {
+        for (int bx = tileX; bx <= tileMaxX; bx += OCCLUSION_BLOCK_SIZE)
+        {
+            float farthest = 0.0f;
+            for (int y = by; y < by + OCCLUSION_BLOCK_SIZE; ++y)
+            {
+                const float* row = _depth + y * _width + bx;
+                for (int x = 0; x < OCCLUSION_BLOCK_SIZE; ++x)
+                    farthest = std::max(farthest, row[x]);
+            }
+            _blocks[(by / OCCLUSION_BLOCK_SIZE) * blocksX + bx / OCCLUSION_BLOCK_SIZE] = farthest;
+        }
+    }
+}
+
+bool OcclusionCuller::isVisible(const BoundingBox& box) const
+{
+    float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX, minZ = FLT_MAX;
+    const Matrix& m = _viewProjection;
+    for (unsigned int i = 0; i < 8; ++i)
+    {
+        float px = (i & 1) ? box.max.x : box.min.x;
+        float py = (i & 2) ? box.max.y : box.min.y;
+        float pz = (i & 4) ? box.max.z : box.min.z;
+        float w = m.m[3] * px + m.m[7] * py + m.m[11] * pz + m.m[15];
+
+        // A box that reaches behind the camera cannot be bounded on screen.
+        if (w < OCCLUSION_MIN_W)
+            return true;
+
+        float invW = 1.0f / w;
+        float x = ((m.m[0] * px + m.m[4] * py + m.m[8] * pz + m.m[12]) * invW * 0.5f + 0.5f) * _width;
+        float y = (0.5f - (m.m[1] * px + m.m[5] * py + m.m[9] * pz + m.m[13]) * invW * 0.5f) * _height;
+        float z = (m.m[2] * px + m.m[6] * py + m.m[10] * pz + m.m[14]) * invW;
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        minZ = std::min(minZ, z);
+    }
+
+    // The pixels the screen bounds overlap, clamped to the view.
+    if (maxX < 0.0f || maxY < 0.0f || minX >= (float)_width || minY >= (float)_height)
+        return false;
+    int x0 = std::max((int)floorf(minX), 0);
+    int y0 = std::max((int)floorf(minY), 0);
+    int x1 = std::min((int)floorf(maxX), (int)_width - 1);
+    int y1 = std::min((int)floorf(maxY), (int)_height - 1);
+
+    return !isOccluded(x0, y0, x1, y1, minZ);
+}
+
+bool OcclusionCuller::isVisible(const BoundingSphere& sphere) const
+{
+    BoundingBox box;
+    box.set(sphere);
+    return isVisible(box);
+}
+
+bool OcclusionCuller::isOccluded(int minX, int minY, int maxX, int maxY, float depth) const
+{
+    // Large rectangles read the farthest depth of whole blocks, which is conservative.
+    if ((maxX - minX + 1) * (maxY - minY + 1) > OCCLUSION_BLOCK_SIZE * OCCLUSION_BLOCK_SIZE)
+    {
+        unsigned int blocksX = _width / OCCLUSION_BLOCK_SIZE;
+        for (int by = minY / OCCLUSION_BLOCK_SIZE; by <= maxY / OCCLUSION_BLOCK_SIZE; ++by)
+        {
+            const float* row = _blocks + by * blocksX;
+            for (int bx = minX / OCCLUSION_BLOCK_SIZE; bx <= maxX / OCCLUSION_BLOCK_SIZE; ++bx)
+            {
+                if (row[bx] >= depth)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    for (int y = minY; y <= maxY; ++y)
+    {
+        const float* row = _depth + y * _width;
+        for (int x = minX; x <= maxX; ++x)
+        {
+            if (row[x] >= depth)
+                return false;
+        }
+    }
+    return true;
+}
+
+bool OcclusionCuller::isVisible(const Node* node) const
+{
+    GP_ASSERT(node);
+
+    const BoundingSphere& sphere = node->getBoundingSphere();
+    return sphere.radius == 0.0f || isVisible(sphere);
+}
+
+unsigned int OcclusionCuller::cull(Node* const* nodes, unsigned int count, std::vector<Node*>& visible) const
+{
+    GP_ASSERT(nodes || count == 0);
+
+    size_t first = visible.size();
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        if (isVisible(nodes[i]))
+            visible.push_back(nodes[i]);
+    }
+    return (unsigned int)(visible.size() - first);
+}
+
+unsigned int OcclusionCuller::getWidth() const
+{
+    return _width;
+}
+
+unsigned int OcclusionCuller::getHeight() const
+{
+    return _height;
+}
+
+const float* OcclusionCuller::getDepthBuffer() const
+{
+    return _depth;
+}
+
+}
@@ -0,0 +1,309 @@
+#ifndef OCCLUSIONCULLER_H_
+#define OCCLUSIONCULLER_H_
+
+#include "Ref.h"
+#include "Mesh.h"
+#include "Matrix.h"
+#include "BoundingBox.h"
+#include "BoundingSphere.h"
+
+namespace vkTools
+{
+class JobSystem;
+}
+
+namespace vkcore
+{
+
+class Node;
+
+/**
+ * Defines a software occlusion culler.
+ *
+ * The culler rasterizes a set of occluders, typically large and simple meshes such as
+ * the walls of buildings and the terrain, into a low resolution depth buffer on the CPU,
+ * then tests the screen-space bounds of other objects against it. Objects entirely
+ * behind the occluders are culled before any command buffer is recorded, with no GPU
+ * query and no frame of latency. The culler does not need a graphics device.
+ *
+ * The depth buffer is conservative: a pixel only holds the depth of a triangle that
+ * covers it entirely, and the farthest depth of the triangle over the pixel. An object
+ * is only reported as occluded if every pixel its screen bounds overlap holds a depth
+ * nearer than the nearest point of its bounds, so culling never removes a visible object.
+ *
+ * The depth buffer is split into tiles that are rasterized in parallel on a job system,
+ * four pixels at a time with SIMD instructions when available. Tests of large screen
+ * rectangles read a coarser level of the buffer that holds the farthest depth of each
+ * block of 8x8 pixels.
+ *
+ * Depths are normalized device depths (z / w), so the view projection must map nearer
+ * points to smaller depths, as the perspective and orthographic projections of Matrix do.
+ * Occluders are clipped where the depth is 0: at the near plane for projections with
+ * depths from 0 to 1, such as createPerspectiveVK, and beyond it for those with depths
+ * from -1 to 1, which only culls less.
+ */
+class OcclusionCuller
+{
+public:
+
+    /**
+     * Defines the geometry of an occluder.
+     *
+     * An occluder holds a copy of the positions and triangles of a mesh. It may be shared
+     * by any number of instances, each added to the culler with its own world matrix.
+     * Occluders should be simplified versions of the meshes they stand for, entirely
+     * inside of them, since any part of an occluder that sticks out of its mesh hides
+     * objects that are in fact visible.
+     */
+    class Occluder : public Ref
+    {
+        friend class OcclusionCuller;
+
+    public:
+
+        /**
+         * Creates an occluder from a triangle list.
+         *
+         * @param vertexFormat The format of the vertices, which must have a POSITION element with 3 components.
+         * @param vertexData The vertices.
+         * @param vertexCount The number of vertices.
+         * @param indexFormat The format of the indices.
+         * @param indexData The indices, or NULL if the vertices are not indexed.
+         * @param indexCount The number of indices.
+         *
+         * @return The new occluder, or NULL if the vertex format has no position.
+         * @script{ignore}
+         */
+        static Occluder* create(const VertexFormat& vertexFormat, const void* vertexData, unsigned int vertexCount,
+                                Mesh::IndexFormat indexFormat = Mesh::INDEX16, const void* indexData = NULL, unsigned int indexCount = 0);
+
+        /**
+         * Creates an occluder from the triangle list parts of a mesh.
+         *
+         * The vertices and indices of meshes are only kept on the GPU, so their data must
+         * be provided, as loaded or generated for the mesh.
+         *
+         * @param mesh The mesh, which gives the vertex format and the index formats and counts.
+         * @param vertexData The vertices of the mesh.
+         * @param indexData The indices of each part of the mesh, or NULL if the mesh has no parts.
+         *
+         * @return The new occluder, or NULL if the mesh cannot be used as an occluder.
+         * @script{ignore}
+         */
+        static Occluder* create(Mesh* mesh, const void* vertexData, const void** indexData);
+
+        /**
+         * Gets the number of triangles of this occluder.
+         *
+         * @return The triangle count.
+         */
+        unsigned int getTriangleCount() const;
+
+    private:
+
+        /**
+         * Constructor.
+         */
+        Occluder();
+
+        /**
+         * Destructor.
+         */
+        ~Occluder();
+
+        /**
+         * Hidden copy constructor.
+         */
+        Occluder(const Occluder& copy);
+
+        /**
+         * Hidden copy assignment operator.
+         */
+        Occluder& operator=(const Occluder&);
+
+        /**
+         * Appends the triangles of a triangle list.
+         */
+        void addTriangles(const float* positions, unsigned int stride, unsigned int vertexCount,
+                          Mesh::IndexFormat indexFormat, const void* indexData, unsigned int indexCount);
+
+        std::vector<Vector3> _positions;        // The vertex positions.
+        std::vector<unsigned int> _indices;     // Three vertex indices per triangle.
+    };
+
+    /**
+     * Constructor.
+     *
+     * @param width The width of the depth buffer, rounded up to a multiple of 8.
+     * @param height The height of the depth buffer, rounded up to a multiple of 8.
+     */
+    OcclusionCuller(unsigned int width = 256, unsigned int height = 128);
+
+    /**
+     * Destructor.
+     */
+    ~OcclusionCuller();
+
+    /**
+     * Sets the job system that the tiles of the depth buffer are rasterized on.
+     *
+     * @param jobSystem The job system to use, or NULL to rasterize on the calling thread.
+     * @script{ignore}
+     */
+    void setJobSystem(vkTools::JobSystem* jobSystem);
+
+    /**
+     * Gets the job system that the tiles of the depth buffer are rasterized on.
+     *
+     * @return The job system, or NULL.
+     * @script{ignore}
+     */
+    vkTools::JobSystem* getJobSystem() const;
+
+    /**
+     * Starts a new frame, dropping the occluders of the previous one.
+     *
+     * @param viewProjection The view projection matrix of the camera.
+     */
+    void begin(const Matrix& viewProjection);
+
+    /**
+     * Adds an instance of an occluder for the current frame.
+     *
+     * The occluder is transformed and set up for rasterization right away; it must only
+     * stay alive until end is called.
+     *
+     * @param occluder The occluder.
+     * @param worldMatrix The world matrix of the instance.
+     */
+    void addOccluder(Occluder* occluder, const Matrix& worldMatrix);
+
+    /**
+     * Rasterizes the occluders of the current frame into the depth buffer.
+     *
+     * Must be called after the occluders are added and before any visibility test.
+     */
+    void end();
+
+    /**
+     * Tests whether a box may be visible behind the occluders.
+     *
+     * @param box The world-space box.
+     *
+     * @return false if the box is entirely behind the occluders or outside of the view; true otherwise.
+     */
+    bool isVisible(const BoundingBox& box) const;
+
+    /**
+     * Tests whether a sphere may be visible behind the occluders.
+     *
+     * @param sphere The world-space sphere.
+     *
+     * @return false if the sphere is entirely behind the occluders or outside of the view; true otherwise.
+     */
+    bool isVisible(const BoundingSphere& sphere) const;
+
+    /**
+     * Tests whether the bounding sphere of a node may be visible behind the occluders.
+     *
+     * Nodes without bounds, such as those of particle emitters, are always visible.
+     *
+     * @param node The node.
+     *
+     * @return false if the node is entirely behind the occluders or outside of the view; true otherwise.
+     */
+    bool isVisible(const Node* node) const;
+
+    /**
+     * Gets the nodes whose bounding spheres may be visible behind the occluders.
+     *
+     * @param nodes The nodes to test, such as the result of a frustum query.
+     * @param count The number of nodes.
+     * @param visible The vector to append the visible nodes to.
+     *
+     * @return The number of nodes appended.
+     * @script{ignore}
+     */
+    unsigned int cull(Node* const* nodes, unsigned int count, std::vector<Node*>& visible) const;
+
+    /**
+     * Gets the width of the depth buffer.
+     *
+     * @return The width, in pixels.
+     */
+    unsigned int getWidth() const;
+
+    /**
+     * Gets the height of the depth buffer.
+     *
+     * @return The height, in pixels.
+     */
+    unsigned int getHeight() const;
+
+    /**
+     * Gets the depth buffer, for debugging.
+     *
+     * @return The depths of the pixels, row by row from the top of the view.
+     */
+    const float* getDepthBuffer() const;
+
+private:
+
+    /**
+     * A triangle set up for rasterization.
+     */
+    struct Triangle
+    {
+        float edges[3][3];  // Edge functions (a, b, c), positive on pixels entirely inside the triangle.
+        float depth[3];     // Farthest depth over a pixel, as a plane (z0, dz/dx, dz/dy).
+        int minX;           // Pixel bounds, inclusive.
+        int minY;
+        int maxX;
+        int maxY;
+    };
+
+    /**
+     * Hidden copy constructor.
+     */
+    OcclusionCuller(const OcclusionCuller& copy);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    OcclusionCuller& operator=(const OcclusionCuller&);
+
+    /**
+     * Sets up a triangle given its vertices in clip space, clipping it against the near plane.
+     */
+    void addTriangle(const Vector4& v0, const Vector4& v1, const Vector4& v2);
+
+    /**
+     * Sets up a triangle given its vertices in front of the camera.
+     */
+    void setupTriangle(const Vector4& v0, const Vector4& v1, const Vector4& v2);
+
+    /**
+     * Rasterizes the triangles that overlap a tile.
+     */
+    void rasterizeTile(unsigned int tile);
+
+    /**
+     * Tests whether a screen rectangle is behind the depth buffer.
+     */
+    bool isOccluded(int minX, int minY, int maxX, int maxY, float depth) const;
+
+    unsigned int _width;                            // The width of the depth buffer.
+    unsigned int _height;                           // The height of the depth buffer.
+    unsigned int _tilesX;                           // The number of tiles along x.
+    unsigned int _tilesY;                           // The number of tiles along y.
+    Matrix _viewProjection;                         // The view projection of the current frame.
+    float* _depth;                                  // The depth buffer.
+    float* _blocks;                                 // The farthest depth of each 8x8 block of pixels.
+    std::vector<Triangle> _triangles;               // The triangles of the current frame.
+    std::vector<std::vector<unsigned int> > _bins;  // The triangles overlapping each tile.
+    vkTools::JobSystem* _jobSystem;                 // The job system tiles are rasterized on.
+};
+
+}
+
+#endif
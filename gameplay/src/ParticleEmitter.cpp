@@ -5,11 +5,18 @@
 #include "Scene.h"
 #include "Quaternion.h"
 #include "Properties.h"
+#include "MathUtil.h"
+#include "jobsystem.hpp"
+
+#ifdef GP_USE_SSE
+#include <emmintrin.h>
+#endif
 
 #define PARTICLE_COUNT_MAX                       100
 #define PARTICLE_EMISSION_RATE                   10
 #define PARTICLE_EMISSION_RATE_TIME_INTERVAL     1000.0f / (float)PARTICLE_EMISSION_RATE
 #define PARTICLE_UPDATE_RATE_MAX                 8
+#define PARTICLE_JOB_GRAIN                       1024
 
 namespace vkcore
 {
@@ -25,20 +32,21 @@ ParticleEmitter::ParticleEmitter(unsigned int particleCountMax) : Drawable(),
     _acceleration(Vector3::zero()), _accelerationVar(Vector3::zero()),
     _rotationPerParticleSpeedMin(0.0f), _rotationPerParticleSpeedMax(0.0f),
     _rotationSpeedMin(0.0f), _rotationSpeedMax(0.0f),
-    _rotationAxis(Vector3::zero()), _rotation(Matrix::identity()),
+    _rotationAxis(Vector3::zero()),
     _spriteBatch(NULL), _spriteBlendMode(BLEND_ALPHA),  _spriteTextureWidth(0), _spriteTextureHeight(0), _spriteTextureWidthRatio(0), _spriteTextureHeightRatio(0), _spriteTextureCoords(NULL),
     _spriteAnimated(false),  _spriteLooped(false), _spriteFrameCount(1), _spriteFrameRandomOffset(0),_spriteFrameDuration(0L), _spriteFrameDurationSecs(0.0f), _spritePercentPerFrame(0.0f),
     _orbitPosition(false), _orbitVelocity(false), _orbitAcceleration(false),
-    _timePerEmission(PARTICLE_EMISSION_RATE_TIME_INTERVAL), _emitTime(0), _lastUpdated(0)
+    _timePerEmission(PARTICLE_EMISSION_RATE_TIME_INTERVAL), _emitTime(0), _updateTime(0), _random(1), _jobSystem(NULL)
 {
     GP_ASSERT(particleCountMax);
-    _particles = new Particle[particleCountMax];
+    setRandomSeed((unsigned int)rand());
+    _particles = new Particles(particleCountMax);
 }
 
 ParticleEmitter::~ParticleEmitter()
 {
     SAFE_DELETE(_spriteBatch);
-    SAFE_DELETE_ARRAY(_particles);
+    SAFE_DELETE(_particles);
     SAFE_DELETE_ARRAY(_spriteTextureCoords);
 }
 
@@ -273,7 +281,7 @@ void ParticleEmitter::setEmissionRate(unsigned int rate)
 void ParticleEmitter::start()
 {
     _started = true;
-    _lastUpdated = 0;
+    _updateTime = 0;
 }
 
 void ParticleEmitter::stop()
@@ -318,63 +326,88 @@ void ParticleEmitter::emitOnce(unsigned int particleCount)
     world.m[14] = 0.0f;
 
     // Emit the new particles.
+    Particles* p = _particles;
     for (unsigned int i = 0; i < particleCount; i++)
     {
-        Particle* p = &_particles[_particleCount];
+        unsigned int index = _particleCount;
 
-        generateColor(_colorStart, _colorStartVar, &p->_colorStart);
-        generateColor(_colorEnd, _colorEndVar, &p->_colorEnd);
-        p->_color.set(p->_colorStart);
+        Vector4 colorStart;
+        Vector4 colorEnd;
+        generateColor(_colorStart, _colorStartVar, &colorStart);
+        generateColor(_colorEnd, _colorEndVar, &colorEnd);
 
-        p->_energy = p->_energyStart = generateScalar(_energyMin, _energyMax);
-        p->_size = p->_sizeStart = generateScalar(_sizeStartMin, _sizeStartMax);
-        p->_sizeEnd = generateScalar(_sizeEndMin, _sizeEndMax);
-        p->_rotationPerParticleSpeed = generateScalar(_rotationPerParticleSpeedMin, _rotationPerParticleSpeedMax);
-        p->_angle = generateScalar(0.0f, p->_rotationPerParticleSpeed);
-        p->_rotationSpeed = generateScalar(_rotationSpeedMin, _rotationSpeedMax);
+        p->energy[index] = p->energyStart[index] = generateScalar(_energyMin, _energyMax);
+        p->size[index] = p->sizeStart[index] = generateScalar(_sizeStartMin, _sizeStartMax);
+        p->sizeEnd[index] = generateScalar(_sizeEndMin, _sizeEndMax);
+        float rotationPerParticleSpeed = generateScalar(_rotationPerParticleSpeedMin, _rotationPerParticleSpeedMax);
+        p->rotationPerParticleSpeed[index] = rotationPerParticleSpeed;
+        p->angle[index] = generateScalar(0.0f, rotationPerParticleSpeed);
+        p->rotationSpeed[index] = generateScalar(_rotationSpeedMin, _rotationSpeedMax);
 
         // Only initial position can be generated within an ellipsoidal domain.
-        generateVector(_position, _positionVar, &p->_position, _ellipsoid);
-        generateVector(_velocity, _velocityVar, &p->_velocity, false);
-        generateVector(_acceleration, _accelerationVar, &p->_acceleration, false);
-        generateVector(_rotationAxis, _rotationAxisVar, &p->_rotationAxis, false);
+        Vector3 position;
+        Vector3 velocity;
+        Vector3 acceleration;
+        Vector3 rotationAxis;
+        generateVector(_position, _positionVar, &position, _ellipsoid);
+        generateVector(_velocity, _velocityVar, &velocity, false);
+        generateVector(_acceleration, _accelerationVar, &acceleration, false);
+        generateVector(_rotationAxis, _rotationAxisVar, &rotationAxis, false);
 
         // Initial position, velocity and acceleration can all be relative to the emitter's transform.
         // Rotate specified properties by the node's rotation.
         if (_orbitPosition)
         {
-            world.transformPoint(p->_position, &p->_position);
+            world.transformPoint(position, &position);
         }
 
         if (_orbitVelocity)
         {
-            world.transformPoint(p->_velocity, &p->_velocity);
+            world.transformPoint(velocity, &velocity);
         }
 
         if (_orbitAcceleration)
         {
-            world.transformPoint(p->_acceleration, &p->_acceleration);
+            world.transformPoint(acceleration, &acceleration);
         }
 
-        // The rotation axis always orbits the node.
-        if (p->_rotationSpeed != 0.0f && !p->_rotationAxis.isZero())
+        // The rotation axis always orbits the node. It is normalized once here, rather than
+        // on every update.
+        if (p->rotationSpeed[index] != 0.0f && !rotationAxis.isZero())
         {
-            world.transformPoint(p->_rotationAxis, &p->_rotationAxis);
+            world.transformPoint(rotationAxis, &rotationAxis);
+            float n = rotationAxis.lengthSquared();
+            if (n > 0.000001f * 0.000001f)
+                rotationAxis.scale(1.0f / sqrt(n));
         }
 
         // Translate position relative to the node's world space.
-        p->_position.add(translation);
+        position.add(translation);
+
+        for (unsigned int c = 0; c < 4; ++c)
+        {
+            p->colorStart[c][index] = (&colorStart.x)[c];
+            p->colorEnd[c][index] = (&colorEnd.x)[c];
+            p->color[c][index] = (&colorStart.x)[c];
+        }
+        for (unsigned int c = 0; c < 3; ++c)
+        {
+            p->position[c][index] = (&position.x)[c];
+            p->velocity[c][index] = (&velocity.x)[c];
+            p->acceleration[c][index] = (&acceleration.x)[c];
+            p->rotationAxis[c][index] = (&rotationAxis.x)[c];
+        }
 
         // Initial sprite frame.
         if (_spriteFrameRandomOffset > 0)
         {
-            p->_frame = rand() % _spriteFrameRandomOffset;
+            p->frame[index] = generateRandom() % _spriteFrameRandomOffset;
         }
         else
         {
-            p->_frame = 0;
+            p->frame[index] = 0;
         }
-        p->_timeOnCurrentFrame = 0.0f;
+        p->timeOnCurrentFrame[index] = 0.0f;
 
         ++_particleCount;
     }
@@ -744,17 +777,37 @@ bool ParticleEmitter::getOrbitAcceleration() const
     return _orbitAcceleration;
 }
 
-long ParticleEmitter::generateScalar(long min, long max)
+void ParticleEmitter::setRandomSeed(unsigned int seed)
 {
-    // Note: this is not a very good RNG, but it should be suitable for our purposes.
-    long r = 0;
-    for (unsigned int i = 0; i < sizeof(long)/sizeof(int); i++)
-    {
-        r = r << 8; // sizeof(int) * CHAR_BITS
-        r |= rand();
-    }
+    // Xorshift gets stuck at zero, so map that seed to another value.
+    _random = seed ? seed : 0x9E3779B9;
+}
 
-    // Now we have a random long between 0 and MAX_LONG.  We need to clamp it between min and max.
+unsigned int ParticleEmitter::generateRandom()
+{
+    // Xorshift32: cheap, and the sequence depends only on the emitter's seed.
+    unsigned int x = _random;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    _random = x;
+    return x;
+}
+
+float ParticleEmitter::generateRandom01()
+{
+    return (float)(generateRandom() >> 8) * (1.0f / 16777215.0f);
+}
+
+float ParticleEmitter::generateRandomMinus1To1()
+{
+    return generateRandom01() * 2.0f - 1.0f;
+}
+
+long ParticleEmitter::generateScalar(long min, long max)
+{
+    // Clamp a random long between 0 and LONG_MAX between min and max.
+    long r = (long)(generateRandom() & 0x7FFFFFFF);
     r %= max - min;
     r += min;
 
@@ -763,7 +816,7 @@ long ParticleEmitter::generateScalar(long min, long max)
 
 float ParticleEmitter::generateScalar(float min, float max)
 {
-    return min + (max - min) * MATH_RANDOM_0_1();
+    return min + (max - min) * generateRandom01();
 }
 
 void ParticleEmitter::generateVectorInRect(const Vector3& base, const Vector3& variance, Vector3* dst)
@@ -772,9 +825,9 @@ void ParticleEmitter::generateVectorInRect(const Vector3& base, const Vector3& v
 
     // Scale each component of the variance vector by a random float
     // between -1 and 1, then add this to the corresponding base component.
-    dst->x = base.x + variance.x * MATH_RANDOM_MINUS1_1();
-    dst->y = base.y + variance.y * MATH_RANDOM_MINUS1_1();
-    dst->z = base.z + variance.z * MATH_RANDOM_MINUS1_1();
+    dst->x = base.x + variance.x * generateRandomMinus1To1();
+    dst->y = base.y + variance.y * generateRandomMinus1To1();
+    dst->z = base.z + variance.z * generateRandomMinus1To1();
 }
 
 void ParticleEmitter::generateVectorInEllipsoid(const Vector3& center, const Vector3& scale, Vector3* dst)
@@ -784,9 +837,9 @@ void ParticleEmitter::generateVectorInEllipsoid(const Vector3& center, const Vec
     // Generate a point within a unit cube, then reject if the point is not in a unit sphere.
     do
     {
-        dst->x = MATH_RANDOM_MINUS1_1();
-        dst->y = MATH_RANDOM_MINUS1_1();
-        dst->z = MATH_RANDOM_MINUS1_1();
+        dst->x = generateRandomMinus1To1();
+        dst->y = generateRandomMinus1To1();
+        dst->z = generateRandomMinus1To1();
     } while (dst->length() > 1.0f);
     
     // Scale this point by the scaling vector.
@@ -816,10 +869,10 @@ void ParticleEmitter::generateColor(const Vector4& base, const Vector4& variance
 
     // Scale each component of the variance color by a random float
     // between -1 and 1, then add this to the corresponding base component.
-    dst->x = base.x + variance.x * MATH_RANDOM_MINUS1_1();
-    dst->y = base.y + variance.y * MATH_RANDOM_MINUS1_1();
-    dst->z = base.z + variance.z * MATH_RANDOM_MINUS1_1();
-    dst->w = base.w + variance.w * MATH_RANDOM_MINUS1_1();
+    dst->x = base.x + variance.x * generateRandomMinus1To1();
+    dst->y = base.y + variance.y * generateRandomMinus1To1();
+    dst->z = base.z + variance.z * generateRandomMinus1To1();
+    dst->w = base.w + variance.w * generateRandomMinus1To1();
 }
 
 ParticleEmitter::BlendMode ParticleEmitter::getBlendModeFromString(const char* str)
@@ -858,26 +911,94 @@ ParticleEmitter::BlendMode ParticleEmitter::getBlendModeFromString(const char* s
 
 void ParticleEmitter::update(float elapsedTime)
 {
-    if (!isActive())
+    float elapsedMs;
+    if (!beginUpdate(elapsedTime, &elapsedMs))
         return;
 
+    // Now update all currently living particles.
+    if (_jobSystem && _particleCount > PARTICLE_JOB_GRAIN)
+    {
+        vkTools::JobHandle job = _jobSystem->parallelFor(_particleCount, PARTICLE_JOB_GRAIN, [this, elapsedMs](uint32_t begin, uint32_t end)
+        {
+            updateParticles(begin, end, elapsedMs);
+        });
+        _jobSystem->wait(job);
+    }
+    else
+    {
+        updateParticles(0, _particleCount, elapsedMs);
+    }
+    removeDeadParticles();
+}
+
+void ParticleEmitter::update(ParticleEmitter** emitters, unsigned int emitterCount, float elapsedTime, vkTools::JobSystem& jobSystem)
+{
+    GP_ASSERT(emitters || emitterCount == 0);
+
+    // A range of the particles of one emitter, updated by a single job.
+    struct Chunk
+    {
+        ParticleEmitter* emitter;
+        unsigned int begin;
+        unsigned int end;
+        float elapsedMs;
+    };
+
+    // Emit on this thread, then split the living particles of all emitters into chunks.
+    std::vector<Chunk> chunks;
+    std::vector<ParticleEmitter*> updated;
+    for (unsigned int i = 0; i < emitterCount; ++i)
+    {
+        ParticleEmitter* emitter = emitters[i];
+        GP_ASSERT(emitter);
+
+        float elapsedMs;
+        if (!emitter->beginUpdate(elapsedTime, &elapsedMs))
+            continue;
+
+        updated.push_back(emitter);
+        for (unsigned int begin = 0; begin < emitter->_particleCount; begin += PARTICLE_JOB_GRAIN)
+        {
+            Chunk chunk = { emitter, begin, std::min(begin + PARTICLE_JOB_GRAIN, emitter->_particleCount), elapsedMs };
+            chunks.push_back(chunk);
+        }
+    }
+
+    Chunk* data = chunks.data();
+    vkTools::JobHandle job = jobSystem.parallelFor((uint32_t)chunks.size(), 1, [data](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; ++i)
+            data[i].emitter->updateParticles(data[i].begin, data[i].end, data[i].elapsedMs);
+    });
+    jobSystem.wait(job);
+
+    for (size_t i = 0, count = updated.size(); i < count; ++i)
+    {
+        updated[i]->removeDeadParticles();
+    }
+}
+
+bool ParticleEmitter::beginUpdate(float elapsedTime, float* elapsedMs)
+{
+    GP_ASSERT(elapsedMs);
+
+    if (!isActive())
+        return false;
+
     // Cap particle updates at a maximum rate. This saves processing
     // and also improves precision since updating with very small
     // time increments is more lossy.
-    static double runningTime = 0;
-    runningTime += elapsedTime;
-    if (runningTime < PARTICLE_UPDATE_RATE_MAX)
-        return;    
-
-    float elapsedMs = runningTime;
-    runningTime = 0;
+    _updateTime += elapsedTime;
+    if (_updateTime < PARTICLE_UPDATE_RATE_MAX)
+        return false;
 
-    float elapsedSecs = elapsedMs * 0.001f;
+    *elapsedMs = _updateTime;
+    _updateTime = 0;
 
     if (_started && _emissionRate)
     {
         // Calculate how much time has passed since we last emitted particles.
-        _emitTime += elapsedMs; //+= elapsedTime;
+        _emitTime += *elapsedMs;
 
         // How many particles should we emit this frame?
         GP_ASSERT(_timePerEmission);
@@ -892,91 +1013,208 @@ void ParticleEmitter::update(float elapsedTime)
             emitOnce(emitCount);
         }
     }
+    return true;
+}
 
-    // Now update all currently living particles.
+void ParticleEmitter::setJobSystem(vkTools::JobSystem* jobSystem)
+{
+    _jobSystem = jobSystem;
+}
+
+vkTools::JobSystem* ParticleEmitter::getJobSystem() const
+{
+    return _jobSystem;
+}
+
+void ParticleEmitter::updateParticles(unsigned int begin, unsigned int end, float elapsedMs)
+{
     GP_ASSERT(_particles);
-    for (unsigned int particlesIndex = 0; particlesIndex < _particleCount; ++particlesIndex)
-    {
-        Particle* p = &_particles[particlesIndex];
-        p->_energy -= elapsedMs;
+    GP_ASSERT(end <= _particleCount);
 
-        if (p->_energy > 0L)
-        {
-            if (p->_rotationSpeed != 0.0f && !p->_rotationAxis.isZero())
-            {
-                Matrix::createRotation(p->_rotationAxis, p->_rotationSpeed * elapsedSecs, &_rotation);
+    Particles* p = _particles;
+    float elapsedSecs = elapsedMs * 0.001f;
 
-                _rotation.transformPoint(p->_velocity, &p->_velocity);
-                _rotation.transformPoint(p->_acceleration, &p->_acceleration);
-            }
+    // Rotate the velocity and acceleration of particles that rotate about an axis.
+    for (unsigned int i = begin; i < end; ++i)
+    {
+        float speed = p->rotationSpeed[i];
+        float x = p->rotationAxis[0][i];
+        float y = p->rotationAxis[1][i];
+        float z = p->rotationAxis[2][i];
+        if (speed == 0.0f || (x == 0.0f && y == 0.0f && z == 0.0f))
+            continue;
+
+        // Rodrigues' rotation formula; the same rotation as Matrix::createRotation about the normalized axis.
+        float angle = speed * elapsedSecs;
+        float c = cos(angle);
+        float s = sin(angle);
+        float t = 1.0f - c;
+        float* vectors[2][3] = { { p->velocity[0], p->velocity[1], p->velocity[2] }, { p->acceleration[0], p->acceleration[1], p->acceleration[2] } };
+        for (unsigned int v = 0; v < 2; ++v)
+        {
+            float vx = vectors[v][0][i];
+            float vy = vectors[v][1][i];
+            float vz = vectors[v][2][i];
+            float dot = t * (x * vx + y * vy + z * vz);
+            vectors[v][0][i] = vx * c + (y * vz - z * vy) * s + x * dot;
+            vectors[v][1][i] = vy * c + (z * vx - x * vz) * s + y * dot;
+            vectors[v][2][i] = vz * c + (x * vy - y * vx) * s + z * dot;
+        }
+    }
 
-            // Particle is still alive.
-            p->_velocity.x += p->_acceleration.x * elapsedSecs;
-            p->_velocity.y += p->_acceleration.y * elapsedSecs;
-            p->_velocity.z += p->_acceleration.z * elapsedSecs;
+    // Integrate motion and interpolate color and size linearly over the life of each particle.
+    unsigned int i = begin;
+#ifdef GP_USE_SSE
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 ms = _mm_set1_ps(elapsedMs);
+    const __m128 dt = _mm_set1_ps(elapsedSecs);
+    for (; i + 4 <= end; i += 4)
+    {
+        __m128 energy = _mm_sub_ps(_mm_loadu_ps(p->energy + i), ms);
+        _mm_storeu_ps(p->energy + i, energy);
 
-            p->_position.x += p->_velocity.x * elapsedSecs;
-            p->_position.y += p->_velocity.y * elapsedSecs;
-            p->_position.z += p->_velocity.z * elapsedSecs;
+        for (unsigned int c = 0; c < 3; ++c)
+        {
+            __m128 velocity = _mm_add_ps(_mm_loadu_ps(p->velocity[c] + i), _mm_mul_ps(_mm_loadu_ps(p->acceleration[c] + i), dt));
+            _mm_storeu_ps(p->velocity[c] + i, velocity);
+            _mm_storeu_ps(p->position[c] + i, _mm_add_ps(_mm_loadu_ps(p->position[c] + i), _mm_mul_ps(velocity, dt)));
+        }
+        _mm_storeu_ps(p->angle + i, _mm_add_ps(_mm_loadu_ps(p->angle + i), _mm_mul_ps(_mm_loadu_ps(p->rotationPerParticleSpeed + i), dt)));
 
-            p->_angle += p->_rotationPerParticleSpeed * elapsedSecs;
+        __m128 percent = _mm_sub_ps(one, _mm_div_ps(energy, _mm_loadu_ps(p->energyStart + i)));
+        for (unsigned int c = 0; c < 4; ++c)
+        {
+            __m128 start = _mm_loadu_ps(p->colorStart[c] + i);
+            _mm_storeu_ps(p->color[c] + i, _mm_add_ps(start, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(p->colorEnd[c] + i), start), percent)));
+        }
+        __m128 sizeStart = _mm_loadu_ps(p->sizeStart + i);
+        _mm_storeu_ps(p->size + i, _mm_add_ps(sizeStart, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(p->sizeEnd + i), sizeStart), percent)));
+    }
+#endif
+    for (; i < end; ++i)
+    {
+        float energy = p->energy[i] -= elapsedMs;
 
-            // Simple linear interpolation of color and size.
-            float percent = 1.0f - ((float)p->_energy / (float)p->_energyStart);
+        for (unsigned int c = 0; c < 3; ++c)
+        {
+            p->velocity[c][i] += p->acceleration[c][i] * elapsedSecs;
+            p->position[c][i] += p->velocity[c][i] * elapsedSecs;
+        }
+        p->angle[i] += p->rotationPerParticleSpeed[i] * elapsedSecs;
 
-            p->_color.x = p->_colorStart.x + (p->_colorEnd.x - p->_colorStart.x) * percent;
-            p->_color.y = p->_colorStart.y + (p->_colorEnd.y - p->_colorStart.y) * percent;
-            p->_color.z = p->_colorStart.z + (p->_colorEnd.z - p->_colorStart.z) * percent;
-            p->_color.w = p->_colorStart.w + (p->_colorEnd.w - p->_colorStart.w) * percent;
+        float percent = 1.0f - (energy / p->energyStart[i]);
+        for (unsigned int c = 0; c < 4; ++c)
+        {
+            p->color[c][i] = p->colorStart[c][i] + (p->colorEnd[c][i] - p->colorStart[c][i]) * percent;
+        }
+        p->size[i] = p->sizeStart[i] + (p->sizeEnd[i] - p->sizeStart[i]) * percent;
+    }
 
-            p->_size = p->_sizeStart + (p->_sizeEnd - p->_sizeStart) * percent;
+    // Handle sprite animations.
+    if (_spriteAnimated)
+    {
+        for (unsigned int i = begin; i < end; ++i)
+        {
+            if (p->energy[i] <= 0.0f)
+                continue;
 
-            // Handle sprite animations.
-            if (_spriteAnimated)
+            if (!_spriteLooped)
             {
-                if (!_spriteLooped)
+                // The last frame should finish exactly when the particle dies.
+                float percent = 1.0f - (p->energy[i] / p->energyStart[i]);
+                p->timeOnCurrentFrame[i] = percent - p->frame[i] * _spritePercentPerFrame;
+                if (p->frame[i] < _spriteFrameCount - 1 &&
+                    p->timeOnCurrentFrame[i] >= _spritePercentPerFrame)
                 {
-                    // The last frame should finish exactly when the particle dies.
-                    float percentSpent = 0.0f;
-                    for (unsigned int i = 0; i < p->_frame; i++)
-                    {
-                        percentSpent += _spritePercentPerFrame;
-                    }
-                    p->_timeOnCurrentFrame = percent - percentSpent;
-                    if (p->_frame < _spriteFrameCount - 1 &&
-                        p->_timeOnCurrentFrame >= _spritePercentPerFrame)
-                    {
-                        ++p->_frame;
-                    }
+                    ++p->frame[i];
                 }
-                else
+            }
+            else
+            {
+                // _spriteFrameDurationSecs is an absolute time measured in seconds,
+                // and the animation repeats indefinitely.
+                p->timeOnCurrentFrame[i] += elapsedSecs;
+                if (p->timeOnCurrentFrame[i] >= _spriteFrameDurationSecs)
                 {
-                    // _spriteFrameDurationSecs is an absolute time measured in seconds,
-                    // and the animation repeats indefinitely.
-                    p->_timeOnCurrentFrame += elapsedSecs;
-                    if (p->_timeOnCurrentFrame >= _spriteFrameDurationSecs)
+                    p->timeOnCurrentFrame[i] -= _spriteFrameDurationSecs;
+                    ++p->frame[i];
+                    if (p->frame[i] == _spriteFrameCount)
                     {
-                        p->_timeOnCurrentFrame -= _spriteFrameDurationSecs;
-                        ++p->_frame;
-                        if (p->_frame == _spriteFrameCount)
-                        {
-                            p->_frame = 0;
-                        }
+                        p->frame[i] = 0;
                     }
                 }
             }
         }
-        else
+    }
+}
+
+void ParticleEmitter::removeDeadParticles()
+{
+    GP_ASSERT(_particles);
+
+    unsigned int i = 0;
+    while (i < _particleCount)
+    {
+        if (_particles->energy[i] > 0.0f)
         {
-            // Particle is dead.  Move the particle furthest from the start of the array
-            // down to take its place, and re-use the slot at the end of the list of living particles.
-            if (particlesIndex != _particleCount - 1)
-            {
-                _particles[particlesIndex] = _particles[_particleCount - 1];
-            }
-            --_particleCount;
+            ++i;
+            continue;
         }
+
+        // Particle is dead. Move the particle furthest from the start of the arrays
+        // down to take its place, and check that one next.
+        --_particleCount;
+        if (i != _particleCount)
+        {
+            _particles->copy(_particleCount, i);
+        }
+    }
+}
+
+ParticleEmitter::Particles::Particles(unsigned int capacity) :
+    _capacity(capacity), _data(NULL)
+{
+    _data = new float[ARRAY_COUNT * capacity];
+    frame = new unsigned int[capacity];
+    memset(_data, 0, ARRAY_COUNT * capacity * sizeof(float));
+    memset(frame, 0, capacity * sizeof(unsigned int));
+
+    float* data = _data;
+    float** arrays[ARRAY_COUNT] =
+    {
+        &position[0], &position[1], &position[2],
+        &velocity[0], &velocity[1], &velocity[2],
+        &acceleration[0], &acceleration[1], &acceleration[2],
+        &colorStart[0], &colorStart[1], &colorStart[2], &colorStart[3],
+        &colorEnd[0], &colorEnd[1], &colorEnd[2], &colorEnd[3],
+        &color[0], &color[1], &color[2], &color[3],
+        &rotationAxis[0], &rotationAxis[1], &rotationAxis[2],
+        &rotationSpeed, &rotationPerParticleSpeed, &angle,
+        &energyStart, &energy,
+        &sizeStart, &sizeEnd, &size,
+        &timeOnCurrentFrame
+    };
+    for (unsigned int i = 0; i < ARRAY_COUNT; ++i, data += capacity)
+    {
+        *arrays[i] = data;
+    }
+}
+
+ParticleEmitter::Particles::~Particles()
+{
+    SAFE_DELETE_ARRAY(_data);
+    SAFE_DELETE_ARRAY(frame);
+}
+
+void ParticleEmitter::Particles::copy(unsigned int src, unsigned int dst)
+{
+    GP_ASSERT(src < _capacity && dst < _capacity);
+
+    for (float* array = _data, *end = _data + ARRAY_COUNT * _capacity; array < end; array += _capacity)
+    {
+        array[dst] = array[src];
     }
+    frame[dst] = frame[src];
 }
 
 unsigned int ParticleEmitter::draw(bool wireframe)
@@ -999,9 +1237,6 @@ unsigned int ParticleEmitter::draw(bool wireframe)
         // Begin sprite batch drawing
         _spriteBatch->start();
 
-        // 2D Rotation.
-        static const Vector2 pivot(0.5f, 0.5f);
-
         // 3D Rotation so that particles always face the camera.
         GP_ASSERT(_node && _node->getScene() && _node->getScene()->getActiveCamera() && _node->getScene()->getActiveCamera()->getNode());
         const Matrix& cameraWorldMatrix = _node->getScene()->getActiveCamera()->getNode()->getWorldMatrix();
@@ -1011,13 +1246,22 @@ unsigned int ParticleEmitter::draw(bool wireframe)
         Vector3 up;
         cameraWorldMatrix.getUpVector(&up);
 
-        for (unsigned int i = 0; i < _particleCount; i++)
+        // Generate the sprites straight into the batch.
+        SpriteBatch::SpriteVertex* vertices = _spriteBatch->addSprites(_particleCount);
+        if (vertices)
         {
-            Particle* p = &_particles[i];
-
-            _spriteBatch->draw(p->_position, right, up, p->_size, p->_size,
-                                _spriteTextureCoords[p->_frame * 4], _spriteTextureCoords[p->_frame * 4 + 1], _spriteTextureCoords[p->_frame * 4 + 2], _spriteTextureCoords[p->_frame * 4 + 3],
-                                p->_color, pivot, p->_angle);
+            if (_jobSystem && _particleCount > PARTICLE_JOB_GRAIN)
+            {
+                vkTools::JobHandle job = _jobSystem->parallelFor(_particleCount, PARTICLE_JOB_GRAIN, [this, &right, &up, vertices](uint32_t begin, uint32_t end)
+                {
+                    generateSprites(begin, end, right, up, vertices);
+                });
+                _jobSystem->wait(job);
+            }
+            else
+            {
+                generateSprites(0, _particleCount, right, up, vertices);
+            }
         }
 
         // Render.
@@ -1026,6 +1270,26 @@ unsigned int ParticleEmitter::draw(bool wireframe)
     return 1;
 }
 
+void ParticleEmitter::generateSprites(unsigned int begin, unsigned int end, const Vector3& right, const Vector3& up, SpriteBatch::SpriteVertex* vertices) const
+{
+    GP_ASSERT(_particles);
+    GP_ASSERT(end <= _particleCount);
+
+    // 2D Rotation.
+    static const Vector2 pivot(0.5f, 0.5f);
+
+    const Particles* p = _particles;
+    for (unsigned int i = begin; i < end; i++)
+    {
+        Vector3 position(p->position[0][i], p->position[1][i], p->position[2][i]);
+        Vector4 color(p->color[0][i], p->color[1][i], p->color[2][i], p->color[3][i]);
+        float size = p->size[i];
+        const float* uvs = &_spriteTextureCoords[p->frame[i] * 4];
+
+        SpriteBatch::computeSprite(position, right, up, size, size, uvs[0], uvs[1], uvs[2], uvs[3], color, pivot, p->angle[i], vertices + i * 4);
+    }
+}
+
 Drawable* ParticleEmitter::clone(NodeCloneContext& context)
 {
     // Create a clone of this emitter
@@ -1064,6 +1328,7 @@ Drawable* ParticleEmitter::clone(NodeCloneContext& context)
     clone->_orbitPosition = _orbitPosition;
     clone->_orbitVelocity = _orbitVelocity;
     clone->_orbitAcceleration = _orbitAcceleration;
+    clone->_jobSystem = _jobSystem;
 
     return clone;
 }
@@ -11,6 +11,11 @@
 #include "Properties.h"
 #include "Drawable.h"
 
+namespace vkTools
+{
+class JobSystem;
+}
+
 namespace vkcore
 {
 
@@ -707,6 +712,54 @@ public:
      */
     void update(float elapsedTime);
 
+    /**
+     * Updates the particles of several emitters together, spreading the particles of all
+     * the emitters over the workers of a job system.
+     *
+     * This gives the same result as calling update on each emitter in turn, but keeps all
+     * workers busy even when the scene holds many small emitters. New particles are still
+     * emitted on the calling thread.
+     *
+     * @param emitters The emitters to update.
+     * @param emitterCount The number of emitters.
+     * @param elapsedTime The amount of time that has passed since the last call to update(), in milliseconds.
+     * @param jobSystem The job system to update the particles on.
+     * @script{ignore}
+     */
+    static void update(ParticleEmitter** emitters, unsigned int emitterCount, float elapsedTime, vkTools::JobSystem& jobSystem);
+
+    /**
+     * Sets the job system that this emitter updates its particles and generates its sprite
+     * vertices on.
+     *
+     * Without a job system, or when there are few particles alive, the particles are
+     * updated and their vertices generated on the calling thread. The result is the same
+     * either way, whatever the number of workers.
+     *
+     * @param jobSystem The job system to use, or NULL to do all the work on the calling thread.
+     * @script{ignore}
+     */
+    void setJobSystem(vkTools::JobSystem* jobSystem);
+
+    /**
+     * Gets the job system that this emitter updates its particles on.
+     *
+     * @return The job system, or NULL.
+     * @script{ignore}
+     */
+    vkTools::JobSystem* getJobSystem() const;
+
+    /**
+     * Seeds the random sequence that the properties of newly emitted particles are drawn from.
+     *
+     * Each emitter draws from a sequence of its own, seeded from rand() when it is created.
+     * Reseeding the emitter with the same value, and then updating it with the same elapsed
+     * times, emits exactly the same particles, which makes it possible to replay an effect.
+     *
+     * @param seed The seed of the random sequence.
+     */
+    void setRandomSeed(unsigned int seed);
+
     /**
      * @see Drawable::draw
      *
@@ -746,6 +799,15 @@ private:
      */
     ParticleEmitter& operator=(const ParticleEmitter&);
 
+    // Gets the next value of the emitter's random sequence.
+    unsigned int generateRandom();
+
+    // Generates a random float between 0 and 1.
+    float generateRandom01();
+
+    // Generates a random float between -1 and 1.
+    float generateRandomMinus1To1();
+
     // Generates a scalar within the range defined by min and max.
     float generateScalar(float min, float max);
 
@@ -766,34 +828,113 @@ private:
     static ParticleEmitter::BlendMode getBlendModeFromString(const char* src);
 
     /**
-     * Defines the data for a single particle in the system.
+     * Updates the living particles in the given range.
+     *
+     * Particles whose energy runs out are left in place, to be removed by removeDeadParticles.
+     *
+     * @param begin The index of the first particle to update.
+     * @param end The index one past the last particle to update.
+     * @param elapsedMs The time to advance the particles by, in milliseconds.
      */
-    class Particle
-    {
+    void updateParticles(unsigned int begin, unsigned int end, float elapsedMs);
 
+    /**
+     * Advances the update timer and emits new particles.
+     *
+     * @param elapsedTime The time passed since the last update, in milliseconds.
+     * @param elapsedMs Populated with the time to advance the living particles by.
+     *
+     * @return true if the living particles should be updated now.
+     */
+    bool beginUpdate(float elapsedTime, float* elapsedMs);
+
+    /**
+     * Generates the camera facing sprites of the particles in the given range.
+     *
+     * @param begin The index of the first particle.
+     * @param end The index one past the last particle.
+     * @param right The right vector of the camera.
+     * @param up The up vector of the camera.
+     * @param vertices The vertices of the particles' sprites, four per particle.
+     */
+    void generateSprites(unsigned int begin, unsigned int end, const Vector3& right, const Vector3& up, SpriteBatch::SpriteVertex* vertices) const;
+
+    /**
+     * Removes the particles whose energy has run out, moving the particles furthest from the
+     * start of the arrays down to take their places.
+     */
+    void removeDeadParticles();
+
+    /**
+     * Defines the state of the particles in the system, in structure-of-arrays form.
+     *
+     * Every component of every particle property is kept in an array of its own, so that
+     * the particles can be integrated four at a time with SIMD instructions. The arrays are
+     * allocated once, with room for the maximum number of particles, in a single block.
+     */
+    class Particles
+    {
     public:
-        Vector3 _position;
-        Vector3 _velocity;
-        Vector3 _acceleration;
-        Vector4 _colorStart;
-        Vector4 _colorEnd;
-        Vector4 _color;
-        float _rotationPerParticleSpeed;
-        Vector3 _rotationAxis;
-        float _rotationSpeed;
-        float _angle;
-        long _energyStart;
-        long _energy;
-        float _sizeStart;
-        float _sizeEnd;
-        float _size;
-        unsigned int _frame;
-        float _timeOnCurrentFrame;
+
+        /**
+         * Number of float arrays in the block.
+         */
+        static const unsigned int ARRAY_COUNT = 33;
+
+        /**
+         * Constructor.
+         *
+         * @param capacity The maximum number of particles.
+         */
+        Particles(unsigned int capacity);
+
+        /**
+         * Destructor.
+         */
+        ~Particles();
+
+        /**
+         * Copies the state of one particle over another.
+         */
+        void copy(unsigned int src, unsigned int dst);
+
+        float* position[3];
+        float* velocity[3];
+        float* acceleration[3];
+        float* colorStart[4];
+        float* colorEnd[4];
+        float* color[4];
+        float* rotationAxis[3];         // Normalized axis that the velocity and acceleration rotate about.
+        float* rotationSpeed;
+        float* rotationPerParticleSpeed;
+        float* angle;
+        float* energyStart;
+        float* energy;
+        float* sizeStart;
+        float* sizeEnd;
+        float* size;
+        float* timeOnCurrentFrame;
+        unsigned int* frame;
+
+    private:
+
+        /**
+         * Hidden copy constructor.
+         */
+        Particles(const Particles& copy);
+
+        /**
+         * Hidden copy assignment operator.
+         */
+        Particles& operator=(const Particles&);
+
+        unsigned int _capacity;         // Length of each array.
+        float* _data;                   // The float arrays, one after another.
     };
 
     unsigned int _particleCountMax;
     unsigned int _particleCount;
-    Particle* _particles;
+    Particles* _particles;
     unsigned int _emissionRate;
     bool _started;
     bool _ellipsoid;
@@ -819,7 +960,6 @@ private:
     float _rotationSpeedMax;
     Vector3 _rotationAxis;
     Vector3 _rotationAxisVar;
-    Matrix _rotation;
     SpriteBatch* _spriteBatch;
     BlendMode _spriteBlendMode;
     float _spriteTextureWidth;
@@ -839,7 +979,9 @@ private:
     bool _orbitAcceleration;
     float _timePerEmission;
     float _emitTime;
-    double _lastUpdated;
+    float _updateTime;                  // Time accumulated since the particles were last updated, in milliseconds.
+    unsigned int _random;               // State of the emitter's random sequence; never zero.
+    vkTools::JobSystem* _jobSystem;     // The job system to update particles on; may be NULL.
 };
 
 }
@@ -898,6 +898,8 @@ PhysicsCollisionShape* PhysicsController::createShape(Node* node, const PhysicsC
                 // Build the heightfield from an attached terrain's height array
                 if (dynamic_cast<Terrain*>(node->getDrawable()) == NULL)
                     GP_ERROR("Empty heightfield collision shapes can only be used on nodes that have an attached Terrain.");
+                else if (dynamic_cast<Terrain*>(node->getDrawable())->isPaged())
+                    GP_ERROR("Empty heightfield collision shapes cannot be used on nodes that have an attached paged Terrain.");
                 else
                     collisionShape = createHeightfield(node, dynamic_cast<Terrain*>(node->getDrawable())->_heightfield, centerOfMassOffset);
             }
@@ -40,6 +40,7 @@ class Matrix;
  */
 class Quaternion
 {
+    friend class AnimationSampler;
     friend class Curve;
     friend class Transform;
 
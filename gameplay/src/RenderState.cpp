@@ -154,6 +154,9 @@ const char* autoBindingToString(RenderState::AutoBinding autoBinding)
     case RenderState::SCENE_AMBIENT_COLOR:
         return "SCENE_AMBIENT_COLOR";
 
+    case RenderState::DUAL_QUATERNION_PALETTE:
+        return "DUAL_QUATERNION_PALETTE";
+
     default:
         return "";
     }
@@ -302,6 +305,10 @@ void RenderState::applyAutoBinding(const char* uniformName, const char* autoBind
         {
             param->bindValue(this, &RenderState::autoBindingGetMatrixPalette, &RenderState::autoBindingGetMatrixPaletteSize);
         }
+        else if (strcmp(autoBinding, "DUAL_QUATERNION_PALETTE") == 0)
+        {
+            param->bindValue(this, &RenderState::autoBindingGetDualQuaternionPalette, &RenderState::autoBindingGetDualQuaternionPaletteSize);
+        }
         else if (strcmp(autoBinding, "SCENE_AMBIENT_COLOR") == 0)
         {
             param->bindValue(this, &RenderState::autoBindingGetAmbientColor);
@@ -395,6 +402,30 @@ unsigned int RenderState::autoBindingGetMatrixPaletteSize() const
     return 0;
 }
 
+const Vector4* RenderState::autoBindingGetDualQuaternionPalette() const
+{
+    Model* model = dynamic_cast<Model*>(_nodeBinding->getDrawable());
+    if (model)
+    {
+        MeshSkin* skin = model->getSkin();
+        if (skin)
+            return skin->getDualQuaternionPalette();
+    }
+    return NULL;
+}
+
+unsigned int RenderState::autoBindingGetDualQuaternionPaletteSize() const
+{
+    Model* model = dynamic_cast<Model*>(_nodeBinding->getDrawable());
+    if (model)
+    {
+        MeshSkin* skin = model->getSkin();
+        if (skin)
+            return skin->getDualQuaternionPaletteSize();
+    }
+    return 0;
+}
+
 const Vector3& RenderState::autoBindingGetAmbientColor() const
 {
     Scene* scene = _nodeBinding ? _nodeBinding->getScene() : NULL;
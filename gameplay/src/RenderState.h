@@ -54,7 +54,8 @@ public:
         CAMERA_WORLD_POSITION,
         CAMERA_VIEW_POSITION,
         MATRIX_PALETTE,
-        SCENE_AMBIENT_COLOR
+        SCENE_AMBIENT_COLOR,
+        DUAL_QUATERNION_PALETTE
     };
 
     /**
@@ -239,6 +240,8 @@ private:
     Vector3 autoBindingGetCameraViewPosition() const;
     const Vector4* autoBindingGetMatrixPalette() const;
     unsigned int autoBindingGetMatrixPaletteSize() const;
+    const Vector4* autoBindingGetDualQuaternionPalette() const;
+    unsigned int autoBindingGetDualQuaternionPaletteSize() const;
     const Vector3& autoBindingGetAmbientColor() const;
     const Vector3& autoBindingGetLightColor() const;
     const Vector3& autoBindingGetLightDirection() const;
@@ -6,6 +6,7 @@
 #include "Joint.h"
 #include "Terrain.h"
 #include "Bundle.h"
+#include "jobsystem.hpp"
 
 namespace vkcore
 {
@@ -61,7 +62,7 @@ static bool endsWith(const char* str, const char* suffix, bool ignoreCase)
 
 Scene::Scene()
     : _id(""), _activeCamera(NULL), _firstNode(NULL), _lastNode(NULL), _nodeCount(0), _bindAudioListenerToCamera(true), 
-      _nextItr(NULL), _nextReset(true)
+      _nextItr(NULL), _nextReset(true), _transformsDirty(true), _boundsTree(NULL)
 {
     __sceneList.push_back(this);
 }
@@ -82,6 +83,7 @@ Scene::~Scene()
 
     // Remove all nodes from the scene
     removeAllNodes();
+    SAFE_DELETE(_boundsTree);
 
     // Remove the scene from global list
     std::vector<Scene*>::iterator itr = std::find(__sceneList.begin(), __sceneList.end(), this);
@@ -273,6 +275,8 @@ void Scene::addNode(Node* node)
 
     ++_nodeCount;
 
+    hierarchyChanged();
+
     // If we don't have an active camera set, then check for one and set it.
     if (_activeCamera == NULL)
     {
@@ -306,6 +310,8 @@ void Scene::removeNode(Node* node)
     SAFE_RELEASE(node);
 
     --_nodeCount;
+
+    hierarchyChanged();
 }
 
 void Scene::removeAllNodes()
@@ -395,6 +401,139 @@ void Scene::update(float elapsedTime)
     }
 }
 
+void Scene::updateTransforms()
+{
+    buildTransforms();
+
+    // Parents always precede their children, so a parent's world matrix is
+    // already resolved by the time any of its children are visited.
+    for (size_t i = 0, count = _transformNodes.size(); i < count; ++i)
+    {
+        int parentIndex = _transformParents[i];
+        _transformNodes[i]->updateWorldMatrix(parentIndex >= 0 ? _transformNodes[parentIndex] : NULL);
+    }
+}
+
+void Scene::updateTransforms(vkTools::JobSystem& jobSystem)
+{
+    buildTransforms();
+
+    size_t nodeCount = _transformNodes.size();
+    size_t threadCount = jobSystem.getThreadCount() + 1;
+    if (_transformRoots.size() <= 1)
+    {
+        updateTransforms(0, nodeCount);
+        return;
+    }
+
+    // Cut the list into runs of whole top-level subtrees. Use a few runs per
+    // thread so that one large subtree does not leave the other threads idle.
+    size_t runSize = std::max(nodeCount / (threadCount * 4), (size_t)1);
+    std::vector<size_t> runs;
+    runs.push_back(0);
+    for (size_t i = 1, rootCount = _transformRoots.size(); i < rootCount; ++i)
+    {
+        if (_transformRoots[i] - runs.back() >= runSize)
+        {
+            runs.push_back(_transformRoots[i]);
+        }
+    }
+    runs.push_back(nodeCount);
+
+    vkTools::JobHandle job = jobSystem.parallelFor((uint32_t)runs.size() - 1, 1, [this, &runs](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t run = begin; run < end; ++run)
+        {
+            updateTransforms(runs[run], runs[run + 1]);
+        }
+    });
+    jobSystem.wait(job);
+}
+
+void Scene::updateTransforms(size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; ++i)
+    {
+        int parentIndex = _transformParents[i];
+        _transformNodes[i]->updateWorldMatrix(parentIndex >= 0 ? _transformNodes[parentIndex] : NULL);
+    }
+
+    // Visit children before their parents so that merging child bounds never recurses.
+    for (size_t i = end; i > begin; --i)
+    {
+        _transformNodes[i - 1]->getBoundingSphere();
+    }
+}
+
+void Scene::buildTransforms()
+{
+    if (_transformsDirty)
+    {
+        _transformNodes.clear();
+        _transformParents.clear();
+        _transformRoots.clear();
+        _transformNodes.reserve(_nodeCount);
+        _transformParents.reserve(_nodeCount);
+        _transformRoots.reserve(_nodeCount);
+        for (Node* node = _firstNode; node != NULL; node = node->_nextSibling)
+        {
+            _transformRoots.push_back(_transformNodes.size());
+            addTransformNode(node, -1);
+        }
+        _transformsDirty = false;
+    }
+}
+
+void Scene::hierarchyChanged()
+{
+    _transformsDirty = true;
+    if (_boundsTree)
+        _boundsTree->setDirty();
+}
+
+void Scene::drawableChanged()
+{
+    if (_boundsTree)
+        _boundsTree->setDirty();
+}
+
+BoundingVolumeTree* Scene::getBoundingVolumeTree()
+{
+    if (!_boundsTree)
+        _boundsTree = new BoundingVolumeTree(this);
+    return _boundsTree;
+}
+
+unsigned int Scene::getVisibleNodes(const Frustum& frustum, std::vector<Node*>& nodes, const OcclusionCuller* occlusionCuller)
+{
+    size_t first = nodes.size();
+    getBoundingVolumeTree()->query(frustum, nodes);
+    if (occlusionCuller)
+    {
+        // Filter the frustum query results in place.
+        size_t count = first;
+        for (size_t i = first, end = nodes.size(); i < end; ++i)
+        {
+            if (occlusionCuller->isVisible(nodes[i]))
+                nodes[count++] = nodes[i];
+        }
+        nodes.resize(count);
+    }
+    return (unsigned int)(nodes.size() - first);
+}
+
+void Scene::addTransformNode(Node* node, int parentIndex)
+{
+    int index = (int)_transformNodes.size();
+    _transformNodes.push_back(node);
+    _transformParents.push_back(parentIndex);
+
+    for (Node* child = node->_firstChild; child != NULL; child = child->_nextSibling)
+    {
+        addTransformNode(child, index);
+    }
+}
+
 void Scene::reset()
 {
     _nextItr = NULL;
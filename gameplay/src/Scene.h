@@ -6,12 +6,21 @@
 #include "ScriptController.h"
 #include "Light.h"
 #include "Model.h"
+#include "BoundingVolumeTree.h"
+#include "OcclusionCuller.h"
+
+namespace vkTools
+{
+class JobSystem;
+}
 
 namespace vkcore
 {
 
 class Scene : public Ref
 {
+    friend class Node;
+
 public:
 
     /**
@@ -183,6 +192,44 @@ public:
      */
     void update(float elapsedTime);
 
+    /**
+     * Resolves the world matrices of all dirty nodes in the scene in a single pass.
+     *
+     * The scene keeps a flat, topologically sorted list of its nodes (every parent
+     * precedes its children) along with the index of each node's parent. This
+     * method walks that list linearly and recomputes only the world matrices that
+     * are dirty, instead of the recursive parent/child pointer chasing performed
+     * by Node::getWorldMatrix(). Subsequent calls to Node::getWorldMatrix() return
+     * the resolved matrices directly.
+     *
+     * The list is rebuilt lazily the first time this method is called after nodes
+     * are added to or removed from the scene hierarchy. Joint hierarchies of mesh
+     * skins are not part of the list and are still resolved on demand.
+     *
+     * This is typically called once per frame, after animations and physics have
+     * been updated and before the scene is drawn.
+     */
+    void updateTransforms();
+
+    /**
+     * Resolves the world matrices and world-space bounding spheres of all dirty
+     * nodes in the scene, spreading the work across the workers of the given job system.
+     *
+     * Top-level nodes and their descendants are independent of each other, so the
+     * flat transform list is split into contiguous runs of whole top-level subtrees
+     * which are resolved concurrently. Within a run, world matrices are resolved
+     * parents first and bounding spheres children first, so no node ever waits on
+     * another run. This method blocks until all the work has completed, executing
+     * jobs on the calling thread while it waits.
+     *
+     * Nodes must not be added, removed or moved while this method is running.
+     * Mesh skins whose joints are shared between subtrees are not safe to resolve
+     * concurrently and should be updated with updateTransforms() instead.
+     *
+     * @param jobSystem The job system to run the work on.
+     */
+    void updateTransforms(vkTools::JobSystem& jobSystem);
+
     /**
      * Visits each node in the scene and calls the specified method pointer.
      *
@@ -241,6 +288,29 @@ public:
      */
     inline void visit(const char* visitMethod);
 
+    /**
+     * Gets the bounding volume hierarchy over the drawable nodes of this scene.
+     *
+     * The tree is created on first use and kept up to date with the scene from then on.
+     *
+     * @return The bounding volume tree of the scene.
+     */
+    BoundingVolumeTree* getBoundingVolumeTree();
+
+    /**
+     * Gets the drawable nodes of this scene whose bounds intersect the given frustum.
+     *
+     * @param frustum The frustum to test against, typically that of the active camera.
+     * @param nodes The vector to append the visible nodes to.
+     * @param occlusionCuller A culler whose depth buffer has been rasterized for the same
+     *      view, to also leave out the nodes hidden behind its occluders; may be NULL.
+     *
+     * @return The number of nodes appended.
+     * @see BoundingVolumeTree::query
+     * @script{ignore}
+     */
+    unsigned int getVisibleNodes(const Frustum& frustum, std::vector<Node*>& nodes, const OcclusionCuller* occlusionCuller = NULL);
+
     /**
      * @see VisibleSet#getNext
      */
@@ -294,6 +364,32 @@ private:
 
     bool isNodeVisible(Node* node);
 
+    /**
+     * Marks the flat transform list as needing a rebuild.
+     */
+    void hierarchyChanged();
+
+    /**
+     * Marks the bounding volume tree as needing a rebuild after a node's drawable changed.
+     */
+    void drawableChanged();
+
+    /**
+     * Appends the given node and all of its children to the flat transform list.
+     */
+    void addTransformNode(Node* node, int parentIndex);
+
+    /**
+     * Rebuilds the flat transform list if the scene hierarchy has changed.
+     */
+    void buildTransforms();
+
+    /**
+     * Resolves the world matrices and bounding spheres of the nodes in the
+     * given range of the flat transform list.
+     */
+    void updateTransforms(size_t begin, size_t end);
+
     std::string _id;
     Camera* _activeCamera;
     Node* _firstNode;
@@ -303,6 +399,11 @@ private:
     bool _bindAudioListenerToCamera;
     Node* _nextItr;
     bool _nextReset;
+    std::vector<Node*> _transformNodes;
+    std::vector<int> _transformParents;
+    std::vector<size_t> _transformRoots;
+    bool _transformsDirty;
+    BoundingVolumeTree* _boundsTree;
 };
 
 template <class T>
@@ -0,0 +1,305 @@
+#include "Base.h"
+#include "SkinDeformer.h"
+#include "MeshSkin.h"
+#include "Model.h"
+#include "Mesh.h"
+#include "MathUtil.h"
+#include "jobsystem.hpp"
+
+#ifdef GP_USE_SSE
+#include <emmintrin.h>
+#endif
+
+// The number of floats in each palette matrix (3 rows of Vector4).
+#define PALETTE_STRIDE 12
+
+// The number of vertices deformed by each job.
+#define SKIN_JOB_GRAIN 2048
+
+namespace vkcore
+{
+
+SkinDeformer::SkinDeformer(MeshSkin* skin, const VertexFormat& vertexFormat, unsigned int vertexCount) :
+    _skin(skin), _vertexFormat(vertexFormat), _vertexCount(vertexCount), _vertexStride(vertexFormat.getVertexSize() / sizeof(float)),
+    _influenceCount(0), _vectorCount(0), _source(NULL), _joints(NULL), _vertices(NULL)
+{
+    memset(_offsets, 0, sizeof(_offsets));
+}
+
+SkinDeformer::~SkinDeformer()
+{
+    SAFE_DELETE_ARRAY(_source);
+    SAFE_DELETE_ARRAY(_joints);
+    SAFE_DELETE_ARRAY(_vertices);
+}
+
+SkinDeformer* SkinDeformer::create(Model* model, const void* vertexData)
+{
+    GP_ASSERT(model);
+
+    MeshSkin* skin = model->getSkin();
+    Mesh* mesh = model->getMesh();
+    if (!skin || !mesh)
+    {
+        GP_WARN("Cannot deform a model without a skin.");
+        return NULL;
+    }
+    return create(skin, mesh->getVertexFormat(), vertexData, mesh->getVertexCount());
+}
+
+SkinDeformer* SkinDeformer::create(MeshSkin* skin, const VertexFormat& vertexFormat, const void* vertexData, unsigned int vertexCount)
+{
+    GP_ASSERT(skin);
+    GP_ASSERT(vertexData || vertexCount == 0);
+
+    // Locate the skinned elements of the vertex format.
+    int position = -1;
+    int indices = -1;
+    int weights = -1;
+    unsigned int influenceCount = 0;
+    unsigned int vectorCount = 0;
+    unsigned int vectorOffsets[3];
+    unsigned int offset = 0;
+    for (unsigned int i = 0, count = vertexFormat.getElementCount(); i < count; ++i)
+    {
+        const VertexFormat::Element& e = vertexFormat.getElement(i);
+        switch (e.usage)
+        {
+        case VertexFormat::POSITION:
+            if (e.size >= 3)
+                position = offset;
+            break;
+        case VertexFormat::NORMAL:
+        case VertexFormat::TANGENT:
+        case VertexFormat::BINORMAL:
+            if (e.size >= 3 && vectorCount < 3)
+                vectorOffsets[vectorCount++] = offset;
+            break;
+        case VertexFormat::BLENDINDICES:
+            indices = offset;
+            influenceCount = e.size;
+            break;
+        case VertexFormat::BLENDWEIGHTS:
+            weights = offset;
+            if (influenceCount == 0 || e.size < influenceCount)
+                influenceCount = e.size;
+            break;
+        default:
+            break;
+        }
+        offset += e.size;
+    }
+    if (position < 0 || indices < 0 || weights < 0 || influenceCount == 0 || influenceCount > 4)
+    {
+        GP_WARN("Vertex format cannot be skinned (it needs a position and 1 to 4 blend indices and weights).");
+        return NULL;
+    }
+
+    SkinDeformer* deformer = new SkinDeformer(skin, vertexFormat, vertexCount);
+    deformer->_influenceCount = influenceCount;
+    deformer->_vectorCount = vectorCount;
+    deformer->_offsets[0] = (unsigned int)position;
+    for (unsigned int v = 0; v < vectorCount; ++v)
+        deformer->_offsets[v + 1] = vectorOffsets[v];
+
+    // Attributes that are not skinned are taken from the bind pose as they are.
+    unsigned int stride = deformer->_vertexStride;
+    deformer->_vertices = new float[vertexCount * stride];
+    memcpy(deformer->_vertices, vertexData, vertexCount * stride * sizeof(float));
+
+    // Split the skinned attributes into an array per component.
+    unsigned int arrayCount = 3 * (1 + vectorCount) + influenceCount;
+    deformer->_source = new float[arrayCount * vertexCount];
+    deformer->_joints = new unsigned int[influenceCount * vertexCount];
+    unsigned int jointCount = skin->getJointCount();
+    const float* src = deformer->_vertices;
+    for (unsigned int i = 0; i < vertexCount; ++i, src += stride)
+    {
+        float* dst = deformer->_source + i;
+        for (unsigned int v = 0; v <= vectorCount; ++v)
+        {
+            for (unsigned int c = 0; c < 3; ++c, dst += vertexCount)
+                *dst = src[deformer->_offsets[v] + c];
+        }
+        for (unsigned int k = 0; k < influenceCount; ++k, dst += vertexCount)
+        {
+            *dst = src[weights + k];
+
+            unsigned int joint = (unsigned int)src[indices + k];
+            GP_ASSERT(joint < jointCount);
+            deformer->_joints[k * vertexCount + i] = joint < jointCount ? joint * PALETTE_STRIDE : 0;
+        }
+    }
+
+    return deformer;
+}
+
+MeshSkin* SkinDeformer::getSkin() const
+{
+    return _skin;
+}
+
+const VertexFormat& SkinDeformer::getVertexFormat() const
+{
+    return _vertexFormat;
+}
+
+unsigned int SkinDeformer::getVertexCount() const
+{
+    return _vertexCount;
+}
+
+const void* SkinDeformer::getVertexData() const
+{
+    return _vertices;
+}
+
+void SkinDeformer::deform()
+{
+    GP_ASSERT(_skin);
+
+    deform(0, _vertexCount, &_skin->getMatrixPalette()->x);
+}
+
+void SkinDeformer::deform(SkinDeformer** deformers, unsigned int deformerCount, vkTools::JobSystem& jobSystem)
+{
+    GP_ASSERT(deformers || deformerCount == 0);
+
+    // A range of the vertices of one deformer, deformed by a single job.
+    struct Chunk
+    {
+        SkinDeformer* deformer;
+        unsigned int begin;
+        unsigned int end;
+        const float* palette;
+    };
+
+    // The palettes read the world matrices of the joints, which are resolved on this thread.
+    std::vector<Chunk> chunks;
+    for (unsigned int i = 0; i < deformerCount; ++i)
+    {
+        SkinDeformer* deformer = deformers[i];
+        GP_ASSERT(deformer && deformer->_skin);
+
+        const float* palette = &deformer->_skin->getMatrixPalette()->x;
+        for (unsigned int begin = 0; begin < deformer->_vertexCount; begin += SKIN_JOB_GRAIN)
+        {
+            Chunk chunk = { deformer, begin, std::min(begin + SKIN_JOB_GRAIN, deformer->_vertexCount), palette };
+            chunks.push_back(chunk);
+        }
+    }
+
+    Chunk* data = chunks.data();
+    vkTools::JobHandle job = jobSystem.parallelFor((uint32_t)chunks.size(), 1, [data](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; ++i)
+            data[i].deformer->deform(data[i].begin, data[i].end, data[i].palette);
+    });
+    jobSystem.wait(job);
+}
+
+void SkinDeformer::updateMesh(Mesh* mesh) const
+{
+    GP_ASSERT(mesh);
+    GP_ASSERT(mesh->getVertexCount() == _vertexCount);
+    GP_ASSERT(mesh->getVertexSize() == _vertexFormat.getVertexSize());
+
+    mesh->setVertexData(_vertices, 0, _vertexCount);
+}
+
+void SkinDeformer::deform(unsigned int begin, unsigned int end, const float* palette)
+{
+    GP_ASSERT(palette);
+    GP_ASSERT(end <= _vertexCount);
+
+    const unsigned int n = _vertexCount;
+    const float* weights = _source + 3 * (1 + _vectorCount) * n;
+    unsigned int i = begin;
+
+#ifdef GP_USE_SSE
+    for (; i + 4 <= end; i += 4)
+    {
+        // Blend the palette matrices of four vertices, one register per matrix element.
+        __m128 m[PALETTE_STRIDE];
+        for (unsigned int e = 0; e < PALETTE_STRIDE; ++e)
+            m[e] = _mm_setzero_ps();
+
+        for (unsigned int k = 0; k < _influenceCount; ++k)
+        {
+            const unsigned int* joints = _joints + k * n + i;
+            const float* p0 = palette + joints[0];
+            const float* p1 = palette + joints[1];
+            const float* p2 = palette + joints[2];
+            const float* p3 = palette + joints[3];
+            __m128 w = _mm_loadu_ps(weights + k * n + i);
+            for (unsigned int r = 0; r < PALETTE_STRIDE; r += 4)
+            {
+                // Transpose a row of each matrix so that each register holds one element of all four.
+                __m128 c0 = _mm_loadu_ps(p0 + r);
+                __m128 c1 = _mm_loadu_ps(p1 + r);
+                __m128 c2 = _mm_loadu_ps(p2 + r);
+                __m128 c3 = _mm_loadu_ps(p3 + r);
+                _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+                m[r + 0] = _mm_add_ps(m[r + 0], _mm_mul_ps(c0, w));
+                m[r + 1] = _mm_add_ps(m[r + 1], _mm_mul_ps(c1, w));
+                m[r + 2] = _mm_add_ps(m[r + 2], _mm_mul_ps(c2, w));
+                m[r + 3] = _mm_add_ps(m[r + 3], _mm_mul_ps(c3, w));
+            }
+        }
+
+        // Transform the position, then the direction vectors without the translation.
+        const float* src = _source + i;
+        for (unsigned int v = 0; v <= _vectorCount; ++v, src += 3 * n)
+        {
+            __m128 x = _mm_loadu_ps(src);
+            __m128 y = _mm_loadu_ps(src + n);
+            __m128 z = _mm_loadu_ps(src + 2 * n);
+
+            float result[3][4];
+            for (unsigned int r = 0; r < 3; ++r)
+            {
+                __m128 t = _mm_add_ps(_mm_mul_ps(m[r * 4 + 0], x), _mm_add_ps(_mm_mul_ps(m[r * 4 + 1], y), _mm_mul_ps(m[r * 4 + 2], z)));
+                if (v == 0)
+                    t = _mm_add_ps(t, m[r * 4 + 3]);
+                _mm_storeu_ps(result[r], t);
+            }
+
+            float* dst = _vertices + i * _vertexStride + _offsets[v];
+            for (unsigned int l = 0; l < 4; ++l, dst += _vertexStride)
+            {
+                dst[0] = result[0][l];
+                dst[1] = result[1][l];
+                dst[2] = result[2][l];
+            }
+        }
+    }
+#endif
+
+    for (; i < end; ++i)
+    {
+        float m[PALETTE_STRIDE];
+        memset(m, 0, sizeof(m));
+        for (unsigned int k = 0; k < _influenceCount; ++k)
+        {
+            const float* p = palette + _joints[k * n + i];
+            float w = weights[k * n + i];
+            for (unsigned int e = 0; e < PALETTE_STRIDE; ++e)
+                m[e] += p[e] * w;
+        }
+
+        const float* src = _source + i;
+        for (unsigned int v = 0; v <= _vectorCount; ++v, src += 3 * n)
+        {
+            float x = src[0];
+            float y = src[n];
+            float z = src[2 * n];
+            float w = v == 0 ? 1.0f : 0.0f;
+
+            float* dst = _vertices + i * _vertexStride + _offsets[v];
+            for (unsigned int r = 0; r < 3; ++r)
+                dst[r] = m[r * 4 + 0] * x + m[r * 4 + 1] * y + m[r * 4 + 2] * z + m[r * 4 + 3] * w;
+        }
+    }
+}
+
+}
@@ -0,0 +1,166 @@
+#ifndef SKINDEFORMER_H_
+#define SKINDEFORMER_H_
+
+#include "VertexFormat.h"
+
+namespace vkTools
+{
+class JobSystem;
+}
+
+namespace vkcore
+{
+
+class MeshSkin;
+class Model;
+class Mesh;
+
+/**
+ * Defines a deformer that skins the vertices of a mesh on the CPU.
+ *
+ * Skinned models are normally deformed on the GPU, from the matrix palette of their
+ * MeshSkin bound as a shader uniform, which limits the number of joints to what fits in
+ * the uniform space. A skin deformer instead blends the palette matrices of each vertex
+ * itself and writes the skinned vertices to a buffer in the vertex format of the mesh,
+ * ready to be uploaded to a dynamic mesh with updateMesh. This supports rigs of any size,
+ * and allows poses to be evaluated where there is no graphics device at all.
+ *
+ * Positions are transformed by the blended matrix; normals, tangents and binormals by
+ * its upper 3x3 part, and are not renormalized (as in the skinning shaders). All other
+ * vertex attributes are copied from the bind pose vertices unchanged.
+ *
+ * The vertices are deformed four at a time with SIMD instructions when available, and
+ * the vertices of several models may be deformed in parallel on a job system.
+ */
+class SkinDeformer
+{
+public:
+
+    /**
+     * Creates a deformer for the given skin.
+     *
+     * The vertices must hold a POSITION element with at least 3 components and BLENDINDICES
+     * and BLENDWEIGHTS elements with the same number of components (1 to 4).
+     *
+     * @param skin The skin whose matrix palette deforms the vertices. Must outlive the deformer.
+     * @param vertexFormat The format of the vertices.
+     * @param vertexData The bind pose vertices. The data is copied.
+     * @param vertexCount The number of vertices.
+     *
+     * @return The new deformer, or NULL if the vertex format cannot be skinned.
+     * @script{ignore}
+     */
+    static SkinDeformer* create(MeshSkin* skin, const VertexFormat& vertexFormat, const void* vertexData, unsigned int vertexCount);
+
+    /**
+     * Creates a deformer for a skinned model.
+     *
+     * @param model The model, which must have a skin. Must outlive the deformer.
+     * @param vertexData The bind pose vertices of the model's mesh, in the format of the mesh.
+     *
+     * @return The new deformer, or NULL if the model has no skin or its vertex format cannot be skinned.
+     * @script{ignore}
+     */
+    static SkinDeformer* create(Model* model, const void* vertexData);
+
+    /**
+     * Destructor.
+     */
+    ~SkinDeformer();
+
+    /**
+     * Gets the skin that deforms the vertices.
+     *
+     * @return The skin.
+     */
+    MeshSkin* getSkin() const;
+
+    /**
+     * Gets the format of the vertices.
+     *
+     * @return The vertex format.
+     */
+    const VertexFormat& getVertexFormat() const;
+
+    /**
+     * Gets the number of vertices.
+     *
+     * @return The vertex count.
+     */
+    unsigned int getVertexCount() const;
+
+    /**
+     * Gets the vertices as deformed by the last call to deform.
+     *
+     * @return The skinned vertices, in the vertex format of the deformer.
+     */
+    const void* getVertexData() const;
+
+    /**
+     * Deforms the vertices by the current pose of the skin's joints.
+     */
+    void deform();
+
+    /**
+     * Deforms the vertices of several deformers by the current poses of their skins.
+     *
+     * The matrix palettes of the skins are built on the calling thread, then the vertices
+     * of all deformers are skinned in parallel on the job system.
+     *
+     * @param deformers The deformers.
+     * @param deformerCount The number of deformers.
+     * @param jobSystem The job system to deform the vertices on.
+     * @script{ignore}
+     */
+    static void deform(SkinDeformer** deformers, unsigned int deformerCount, vkTools::JobSystem& jobSystem);
+
+    /**
+     * Uploads the skinned vertices to a mesh.
+     *
+     * The mesh should be dynamic and have the vertex format and vertex count of the deformer.
+     *
+     * @param mesh The mesh to upload the vertices to.
+     */
+    void updateMesh(Mesh* mesh) const;
+
+private:
+
+    /**
+     * Constructor.
+     */
+    SkinDeformer(MeshSkin* skin, const VertexFormat& vertexFormat, unsigned int vertexCount);
+
+    /**
+     * Hidden copy constructor.
+     */
+    SkinDeformer(const SkinDeformer& copy);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    SkinDeformer& operator=(const SkinDeformer&);
+
+    /**
+     * Deforms the vertices in the given range.
+     *
+     * @param begin The index of the first vertex.
+     * @param end The index one past the last vertex.
+     * @param palette The matrix palette of the skin.
+     */
+    void deform(unsigned int begin, unsigned int end, const float* palette);
+
+    MeshSkin* _skin;                    // The skin whose palette deforms the vertices.
+    VertexFormat _vertexFormat;         // The format of the vertices.
+    unsigned int _vertexCount;          // The number of vertices.
+    unsigned int _vertexStride;         // The number of floats in a vertex.
+    unsigned int _influenceCount;       // The number of joints influencing each vertex.
+    unsigned int _vectorCount;          // The number of direction vectors (normal, tangent, binormal) per vertex.
+    unsigned int _offsets[4];           // Offsets of the position and direction vectors in a vertex, in floats.
+    float* _source;                     // Bind pose positions, vectors and weights, one array per component.
+    unsigned int* _joints;              // Palette index of each influence, one array per influence.
+    float* _vertices;                   // The skinned vertices.
+};
+
+}
+
+#endif
@@ -239,6 +239,19 @@ void SpriteBatch::draw(float x, float y, float z, float width, float height, flo
 void SpriteBatch::draw(const Vector3& position, const Vector3& right, const Vector3& forward, float width, float height,
     float u1, float v1, float u2, float v2, const Vector4& color, const Vector2& rotationPoint, float rotationAngle)
 {
+    // Add the sprite vertex data to the batch.
+    SpriteVertex v[4];
+    computeSprite(position, right, forward, width, height, u1, v1, u2, v2, color, rotationPoint, rotationAngle, v);
+
+    static const unsigned short indices[4] = { 0, 1, 2, 3 };
+    _batch->add(v, 4, const_cast<unsigned short*>(indices), 4);
+}
+
+void SpriteBatch::computeSprite(const Vector3& position, const Vector3& right, const Vector3& forward, float width, float height,
+    float u1, float v1, float u2, float v2, const Vector4& color, const Vector2& rotationPoint, float rotationAngle, SpriteVertex* vertices)
+{
+    GP_ASSERT(vertices);
+
     // Calculate the vertex positions.
     Vector3 tRight(right);
     tRight *= width * 0.5f;
@@ -271,9 +284,9 @@ void SpriteBatch::draw(const Vector3& position, const Vector3& right, const Vect
         rp += tForward;
 
         // Rotate all points the specified amount about the given point (about the up vector).
-        static Vector3 u;
+        Vector3 u;
         Vector3::cross(right, forward, &u);
-        static Matrix rotation;
+        Matrix rotation;
         Matrix::createRotation(u, rotationAngle, &rotation);
         p0 -= rp;
         p0 *= rotation;
@@ -289,16 +302,40 @@ void SpriteBatch::draw(const Vector3& position, const Vector3& right, const Vect
         p3 += rp;
     }
 
+    SPRITE_ADD_VERTEX(vertices[0], p0.x, p0.y, p0.z, u1, v1, color.x, color.y, color.z, color.w);
+    SPRITE_ADD_VERTEX(vertices[1], p1.x, p1.y, p1.z, u2, v1, color.x, color.y, color.z, color.w);
+    SPRITE_ADD_VERTEX(vertices[2], p2.x, p2.y, p2.z, u1, v2, color.x, color.y, color.z, color.w);
+    SPRITE_ADD_VERTEX(vertices[3], p3.x, p3.y, p3.z, u2, v2, color.x, color.y, color.z, color.w);
+}
 
-    // Add the sprite vertex data to the batch.
-    static SpriteVertex v[4];
-    SPRITE_ADD_VERTEX(v[0], p0.x, p0.y, p0.z, u1, v1, color.x, color.y, color.z, color.w);
-    SPRITE_ADD_VERTEX(v[1], p1.x, p1.y, p1.z, u2, v1, color.x, color.y, color.z, color.w);
-    SPRITE_ADD_VERTEX(v[2], p2.x, p2.y, p2.z, u1, v2, color.x, color.y, color.z, color.w);
-    SPRITE_ADD_VERTEX(v[3], p3.x, p3.y, p3.z, u2, v2, color.x, color.y, color.z, color.w);
-    
-    static const unsigned short indices[4] = { 0, 1, 2, 3 };
-    _batch->add(v, 4, const_cast<unsigned short*>(indices), 4);
+SpriteBatch::SpriteVertex* SpriteBatch::addSprites(unsigned int count)
+{
+    GP_ASSERT(_batch);
+
+    if (count == 0)
+        return NULL;
+
+    // Each sprite is a strip of four vertices, connected to the previous one by a degenerate triangle.
+    void* vertices;
+    unsigned short* indices;
+    unsigned int firstVertex;
+    if (!_batch->append(count * 4, count * 6 - 2, &vertices, &indices, &firstVertex))
+        return NULL;
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        unsigned short vertex = (unsigned short)(firstVertex + i * 4);
+        if (i > 0)
+        {
+            *indices++ = vertex - 1;
+            *indices++ = vertex;
+        }
+        *indices++ = vertex;
+        *indices++ = vertex + 1;
+        *indices++ = vertex + 2;
+        *indices++ = vertex + 3;
+    }
+    return (SpriteVertex*)vertices;
 }
 
 void SpriteBatch::draw(float x, float y, float width, float height, float u1, float v1, float u2, float v2, const Vector4& color)
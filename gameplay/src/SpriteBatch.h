@@ -298,6 +298,48 @@ public:
      * @param indexCount The number of indices within the index array.
      */
     void draw(SpriteBatch::SpriteVertex* vertices, unsigned int vertexCount, unsigned short* indices, unsigned int indexCount);
+
+    /**
+     * Adds a number of sprites to the batch and returns their vertices, so that the sprites
+     * can be generated directly into the batch (see computeSprite).
+     *
+     * Each sprite takes four consecutive vertices of the returned array; the indices that
+     * connect them are written by this method. The vertices may be filled from several
+     * threads, and must all be filled before the batch is next drawn to.
+     *
+     * This is for more advanced usage.
+     *
+     * @param count The number of sprites to add.
+     *
+     * @return The vertices of the sprites, or NULL if the batch could not grow to hold them.
+     * @script{ignore}
+     */
+    SpriteBatch::SpriteVertex* addSprites(unsigned int count);
+
+    /**
+     * Computes the vertices of a single sprite, rotated about the implied up vector, as drawn
+     * by the draw method with the same parameters.
+     *
+     * This touches no shared state, so it may be called from any thread; use it with addSprites
+     * to generate many sprites in place.
+     *
+     * @param position The destination position.
+     * @param right The right vector of the sprite quad (should be normalized).
+     * @param forward The forward vector of the sprite quad (should be normalized).
+     * @param width The width of the sprite.
+     * @param height The height of the sprite.
+     * @param u1 Texture coordinate.
+     * @param v1 Texture coordinate.
+     * @param u2 Texture coordinate.
+     * @param v2 Texture coordinate.
+     * @param color The color to tint the sprite. Use white for no tint.
+     * @param rotationPoint The point to rotate around, relative to dst's x and y values.
+     * @param rotationAngle The rotation angle in radians.
+     * @param vertices Populated with the four vertices of the sprite.
+     * @script{ignore}
+     */
+    static void computeSprite(const Vector3& position, const Vector3& right, const Vector3& forward, float width, float height,
+                              float u1, float v1, float u2, float v2, const Vector4& color, const Vector2& rotationPoint, float rotationAngle, SpriteVertex* vertices);
     
     /**
      * Finishes sprite drawing.
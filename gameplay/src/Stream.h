@@ -155,6 +155,59 @@ public:
      */
     virtual bool rewind() = 0;
 
+    /**
+     * Returns the length of the stream in bytes, for streams that may be larger than
+     * length() can express (2 GB where long or size_t is 32 bits).
+     *
+     * @return The length of the stream in bytes, or zero if it is unknown.
+     */
+    virtual int64_t length64() { return (int64_t)length(); }
+
+    /**
+     * Sets the position of the file pointer to an offset from the beginning of the stream,
+     * for streams that may be larger than seek() can reach.
+     *
+     * Use canSeek() to determine if this method is supported.
+     *
+     * @param offset The number of bytes from the beginning of the stream.
+     *
+     * @return True if successful, false otherwise (including for offsets the stream cannot reach).
+     *
+     * @see canSeek()
+     */
+    virtual bool seek64(int64_t offset)
+    {
+        if (offset < 0 || (int64_t)(long int)offset != offset)
+            return false;
+        return seek((long int)offset, SEEK_SET);
+    }
+
+    /**
+     * Returns the contents of the stream as a contiguous block of memory, for streams
+     * that are backed by one (such as a memory mapped file).
+     *
+     * The block holds length() bytes and remains valid until the stream is closed.
+     * Reading through it does not move the file pointer.
+     *
+     * @return The contents of the stream, or NULL if the stream is not memory backed.
+     *
+     * @see FileSystem::MAPPED
+     */
+    virtual const unsigned char* getData() { return NULL; }
+
+    /**
+     * Creates a read-only stream over the same memory as this stream, with its own file
+     * pointer, for streams that are backed by a block of memory.
+     *
+     * Cursors can be read concurrently from different threads. A cursor does not own the
+     * memory; it must be closed before this stream is.
+     *
+     * @return The new stream, positioned at the start, or NULL if the stream is not memory backed.
+     *
+     * @see getData()
+     */
+    virtual Stream* createCursor() { return NULL; }
+
 protected:
     Stream() {};
 private:
@@ -2,7 +2,10 @@
 #include "Terrain.h"
 #include "TerrainPatch.h"
 #include "Node.h"
+#include "Scene.h"
 #include "FileSystem.h"
+#include "Game.h"
+#include "jobsystem.hpp"
 
 namespace vkcore
 {
@@ -22,27 +25,87 @@ static const unsigned int DEFAULT_TERRAIN_PATCH_SIZE = 32;
 //
 static const float DEFAULT_TERRAIN_HEIGHT_RATIO = 0.3f;
 
+// The default largest height error, in pixels, of the level of detail used for a patch.
+static const float DEFAULT_TERRAIN_LOD_ERROR_THRESHOLD = 2.0f;
+
+// The default number of quads along the sides of the pages of a paged terrain
+// definition that does not have a valid page size.
+static const unsigned int DEFAULT_TERRAIN_PAGE_SIZE = 256;
+
+// The default memory budget of the loaded pages of a paged terrain.
+static const size_t DEFAULT_TERRAIN_PAGE_MEMORY_BUDGET = 256 * 1024 * 1024;
+
+// The maximum depth of a quadtree traversal, which visits up to three siblings
+// of each node on the way down.
+#define TERRAIN_QUADTREE_STACK_SIZE 64
+
 // Terrain dirty flags
 static const unsigned int DIRTY_FLAG_INVERSE_WORLD = 1;
+static const unsigned int DIRTY_FLAG_WORLD_BOUNDS = 2;
 
 static float getDefaultHeight(unsigned int width, unsigned int height);
 
 Terrain::Terrain() : Drawable(),
     _heightfield(NULL), _normalMap(NULL), _flags(FRUSTUM_CULLING | LEVEL_OF_DETAIL),
-    _dirtyFlags(DIRTY_FLAG_INVERSE_WORLD)
+    _dirtyFlags(DIRTY_FLAG_INVERSE_WORLD | DIRTY_FLAG_WORLD_BOUNDS),
+    _lodErrorThreshold(DEFAULT_TERRAIN_LOD_ERROR_THRESHOLD), _worldScaleY(1.0f),
+    _width(0), _height(0), _patchSize(0), _maxStep(1), _skirtScale(0.0f), _pageSize(0), _pageColumns(0),
+    _pageDistance(0.0f), _pageMemoryBudget(DEFAULT_TERRAIN_PAGE_MEMORY_BUDGET), _jobSystem(NULL)
 {
 }
 
 Terrain::~Terrain()
 {
-    for (size_t i = 0, count = _patches.size(); i < count; ++i)
+    if (_pages.empty())
     {
-        SAFE_DELETE(_patches[i]);
+        for (size_t i = 0, count = _patches.size(); i < count; ++i)
+        {
+            SAFE_DELETE(_patches[i]);
+        }
+    }
+    _patches.clear();
+
+    // The patches of paged terrains belong to their pages
+    for (size_t i = 0, count = _pages.size(); i < count; ++i)
+    {
+        Page* page = _pages[i];
+        if (page->job)
+        {
+            page->cancelled.store(true, std::memory_order_relaxed);
+            _jobSystem->wait(*page->job);
+        }
+        SAFE_DELETE(page);
     }
     SAFE_RELEASE(_normalMap);
     SAFE_RELEASE(_heightfield);
 }
 
+Terrain::Page::Page() :
+    x1(0), z1(0), x2(0), z2(0), state(UNLOADED), memory(0), distance(0.0f),
+    heights(NULL), heightsX(0), heightsZ(0), cancelled(false), built(false), job(NULL)
+{
+}
+
+Terrain::Page::~Page()
+{
+    clear();
+    SAFE_DELETE(job);
+}
+
+void Terrain::Page::clear()
+{
+    for (size_t i = 0, count = patches.size(); i < count; ++i)
+    {
+        SAFE_DELETE(patches[i]);
+    }
+    patches.clear();
+    quadtree.clear();
+    quadtreeBounds.clear();
+    SAFE_RELEASE(heights);
+    heightsX = 0;
+    heightsZ = 0;
+}
+
 Terrain* Terrain::create(const char* path)
 {
     return create(path, NULL);
@@ -66,6 +129,8 @@ Terrain* Terrain::create(const char* path, Properties* properties)
     float skirtScale = 0;
     const char* normalMap = NULL;
     std::string materialPath;
+    std::string pagePath;
+    Vector2 pageImageSize;
 
     if (!p && path)
     {
@@ -119,8 +184,17 @@ Terrain* Terrain::create(const char* path, Properties* properties)
                 return NULL;
             }
 
-            // Read normalized height values from RAW file
-            heightfield = HeightField::createFromRAW(heightmap.c_str(), (unsigned int)imageSize.x, (unsigned int)imageSize.y, 0, 1);
+            if (pTerrain->exists("pageSize"))
+            {
+                // Paged terrains read the RAW file a page at a time as they are drawn
+                pagePath = heightmap;
+                pageImageSize = imageSize;
+            }
+            else
+            {
+                // Read normalized height values from RAW file
+                heightfield = HeightField::createFromRAW(heightmap.c_str(), (unsigned int)imageSize.x, (unsigned int)imageSize.y, 0, 1);
+            }
         }
         else
         {
@@ -198,6 +272,35 @@ Terrain* Terrain::create(const char* path, Properties* properties)
     // Read 'material'
     materialPath = pTerrain->getString("material", "");
 
+    if (!pagePath.empty())
+    {
+        unsigned int width = (unsigned int)pageImageSize.x;
+        unsigned int height = (unsigned int)pageImageSize.y;
+        if (terrainSize.isZero())
+            terrainSize.set(width, getDefaultHeight(width, height), height);
+        if (patchSize <= 0 || patchSize > (int)width || patchSize > (int)height)
+            patchSize = std::min(height, std::min(width, DEFAULT_TERRAIN_PATCH_SIZE));
+        Vector3 scale(terrainSize.x / (width-1), terrainSize.y, terrainSize.z / (height-1));
+        int pageSize = pTerrain->getInt("pageSize");
+
+        Terrain* terrain = createPaged(pagePath.c_str(), width, height, scale, pageSize > 0 ? (unsigned int)pageSize : DEFAULT_TERRAIN_PAGE_SIZE,
+                                       (unsigned int)patchSize, (unsigned int)std::max(detailLevels, 1), std::max(skirtScale, 0.0f),
+                                       normalMap, materialPath.c_str(), pTerrain);
+        if (terrain)
+        {
+            if (pTerrain->exists("pageDistance"))
+                terrain->setPageDistance(pTerrain->getFloat("pageDistance"));
+            if (pTerrain->exists("pageMemoryBudget"))
+                terrain->setPageMemoryBudget((size_t)(pTerrain->getFloat("pageMemoryBudget") * 1024 * 1024));
+            if (pTerrain->exists("lodErrorThreshold"))
+                terrain->setLODErrorThreshold(pTerrain->getFloat("lodErrorThreshold"));
+        }
+
+        if (!externalProperties)
+            SAFE_DELETE(p);
+        return terrain;
+    }
+
     if (heightfield == NULL)
     {
         GP_WARN("Failed to read heightfield heights for terrain definition: %s", path);
@@ -228,6 +331,9 @@ Terrain* Terrain::create(const char* path, Properties* properties)
     // Create terrain
     Terrain* terrain = create(heightfield, scale, (unsigned int)patchSize, (unsigned int)detailLevels, skirtScale, normalMap, materialPath.c_str(), pTerrain);
 
+    if (terrain && pTerrain->exists("lodErrorThreshold"))
+        terrain->setLODErrorThreshold(pTerrain->getFloat("lodErrorThreshold"));
+
     if (!externalProperties)
         SAFE_DELETE(p);
 
@@ -273,8 +379,14 @@ Terrain* Terrain::create(HeightField* heightfield, const Vector3& scale,
     // This determines how many vertices will be skipped per triange/quad on the lowest
     // level detail terrain patch.
     unsigned int maxStep = (unsigned int)std::pow(2.0, (double)(detailLevels-1));
+    terrain->_width = width;
+    terrain->_height = height;
+    terrain->_patchSize = patchSize;
+    terrain->_maxStep = maxStep;
+    terrain->_skirtScale = skirtScale;
 
     // Create terrain patches
+    TerrainPatch::Heights heights = { heightfield->getArray(), 0, 0, width };
     unsigned int x1, x2, z1, z2;
     unsigned int row = 0, column = 0;
     for (unsigned int z = 0; z < height-1; z = z2, ++row)
@@ -288,7 +400,8 @@ Terrain* Terrain::create(HeightField* heightfield, const Vector3& scale,
             x2 = std::min(x1 + patchSize, width-1);
 
             // Create this patch
-            TerrainPatch* patch = TerrainPatch::create(terrain, terrain->_patches.size(), row, column, heightfield->getArray(), width, height, x1, z1, x2, z2, -halfWidth, -halfHeight, maxStep, skirtScale);
+            TerrainPatch* patch = TerrainPatch::create(terrain, terrain->_patches.size(), row, column, heights, width, height, x1, z1, x2, z2, -halfWidth, -halfHeight, maxStep, skirtScale);
+            patch->createModels();
             terrain->_patches.push_back(patch);
 
             // Append the new patch's local bounds to the terrain local bounds
@@ -296,84 +409,205 @@ Terrain* Terrain::create(HeightField* heightfield, const Vector3& scale,
         }
     }
 
+    // Build the quadtree over the patches, which are stored row by row
+    unsigned int columnCount = (width - 2) / patchSize + 1;
+    buildQuadtree(terrain->_quadtree, terrain->_patches, 0, 0, row, columnCount, columnCount);
+
+    // Read additional layer information from properties (if specified)
+    if (properties)
+        terrain->setLayers(properties);
+
+    // Load materials for all patches
+    for (size_t i = 0, count = terrain->_patches.size(); i < count; ++i)
+        terrain->_patches[i]->updateMaterial();
+
+    return terrain;
+}
+
+Terrain* Terrain::createPaged(const char* path, unsigned int width, unsigned int height, const Vector3& scale,
+    unsigned int pageSize, unsigned int patchSize, unsigned int detailLevels, float skirtScale,
+    const char* normalMapPath, const char* materialPath)
+{
+    return createPaged(path, width, height, scale, pageSize, patchSize, detailLevels, skirtScale, normalMapPath, materialPath, NULL);
+}
+
+Terrain* Terrain::createPaged(const char* path, unsigned int width, unsigned int height, const Vector3& scale,
+    unsigned int pageSize, unsigned int patchSize, unsigned int detailLevels, float skirtScale,
+    const char* normalMapPath, const char* materialPath, Properties* properties)
+{
+    GP_ASSERT(path);
+
+    std::string ext = FileSystem::getExtension(path);
+    if (ext != ".RAW" && ext != ".R16")
+    {
+        GP_WARN("Paged terrains require a RAW heightmap: %s", path);
+        return NULL;
+    }
+    if (width < 2 || height < 2 || patchSize == 0 || detailLevels == 0)
+    {
+        GP_WARN("Invalid size, patch size or detail levels for paged terrain: %s", path);
+        return NULL;
+    }
+    if (!FileSystem::fileExists(path))
+    {
+        GP_WARN("Failed to find heightmap for paged terrain: %s", path);
+        return NULL;
+    }
+
+    // Pages hold whole patches
+    pageSize = std::max((pageSize + patchSize - 1) / patchSize, 1u) * patchSize;
+
+    // Create the terrain object
+    Terrain* terrain = new Terrain();
+    terrain->_materialPath = (materialPath == NULL || strlen(materialPath) == 0) ? TERRAIN_MATERIAL : materialPath;
+    terrain->_localScale.set(scale);
+
+    if (normalMapPath)
+    {
+        terrain->_normalMap = Texture::Sampler::create(normalMapPath, true);
+        terrain->_normalMap->setWrapMode(Texture::CLAMP, Texture::CLAMP);
+        GP_ASSERT( terrain->_normalMap->getTexture()->getType() == Texture::TEXTURE_2D );
+    }
+
+    unsigned int maxStep = (unsigned int)std::pow(2.0, (double)(detailLevels-1));
+    terrain->_pagePath = path;
+    terrain->_width = width;
+    terrain->_height = height;
+    terrain->_patchSize = patchSize;
+    terrain->_maxStep = maxStep;
+    terrain->_skirtScale = skirtScale;
+    terrain->_pageSize = pageSize;
+    terrain->_pageColumns = (width - 2) / pageSize + 1;
+    terrain->_pageDistance = 2.0f * pageSize * std::max(fabs(scale.x), fabs(scale.z));
+
+    float halfWidth = (width - 1) * 0.5f;
+    float halfHeight = (height - 1) * 0.5f;
+
+    // Until a page is loaded its bounds span the whole range of normalized heights, skirts included
+    float minY = std::min(0.0f, scale.y) - fabs(skirtScale * scale.y);
+    float maxY = std::max(0.0f, scale.y);
+
+    // Approximate memory of the vertices of a level, on the GPU and kept on the CPU for morphing,
+    // and of its morph offsets, heights and indices
+    unsigned int vertexElements = terrain->_normalMap ? 5 : 8;
+    size_t vertexMemory = vertexElements * sizeof(float) * 2 + sizeof(float) * 2 + sizeof(unsigned short) * 2;
+
+    BoundingBox& bounds = terrain->_boundingBox;
+    bounds = BoundingBox::empty();
+    for (unsigned int z = 0; z < height - 1; z += pageSize)
+    {
+        for (unsigned int x = 0; x < width - 1; x += pageSize)
+        {
+            Page* page = new Page();
+            page->x1 = x;
+            page->z1 = z;
+            page->x2 = std::min(x + pageSize, width - 1);
+            page->z2 = std::min(z + pageSize, height - 1);
+
+            Vector3 corner1((page->x1 - halfWidth) * scale.x, minY, (page->z1 - halfHeight) * scale.z);
+            Vector3 corner2((page->x2 - halfWidth) * scale.x, maxY, (page->z2 - halfHeight) * scale.z);
+            page->bounds = BoundingBox::empty();
+            page->bounds.merge(BoundingBox(corner1, corner1));
+            page->bounds.merge(BoundingBox(corner2, corner2));
+            bounds.merge(page->bounds);
+
+            // The heights are read with a border of the largest step for the vertex normals
+            unsigned int columns = page->x2 - page->x1;
+            unsigned int rows = page->z2 - page->z1;
+            unsigned int heightColumns = std::min(page->x2 + maxStep, width - 1) - (page->x1 - std::min(page->x1, maxStep)) + 1;
+            unsigned int heightRows = std::min(page->z2 + maxStep, height - 1) - (page->z1 - std::min(page->z1, maxStep)) + 1;
+            page->memory = (size_t)heightColumns * heightRows * sizeof(float);
+
+            size_t patchCount = (size_t)((columns + patchSize - 1) / patchSize) * ((rows + patchSize - 1) / patchSize);
+            for (unsigned int step = 1; step <= maxStep; step *= 2)
+            {
+                size_t side = std::max(patchSize / step, 1u) + (skirtScale > 0 ? 3 : 1);
+                page->memory += patchCount * side * side * vertexMemory;
+            }
+
+            terrain->_pages.push_back(page);
+        }
+    }
+
     // Read additional layer information from properties (if specified)
     if (properties)
+        terrain->setLayers(properties);
+
+    return terrain;
+}
+
+void Terrain::setLayers(Properties* properties)
+{
+    GP_ASSERT(properties);
+
+    // Parse terrain layers
+    Properties* lp;
+    int index = -1;
+    while ((lp = properties->getNextNamespace()) != NULL)
     {
-        // Parse terrain layers
-        Properties* lp;
-        int index = -1;
-        while ((lp = properties->getNextNamespace()) != NULL)
+        if (strcmp(lp->getNamespace(), "layer") == 0)
         {
-            if (strcmp(lp->getNamespace(), "layer") == 0)
+            // If there is no explicitly specified index for this layer, assume it's the 'next' layer
+            if (lp->exists("index"))
+                index = lp->getInt("index");
+            else
+                ++index;
+
+            std::string textureMap;
+            const char* textureMapPtr = NULL;
+            std::string blendMap;
+            const char* blendMapPtr = NULL;
+            Vector2 textureRepeat;
+            int blendChannel = 0;
+            int row = -1, column = -1;
+            Vector4 temp;
+
+            // Read layer textures
+            Properties* t = lp->getNamespace("texture", true);
+            if (t)
             {
-                // If there is no explicitly specified index for this layer, assume it's the 'next' layer
-                if (lp->exists("index"))
-                    index = lp->getInt("index");
-                else
-                    ++index;
-
-                std::string textureMap;
-                const char* textureMapPtr = NULL;
-                std::string blendMap;
-                const char* blendMapPtr = NULL;
-                Vector2 textureRepeat;
-                int blendChannel = 0;
-                int row = -1, column = -1;
-                Vector4 temp;
-
-                // Read layer textures
-                Properties* t = lp->getNamespace("texture", true);
-                if (t)
+                if (t->getPath("path", &textureMap))
                 {
-                    if (t->getPath("path", &textureMap))
-                    {
-                        textureMapPtr = textureMap.c_str();
-                    }
-                    if (!t->getVector2("repeat", &textureRepeat))
-                        textureRepeat.set(1,1);
+                    textureMapPtr = textureMap.c_str();
                 }
+                if (!t->getVector2("repeat", &textureRepeat))
+                    textureRepeat.set(1,1);
+            }
 
-                Properties* b = lp->getNamespace("blend", true);
-                if (b)
+            Properties* b = lp->getNamespace("blend", true);
+            if (b)
+            {
+                if (b->getPath("path", &blendMap))
                 {
-                    if (b->getPath("path", &blendMap))
-                    {
-                        blendMapPtr = blendMap.c_str();
-                    }
-                    const char* channel = b->getString("channel");
-                    if (channel && strlen(channel) > 0)
-                    {
-                        char c = std::toupper(channel[0]);
-                        if (c == 'R' || c == '0')
-                            blendChannel = 0;
-                        else if (c == 'G' || c == '1')
-                            blendChannel = 1;
-                        else if (c == 'B' || c == '2')
-                            blendChannel = 2;
-                        else if (c == 'A' || c == '3')
-                            blendChannel = 3;
-                    }
+                    blendMapPtr = blendMap.c_str();
                 }
-
-                // Get patch row/columns that this layer applies to.
-                if (lp->exists("row"))
-                    row = lp->getInt("row");
-                if (lp->exists("column"))
-                    column = lp->getInt("column");
-
-                if (!terrain->setLayer(index, textureMapPtr, textureRepeat, blendMapPtr, blendChannel, row, column))
+                const char* channel = b->getString("channel");
+                if (channel && strlen(channel) > 0)
                 {
-                    GP_WARN("Failed to load terrain layer: %s", textureMap.c_str());
+                    char c = std::toupper(channel[0]);
+                    if (c == 'R' || c == '0')
+                        blendChannel = 0;
+                    else if (c == 'G' || c == '1')
+                        blendChannel = 1;
+                    else if (c == 'B' || c == '2')
+                        blendChannel = 2;
+                    else if (c == 'A' || c == '3')
+                        blendChannel = 3;
                 }
             }
-        }
-    }
 
-    // Load materials for all patches
-    for (size_t i = 0, count = terrain->_patches.size(); i < count; ++i)
-        terrain->_patches[i]->updateMaterial();
+            // Get patch row/columns that this layer applies to.
+            if (lp->exists("row"))
+                row = lp->getInt("row");
+            if (lp->exists("column"))
+                column = lp->getInt("column");
 
-    return terrain;
+            if (!setLayer(index, textureMapPtr, textureRepeat, blendMapPtr, blendChannel, row, column))
+            {
+                GP_WARN("Failed to load terrain layer: %s", textureMap.c_str());
+            }
+        }
+    }
 }
 
 void Terrain::setNode(Node* node)
@@ -393,14 +627,20 @@ void Terrain::setNode(Node* node)
         for (size_t i = 0, count = _patches.size(); i < count; ++i)
         {
             _patches[i]->updateNodeBindings();
+            _patches[i]->setBoundsDirty();
         }
-        _dirtyFlags |= DIRTY_FLAG_INVERSE_WORLD;
+        _dirtyFlags |= DIRTY_FLAG_INVERSE_WORLD | DIRTY_FLAG_WORLD_BOUNDS;
     }
 }
 
 void Terrain::transformChanged(Transform* transform, long cookie)
 {
-    _dirtyFlags |= DIRTY_FLAG_INVERSE_WORLD;
+    _dirtyFlags |= DIRTY_FLAG_INVERSE_WORLD | DIRTY_FLAG_WORLD_BOUNDS;
+
+    for (size_t i = 0, count = _patches.size(); i < count; ++i)
+    {
+        _patches[i]->setBoundsDirty();
+    }
 }
 
 const Matrix& Terrain::getInverseWorldMatrix() const
@@ -430,6 +670,31 @@ bool Terrain::setLayer(int index, const char* texturePath, const Vector2& textur
     if (!texturePath)
         return false;
 
+    // Paged terrains also set the layer on the patches of pages loaded later
+    if (!_pages.empty())
+    {
+        PageLayer layer;
+        layer.index = index;
+        layer.texturePath = texturePath;
+        layer.textureRepeat = textureRepeat;
+        layer.blendPath = blendPath ? blendPath : "";
+        layer.blendChannel = blendChannel;
+        layer.row = row;
+        layer.column = column;
+
+        size_t i = 0;
+        for (size_t count = _pageLayers.size(); i < count; ++i)
+        {
+            const PageLayer& other = _pageLayers[i];
+            if (other.index == index && other.row == row && other.column == column)
+                break;
+        }
+        if (i < _pageLayers.size())
+            _pageLayers[i] = layer;
+        else
+            _pageLayers.push_back(layer);
+    }
+
     // Set layer on applicable patches
     bool result = true;
     for (size_t i = 0, count = _patches.size(); i < count; ++i)
@@ -479,6 +744,30 @@ void Terrain::setFlag(Flags flag, bool on)
             _patches[i]->setMaterialDirty();
         }
     }
+    else if (flag == LEVEL_OF_DETAIL && changed)
+    {
+        for (size_t i = 0, count = _patches.size(); i < count; ++i)
+        {
+            _patches[i]->setLevelDirty();
+        }
+    }
+}
+
+void Terrain::setLODErrorThreshold(float pixels)
+{
+    if (_lodErrorThreshold == pixels)
+        return;
+
+    _lodErrorThreshold = pixels;
+    for (size_t i = 0, count = _patches.size(); i < count; ++i)
+    {
+        _patches[i]->setLevelDirty();
+    }
+}
+
+float Terrain::getLODErrorThreshold() const
+{
+    return _lodErrorThreshold;
 }
 
 unsigned int Terrain::getPatchCount() const
@@ -499,8 +788,8 @@ const BoundingBox& Terrain::getBoundingBox() const
 float Terrain::getHeight(float x, float z) const
 {
     // Calculate the correct x, z position relative to the heightfield data.
-    float cols = _heightfield->getColumnCount();
-    float rows = _heightfield->getRowCount();
+    float cols = _width;
+    float rows = _height;
 
     GP_ASSERT(cols > 0);
     GP_ASSERT(rows > 0);
@@ -512,8 +801,21 @@ float Terrain::getHeight(float x, float z) const
     x = v.x + (cols - 1) * 0.5f;
     z = v.z + (rows - 1) * 0.5f;
 
-    // Get the unscaled height value from the HeightField
-    float height = _heightfield->getHeight(x, z);
+    // Get the unscaled height value from the HeightField, or from that of a loaded page
+    float height;
+    if (_pages.empty())
+    {
+        height = _heightfield->getHeight(x, z);
+    }
+    else
+    {
+        x = std::max(0.0f, std::min(x, cols - 1));
+        z = std::max(0.0f, std::min(z, rows - 1));
+        Page* page = getPage(x, z);
+        if (page->state != Page::LOADED)
+            return 0.0f;
+        height = page->heights->getHeight(x - page->heightsX, z - page->heightsZ);
+    }
 
     // Apply world scale to the height value
     if (_node)
@@ -529,16 +831,508 @@ float Terrain::getHeight(float x, float z) const
     return height;
 }
 
+bool Terrain::isLoaded(float x, float z) const
+{
+    if (_pages.empty())
+        return true;
+
+    Vector3 v = getInverseWorldMatrix() * Vector3(x, 0.0f, z);
+    return getPage(v.x + (_width - 1) * 0.5f, v.z + (_height - 1) * 0.5f)->state == Page::LOADED;
+}
+
+int Terrain::buildQuadtree(std::vector<QuadtreeNode>& quadtree, const std::vector<TerrainPatch*>& patches,
+                           unsigned int row1, unsigned int column1, unsigned int row2, unsigned int column2, unsigned int columnCount)
+{
+    GP_ASSERT(row1 < row2 && column1 < column2);
+
+    int index = (int)quadtree.size();
+    QuadtreeNode node;
+    node.bounds = BoundingBox::empty();
+    node.error = 0.0f;
+    node.patch = -1;
+    for (unsigned int i = 0; i < 4; ++i)
+        node.children[i] = -1;
+    quadtree.push_back(node);
+
+    if (row2 - row1 == 1 && column2 - column1 == 1)
+    {
+        TerrainPatch* patch = patches[row1 * columnCount + column1];
+        QuadtreeNode& leaf = quadtree[index];
+        leaf.patch = (int)(row1 * columnCount + column1);
+        leaf.bounds.set(patch->getBoundingBox(false));
+        leaf.error = patch->_levels.back()->error;
+        return index;
+    }
+
+    // Split the rows and columns in halves, skipping the halves that are empty
+    unsigned int rowSplit = (row1 + row2 + 1) / 2;
+    unsigned int columnSplit = (column1 + column2 + 1) / 2;
+    unsigned int rows[3] = { row1, rowSplit, row2 };
+    unsigned int columns[3] = { column1, columnSplit, column2 };
+    unsigned int childCount = 0;
+    for (unsigned int r = 0; r < 2; ++r)
+    {
+        for (unsigned int c = 0; c < 2; ++c)
+        {
+            if (rows[r] < rows[r + 1] && columns[c] < columns[c + 1])
+            {
+                int child = buildQuadtree(quadtree, patches, rows[r], columns[c], rows[r + 1], columns[c + 1], columnCount);
+                QuadtreeNode& parent = quadtree[index];
+                parent.children[childCount++] = child;
+                parent.bounds.merge(quadtree[child].bounds);
+                parent.error = std::max(parent.error, quadtree[child].error);
+            }
+        }
+    }
+
+    return index;
+}
+
+void Terrain::updateWorldBounds() const
+{
+    if (!(_dirtyFlags & DIRTY_FLAG_WORLD_BOUNDS))
+        return;
+
+    _dirtyFlags &= ~DIRTY_FLAG_WORLD_BOUNDS;
+
+    _quadtreeBounds.resize(_quadtree.size());
+    for (size_t i = 0, count = _quadtree.size(); i < count; ++i)
+    {
+        transformBounds(_quadtree[i].bounds, &_quadtreeBounds[i]);
+    }
+
+    // The quadtrees of pages that are still loading belong to their jobs
+    for (size_t i = 0, count = _pages.size(); i < count; ++i)
+    {
+        Page* page = _pages[i];
+        transformBounds(page->bounds, &page->worldBounds);
+        if (page->state != Page::LOADED)
+            continue;
+
+        page->quadtreeBounds.resize(page->quadtree.size());
+        for (size_t j = 0, nodeCount = page->quadtree.size(); j < nodeCount; ++j)
+        {
+            transformBounds(page->quadtree[j].bounds, &page->quadtreeBounds[j]);
+        }
+    }
+
+    _worldScaleY = 1.0f;
+    if (_node)
+    {
+        Vector3 worldScale;
+        _node->getWorldMatrix().getScale(&worldScale);
+        _worldScaleY = worldScale.y;
+    }
+}
+
+void Terrain::transformBounds(const BoundingBox& bounds, BoundingBox* worldBounds) const
+{
+    GP_ASSERT(worldBounds);
+
+    worldBounds->set(bounds);
+    if (_node)
+        worldBounds->transform(_node->getWorldMatrix());
+}
+
+float Terrain::computeErrorScale(Camera* camera, const BoundingBox& worldBounds) const
+{
+    GP_ASSERT(camera);
+
+    updateWorldBounds();
+
+    float viewportHeight = (float)Game::getInstance()->getHeight();
+    if (camera->getCameraType() == Camera::ORTHOGRAPHIC)
+        return _worldScaleY * viewportHeight / camera->getZoomY();
+
+    // Distance from the camera to the nearest point of the bounds
+    Vector3 eye;
+    camera->getInverseViewMatrix().getTranslation(&eye);
+    Vector3 nearest;
+    Vector3::clamp(eye, worldBounds.min, worldBounds.max, &nearest);
+    float distance = std::max(eye.distance(nearest), camera->getNearPlane());
+
+    float pixelsPerUnit = viewportHeight / (2.0f * tan(MATH_DEG_TO_RAD(camera->getFieldOfView()) * 0.5f));
+    return _worldScaleY * pixelsPerUnit / distance;
+}
+
 unsigned int Terrain::draw(bool wireframe)
 {
+    Scene* scene = _node ? _node->getScene() : NULL;
+    Camera* camera = scene ? scene->getActiveCamera() : NULL;
+    if (!camera)
+        return 0;
+
+    updateWorldBounds();
+
+    if (_pages.empty())
+        return _quadtree.empty() ? 0 : drawQuadtree(_quadtree, _quadtreeBounds, _patches, camera, wireframe);
+
+    // Cull whole pages before walking their quadtrees
+    const Frustum& frustum = camera->getFrustum();
+    bool frustumCulling = isFlagSet(FRUSTUM_CULLING);
+    unsigned int visibleCount = 0;
+    for (size_t i = 0, count = _pages.size(); i < count; ++i)
+    {
+        Page* page = _pages[i];
+        if (page->state != Page::LOADED || (frustumCulling && !frustum.intersects(page->worldBounds)))
+            continue;
+
+        visibleCount += drawQuadtree(page->quadtree, page->quadtreeBounds, page->patches, camera, wireframe);
+    }
+    return visibleCount;
+}
+
+unsigned int Terrain::drawQuadtree(const std::vector<QuadtreeNode>& quadtree, const std::vector<BoundingBox>& worldBounds,
+                                   const std::vector<TerrainPatch*>& patches, Camera* camera, bool wireframe)
+{
+    GP_ASSERT(camera && !quadtree.empty() && worldBounds.size() == quadtree.size());
+
+    const Frustum& frustum = camera->getFrustum();
+    bool frustumCulling = isFlagSet(FRUSTUM_CULLING);
+    bool levelOfDetail = isFlagSet(LEVEL_OF_DETAIL);
+
+    // Walk the quadtree, culling whole regions that are outside of the view, and drawing
+    // whole regions whose coarsest levels are within the error threshold at those levels
+    int stack[TERRAIN_QUADTREE_STACK_SIZE];
+    bool coarsest[TERRAIN_QUADTREE_STACK_SIZE];
+    unsigned int size = 0;
+    stack[size] = 0;
+    coarsest[size++] = false;
+
     size_t visibleCount = 0;
-    for (size_t i = 0, count = _patches.size(); i < count; ++i)
+    while (size > 0)
     {
-        visibleCount += _patches[i]->draw(wireframe);
+        --size;
+        const QuadtreeNode& node = quadtree[stack[size]];
+        const BoundingBox& bounds = worldBounds[stack[size]];
+        bool nodeCoarsest = coarsest[size];
+
+        // If the box does not intersect the view frustum, cull it
+        if (frustumCulling && !frustum.intersects(bounds))
+            continue;
+
+        if (levelOfDetail && !nodeCoarsest && node.error * computeErrorScale(camera, bounds) <= _lodErrorThreshold)
+            nodeCoarsest = true;
+
+        if (node.patch >= 0)
+        {
+            visibleCount += patches[node.patch]->draw(camera, wireframe, nodeCoarsest);
+            continue;
+        }
+
+        for (unsigned int i = 0; i < 4 && node.children[i] >= 0; ++i)
+        {
+            GP_ASSERT(size < TERRAIN_QUADTREE_STACK_SIZE);
+            stack[size] = node.children[i];
+            coarsest[size++] = nodeCoarsest;
+        }
     }
     return visibleCount;
 }
 
+bool Terrain::isPaged() const
+{
+    return !_pages.empty();
+}
+
+void Terrain::setJobSystem(vkTools::JobSystem* jobSystem)
+{
+    if (_jobSystem == jobSystem)
+        return;
+
+    // Jobs already running on the previous job system are waited for; their pages are hooked up as usual
+    for (size_t i = 0, count = _pages.size(); i < count; ++i)
+    {
+        Page* page = _pages[i];
+        if (page->job)
+        {
+            _jobSystem->wait(*page->job);
+            SAFE_DELETE(page->job);
+        }
+    }
+    _jobSystem = jobSystem;
+}
+
+vkTools::JobSystem* Terrain::getJobSystem() const
+{
+    return _jobSystem;
+}
+
+void Terrain::setPageDistance(float distance)
+{
+    _pageDistance = distance;
+}
+
+float Terrain::getPageDistance() const
+{
+    return _pageDistance;
+}
+
+void Terrain::setPageMemoryBudget(size_t bytes)
+{
+    _pageMemoryBudget = bytes;
+}
+
+size_t Terrain::getPageMemoryBudget() const
+{
+    return _pageMemoryBudget;
+}
+
+size_t Terrain::getPageMemoryUsage() const
+{
+    size_t memory = 0;
+    for (size_t i = 0, count = _pages.size(); i < count; ++i)
+    {
+        if (_pages[i]->state == Page::LOADING || _pages[i]->state == Page::LOADED)
+            memory += _pages[i]->memory;
+    }
+    return memory;
+}
+
+unsigned int Terrain::updatePages(float budget)
+{
+    Scene* scene = _node ? _node->getScene() : NULL;
+    Camera* camera = scene ? scene->getActiveCamera() : NULL;
+    if (!camera || _pages.empty())
+        return 0;
+
+    updateWorldBounds();
+
+    // Sort the pages by their distance from the camera
+    Vector3 eye;
+    camera->getInverseViewMatrix().getTranslation(&eye);
+    std::vector<Page*> pages(_pages);
+    for (size_t i = 0, count = pages.size(); i < count; ++i)
+    {
+        Page* page = pages[i];
+        Vector3 nearest;
+        Vector3::clamp(eye, page->worldBounds.min, page->worldBounds.max, &nearest);
+        page->distance = eye.distance(nearest);
+    }
+    std::sort(pages.begin(), pages.end(), [](const Page* a, const Page* b) { return a->distance < b->distance; });
+
+    // Keep the nearest pages that fit in the memory budget, requesting those within the page
+    // distance, and unload the others. The nearest page is always kept.
+    size_t memory = 0;
+    for (size_t i = 0, count = pages.size(); i < count; ++i)
+    {
+        Page* page = pages[i];
+        if (page->state == Page::FAILED || page->cancelled.load(std::memory_order_relaxed))
+            continue;
+        if (page->state == Page::UNLOADED && page->distance > _pageDistance)
+            continue;
+
+        if (memory == 0 || memory + page->memory <= _pageMemoryBudget)
+        {
+            memory += page->memory;
+            if (page->state == Page::UNLOADED)
+                loadPage(page);
+        }
+        else
+        {
+            unloadPage(page);
+        }
+    }
+
+    // Hook up the built pages, nearest first, until the time budget is spent
+    double start = Game::getAbsoluteTime();
+    unsigned int finished = 0;
+    unsigned int loading = 0;
+    for (size_t i = 0, count = pages.size(); i < count; ++i)
+    {
+        Page* page = pages[i];
+        if (page->state != Page::LOADING)
+            continue;
+
+        bool built = page->built.load(std::memory_order_acquire);
+        if (!built && page->job)
+        {
+            ++loading;
+            continue;
+        }
+
+        // Discarding a cancelled page is cheap and does not count against the time budget
+        bool cancelled = page->cancelled.load(std::memory_order_relaxed);
+        if (!cancelled && finished > 0 && Game::getAbsoluteTime() - start >= budget)
+        {
+            ++loading;
+            continue;
+        }
+
+        // Without a job system, pages are built here
+        if (!built)
+            buildPage(page);
+        finishPage(page);
+        if (!cancelled)
+            ++finished;
+    }
+    return loading;
+}
+
+void Terrain::loadPage(Page* page)
+{
+    GP_ASSERT(page && page->state == Page::UNLOADED && page->job == NULL);
+
+    page->state = Page::LOADING;
+    page->cancelled.store(false, std::memory_order_relaxed);
+    page->built.store(false, std::memory_order_relaxed);
+
+    if (_jobSystem)
+    {
+        Terrain* terrain = this;
+        page->job = new vkTools::JobHandle(_jobSystem->run([terrain, page]()
+        {
+            terrain->buildPage(page);
+        }));
+    }
+}
+
+void Terrain::buildPage(Page* page)
+{
+    GP_ASSERT(page);
+
+    if (!page->cancelled.load(std::memory_order_relaxed))
+    {
+        // Read the heights of the page with a border of the largest step, which the vertex normals sample
+        unsigned int x1 = page->x1 - std::min(page->x1, _maxStep);
+        unsigned int z1 = page->z1 - std::min(page->z1, _maxStep);
+        unsigned int x2 = std::min(page->x2 + _maxStep, _width - 1);
+        unsigned int z2 = std::min(page->z2 + _maxStep, _height - 1);
+        page->heights = HeightField::createFromRAW(_pagePath.c_str(), _width, _height, x1, z1, x2 - x1 + 1, z2 - z1 + 1, 0, 1);
+    }
+
+    if (page->heights)
+    {
+        page->heightsX = page->x1 - std::min(page->x1, _maxStep);
+        page->heightsZ = page->z1 - std::min(page->z1, _maxStep);
+        TerrainPatch::Heights heights = { page->heights->getArray(), page->heightsX, page->heightsZ, page->heights->getColumnCount() };
+
+        float halfWidth = (_width - 1) * 0.5f;
+        float halfHeight = (_height - 1) * 0.5f;
+        unsigned int patchColumns = (_width - 2) / _patchSize + 1;
+
+        // Create the patches of the page, with the rows, columns and indices they have in the whole terrain
+        unsigned int rowCount = 0, columnCount = 0;
+        for (unsigned int z = page->z1; z < page->z2; z += _patchSize, ++rowCount)
+        {
+            columnCount = 0;
+            for (unsigned int x = page->x1; x < page->x2; x += _patchSize, ++columnCount)
+            {
+                unsigned int row = z / _patchSize;
+                unsigned int column = x / _patchSize;
+                TerrainPatch* patch = TerrainPatch::create(this, row * patchColumns + column, row, column, heights, _width, _height,
+                                                           x, z, std::min(x + _patchSize, page->x2), std::min(z + _patchSize, page->z2),
+                                                           -halfWidth, -halfHeight, _maxStep, _skirtScale);
+                page->patches.push_back(patch);
+            }
+        }
+        buildQuadtree(page->quadtree, page->patches, 0, 0, rowCount, columnCount, columnCount);
+    }
+
+    page->built.store(true, std::memory_order_release);
+}
+
+void Terrain::finishPage(Page* page)
+{
+    GP_ASSERT(page && page->state == Page::LOADING);
+
+    if (page->job)
+    {
+        _jobSystem->wait(*page->job);
+        SAFE_DELETE(page->job);
+    }
+    page->built.store(false, std::memory_order_relaxed);
+
+    if (page->cancelled.load(std::memory_order_relaxed))
+    {
+        page->clear();
+        page->cancelled.store(false, std::memory_order_relaxed);
+        page->state = Page::UNLOADED;
+        return;
+    }
+    if (!page->heights)
+    {
+        GP_WARN("Failed to read heights of terrain page (%u, %u) from: %s", page->x1, page->z1, _pagePath.c_str());
+        page->clear();
+        page->state = Page::FAILED;
+        return;
+    }
+
+    // Create the GPU resources of the patches and apply the layers set on the terrain
+    for (size_t i = 0, count = page->patches.size(); i < count; ++i)
+    {
+        TerrainPatch* patch = page->patches[i];
+        patch->createModels();
+
+        for (size_t j = 0, layerCount = _pageLayers.size(); j < layerCount; ++j)
+        {
+            const PageLayer& layer = _pageLayers[j];
+            if ((layer.row == -1 || (int)patch->_row == layer.row) && (layer.column == -1 || (int)patch->_column == layer.column))
+            {
+                patch->setLayer(layer.index, layer.texturePath.c_str(), layer.textureRepeat,
+                                layer.blendPath.empty() ? NULL : layer.blendPath.c_str(), layer.blendChannel);
+            }
+        }
+        patch->updateMaterial();
+    }
+
+    // The bounds of the heights read replace those of the full height range
+    page->bounds.set(page->quadtree[0].bounds);
+    transformBounds(page->bounds, &page->worldBounds);
+    page->quadtreeBounds.resize(page->quadtree.size());
+    for (size_t i = 0, count = page->quadtree.size(); i < count; ++i)
+    {
+        transformBounds(page->quadtree[i].bounds, &page->quadtreeBounds[i]);
+    }
+
+    page->state = Page::LOADED;
+    updatePagePatches();
+}
+
+void Terrain::unloadPage(Page* page)
+{
+    GP_ASSERT(page);
+
+    if (page->state == Page::LOADING)
+    {
+        // The job owns the page until it is done; the page is discarded when it is hooked up
+        if (page->job)
+        {
+            page->cancelled.store(true, std::memory_order_relaxed);
+            return;
+        }
+        page->built.store(false, std::memory_order_relaxed);
+    }
+    else if (page->state != Page::LOADED)
+    {
+        return;
+    }
+
+    page->clear();
+    page->state = Page::UNLOADED;
+    updatePagePatches();
+}
+
+Terrain::Page* Terrain::getPage(float column, float row) const
+{
+    GP_ASSERT(!_pages.empty());
+
+    unsigned int c = std::min((unsigned int)std::max(column, 0.0f) / _pageSize, _pageColumns - 1);
+    unsigned int r = std::min((unsigned int)std::max(row, 0.0f) / _pageSize, (unsigned int)_pages.size() / _pageColumns - 1);
+    return _pages[r * _pageColumns + c];
+}
+
+void Terrain::updatePagePatches()
+{
+    _patches.clear();
+    for (size_t i = 0, count = _pages.size(); i < count; ++i)
+    {
+        Page* page = _pages[i];
+        if (page->state == Page::LOADED)
+            _patches.insert(_patches.end(), page->patches.begin(), page->patches.end());
+    }
+}
+
 Drawable* Terrain::clone(NodeCloneContext& context)
 {
     // TODO:
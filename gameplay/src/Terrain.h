@@ -10,6 +10,12 @@
 #include "BoundingBox.h"
 #include "TerrainPatch.h"
 
+namespace vkTools
+{
+class JobSystem;
+class JobHandle;
+}
+
 namespace vkcore
 {
 
@@ -61,11 +67,13 @@ class TerrainAutoBindingResolver;
  * flags.
  *
  * Level of detail (LOD) is supported using a technique that is similar to texture mipmapping.
- * A distance-to-camera based test, using a simple screen-space error metric is used to decide
- * the appropriate LOD for a terrain patch. The number of LOD levels is 1 by default (which
- * means only the base level is used), but can be specified via the detailLevels property.
- * Using too large a number for detailLevels can result in excessive popping in the distance
- * for very hilly terrains, so a smaller number (2-3) often works best in these cases.
+ * Each coarser level of a patch records the largest height error it has against the full
+ * resolution heightfield. A patch draws the coarsest level whose error, projected on the
+ * screen from the point of the patch nearest to the camera, is within the LOD error
+ * threshold (see setLODErrorThreshold). As that error approaches the threshold the vertices
+ * of the level are geomorphed onto the surface of the next coarser level, so switching
+ * levels does not pop. The number of LOD levels is 1 by default (which means only the base
+ * level is used), but can be specified via the detailLevels property.
  *
  * Finally, when LOD is enabled, cracks can begin to appear between terrain patches of
  * different LOD levels. If the cracks are only minor (depends on your terrain topology
@@ -79,6 +87,14 @@ class TerrainAutoBindingResolver;
  * approaches. In practice, the skirts are often not noticeable at all unless the LOD variation
  * is very large and the terrain is excessively hilly on the edge of a LOD transition.
  *
+ * Heightfields too large to be loaded whole can be drawn by a paged terrain, created with
+ * createPaged or with the pageSize property of a terrain definition with a RAW heightmap.
+ * A paged terrain is split into square pages of the heightfield, which are read from the
+ * RAW file along with the patches and levels of detail built from them on a job system,
+ * as the camera comes within the page distance of them. Pages are hooked up to the terrain
+ * and unloaded, farthest from the camera first, to stay within a memory budget, by calling
+ * updatePages once per frame. Only the loaded pages are drawn and report their heights.
+ *
  * @see http://gameplay3d.github.io/GamePlay/docs/file-formats.html#wiki-Terrain
  */
 class Terrain : public Ref, public Drawable, public Transform::Listener
@@ -115,6 +131,12 @@ public:
           * This flag enables or disables level of detail, however it does nothing if
           * "detailLevels" was not set to a value greater than 1 in the terrain
           * properties file at creation time.
+          *
+          * Each patch uses the coarsest level whose height error, projected on the screen,
+          * is within the LOD error threshold, and is morphed into the next coarser level
+          * as it approaches the threshold so that switching levels does not pop.
+          *
+          * @see setLODErrorThreshold
           */
          LEVEL_OF_DETAIL = 8
     };
@@ -176,6 +198,123 @@ public:
                            unsigned int detailLevels = 1, float skirtScale = 0.0f, const char* normalMapPath = NULL,
                            const char* materialPath = NULL);
 
+    /**
+     * Creates a paged terrain, which streams the pages of a RAW heightfield from disk.
+     *
+     * No heights are read by this method. Pages are loaded by updatePages as the camera
+     * comes near them, and the terrain draws nothing until then. Heights are normalized
+     * (0 to 1) before the scale is applied, as they are for RAW heightmaps of terrain
+     * definitions. Paged terrains have no heightfield for physics collision shapes.
+     *
+     * @param path Path to the RAW heightmap (must end in a .raw or .r16 file extension).
+     * @param width The number of columns of the RAW heightmap.
+     * @param height The number of rows of the RAW heightmap.
+     * @param scale A scale to apply to the terrain along the X, Y and Z axes.
+     * @param pageSize The number of quads along the sides of a page, rounded up to a multiple of the patch size.
+     * @param patchSize Size of terrain patches (number of quads).
+     * @param detailLevels Number of detail levels to generate for the terrain.
+     * @param skirtScale The scale of vertical skirts, or zero to disable them.
+     * @param normalMapPath Path to an object-space normal map to use for terrain lighting, instead of vertex normals.
+     * @param materialPath Optional path to a material file to use for the terrain.
+     *
+     * @return A new paged Terrain, or NULL if the parameters are invalid.
+     * @script{create}
+     */
+    static Terrain* createPaged(const char* path, unsigned int width, unsigned int height, const Vector3& scale = Vector3::one(),
+                                unsigned int pageSize = 256, unsigned int patchSize = 32, unsigned int detailLevels = 1,
+                                float skirtScale = 0.0f, const char* normalMapPath = NULL, const char* materialPath = NULL);
+
+    /**
+     * Determines whether this terrain streams its heightfield in pages.
+     *
+     * @return True if the terrain is paged.
+     */
+    bool isPaged() const;
+
+    /**
+     * Sets the job system that the pages of a paged terrain are read and built on.
+     *
+     * @param jobSystem The job system to use, or NULL to build pages on the main thread in updatePages.
+     * @script{ignore}
+     */
+    void setJobSystem(vkTools::JobSystem* jobSystem);
+
+    /**
+     * Gets the job system that the pages of a paged terrain are read and built on.
+     *
+     * @return The job system, or NULL.
+     * @script{ignore}
+     */
+    vkTools::JobSystem* getJobSystem() const;
+
+    /**
+     * Sets the distance from the camera, in world units, within which the pages of a paged
+     * terrain are loaded (two pages by default).
+     *
+     * Pages farther away stay loaded until the memory budget is needed for nearer pages.
+     *
+     * @param distance The load distance.
+     */
+    void setPageDistance(float distance);
+
+    /**
+     * Gets the distance from the camera, in world units, within which the pages of a paged
+     * terrain are loaded.
+     *
+     * @return The load distance.
+     */
+    float getPageDistance() const;
+
+    /**
+     * Sets the approximate memory, in bytes, that the loaded pages of a paged terrain may
+     * use for their heights and geometry (256 MB by default).
+     *
+     * @param bytes The memory budget.
+     */
+    void setPageMemoryBudget(size_t bytes);
+
+    /**
+     * Gets the approximate memory, in bytes, that the loaded pages of a paged terrain may use.
+     *
+     * @return The memory budget.
+     */
+    size_t getPageMemoryBudget() const;
+
+    /**
+     * Gets the approximate memory, in bytes, used by the pages of a paged terrain that are
+     * loaded or loading.
+     *
+     * @return The memory in use.
+     */
+    size_t getPageMemoryUsage() const;
+
+    /**
+     * Loads and unloads the pages of a paged terrain around the scene's active camera.
+     *
+     * Must be called on the main thread, typically once per frame. Pages within the page
+     * distance are requested nearest first, and the farthest pages are unloaded to keep
+     * within the memory budget. Pages whose heights and geometry have been built are then
+     * hooked up, nearest first, until the time budget is spent; at least one is hooked up
+     * on every call so that loading always makes progress.
+     *
+     * @param budget The time, in milliseconds, to spend hooking up built pages.
+     *
+     * @return The number of pages still loading.
+     */
+    unsigned int updatePages(float budget);
+
+    /**
+     * Determines whether the heights at the specified position on the X,Z plane are loaded.
+     *
+     * The heights of terrains that are not paged are always loaded.
+     *
+     * @param x The X coordinate, in world space.
+     * @param z The Z coordinate, in world space.
+     *
+     * @return True if getHeight returns the height of the terrain at the point.
+     */
+    bool isLoaded(float x, float z) const;
+
     /**
      * Determines if the specified terrain flag is currently set.
      */
@@ -189,9 +328,33 @@ public:
      */
     void setFlag(Flags flag, bool on);
 
+    /**
+     * Sets the largest height error, in pixels, allowed between the level of detail used
+     * for a patch and the full resolution terrain (2 by default).
+     *
+     * The error of a level is the largest difference between the heights of its mesh and
+     * those of the heightfield, measured when the terrain is created, and projected on the
+     * screen from the point of the patch nearest to the camera. Larger thresholds draw
+     * coarser levels. The threshold may also be set with the "lodErrorThreshold" property
+     * of a terrain definition.
+     *
+     * @param pixels The error threshold, in pixels of the viewport height.
+     */
+    void setLODErrorThreshold(float pixels);
+
+    /**
+     * Gets the largest height error, in pixels, allowed between the level of detail used
+     * for a patch and the full resolution terrain.
+     *
+     * @return The error threshold, in pixels.
+     */
+    float getLODErrorThreshold() const;
+
     /**
      * Gets the total number of terrain patches.
      *
+     * Only the patches of the loaded pages of a paged terrain are counted.
+     *
      * @return The number of terrain patches.
      */
     unsigned int getPatchCount() const;
@@ -218,7 +381,10 @@ public:
      * @param x The X coordinate, in world space.
      * @param z The Z coordinate, in world space.
      *
-     * @return The height at the specified point, clamped to the boundaries of the terrain.
+     * @return The height at the specified point, clamped to the boundaries of the terrain, or
+     *      zero if the point lies on a page of a paged terrain that is not loaded.
+     *
+     * @see isLoaded
      */
     float getHeight(float x, float z) const;
 
@@ -313,6 +479,18 @@ private:
      */
     static Terrain* create(const char* path, Properties* properties);
 
+    /**
+     * Internal method for creating paged terrain.
+     */
+    static Terrain* createPaged(const char* path, unsigned int width, unsigned int height, const Vector3& scale,
+        unsigned int pageSize, unsigned int patchSize, unsigned int detailLevels, float skirtScale,
+        const char* normalMapPath, const char* materialPath, Properties* properties);
+
+    /**
+     * Sets the layers of a terrain definition.
+     */
+    void setLayers(Properties* properties);
+
     /**
      * @see Transform::Listener::transformChanged.
      */
@@ -329,6 +507,137 @@ private:
      */
     BoundingBox getBoundingBox(bool worldSpace) const;
 
+    /**
+     * A node of the quadtree over the patches, which culls and selects the level of
+     * detail of whole regions of the terrain at once.
+     */
+    struct QuadtreeNode
+    {
+        BoundingBox bounds;     // The local bounds of the patches under the node.
+        float error;            // The largest error of the coarsest level of the patches under the node.
+        int patch;              // The patch of a leaf, or -1.
+        int children[4];        // The child nodes, or -1.
+    };
+
+    /**
+     * A page of a paged terrain.
+     *
+     * While a page is loading, its heights, patches and quadtree belong to the job that
+     * builds them, until built is set.
+     */
+    struct Page
+    {
+        enum State
+        {
+            UNLOADED,
+            LOADING,
+            LOADED,
+            FAILED
+        };
+
+        Page();
+
+        ~Page();
+
+        /**
+         * Frees the heights, patches and quadtree of the page.
+         */
+        void clear();
+
+        unsigned int x1;                            // The heightfield columns and rows covered by the page.
+        unsigned int z1;
+        unsigned int x2;
+        unsigned int z2;
+        State state;
+        size_t memory;                              // The approximate memory used when loaded.
+        BoundingBox bounds;                         // The local bounds; those of the full height range until loaded.
+        BoundingBox worldBounds;
+        float distance;                             // The distance from the camera at the last update.
+        HeightField* heights;                       // The heights of the page, with a border for the vertex normals.
+        unsigned int heightsX;                      // The heightfield column of the first column of the heights.
+        unsigned int heightsZ;                      // The heightfield row of the first row of the heights.
+        std::vector<TerrainPatch*> patches;
+        std::vector<QuadtreeNode> quadtree;
+        std::vector<BoundingBox> quadtreeBounds;    // The world bounds of the quadtree nodes.
+        std::atomic<bool> cancelled;                // Set when the page is unloaded while loading.
+        std::atomic<bool> built;                    // Set once the job building the page is done with it.
+        vkTools::JobHandle* job;                    // The job building the page.
+    };
+
+    /**
+     * A layer set on a paged terrain, applied to the patches of pages as they are loaded.
+     */
+    struct PageLayer
+    {
+        int index;
+        std::string texturePath;
+        Vector2 textureRepeat;
+        std::string blendPath;
+        int blendChannel;
+        int row;
+        int column;
+    };
+
+    /**
+     * Builds the quadtree node over the given patches, stored row by row, in the given
+     * rows and columns (exclusive of row2 and column2) and returns its index.
+     */
+    static int buildQuadtree(std::vector<QuadtreeNode>& quadtree, const std::vector<TerrainPatch*>& patches,
+                             unsigned int row1, unsigned int column1, unsigned int row2, unsigned int column2, unsigned int columnCount);
+
+    /**
+     * Draws the patches under the given quadtree that are visible to the camera.
+     */
+    unsigned int drawQuadtree(const std::vector<QuadtreeNode>& quadtree, const std::vector<BoundingBox>& worldBounds,
+                              const std::vector<TerrainPatch*>& patches, Camera* camera, bool wireframe);
+
+    /**
+     * Updates the world-space bounds of the quadtree nodes and pages and the world height
+     * scale when the terrain has moved.
+     */
+    void updateWorldBounds() const;
+
+    /**
+     * Transforms local bounds to world space.
+     */
+    void transformBounds(const BoundingBox& bounds, BoundingBox* worldBounds) const;
+
+    /**
+     * Returns the factor converting a height error of the terrain to pixels, as seen by
+     * the given camera from the point of the given world-space bounds nearest to it.
+     */
+    float computeErrorScale(Camera* camera, const BoundingBox& worldBounds) const;
+
+    /**
+     * Starts loading a page, on the job system if there is one.
+     */
+    void loadPage(Page* page);
+
+    /**
+     * Reads the heights of a page and builds its patches. Runs on a worker thread.
+     */
+    void buildPage(Page* page);
+
+    /**
+     * Creates the models and materials of a built page and starts drawing it.
+     */
+    void finishPage(Page* page);
+
+    /**
+     * Unloads a page, or cancels it if it is still loading.
+     */
+    void unloadPage(Page* page);
+
+    /**
+     * Gets the page holding a heightfield column and row.
+     */
+    Page* getPage(float column, float row) const;
+
+    /**
+     * Gathers the patches of the loaded pages.
+     */
+    void updatePagePatches();
+
     std::string _materialPath;
     HeightField* _heightfield;
     Vector3 _localScale;
@@ -338,6 +647,23 @@ private:
     mutable Matrix _inverseWorldMatrix;
     mutable unsigned int _dirtyFlags;
     BoundingBox _boundingBox;
+    float _lodErrorThreshold;
+    std::vector<QuadtreeNode> _quadtree;
+    mutable std::vector<BoundingBox> _quadtreeBounds;
+    mutable float _worldScaleY;
+    std::string _pagePath;
+    unsigned int _width;
+    unsigned int _height;
+    unsigned int _patchSize;
+    unsigned int _maxStep;
+    float _skirtScale;
+    unsigned int _pageSize;
+    unsigned int _pageColumns;
+    std::vector<Page*> _pages;
+    std::vector<PageLayer> _pageLayers;
+    float _pageDistance;
+    size_t _pageMemoryBudget;
+    vkTools::JobSystem* _jobSystem;
 };
 
 }
@@ -18,6 +18,17 @@ template <class T> T clamp(T value, T min, T max) { return value < min ? min : (
 #define TERRAINPATCH_DIRTY_LEVEL 4
 #define TERRAINPATCH_DIRTY_ALL (TERRAINPATCH_DIRTY_MATERIAL | TERRAINPATCH_DIRTY_BOUNDS | TERRAINPATCH_DIRTY_LEVEL)
 
+// A level starts morphing into the next coarser level once the projected error of that
+// level falls below this multiple of the error threshold, and has fully become it when
+// the error reaches the threshold and the coarser level is switched to. The error of each
+// level is at least this multiple of the error of the next finer level, so a level that
+// is switched to has not started morphing yet.
+#define TERRAINPATCH_MORPH_RANGE 2.0f
+
+// The number of distinct morph factors, which bounds how often the vertices of a level
+// are rewritten as the camera moves.
+#define TERRAINPATCH_MORPH_STEPS 32.0f
+
 /**
  * Custom material auto-binding resolver for terrain.
  * @script{ignore}
@@ -27,7 +38,7 @@ class TerrainAutoBindingResolver : RenderState::AutoBindingResolver
     bool resolveAutoBinding(const char* autoBinding, Node* node, MaterialParameter* parameter);
 };
 static TerrainAutoBindingResolver __autoBindingResolver;
-static int __currentPatchIndex = -1;
+static TerrainPatch* __currentPatch = NULL;
 
 TerrainPatch::TerrainPatch() :
     _terrain(NULL), _row(0), _column(0), _camera(NULL), _level(0), _bits(TERRAINPATCH_DIRTY_ALL)
@@ -41,6 +52,10 @@ TerrainPatch::~TerrainPatch()
         Level* level = _levels[i];
 
         SAFE_RELEASE(level->model);
+        SAFE_DELETE_ARRAY(level->vertices);
+        SAFE_DELETE_ARRAY(level->heights);
+        SAFE_DELETE_ARRAY(level->morphOffsets);
+        SAFE_DELETE_ARRAY(level->indices);
         SAFE_DELETE(level);
     }
 
@@ -58,7 +73,7 @@ TerrainPatch::~TerrainPatch()
 
 TerrainPatch* TerrainPatch::create(Terrain* terrain, unsigned int index,
                                    unsigned int row, unsigned int column,
-                                   float* heights, unsigned int width, unsigned int height,
+                                   const Heights& heights, unsigned int width, unsigned int height,
                                    unsigned int x1, unsigned int z1, unsigned int x2, unsigned int z2,
                                    float xOffset, float zOffset,
                                    unsigned int maxStep, float verticalSkirtSize)
@@ -78,11 +93,54 @@ TerrainPatch* TerrainPatch::create(Terrain* terrain, unsigned int index,
 
     // Set our bounding box using the base LOD mesh
     BoundingBox& bounds = patch->_boundingBox;
-    bounds.set(patch->_levels[0]->model->getMesh()->getBoundingBox());
+    bounds.set(patch->_levels[0]->bounds);
 
     return patch;
 }
 
+void TerrainPatch::createModels()
+{
+    VertexFormat::Element elements[3];
+    elements[0] = VertexFormat::Element(VertexFormat::POSITION, 3);
+    if (_terrain->_normalMap)
+    {
+        elements[1] = VertexFormat::Element(VertexFormat::TEXCOORD0, 2);
+    }
+    else
+    {
+        elements[1] = VertexFormat::Element(VertexFormat::NORMAL, 3);
+        elements[2] = VertexFormat::Element(VertexFormat::TEXCOORD0, 2);
+    }
+    VertexFormat format(elements, _terrain->_normalMap ? 2 : 3);
+
+    for (size_t i = 0, count = _levels.size(); i < count; ++i)
+    {
+        Level* level = _levels[i];
+        if (level->model)
+            continue;
+
+        // Create mesh
+        Mesh* mesh = Mesh::createMesh(format, level->vertexCount);
+        mesh->setVertexData(level->vertices, 0, level->vertexCount);
+        mesh->setBoundingBox(level->bounds);
+        Vector3 center = level->bounds.getCenter();
+        mesh->setBoundingSphere(BoundingSphere(center, center.distance(level->bounds.max)));
+
+        // Add mesh part for indices
+        MeshPart* part = mesh->addPart(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP, Mesh::INDEX16, level->indexCount);
+        part->setIndexData(level->indices, 0, level->indexCount);
+        SAFE_DELETE_ARRAY(level->indices);
+
+        // The vertices are only kept for levels that morph into a coarser level
+        if (!level->morphOffsets)
+            SAFE_DELETE_ARRAY(level->vertices);
+
+        // Create model
+        level->model = Model::create(mesh);
+        mesh->release();
+    }
+}
+
 unsigned int TerrainPatch::getMaterialCount() const
 {
     return _levels.size();
@@ -94,7 +152,7 @@ Material* TerrainPatch::getMaterial(int index) const
     {
         Scene* scene = _terrain->_node ? _terrain->_node->getScene() : NULL;
         Camera* camera = scene ? scene->getActiveCamera() : NULL;
-        if (!camera)
+        if (camera)
         {
             _level = const_cast<TerrainPatch*>(this)->computeLOD(camera, getBoundingBox(true));
         }
@@ -107,7 +165,45 @@ Material* TerrainPatch::getMaterial(int index) const
     return _levels[index]->model->getMaterial();
 }
 
-void TerrainPatch::addLOD(float* heights, unsigned int width, unsigned int height,
+/**
+ * Gets the heightfield columns (or rows) of the vertices of a level, from a1 to a2 every
+ * step, with the first and last repeated for the vertical skirts.
+ */
+static void getSamples(unsigned int a1, unsigned int a2, unsigned int step, bool verticalSkirt, std::vector<unsigned int>* samples)
+{
+    samples->clear();
+    if (verticalSkirt)
+        samples->push_back(a1);
+    for (unsigned int a = a1; ; a = std::min(a + step, a2))
+    {
+        samples->push_back(a);
+        if (a == a2)
+            break;
+    }
+    if (verticalSkirt)
+        samples->push_back(a2);
+}
+
+float TerrainPatch::interpolateHeight(const Heights& heights, unsigned int step,
+                                      const std::vector<unsigned int>& xs, const std::vector<unsigned int>& zs,
+                                      unsigned int x, unsigned int z)
+{
+    size_t i = std::min((size_t)((x - xs[0]) / step), xs.size() - 2);
+    size_t j = std::min((size_t)((z - zs[0]) / step), zs.size() - 2);
+    float u = (float)(x - xs[i]) / (xs[i+1] - xs[i]);
+    float v = (float)(z - zs[j]) / (zs[j+1] - zs[j]);
+    float h00 = heights.get(xs[i], zs[j]);
+    float h10 = heights.get(xs[i+1], zs[j]);
+    float h01 = heights.get(xs[i], zs[j+1]);
+    float h11 = heights.get(xs[i+1], zs[j+1]);
+
+    // The triangle strips split each quad along its diagonal from (x+1, z) to (x, z+1)
+    if (u + v <= 1.0f)
+        return h00 + (h10 - h00) * u + (h01 - h00) * v;
+    return h11 + (h01 - h11) * (1.0f - u) + (h10 - h11) * (1.0f - v);
+}
+
+void TerrainPatch::addLOD(const Heights& heights, unsigned int width, unsigned int height,
                           unsigned int x1, unsigned int z1, unsigned int x2, unsigned int z2,
                           float xOffset, float zOffset,
                           unsigned int step, float verticalSkirtSize)
@@ -156,7 +252,7 @@ void TerrainPatch::addLOD(float* heights, unsigned int width, unsigned int heigh
 
             // Compute position - apply the local scale of the terrain into the vertex data
             v[0] = (x + xOffset) * _terrain->_localScale.x;
-            v[1] = computeHeight(heights, width, x, z);
+            v[1] = computeHeight(heights, x, z);
             if (xskirt || zskirt)
                 v[1] -= verticalSkirtSize * _terrain->_localScale.y;
             v[2] = (z + zOffset) * _terrain->_localScale.z;
@@ -181,11 +277,11 @@ void TerrainPatch::addLOD(float* heights, unsigned int width, unsigned int heigh
             // Compute normal
             if (!_terrain->_normalMap)
             {
-                Vector3 p(v[0], computeHeight(heights, width, x, z), v[2]);
-                Vector3 w(Vector3(x>=step ? v[0]-stepXScaled : v[0], computeHeight(heights, width, x>=step ? x-step : x, z), v[2]), p);
-                Vector3 e(Vector3(x<width-step ? v[0]+stepXScaled : v[0], computeHeight(heights, width, x<width-step ? x+step : x, z), v[2]), p);
-                Vector3 s(Vector3(v[0], computeHeight(heights, width, x, z>=step ? z-step : z), z>=step ? v[2]-stepZScaled : v[2]), p);
-                Vector3 n(Vector3(v[0], computeHeight(heights, width, x, z<height-step ? z+step : z), z<height-step ? v[2]+stepZScaled : v[2]), p);
+                Vector3 p(v[0], computeHeight(heights, x, z), v[2]);
+                Vector3 w(Vector3(x>=step ? v[0]-stepXScaled : v[0], computeHeight(heights, x>=step ? x-step : x, z), v[2]), p);
+                Vector3 e(Vector3(x<width-step ? v[0]+stepXScaled : v[0], computeHeight(heights, x<width-step ? x+step : x, z), v[2]), p);
+                Vector3 s(Vector3(v[0], computeHeight(heights, x, z>=step ? z-step : z), z>=step ? v[2]-stepZScaled : v[2]), p);
+                Vector3 n(Vector3(v[0], computeHeight(heights, x, z<height-step ? z+step : z), z<height-step ? v[2]+stepZScaled : v[2]), p);
                 Vector3 normals[4];
                 Vector3::cross(n, w, &normals[0]);
                 Vector3::cross(w, s, &normals[1]);
@@ -250,27 +346,7 @@ void TerrainPatch::addLOD(float* heights, unsigned int width, unsigned int heigh
     }
     GP_ASSERT(index == vertexCount);
 
-    Vector3 center(min + ((max - min) * 0.5f));
-
-    // Create mesh
-    VertexFormat::Element elements[3];
-    elements[0] = VertexFormat::Element(VertexFormat::POSITION, 3);
-    if (_terrain->_normalMap)
-    {
-        elements[1] = VertexFormat::Element(VertexFormat::TEXCOORD0, 2);
-    }
-    else
-    {
-        elements[1] = VertexFormat::Element(VertexFormat::NORMAL, 3);
-        elements[2] = VertexFormat::Element(VertexFormat::TEXCOORD0, 2);
-    }
-    VertexFormat format(elements, _terrain->_normalMap ? 2 : 3);
-    Mesh* mesh = Mesh::createMesh(format, vertexCount);
-    mesh->setVertexData(vertices);
-    mesh->setBoundingBox(BoundingBox(min, max));
-    mesh->setBoundingSphere(BoundingSphere(center, center.distance(max)));
-
-    // Add mesh part for indices
+    // Compute indices
     unsigned int indexCount =
         (patchWidth * 2) *      // # indices per row of tris
         (patchHeight - 1) +     // # rows of tris
@@ -284,7 +360,6 @@ void TerrainPatch::addLOD(float* heights, unsigned int width, unsigned int heigh
         GP_ASSERT(indexCount <= USHRT_MAX);
     }
 
-    MeshPart* part = mesh->addPart(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP, Mesh::INDEX16, indexCount);
     unsigned short* indices = new unsigned short[indexCount];
     index = 0;
     for (unsigned int z = 0; z < patchHeight-1; ++z)
@@ -332,21 +407,79 @@ void TerrainPatch::addLOD(float* heights, unsigned int width, unsigned int heigh
         }
     }
     GP_ASSERT(index == indexCount);
-    part->setIndexData(indices, 0, indexCount);
 
-    SAFE_DELETE_ARRAY(vertices);
-    SAFE_DELETE_ARRAY(indices);
+    // Add this level; its mesh is created from the vertices and indices by createModels
+    Level* level = new Level();
+    level->vertices = vertices;
+    level->vertexCount = vertexCount;
+    level->indices = indices;
+    level->indexCount = indexCount;
+    level->bounds.set(min, max);
+
+    if (step > 1)
+    {
+        // Measure the largest deviation of this level from the full resolution heightfield
+        std::vector<unsigned int> xs, zs;
+        getSamples(x1, x2, step, false, &xs);
+        getSamples(z1, z2, step, false, &zs);
+        float error = 0.0f;
+        for (unsigned int z = z1; z <= z2; ++z)
+        {
+            for (unsigned int x = x1; x <= x2; ++x)
+            {
+                float deviation = fabs(interpolateHeight(heights, step, xs, zs, x, z) - heights.get(x, z));
+                if (deviation > error)
+                    error = deviation;
+            }
+        }
+        level->error = error * fabs(_terrain->_localScale.y);
 
-    // Create model
-    Model* model = Model::create(mesh);
-    mesh->release();
+        // Grow the errors by at least the morph range from level to level, so every level finer than
+        // one within the threshold is too, and a level is switched to before it starts morphing
+        if (_levels.size() > 0)
+        {
+            Level* finer = _levels.back();
+            level->error = std::max(level->error, finer->error * TERRAINPATCH_MORPH_RANGE);
+            addMorphOffsets(finer, heights, x1, z1, x2, z2, step, verticalSkirtSize > 0.0f);
+        }
+    }
 
-    // Add this level
-    Level* level = new Level();
-    level->model = model;
     _levels.push_back(level);
 }
 
+void TerrainPatch::addMorphOffsets(Level* level, const Heights& heights,
+                                   unsigned int x1, unsigned int z1, unsigned int x2, unsigned int z2,
+                                   unsigned int step, bool verticalSkirt)
+{
+    GP_ASSERT(level && level->vertices);
+
+    // Walk the vertices of the level in the order they were generated, moving each onto the
+    // surface of the coarser level of the given step. The vertices shared with the coarser
+    // level do not move, so the two levels are identical once the morph is complete.
+    std::vector<unsigned int> vertexXs, vertexZs, xs, zs;
+    getSamples(x1, x2, step / 2, verticalSkirt, &vertexXs);
+    getSamples(z1, z2, step / 2, verticalSkirt, &vertexZs);
+    getSamples(x1, x2, step, false, &xs);
+    getSamples(z1, z2, step, false, &zs);
+    GP_ASSERT(vertexXs.size() * vertexZs.size() == level->vertexCount);
+
+    unsigned int vertexElements = _terrain->_normalMap ? 5 : 8;
+    level->heights = new float[level->vertexCount];
+    level->morphOffsets = new float[level->vertexCount];
+    unsigned int index = 0;
+    for (size_t j = 0; j < vertexZs.size(); ++j)
+    {
+        for (size_t i = 0; i < vertexXs.size(); ++i, ++index)
+        {
+            unsigned int x = vertexXs[i];
+            unsigned int z = vertexZs[j];
+            float offset = interpolateHeight(heights, step, xs, zs, x, z) - heights.get(x, z);
+            level->heights[index] = level->vertices[index * vertexElements + 1];
+            level->morphOffsets[index] = offset * _terrain->_localScale.y;
+        }
+    }
+}
+
 void TerrainPatch::deleteLayer(Layer* layer)
 {
     // Release layer samplers
@@ -534,7 +667,7 @@ bool TerrainPatch::updateMaterial()
 
     _bits &= ~TERRAINPATCH_DIRTY_MATERIAL;
 
-    __currentPatchIndex = _index;
+    __currentPatch = this;
 
     for (size_t i = 0, count = _levels.size(); i < count; ++i)
     {
@@ -543,7 +676,7 @@ bool TerrainPatch::updateMaterial()
         if (!material)
         {
             GP_WARN("Failed to load material for terrain patch: %s", _terrain->_materialPath.c_str());
-            __currentPatchIndex = -1;
+            __currentPatch = NULL;
             return false;
         }
 
@@ -555,40 +688,39 @@ bool TerrainPatch::updateMaterial()
         material->release();
     }
 
-    __currentPatchIndex = -1;
+    __currentPatch = NULL;
 
     return true;
 }
 
 void TerrainPatch::updateNodeBindings()
 {
-    __currentPatchIndex = _index;
+    __currentPatch = this;
     for (size_t i = 0, count = _levels.size(); i < count; ++i)
     {
         _levels[i]->model->getMaterial()->setNodeBinding(_terrain->_node);
     }
-    __currentPatchIndex = -1;
+    __currentPatch = NULL;
 }
 
-unsigned int TerrainPatch::draw(bool wireframe)
+unsigned int TerrainPatch::draw(Camera* camera, bool wireframe, bool coarsest)
 {
-    Scene* scene = _terrain->_node ? _terrain->_node->getScene() : NULL;
-    Camera* camera = scene ? scene->getActiveCamera() : NULL;
-    if (!camera)
-        return 0;
-
-    // Get our world-space bounding box
-    BoundingBox bounds = getBoundingBox(true);
-
-    // If the box does not intersect the view frustum, cull it
-    if (_terrain->isFlagSet(Terrain::FRUSTUM_CULLING) && !camera->getFrustum().intersects(bounds))
-        return 0;
+    GP_ASSERT(camera);
 
     if (!updateMaterial())
         return 0;
 
-    // Compute the LOD level from the camera's perspective
-    _level = computeLOD(camera, bounds);
+    // Compute the LOD level from the camera's perspective, unless the terrain already
+    // found the whole region of the patch to be far enough for its coarsest level
+    if (coarsest && _terrain->isFlagSet(Terrain::LEVEL_OF_DETAIL))
+    {
+        setLevel(_levels.size() - 1, 0.0f);
+        _bits |= TERRAINPATCH_DIRTY_LEVEL;
+    }
+    else
+    {
+        _level = computeLOD(camera, getBoundingBox(true));
+    }
 
     // Draw the model for the current LOD
     return _levels[_level]->model->draw(wireframe);
@@ -635,49 +767,64 @@ unsigned int TerrainPatch::computeLOD(Camera* camera, const BoundingBox& worldBo
     }
 
     // base level
-    if (!_terrain->isFlagSet(Terrain::LEVEL_OF_DETAIL) || _levels.size() == 0)
+    if (!_terrain->isFlagSet(Terrain::LEVEL_OF_DETAIL) || _levels.size() <= 1)
+    {
+        if (_levels.size() > 0)
+            setLevel(0, 0.0f);
         return 0;
+    }
 
     if (!(_bits & TERRAINPATCH_DIRTY_LEVEL))
         return _level;
 
     _bits &= ~TERRAINPATCH_DIRTY_LEVEL;
 
-    // Compute LOD to use based on very simple distance metric. TODO: Optimize me.
-    Game* game = Game::getInstance();
-    VRectangle vp(0, 0, game->getWidth(), game->getHeight());
-    Vector3 corners[8];
-    Vector2 min(FLT_MAX, FLT_MAX);
-    Vector2 max(-FLT_MAX, -FLT_MAX);
-    worldBounds.getCorners(corners);
-    for (unsigned int i = 0; i < 8; ++i)
-    {
-        const Vector3& corner = corners[i];
-        float x, y;
-        camera->project(vp, corners[i], &x, &y);
-        if (x < min.x)
-            min.x = x;
-        if (y < min.y)
-            min.y = y;
-        if (x > max.x)
-            max.x = x;
-        if (y > max.y)
-            max.y = y;
-    }
-    float area = (max.x - min.x) * (max.y - min.y);
-    float screenArea = game->getWidth() * game->getHeight() / 10.0f;
-    float error = screenArea / area;
-
-    // Level LOD based on distance from camera
-    size_t maxLod = _levels.size()-1;
-    size_t lod = (size_t)error;
-    lod = std::max(lod, (size_t)0);
-    lod = std::min(lod, maxLod);
-    _level = lod;
+    // Use the coarsest level whose height error, projected on the screen from the point of
+    // the patch nearest to the camera, is within the terrain's threshold
+    float scale = _terrain->computeErrorScale(camera, worldBounds);
+    float threshold = _terrain->_lodErrorThreshold;
+    unsigned int level = 0;
+    unsigned int levelCount = _levels.size();
+    while (level + 1 < levelCount && _levels[level + 1]->error * scale <= threshold)
+        ++level;
+
+    // Morph towards the next coarser level as its error approaches the threshold, so the
+    // switch does not pop. The errors grow by at least the morph range from level to level,
+    // so the morph of a level is 0 when it is switched to and 1 when it is switched from.
+    float morph = 0.0f;
+    if (level + 1 < levelCount && threshold > 0.0f)
+    {
+        float error = _levels[level + 1]->error * scale;
+        morph = clamp((TERRAINPATCH_MORPH_RANGE * threshold - error) / ((TERRAINPATCH_MORPH_RANGE - 1.0f) * threshold), 0.0f, 1.0f);
+    }
+    setLevel(level, morph);
 
     return _level;
 }
 
+void TerrainPatch::setLevel(unsigned int level, float morph)
+{
+    GP_ASSERT(level < _levels.size());
+
+    _level = level;
+
+    Level* l = _levels[level];
+    if (!l->morphOffsets)
+        return;
+
+    morph = floor(morph * TERRAINPATCH_MORPH_STEPS + 0.5f) / TERRAINPATCH_MORPH_STEPS;
+    if (morph == l->morph)
+        return;
+    l->morph = morph;
+
+    unsigned int vertexElements = _terrain->_normalMap ? 5 : 8;
+    for (unsigned int i = 0; i < l->vertexCount; ++i)
+    {
+        l->vertices[i * vertexElements + 1] = l->heights[i] + l->morphOffsets[i] * morph;
+    }
+    l->model->getMesh()->setVertexData(l->vertices, 0, l->vertexCount);
+}
+
 const Vector3& TerrainPatch::getAmbientColor() const
 {
     Scene* scene = _terrain->_node ? _terrain->_node->getScene() : NULL;
@@ -689,9 +836,19 @@ void TerrainPatch::setMaterialDirty()
     _bits |= TERRAINPATCH_DIRTY_MATERIAL;
 }
 
-float TerrainPatch::computeHeight(float* heights, unsigned int width, unsigned int x, unsigned int z)
+void TerrainPatch::setBoundsDirty()
+{
+    _bits |= TERRAINPATCH_DIRTY_BOUNDS | TERRAINPATCH_DIRTY_LEVEL;
+}
+
+void TerrainPatch::setLevelDirty()
+{
+    _bits |= TERRAINPATCH_DIRTY_LEVEL;
+}
+
+float TerrainPatch::computeHeight(const Heights& heights, unsigned int x, unsigned int z)
 {
-    return heights[z * width + x] * _terrain->_localScale.y;
+    return heights.get(x, z) * _terrain->_localScale.y;
 }
 
 TerrainPatch::Layer::Layer() :
@@ -703,7 +860,9 @@ TerrainPatch::Layer::~Layer()
 {
 }
 
-TerrainPatch::Level::Level() : model(NULL)
+TerrainPatch::Level::Level() :
+    model(NULL), error(0.0f), vertices(NULL), heights(NULL), morphOffsets(NULL), vertexCount(0),
+    indices(NULL), indexCount(0), morph(0.0f)
 {
 }
 
@@ -720,12 +879,9 @@ bool TerrainAutoBindingResolver::resolveAutoBinding(const char* autoBinding, Nod
         static TerrainPatch* getPatch(Node* node)
         {
             Terrain* terrain = dynamic_cast<Terrain*>(node->getDrawable());
-            if (terrain)
+            if (terrain && __currentPatch && __currentPatch->_terrain == terrain)
             {
-                if (__currentPatchIndex >= 0 && __currentPatchIndex < (int)terrain->_patches.size())
-                {
-                    return terrain->_patches[__currentPatchIndex];
-                }
+                return __currentPatch;
             }
             return NULL;
         }
@@ -93,13 +93,42 @@ private:
         int blendChannel;
     };
 
+    /**
+     * A level of detail of the patch.
+     *
+     * Every level but the coarsest keeps a copy of its vertices, along with the offsets
+     * that move each vertex onto the surface of the next coarser level, so it can be
+     * morphed into that level before switching to it.
+     */
     struct Level
     {
         Model* model;
+        float error;                // Largest height deviation from the full resolution heightfield.
+        float* vertices;            // The vertices, or NULL if the level is not morphed.
+        float* heights;             // The unmorphed height of each vertex.
+        float* morphOffsets;        // The height offset of each vertex to the next coarser level.
+        unsigned int vertexCount;
+        unsigned short* indices;    // The indices, until the model is created.
+        unsigned int indexCount;
+        BoundingBox bounds;
+        float morph;                // The morph factor currently in the vertices.
 
         Level();
     };
 
+    /**
+     * A window of the terrain's heightfield, addressed by heightfield column and row.
+     */
+    struct Heights
+    {
+        const float* array;         // The heights of the window, row by row.
+        unsigned int x;             // The heightfield column of the first column of the window.
+        unsigned int z;             // The heightfield row of the first row of the window.
+        unsigned int width;         // The number of columns of the window.
+
+        float get(unsigned int column, unsigned int row) const { return array[(row - z) * width + (column - x)]; }
+    };
+
     struct LayerCompare
     {
         bool operator() (const Layer* lhs, const Layer* rhs) const;
@@ -107,14 +136,24 @@ private:
 
     static TerrainPatch* create(Terrain* terrain, unsigned int index,
                                 unsigned int row, unsigned int column,
-                                float* heights, unsigned int width, unsigned int height,
+                                const Heights& heights, unsigned int width, unsigned int height,
                                 unsigned int x1, unsigned int z1, unsigned int x2, unsigned int z2,
                                 float xOffset, float zOffset, unsigned int maxStep, float verticalSkirtSize);
 
-    void addLOD(float* heights, unsigned int width, unsigned int height,
+    void addLOD(const Heights& heights, unsigned int width, unsigned int height,
                 unsigned int x1, unsigned int z1, unsigned int x2, unsigned int z2,
                 float xOffset, float zOffset, unsigned int step, float verticalSkirtSize);
 
+    void addMorphOffsets(Level* level, const Heights& heights,
+                         unsigned int x1, unsigned int z1, unsigned int x2, unsigned int z2,
+                         unsigned int step, bool verticalSkirt);
+
+    static float interpolateHeight(const Heights& heights, unsigned int step,
+                                   const std::vector<unsigned int>& xs, const std::vector<unsigned int>& zs,
+                                   unsigned int x, unsigned int z);
+
+    void createModels();
+
 
     bool setLayer(int index, const char* texturePath, const Vector2& textureRepeat, const char* blendPath, int blendChannel);
 
@@ -122,17 +161,23 @@ private:
 
     int addSampler(const char* path);
 
-    unsigned int draw(bool wireframe);
+    unsigned int draw(Camera* camera, bool wireframe, bool coarsest);
 
     bool updateMaterial();
 
     unsigned int computeLOD(Camera* camera, const BoundingBox& worldBounds);
 
+    void setLevel(unsigned int level, float morph);
+
     const Vector3& getAmbientColor() const;
 
     void setMaterialDirty();
 
-    float computeHeight(float* heights, unsigned int width, unsigned int x, unsigned int z);
+    void setBoundsDirty();
+
+    void setLevelDirty();
+
+    float computeHeight(const Heights& heights, unsigned int x, unsigned int z);
 
     void updateNodeBindings();
 
@@ -9,6 +9,9 @@ namespace vkcore
 int Transform::_suspendTransformChanged(0);
 std::vector<Transform*> Transform::_transformsChanged;
 
+// List the calling thread records suspended transform changes in; NULL for the global list.
+static thread_local std::vector<Transform*>* __transformsChangedList = NULL;
+
 Transform::Transform()
     : _matrixDirtyBits(0), _listeners(NULL)
 {
@@ -87,6 +90,19 @@ void Transform::resumeTransformChanged()
     _suspendTransformChanged--;
 }
 
+void Transform::setTransformChangedList(std::vector<Transform*>* list)
+{
+    __transformsChangedList = list;
+}
+
+void Transform::mergeTransformChanged(const std::vector<Transform*>& list)
+{
+    GP_ASSERT(__transformsChangedList == NULL);
+    GP_ASSERT(isTransformChangedSuspended() || list.empty());
+
+    _transformsChanged.insert(_transformsChanged.end(), list.begin(), list.end());
+}
+
 bool Transform::isTransformChangedSuspended()
 {
     return (_suspendTransformChanged > 0);
@@ -940,7 +956,10 @@ void Transform::suspendTransformChange(Transform* transform)
 {
     GP_ASSERT(transform);
     transform->_matrixDirtyBits |= DIRTY_NOTIFY;
-    _transformsChanged.push_back(transform);
+    if (__transformsChangedList)
+        __transformsChangedList->push_back(transform);
+    else
+        _transformsChanged.push_back(transform);
 }
 
 void Transform::addListener(Transform::Listener* listener, long cookie)
@@ -1009,4 +1028,33 @@ void Transform::applyAnimationValueRotation(AnimationValue* value, unsigned int
     dirty(DIRTY_ROTATION);
 }
 
+void Transform::applyAnimationPose(const float* scale, const float* rotation, const float* translation, float blendWeight)
+{
+    GP_ASSERT(blendWeight >= 0.0f && blendWeight <= 1.0f);
+
+    if (isStatic())
+        return;
+
+    char dirtyBits = 0;
+    if (scale)
+    {
+        _scale.set(Curve::lerp(blendWeight, _scale.x, scale[0]), Curve::lerp(blendWeight, _scale.y, scale[1]), Curve::lerp(blendWeight, _scale.z, scale[2]));
+        dirtyBits |= DIRTY_SCALE;
+    }
+    if (rotation)
+    {
+        Quaternion::slerp(_rotation.x, _rotation.y, _rotation.z, _rotation.w, rotation[0], rotation[1], rotation[2], rotation[3], blendWeight,
+            &_rotation.x, &_rotation.y, &_rotation.z, &_rotation.w);
+        dirtyBits |= DIRTY_ROTATION;
+    }
+    if (translation)
+    {
+        _translation.set(Curve::lerp(blendWeight, _translation.x, translation[0]), Curve::lerp(blendWeight, _translation.y, translation[1]), Curve::lerp(blendWeight, _translation.z, translation[2]));
+        dirtyBits |= DIRTY_TRANSLATION;
+    }
+
+    if (dirtyBits)
+        dirty(dirtyBits);
+}
+
 }
@@ -30,6 +30,9 @@ class ScriptListener;
  */
 class Transform : public AnimationTarget, public ScriptTarget
 {
+    friend class AnimationSampler;
+    friend class AnimationController;
+
     GP_SCRIPT_EVENTS_START();
     GP_SCRIPT_EVENT(transformChanged, "<Transform>");
     GP_SCRIPT_EVENTS_END();
@@ -894,6 +897,36 @@ private:
    
     void applyAnimationValueRotation(AnimationValue* value, unsigned int index, float blendWeight);
 
+    /**
+     * Blends a sampled animation pose into the transform, marking it dirty once.
+     *
+     * @param scale The sampled scale (3 floats); NULL if the scale is not animated.
+     * @param rotation The sampled rotation (4 floats); NULL if the rotation is not animated.
+     * @param translation The sampled translation (3 floats); NULL if the translation is not animated.
+     * @param blendWeight The weight to blend the pose with the current values.
+     */
+    void applyAnimationPose(const float* scale, const float* rotation, const float* translation, float blendWeight);
+
+    /**
+     * Sets the list that suspended transform changes made on the calling thread are
+     * recorded in, in place of the global list.
+     *
+     * This lets worker threads change disjoint sets of transforms while transform changed
+     * events are suspended. The recorded lists must be merged with mergeTransformChanged
+     * on the main thread before the events are resumed.
+     *
+     * @param list The list to record changes in, or NULL to record them in the global list.
+     */
+    static void setTransformChangedList(std::vector<Transform*>* list);
+
+    /**
+     * Adds the transforms recorded in a list set with setTransformChangedList to the global
+     * list of transforms waiting to be notified of a change.
+     *
+     * @param list The recorded list.
+     */
+    static void mergeTransformChanged(const std::vector<Transform*>& list);
+
     static int _suspendTransformChanged;
     static std::vector<Transform*> _transformsChanged;
     
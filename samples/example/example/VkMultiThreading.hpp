@@ -13,7 +13,7 @@
 #include <vulkan/vulkan.h>
 #include "VulkanBase.h"
 
-#include "threadpool.hpp"
+#include "jobsystem.hpp"
 #include "frustum.hpp"
 
 #define ENABLE_VALIDATION false
@@ -94,7 +94,7 @@ public:
 	};
 	std::vector<ThreadData> threadData;
 
-	vkTools::ThreadPool threadPool;
+	vkTools::JobSystem jobSystem;
 
 	// Fence to wait for all command buffers to finish before
 	// presenting to the swap chain
@@ -125,7 +125,7 @@ public:
 #endif
 		srand(time(NULL));
 
-		threadPool.setThreadCount(numThreads);
+		jobSystem.setThreadCount(numThreads);
 
 		numObjectsPerThread = 512 / numThreads;
 	}
@@ -388,16 +388,19 @@ public:
 		updateSecondaryCommandBuffer(inheritanceInfo);
 		commandBuffers.push_back(secondaryCommandBuffer);
 
-		// Add a job to the thread's queue for each object to be rendered
-		for (uint32_t t = 0; t < numThreads; t++)
+		// One job per thread data block, as its command pool must not be used concurrently
+		vkTools::JobHandle renderJob = jobSystem.parallelFor(numThreads, 1, [=](uint32_t begin, uint32_t end)
 		{
-			for (uint32_t i = 0; i < numObjectsPerThread; i++)
+			for (uint32_t t = begin; t < end; t++)
 			{
-				threadPool.threads[t]->addJob([=] { threadRenderCode(t, i, inheritanceInfo); });
+				for (uint32_t i = 0; i < numObjectsPerThread; i++)
+				{
+					threadRenderCode(t, i, inheritanceInfo);
+				}
 			}
-		}
+		});
 
-		threadPool.wait();
+		jobSystem.wait(renderJob);
 
 		// Only submit if object is within the current view frustum
 		for (uint32_t t = 0; t < numThreads; t++)
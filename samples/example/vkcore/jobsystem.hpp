@@ -0,0 +1,612 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <algorithm>
+#include <cstdint>
+#include <cassert>
+
+namespace vkTools
+{
+	class JobSystem;
+
+	// A single unit of work
+	// The callable is stored inline in the job when it fits, so scheduling a job
+	// does not allocate (jobs themselves are recycled through per-worker free lists)
+	struct Job
+	{
+		static const size_t STORAGE_SIZE = 64;
+		static const uint32_t MAX_DEPENDENCIES = 8;
+
+		// Links a job into the list of jobs waiting on one of its dependencies
+		struct Edge
+		{
+			Job* dependent;
+			Edge* next;
+		};
+
+		void(*invoke)(Job*);
+		void(*destroy)(Job*);
+		Job* parent;
+		// 1 for the job itself plus 1 for every unfinished child job
+		std::atomic<int32_t> unfinished;
+		// Number of unfinished dependencies (plus 1 while the job is being set up)
+		std::atomic<int32_t> blockers;
+		// Number of handles plus 1 held by the job system until the job has finished
+		std::atomic<int32_t> refs;
+		// Jobs waiting on this job, set to closedEdge() once this job has finished
+		std::atomic<Edge*> dependents;
+		Edge edges[MAX_DEPENDENCIES];
+		Job* nextFree;
+		typename std::aligned_storage<STORAGE_SIZE, 16>::type storage;
+
+		static Edge* closedEdge()
+		{
+			static Edge closed = { nullptr, nullptr };
+			return &closed;
+		}
+	};
+
+	// Reference counted handle to a scheduled job
+	// Can be waited on or passed as a dependency of other jobs
+	class JobHandle
+	{
+	public:
+		JobHandle() : job(nullptr), system(nullptr) {}
+		JobHandle(const JobHandle& other) : job(other.job), system(other.system) { if (job) job->refs.fetch_add(1); }
+		JobHandle(JobHandle&& other) : job(other.job), system(other.system) { other.job = nullptr; }
+		~JobHandle() { reset(); }
+
+		JobHandle& operator=(JobHandle other)
+		{
+			std::swap(job, other.job);
+			std::swap(system, other.system);
+			return *this;
+		}
+
+		// Returns true if the handle refers to a job
+		bool valid() const { return job != nullptr; }
+
+		// Returns true once the job and all of its children have finished
+		bool finished() const { return job == nullptr || job->unfinished.load(std::memory_order_acquire) == 0; }
+
+		// Releases the reference to the job
+		inline void reset();
+
+	private:
+		friend class JobSystem;
+		JobHandle(Job* job, JobSystem* system) : job(job), system(system) { job->refs.fetch_add(1); }
+
+		Job* job;
+		JobSystem* system;
+	};
+
+	// Chase-Lev work stealing deque
+	// Only the owning worker pushes and pops (LIFO, at the bottom), any thread may steal (FIFO, at the top)
+	class WorkStealingQueue
+	{
+	public:
+		static const int64_t CAPACITY = 4096;
+
+		WorkStealingQueue() : top(0), bottom(0)
+		{
+			for (auto& job : jobs)
+			{
+				job.store(nullptr, std::memory_order_relaxed);
+			}
+		}
+
+		// Returns false if the queue is full
+		bool push(Job* job)
+		{
+			int64_t b = bottom.load(std::memory_order_relaxed);
+			int64_t t = top.load(std::memory_order_acquire);
+			if (b - t >= CAPACITY)
+			{
+				return false;
+			}
+			jobs[b & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+			bottom.store(b + 1, std::memory_order_release);
+			return true;
+		}
+
+		Job* pop()
+		{
+			int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+			bottom.store(b, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t t = top.load(std::memory_order_relaxed);
+			if (t > b)
+			{
+				// Empty
+				bottom.store(b + 1, std::memory_order_relaxed);
+				return nullptr;
+			}
+			Job* job = jobs[b & (CAPACITY - 1)].load(std::memory_order_relaxed);
+			if (t == b)
+			{
+				// Last job, race against thieves for it
+				if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				{
+					job = nullptr;
+				}
+				bottom.store(b + 1, std::memory_order_relaxed);
+			}
+			return job;
+		}
+
+		Job* steal()
+		{
+			int64_t t = top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t b = bottom.load(std::memory_order_acquire);
+			if (t >= b)
+			{
+				return nullptr;
+			}
+			Job* job = jobs[t & (CAPACITY - 1)].load(std::memory_order_relaxed);
+			if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				// Lost the race against another thief or the owner
+				return nullptr;
+			}
+			return job;
+		}
+
+	private:
+		std::atomic<int64_t> top;
+		std::atomic<int64_t> bottom;
+		std::atomic<Job*> jobs[CAPACITY];
+	};
+
+	// Work stealing job system
+	// Every worker thread owns a lock-free deque; idle workers steal from the others.
+	// Jobs scheduled from threads that are not workers of this system (e.g. the main thread)
+	// go to a shared injection queue. Threads waiting on a job help executing jobs meanwhile.
+	class JobSystem
+	{
+	public:
+		// Creates a job system with the given number of worker threads
+		// (0 = one less than the number of hardware threads, at least one)
+		explicit JobSystem(uint32_t threadCount = 0) : stopping(false), queuedJobs(0), sleepingWorkers(0), externalFreeJobs(nullptr)
+		{
+			setThreadCount(threadCount);
+		}
+
+		~JobSystem()
+		{
+			stopWorkers();
+			for (auto job : allJobs)
+			{
+				delete job;
+			}
+		}
+
+		// Sets the number of worker threads
+		// Must not be called while jobs are in flight
+		void setThreadCount(uint32_t count)
+		{
+			stopWorkers();
+			if (count == 0)
+			{
+				count = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+			}
+			stopping = false;
+			workers.clear();
+			for (uint32_t i = 0; i < count; i++)
+			{
+				workers.push_back(std::unique_ptr<Worker>(new Worker()));
+			}
+			for (uint32_t i = 0; i < count; i++)
+			{
+				workers[i]->thread = std::thread(&JobSystem::workerLoop, this, i);
+			}
+		}
+
+		uint32_t getThreadCount() const
+		{
+			return (uint32_t)workers.size();
+		}
+
+		// Schedules a callable (void()) for execution
+		template<typename F>
+		JobHandle run(F&& function)
+		{
+			return run(std::forward<F>(function), nullptr, 0);
+		}
+
+		// Schedules a callable (void()) that starts once all the given jobs have finished
+		template<typename F>
+		JobHandle run(F&& function, const JobHandle* dependencies, uint32_t dependencyCount)
+		{
+			assert(dependencyCount <= Job::MAX_DEPENDENCIES);
+			Job* job = createJob(std::forward<F>(function), nullptr);
+			JobHandle handle(job, this);
+
+			job->blockers.store(dependencyCount + 1, std::memory_order_relaxed);
+			for (uint32_t i = 0; i < dependencyCount; i++)
+			{
+				Job* dependency = dependencies[i].job;
+				if (!dependency || !addDependent(dependency, &job->edges[i], job))
+				{
+					job->blockers.fetch_sub(1);
+				}
+			}
+			if (job->blockers.fetch_sub(1) == 1)
+			{
+				schedule(job);
+			}
+			return handle;
+		}
+
+		// Splits [0, count) into ranges of at most grainSize elements and calls
+		// function(begin, end) for every range in parallel
+		// Ranges are split recursively by the workers themselves, so scheduling
+		// a large loop does not funnel every job through the calling thread
+		// The returned handle finishes once all ranges have been processed
+		template<typename F>
+		JobHandle parallelFor(uint32_t count, uint32_t grainSize, F function)
+		{
+			grainSize = std::max(grainSize, 1u);
+			Job* root = createJob([] {}, nullptr);
+			JobHandle handle(root, this);
+			if (count > 0)
+			{
+				spawnRange(root, 0, count, grainSize, function);
+			}
+			// The root itself has nothing to run
+			root->destroy(root);
+			finish(root);
+			return handle;
+		}
+
+		// Waits for the job to finish, executing other jobs in the meantime
+		void wait(const JobHandle& handle)
+		{
+			while (!handle.finished())
+			{
+				if (Job* job = findJob())
+				{
+					execute(job);
+				}
+				else
+				{
+					std::this_thread::yield();
+				}
+			}
+		}
+
+	private:
+		friend class JobHandle;
+
+		struct Worker
+		{
+			WorkStealingQueue queue;
+			Job* freeJobs = nullptr;
+			std::thread thread;
+		};
+
+		std::vector<std::unique_ptr<Worker>> workers;
+		bool stopping;
+
+		// Jobs scheduled by threads that are not workers of this system
+		std::deque<Job*> injectedJobs;
+		std::mutex injectedMutex;
+
+		// Idle workers sleep until jobs are queued
+		std::atomic<int32_t> queuedJobs;
+		std::atomic<int32_t> sleepingWorkers;
+		std::mutex sleepMutex;
+		std::condition_variable sleepCondition;
+
+		// Jobs released by threads that are not workers of this system, and every job ever allocated
+		Job* externalFreeJobs;
+		std::vector<Job*> allJobs;
+		std::mutex allocMutex;
+
+		static JobSystem*& currentSystem()
+		{
+			static thread_local JobSystem* system = nullptr;
+			return system;
+		}
+
+		static uint32_t& currentWorker()
+		{
+			static thread_local uint32_t worker = 0;
+			return worker;
+		}
+
+		// Returns the calling thread's worker, or nullptr if it is not a worker of this system
+		Worker* localWorker()
+		{
+			return (currentSystem() == this) ? workers[currentWorker()].get() : nullptr;
+		}
+
+		template<typename F>
+		static void invokeInline(Job* job) { (*reinterpret_cast<F*>(&job->storage))(); }
+		template<typename F>
+		static void destroyInline(Job* job) { reinterpret_cast<F*>(&job->storage)->~F(); }
+		template<typename F>
+		static void invokeHeap(Job* job) { (**reinterpret_cast<F**>(&job->storage))(); }
+		template<typename F>
+		static void destroyHeap(Job* job) { delete *reinterpret_cast<F**>(&job->storage); }
+
+		template<typename F>
+		static void store(Job* job, F&& function, std::true_type)
+		{
+			typedef typename std::decay<F>::type Callable;
+			new (&job->storage) Callable(std::forward<F>(function));
+			job->invoke = &invokeInline<Callable>;
+			job->destroy = &destroyInline<Callable>;
+		}
+
+		template<typename F>
+		static void store(Job* job, F&& function, std::false_type)
+		{
+			// Too large for the inline storage
+			typedef typename std::decay<F>::type Callable;
+			*reinterpret_cast<Callable**>(&job->storage) = new Callable(std::forward<F>(function));
+			job->invoke = &invokeHeap<Callable>;
+			job->destroy = &destroyHeap<Callable>;
+		}
+
+		template<typename F>
+		Job* createJob(F&& function, Job* parent)
+		{
+			typedef typename std::decay<F>::type Callable;
+			typedef std::integral_constant<bool, sizeof(Callable) <= Job::STORAGE_SIZE && std::alignment_of<Callable>::value <= 16> FitsInline;
+
+			Job* job = allocateJob();
+			store(job, std::forward<F>(function), FitsInline());
+			job->parent = parent;
+			job->unfinished.store(1, std::memory_order_relaxed);
+			job->blockers.store(0, std::memory_order_relaxed);
+			job->refs.store(1, std::memory_order_relaxed);
+			job->dependents.store(nullptr, std::memory_order_relaxed);
+			return job;
+		}
+
+		Job* allocateJob()
+		{
+			Worker* worker = localWorker();
+			if (worker && worker->freeJobs)
+			{
+				Job* job = worker->freeJobs;
+				worker->freeJobs = job->nextFree;
+				return job;
+			}
+			std::lock_guard<std::mutex> lock(allocMutex);
+			if (externalFreeJobs)
+			{
+				Job* job = externalFreeJobs;
+				externalFreeJobs = job->nextFree;
+				return job;
+			}
+			Job* job = new Job();
+			allJobs.push_back(job);
+			return job;
+		}
+
+		void releaseJob(Job* job)
+		{
+			if (job->refs.fetch_sub(1) != 1)
+			{
+				return;
+			}
+			Worker* worker = localWorker();
+			if (worker)
+			{
+				job->nextFree = worker->freeJobs;
+				worker->freeJobs = job;
+			}
+			else
+			{
+				std::lock_guard<std::mutex> lock(allocMutex);
+				job->nextFree = externalFreeJobs;
+				externalFreeJobs = job;
+			}
+		}
+
+		// Adds a job to the list of jobs waiting on the dependency
+		// Returns false if the dependency has already finished
+		bool addDependent(Job* dependency, Job::Edge* edge, Job* dependent)
+		{
+			edge->dependent = dependent;
+			Job::Edge* head = dependency->dependents.load();
+			do
+			{
+				if (head == Job::closedEdge())
+				{
+					return false;
+				}
+				edge->next = head;
+			} while (!dependency->dependents.compare_exchange_weak(head, edge));
+			return true;
+		}
+
+		void schedule(Job* job)
+		{
+			queuedJobs.fetch_add(1);
+			Worker* worker = localWorker();
+			if (worker)
+			{
+				if (!worker->queue.push(job))
+				{
+					// Queue is full, run the job right away
+					queuedJobs.fetch_sub(1);
+					execute(job);
+					return;
+				}
+			}
+			else
+			{
+				std::lock_guard<std::mutex> lock(injectedMutex);
+				injectedJobs.push_back(job);
+			}
+			if (sleepingWorkers.load() > 0)
+			{
+				std::lock_guard<std::mutex> lock(sleepMutex);
+				sleepCondition.notify_one();
+			}
+		}
+
+		Job* findJob()
+		{
+			Job* job = nullptr;
+			Worker* worker = localWorker();
+			if (worker)
+			{
+				job = worker->queue.pop();
+			}
+			if (!job)
+			{
+				std::lock_guard<std::mutex> lock(injectedMutex);
+				if (!injectedJobs.empty())
+				{
+					job = injectedJobs.front();
+					injectedJobs.pop_front();
+				}
+			}
+			if (!job && !workers.empty())
+			{
+				// Steal, starting at a different victim for every thread
+				size_t count = workers.size();
+				size_t start = std::hash<std::thread::id>()(std::this_thread::get_id()) % count;
+				for (size_t i = 0; i < count && !job; i++)
+				{
+					Worker* victim = workers[(start + i) % count].get();
+					if (victim != worker)
+					{
+						job = victim->queue.steal();
+					}
+				}
+			}
+			if (job)
+			{
+				queuedJobs.fetch_sub(1);
+			}
+			return job;
+		}
+
+		template<typename F>
+		void spawnRange(Job* root, uint32_t begin, uint32_t end, uint32_t grainSize, const F& function)
+		{
+			root->unfinished.fetch_add(1);
+			schedule(createJob([this, root, begin, end, grainSize, function] { splitRange(root, begin, end, grainSize, function); }, root));
+		}
+
+		template<typename F>
+		void splitRange(Job* root, uint32_t begin, uint32_t end, uint32_t grainSize, const F& function)
+		{
+			// Hand off the upper halves to other workers, process what is left here
+			while (end - begin > grainSize)
+			{
+				uint32_t middle = begin + (end - begin) / 2;
+				spawnRange(root, middle, end, grainSize, function);
+				end = middle;
+			}
+			function(begin, end);
+		}
+
+		void execute(Job* job)
+		{
+			job->invoke(job);
+			job->destroy(job);
+			finish(job);
+		}
+
+		void finish(Job* job)
+		{
+			if (job->unfinished.fetch_sub(1, std::memory_order_acq_rel) != 1)
+			{
+				return;
+			}
+			// Release the jobs that were waiting on this one
+			Job::Edge* edge = job->dependents.exchange(Job::closedEdge());
+			while (edge)
+			{
+				Job::Edge* next = edge->next;
+				Job* dependent = edge->dependent;
+				if (dependent->blockers.fetch_sub(1) == 1)
+				{
+					schedule(dependent);
+				}
+				edge = next;
+			}
+			if (job->parent)
+			{
+				finish(job->parent);
+			}
+			releaseJob(job);
+		}
+
+		void workerLoop(uint32_t index)
+		{
+			currentSystem() = this;
+			currentWorker() = index;
+			while (true)
+			{
+				if (Job* job = findJob())
+				{
+					execute(job);
+					continue;
+				}
+				std::unique_lock<std::mutex> lock(sleepMutex);
+				sleepingWorkers.fetch_add(1);
+				sleepCondition.wait(lock, [this] { return queuedJobs.load() > 0 || stopping; });
+				sleepingWorkers.fetch_sub(1);
+				if (stopping)
+				{
+					break;
+				}
+			}
+			currentSystem() = nullptr;
+		}
+
+		void stopWorkers()
+		{
+			{
+				std::lock_guard<std::mutex> lock(sleepMutex);
+				stopping = true;
+				sleepCondition.notify_all();
+			}
+			for (auto& worker : workers)
+			{
+				if (worker->thread.joinable())
+				{
+					worker->thread.join();
+				}
+			}
+			// Jobs recycled by the stopped workers go back to the shared free list
+			std::lock_guard<std::mutex> lock(allocMutex);
+			for (auto& worker : workers)
+			{
+				while (worker->freeJobs)
+				{
+					Job* job = worker->freeJobs;
+					worker->freeJobs = job->nextFree;
+					job->nextFree = externalFreeJobs;
+					externalFreeJobs = job;
+				}
+			}
+		}
+	};
+
+	inline void JobHandle::reset()
+	{
+		if (job)
+		{
+			system->releaseJob(job);
+			job = nullptr;
+		}
+	}
+}
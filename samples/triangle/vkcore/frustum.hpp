@@ -2,6 +2,7 @@
 #include <array>
 #include <math.h>
 #include <glm/glm.hpp>
+#include "frustumculling.hpp"
 
 namespace vkTools
 {
@@ -91,5 +92,18 @@ namespace vkTools
 			}
 			return true;
 		}
+
+		// Culls a batch of spheres stored as one array per component, see cullSpheres
+		void checkSpheres(const float* x, const float* y, const float* z, const float* radius, uint32_t count, uint8_t* visible, uint8_t* planeCache = nullptr)
+		{
+			cullSpheres(reinterpret_cast<const float(*)[4]>(planes.data()), x, y, z, radius, count, visible, planeCache);
+		}
+
+		// Culls a batch of axis-aligned boxes stored as one array per component, see cullBoxes
+		void checkBoxes(const float* minX, const float* minY, const float* minZ, const float* maxX, const float* maxY, const float* maxZ,
+			uint32_t count, uint8_t* visible, uint8_t* planeCache = nullptr)
+		{
+			cullBoxes(reinterpret_cast<const float(*)[4]>(planes.data()), minX, minY, minZ, maxX, maxY, maxZ, count, visible, planeCache);
+		}
 	};
 }
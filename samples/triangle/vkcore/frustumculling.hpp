@@ -0,0 +1,230 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define VKTOOLS_CULL_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VKTOOLS_CULL_SSE
+#endif
+
+namespace vkTools
+{
+	// Batched culling of bounding volumes against the six planes of a frustum
+	// The planes are given as (normal.x, normal.y, normal.z, distance) with the normals
+	// pointing into the frustum, so a point p is inside a plane when dot(normal, p) + distance >= 0
+	// The volumes are passed as one array per component (structure of arrays), and the result
+	// is a bitmask with bit (i & 7) of visible[i >> 3] set if volume i is not entirely outside
+	// of one of the planes; (count + 7) / 8 bytes are written
+	// The optional plane cache holds one byte per volume, initialized to zero, in which the index
+	// of the plane that last culled the volume is kept: that plane is tested first on the next
+	// call, which rejects most invisible volumes with a single test when the view changes smoothly
+	namespace culling
+	{
+		// Eight lanes of floats, in one AVX register or two SSE registers
+#if defined(VKTOOLS_CULL_AVX)
+		struct Float8
+		{
+			__m256 v;
+		};
+
+		inline Float8 load(const float* p) { Float8 r = { _mm256_loadu_ps(p) }; return r; }
+		inline Float8 splat(float f) { Float8 r = { _mm256_set1_ps(f) }; return r; }
+		inline Float8 add(Float8 a, Float8 b) { Float8 r = { _mm256_add_ps(a.v, b.v) }; return r; }
+		inline Float8 madd(Float8 a, Float8 b, Float8 c) { Float8 r = { _mm256_add_ps(_mm256_mul_ps(a.v, b.v), c.v) }; return r; }
+		inline uint32_t negative(Float8 a) { return (uint32_t)_mm256_movemask_ps(_mm256_cmp_ps(a.v, _mm256_setzero_ps(), _CMP_LT_OQ)); }
+#elif defined(VKTOOLS_CULL_SSE)
+		struct Float8
+		{
+			__m128 lo;
+			__m128 hi;
+		};
+
+		inline Float8 load(const float* p) { Float8 r = { _mm_loadu_ps(p), _mm_loadu_ps(p + 4) }; return r; }
+		inline Float8 splat(float f) { Float8 r = { _mm_set1_ps(f), _mm_set1_ps(f) }; return r; }
+		inline Float8 add(Float8 a, Float8 b) { Float8 r = { _mm_add_ps(a.lo, b.lo), _mm_add_ps(a.hi, b.hi) }; return r; }
+		inline Float8 madd(Float8 a, Float8 b, Float8 c)
+		{
+			Float8 r = { _mm_add_ps(_mm_mul_ps(a.lo, b.lo), c.lo), _mm_add_ps(_mm_mul_ps(a.hi, b.hi), c.hi) };
+			return r;
+		}
+		inline uint32_t negative(Float8 a)
+		{
+			__m128 zero = _mm_setzero_ps();
+			return (uint32_t)(_mm_movemask_ps(_mm_cmplt_ps(a.lo, zero)) | (_mm_movemask_ps(_mm_cmplt_ps(a.hi, zero)) << 4));
+		}
+#else
+		struct Float8
+		{
+			float v[8];
+		};
+
+		inline Float8 load(const float* p) { Float8 r; for (int i = 0; i < 8; i++) r.v[i] = p[i]; return r; }
+		inline Float8 splat(float f) { Float8 r; for (int i = 0; i < 8; i++) r.v[i] = f; return r; }
+		inline Float8 add(Float8 a, Float8 b) { for (int i = 0; i < 8; i++) a.v[i] += b.v[i]; return a; }
+		inline Float8 madd(Float8 a, Float8 b, Float8 c) { for (int i = 0; i < 8; i++) a.v[i] = a.v[i] * b.v[i] + c.v[i]; return a; }
+		inline uint32_t negative(Float8 a) { uint32_t m = 0; for (int i = 0; i < 8; i++) m |= (a.v[i] < 0.0f ? 1u : 0u) << i; return m; }
+#endif
+
+		// Signed distance of the points to a plane, plus an offset (the sphere radius)
+		inline Float8 distance(const float plane[4], Float8 x, Float8 y, Float8 z, Float8 offset)
+		{
+			Float8 d = madd(x, splat(plane[0]), add(splat(plane[3]), offset));
+			d = madd(y, splat(plane[1]), d);
+			return madd(z, splat(plane[2]), d);
+		}
+
+		// Distance of the volumes to their own cached planes; the planes differ per lane
+		inline Float8 cachedDistance(const float planes[6][4], const uint8_t* cache, Float8 x, Float8 y, Float8 z, Float8 offset)
+		{
+			alignas(32) float nx[8], ny[8], nz[8], nw[8];
+			for (int i = 0; i < 8; i++)
+			{
+				const float* plane = planes[cache[i] < 6 ? cache[i] : 0];
+				nx[i] = plane[0];
+				ny[i] = plane[1];
+				nz[i] = plane[2];
+				nw[i] = plane[3];
+			}
+			Float8 d = madd(x, load(nx), add(load(nw), offset));
+			d = madd(y, load(ny), d);
+			return madd(z, load(nz), d);
+		}
+
+		// Tests eight volumes against all planes, skipping those already rejected, and returns the visibility bits
+		// distances(plane) returns the signed distances of the eight volumes to the given plane
+		template <typename Distances>
+		inline uint8_t test(uint32_t rejected, uint8_t* cache, Distances distances)
+		{
+			for (uint32_t p = 0; p < 6 && rejected != 0xff; p++)
+			{
+				uint32_t outside = negative(distances(p)) & ~rejected;
+				if (cache)
+				{
+					for (uint32_t bits = outside, i = 0; bits != 0; bits >>= 1, i++)
+					{
+						if (bits & 1)
+							cache[i] = (uint8_t)p;
+					}
+				}
+				rejected |= outside;
+			}
+			return (uint8_t)~rejected;
+		}
+
+		// Culls a single volume, for the tail of an array
+		inline bool testOne(const float planes[6][4], uint8_t* cache, float x, float y, float z, float offset)
+		{
+			uint32_t first = (cache && *cache < 6) ? *cache : 0;
+			for (uint32_t i = 0; i < 6; i++)
+			{
+				uint32_t p = (first + i) % 6;
+				if (planes[p][0] * x + planes[p][1] * y + planes[p][2] * z + planes[p][3] + offset < 0.0f)
+				{
+					if (cache)
+						*cache = (uint8_t)p;
+					return false;
+				}
+			}
+			return true;
+		}
+	}
+
+	// Culls bounding spheres given their centers and radii
+	inline void cullSpheres(const float planes[6][4], const float* x, const float* y, const float* z, const float* radius,
+		uint32_t count, uint8_t* visible, uint8_t* planeCache = nullptr)
+	{
+		using namespace culling;
+
+		uint32_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			Float8 cx = load(x + i);
+			Float8 cy = load(y + i);
+			Float8 cz = load(z + i);
+			Float8 r = load(radius + i);
+			uint8_t* cache = planeCache ? planeCache + i : nullptr;
+
+			uint32_t rejected = cache ? negative(cachedDistance(planes, cache, cx, cy, cz, r)) : 0;
+			visible[i >> 3] = test(rejected, cache, [&](uint32_t p) { return distance(planes[p], cx, cy, cz, r); });
+		}
+
+		if (i < count)
+		{
+			uint8_t bits = 0;
+			for (uint32_t j = 0; i + j < count; j++)
+			{
+				if (testOne(planes, planeCache ? planeCache + i + j : nullptr, x[i + j], y[i + j], z[i + j], radius[i + j]))
+					bits |= (uint8_t)(1 << j);
+			}
+			visible[i >> 3] = bits;
+		}
+	}
+
+	// Culls axis-aligned bounding boxes given their minimum and maximum corners
+	// Each plane is tested against the corner of the box furthest along its normal
+	inline void cullBoxes(const float planes[6][4], const float* minX, const float* minY, const float* minZ,
+		const float* maxX, const float* maxY, const float* maxZ, uint32_t count, uint8_t* visible, uint8_t* planeCache = nullptr)
+	{
+		using namespace culling;
+
+		const Float8 zero = splat(0.0f);
+		uint32_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			Float8 lx = load(minX + i), ly = load(minY + i), lz = load(minZ + i);
+			Float8 hx = load(maxX + i), hy = load(maxY + i), hz = load(maxZ + i);
+			auto corners = [&](uint32_t p)
+			{
+				return distance(planes[p], planes[p][0] >= 0.0f ? hx : lx, planes[p][1] >= 0.0f ? hy : ly, planes[p][2] >= 0.0f ? hz : lz, zero);
+			};
+			uint8_t* cache = planeCache ? planeCache + i : nullptr;
+
+			uint32_t rejected = 0;
+			if (cache)
+			{
+				// The furthest corner differs per lane when the cached planes do
+				alignas(32) float px[8], py[8], pz[8];
+				for (int j = 0; j < 8; j++)
+				{
+					const float* plane = planes[cache[j] < 6 ? cache[j] : 0];
+					px[j] = plane[0] >= 0.0f ? maxX[i + j] : minX[i + j];
+					py[j] = plane[1] >= 0.0f ? maxY[i + j] : minY[i + j];
+					pz[j] = plane[2] >= 0.0f ? maxZ[i + j] : minZ[i + j];
+				}
+				rejected = negative(cachedDistance(planes, cache, load(px), load(py), load(pz), zero));
+			}
+			visible[i >> 3] = test(rejected, cache, corners);
+		}
+
+		if (i < count)
+		{
+			uint8_t bits = 0;
+			for (uint32_t j = 0; i + j < count; j++)
+			{
+				uint32_t k = i + j;
+				uint8_t* cache = planeCache ? planeCache + k : nullptr;
+				uint32_t first = (cache && *cache < 6) ? *cache : 0;
+				bool inside = true;
+				for (uint32_t n = 0; n < 6 && inside; n++)
+				{
+					uint32_t p = (first + n) % 6;
+					float px = planes[p][0] >= 0.0f ? maxX[k] : minX[k];
+					float py = planes[p][1] >= 0.0f ? maxY[k] : minY[k];
+					float pz = planes[p][2] >= 0.0f ? maxZ[k] : minZ[k];
+					if (planes[p][0] * px + planes[p][1] * py + planes[p][2] * pz + planes[p][3] < 0.0f)
+					{
+						if (cache)
+							*cache = (uint8_t)p;
+						inside = false;
+					}
+				}
+				if (inside)
+					bits |= (uint8_t)(1 << j);
+			}
+			visible[i >> 3] = bits;
+		}
+	}
+}